@@ -0,0 +1,580 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include "spinlock.h"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <assert.h>
+
+namespace nc::base {
+
+/**
+ * A least-recently-used cache which keeps its entries in a contiguous slab of nodes.
+ * The nodes are linked into an intrusive doubly-linked ring by their indices and are looked up via a flat
+ * open-addressing index of node indices with linear probing. Once the slab has grown to its capacity, inserting
+ * neither allocates nor deallocates anything besides what the keys and the values do themselves.
+ * The capacity is set at runtime. Optionally, the entries can carry weights, e.g. their sizes in bytes, and the
+ * cache then also evicts the least recently used entries while the total weight exceeds its limit.
+ * Not thread-safe, see ShardedLRUCache for that.
+ */
+template <class _Key, class _Value, class _Hash = std::hash<_Key>, class _KeyEqual = std::equal_to<_Key>>
+class FlatLRUCache
+{
+public:
+    /**
+     * _max_size is the maximum amount of entries, must be positive.
+     * _max_weight is the maximum total weight of the entries, zero means no limit.
+     */
+    explicit FlatLRUCache(size_t _max_size, size_t _max_weight = 0);
+    FlatLRUCache(const FlatLRUCache &) = default;
+    FlatLRUCache(FlatLRUCache &&_rhs) noexcept;
+    ~FlatLRUCache() = default;
+
+    bool empty() const noexcept;
+    size_t size() const noexcept;
+    size_t max_size() const noexcept;
+    size_t weight() const noexcept;
+    size_t max_weight() const noexcept;
+
+    void clear() noexcept;
+
+    /**
+     * Associates _value with _key and makes it the most recent, replacing the previous value if any.
+     * May evict other values in the process if the cache is already at max_size() or exceeds max_weight().
+     * O(1).
+     */
+    void insert(_Key _key, _Value _value, size_t _weight = 0);
+
+    /**
+     * Returns 1 if there is a value associated with _key, or 0 otherwise.
+     * Does not change LRU order.
+     * O(1).
+     */
+    size_t count(const _Key &_key) const noexcept;
+
+    /**
+     * Checks whether there is a value corresponding to _key. If there is - makes it the most
+     * recent and returns a pointer to the value. Otherwise, returns nullptr.
+     * The pointer stays valid until the next modification of the cache.
+     * O(1).
+     */
+    _Value *find(const _Key &_key) noexcept;
+
+    /**
+     * Checks whether there is a value corresponding to _key. If there is - makes it the most
+     * recent and returns a reference to the value. Otherwise, throws an exception.
+     * O(1).
+     */
+    _Value &at(const _Key &_key);
+
+    /**
+     * Checks whether there is a value corresponding to _key. If there is - makes it the most
+     * recent and returns a reference to the value. Otherwise, creates a (_key, Value{}) pair,
+     * inserts it to the front and returns a references to the value.
+     * May evict another value in the process if cache is already at max_size().
+     * O(1).
+     */
+    _Value &operator[](const _Key &_key);
+
+    /**
+     * Removes the value associated with _key, returns 1 if there was one, or 0 otherwise.
+     * O(1).
+     */
+    size_t erase(const _Key &_key) noexcept;
+
+    FlatLRUCache &operator=(const FlatLRUCache &) = default;
+    FlatLRUCache &operator=(FlatLRUCache &&_rhs) noexcept;
+
+private:
+    using Index = uint32_t;
+    static constexpr Index npos = std::numeric_limits<Index>::max();
+
+    struct Node {
+        std::optional<std::pair<_Key, _Value>> kv; // empty while the node is in the free list
+        size_t hash = 0;
+        size_t weight = 0;
+        Index prev = npos;
+        Index next = npos; // links the free list as well
+    };
+
+    size_t hash(const _Key &_key) const noexcept;
+    size_t home(size_t _hash) const noexcept;
+    size_t lookup(const _Key &_key, size_t _hash) const noexcept; // position in m_Table or npos
+    void grow_table_if_needed();
+    void place(Index _node);
+    void erase_at(size_t _position) noexcept;
+    Index emplace(_Key &&_key, _Value &&_value, size_t _hash, size_t _weight);
+    void evict_if_needed(Index _keep);
+    void unlink(Index _node) noexcept;
+    void link_front(Index _node) noexcept;
+    void make_front(Index _node) noexcept;
+
+    std::vector<Node> m_Nodes;
+    std::vector<Index> m_Table; // indices of the nodes, npos for the empty positions, power of two in size
+    size_t m_Size = 0;
+    size_t m_Weight = 0;
+    size_t m_MaxSize;
+    size_t m_MaxWeight;
+    Index m_Head = npos; // the most recent node, its prev is the least recent one
+    Index m_Free = npos;
+    [[no_unique_address]] _Hash m_Hasher;
+    [[no_unique_address]] _KeyEqual m_Equal;
+};
+
+/**
+ * A thread-safe least-recently-used cache split into independently locked FlatLRUCache shards, picked by the hashes
+ * of the keys. The recency order and the limits are maintained per shard.
+ * The values are given out by copies, since a reference could be invalidated by another thread at any moment.
+ */
+template <class _Key,
+          class _Value,
+          size_t _Shards = 16,
+          class _Hash = std::hash<_Key>,
+          class _KeyEqual = std::equal_to<_Key>>
+class ShardedLRUCache
+{
+public:
+    explicit ShardedLRUCache(size_t _max_size, size_t _max_weight = 0);
+
+    size_t size() const noexcept;
+    size_t weight() const noexcept;
+
+    void clear() noexcept;
+
+    void insert(_Key _key, _Value _value, size_t _weight = 0);
+
+    size_t count(const _Key &_key) const noexcept;
+
+    /**
+     * Returns a copy of the value associated with _key and makes it the most recent, or nullopt.
+     */
+    std::optional<_Value> get(const _Key &_key);
+
+    size_t erase(const _Key &_key) noexcept;
+
+private:
+    static_assert(_Shards > 0);
+    struct Shard {
+        explicit Shard(size_t _max_size, size_t _max_weight);
+        mutable spinlock lock;
+        FlatLRUCache<_Key, _Value, _Hash, _KeyEqual> cache;
+    };
+    template <size_t... _I>
+    static std::array<Shard, _Shards> make_shards(size_t _max_size, size_t _max_weight, std::index_sequence<_I...>);
+    Shard &shard(const _Key &_key) const noexcept;
+
+    mutable std::array<Shard, _Shards> m_Shards;
+    [[no_unique_address]] _Hash m_Hasher;
+};
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::FlatLRUCache(size_t _max_size, size_t _max_weight)
+    : m_MaxSize(_max_size), m_MaxWeight(_max_weight)
+{
+    assert(_max_size > 0 && _max_size < npos / 2);
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::FlatLRUCache(FlatLRUCache &&_rhs) noexcept
+    : m_Nodes(std::move(_rhs.m_Nodes)), m_Table(std::move(_rhs.m_Table)), m_Size(_rhs.m_Size),
+      m_Weight(_rhs.m_Weight), m_MaxSize(_rhs.m_MaxSize), m_MaxWeight(_rhs.m_MaxWeight), m_Head(_rhs.m_Head),
+      m_Free(_rhs.m_Free), m_Hasher(std::move(_rhs.m_Hasher)), m_Equal(std::move(_rhs.m_Equal))
+{
+    _rhs.clear();
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+FlatLRUCache<_Key, _Value, _Hash, _KeyEqual> &
+FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::operator=(FlatLRUCache &&_rhs) noexcept
+{
+    if( this == &_rhs )
+        return *this;
+
+    m_Nodes = std::move(_rhs.m_Nodes);
+    m_Table = std::move(_rhs.m_Table);
+    m_Size = _rhs.m_Size;
+    m_Weight = _rhs.m_Weight;
+    m_MaxSize = _rhs.m_MaxSize;
+    m_MaxWeight = _rhs.m_MaxWeight;
+    m_Head = _rhs.m_Head;
+    m_Free = _rhs.m_Free;
+    m_Hasher = std::move(_rhs.m_Hasher);
+    m_Equal = std::move(_rhs.m_Equal);
+    _rhs.clear();
+    return *this;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+bool FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::empty() const noexcept
+{
+    return m_Size == 0;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::size() const noexcept
+{
+    return m_Size;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::max_size() const noexcept
+{
+    return m_MaxSize;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::weight() const noexcept
+{
+    return m_Weight;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::max_weight() const noexcept
+{
+    return m_MaxWeight;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::clear() noexcept
+{
+    m_Nodes.clear();
+    m_Table.clear();
+    m_Size = 0;
+    m_Weight = 0;
+    m_Head = npos;
+    m_Free = npos;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::insert(_Key _key, _Value _value, size_t _weight)
+{
+    const size_t key_hash = hash(_key);
+    if( const size_t position = lookup(_key, key_hash); position != npos ) {
+        Node &node = m_Nodes[m_Table[position]];
+        node.kv->second = std::move(_value);
+        m_Weight = m_Weight - node.weight + _weight;
+        node.weight = _weight;
+        make_front(m_Table[position]);
+        evict_if_needed(m_Table[position]);
+    }
+    else {
+        evict_if_needed(npos);
+        evict_if_needed(emplace(std::move(_key), std::move(_value), key_hash, _weight));
+    }
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::count(const _Key &_key) const noexcept
+{
+    return lookup(_key, hash(_key)) != npos ? 1 : 0;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+_Value *FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::find(const _Key &_key) noexcept
+{
+    const size_t position = lookup(_key, hash(_key));
+    if( position == npos )
+        return nullptr;
+    make_front(m_Table[position]);
+    return &m_Nodes[m_Table[position]].kv->second;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+_Value &FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::at(const _Key &_key)
+{
+    if( _Value *value = find(_key) )
+        return *value;
+
+    throw std::out_of_range("FlatLRUCache::at(const _Key &_key): invalid key");
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+_Value &FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::operator[](const _Key &_key)
+{
+    if( _Value *value = find(_key) )
+        return *value;
+
+    evict_if_needed(npos);
+    const Index node = emplace(_Key(_key), _Value{}, hash(_key), 0);
+    return m_Nodes[node].kv->second;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::erase(const _Key &_key) noexcept
+{
+    const size_t position = lookup(_key, hash(_key));
+    if( position == npos )
+        return 0;
+    erase_at(position);
+    return 1;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::hash(const _Key &_key) const noexcept
+{
+    return m_Hasher(_key);
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::home(size_t _hash) const noexcept
+{
+    // Fibonacci hashing - the upper bits of the product are well mixed even if the hash itself is not,
+    // e.g. std::hash of an integer
+    assert(m_Table.size() >= 2);
+    const int bits = std::countr_zero(m_Table.size());
+    return static_cast<size_t>((static_cast<uint64_t>(_hash) * 0x9E3779B97F4A7C15ULL) >> (64 - bits));
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+size_t FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::lookup(const _Key &_key, size_t _hash) const noexcept
+{
+    if( m_Table.empty() )
+        return npos;
+    const size_t mask = m_Table.size() - 1;
+    for( size_t position = home(_hash);; position = (position + 1) & mask ) {
+        const Index index = m_Table[position];
+        if( index == npos )
+            return npos;
+        const Node &node = m_Nodes[index];
+        if( node.hash == _hash && m_Equal(node.kv->first, _key) )
+            return position;
+    }
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::grow_table_if_needed()
+{
+    // keep the load factor at or below 1/2, so that the probe sequences stay short
+    if( (m_Size + 1) * 2 <= m_Table.size() )
+        return;
+
+    m_Table.assign(std::max(size_t(16), m_Table.size() * 2), npos);
+    for( size_t index = 0; index != m_Nodes.size(); ++index )
+        if( m_Nodes[index].kv )
+            place(static_cast<Index>(index));
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::place(Index _node)
+{
+    const size_t mask = m_Table.size() - 1;
+    size_t position = home(m_Nodes[_node].hash);
+    while( m_Table[position] != npos )
+        position = (position + 1) & mask;
+    m_Table[position] = _node;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::erase_at(size_t _position) noexcept
+{
+    const Index index = m_Table[_position];
+    Node &node = m_Nodes[index];
+    unlink(index);
+    m_Weight -= node.weight;
+    --m_Size;
+    node.kv.reset();
+    node.weight = 0;
+    node.next = m_Free;
+    m_Free = index;
+
+    // backward shift deletion - pull the following entries of the probe sequence into the gap, unless that would
+    // move an entry before its home position, so the lookups never need tombstones
+    const size_t mask = m_Table.size() - 1;
+    size_t gap = _position;
+    for( size_t position = (gap + 1) & mask; m_Table[position] != npos; position = (position + 1) & mask ) {
+        const size_t position_home = home(m_Nodes[m_Table[position]].hash);
+        if( ((position - position_home) & mask) >= ((position - gap) & mask) ) {
+            m_Table[gap] = m_Table[position];
+            gap = position;
+        }
+    }
+    m_Table[gap] = npos;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+typename FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::Index
+FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::emplace(_Key &&_key, _Value &&_value, size_t _hash, size_t _weight)
+{
+    grow_table_if_needed();
+
+    Index index = m_Free;
+    if( index != npos ) {
+        m_Free = m_Nodes[index].next;
+    }
+    else {
+        index = static_cast<Index>(m_Nodes.size());
+        m_Nodes.emplace_back();
+    }
+
+    // the pair is constructed anew rather than assigned to, so that keys referring to their own storage stay valid
+    Node &node = m_Nodes[index];
+    node.kv.emplace(std::move(_key), std::move(_value));
+    node.hash = _hash;
+    node.weight = _weight;
+    link_front(index);
+    place(index);
+    ++m_Size;
+    m_Weight += _weight;
+    return index;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::evict_if_needed(Index _keep)
+{
+    // with _keep == npos makes room for one more entry, otherwise fits the limits while keeping the _keep node
+    const size_t max_size = _keep == npos ? m_MaxSize - 1 : m_MaxSize;
+    while( m_Head != npos ) {
+        const bool over_size = m_Size > max_size;
+        const bool over_weight = m_MaxWeight != 0 && m_Weight > m_MaxWeight;
+        if( !over_size && !over_weight )
+            break;
+        const Index least_recent = m_Nodes[m_Head].prev;
+        if( least_recent == _keep )
+            break;
+        erase_at(lookup(m_Nodes[least_recent].kv->first, m_Nodes[least_recent].hash));
+    }
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::unlink(Index _node) noexcept
+{
+    Node &node = m_Nodes[_node];
+    if( node.next == _node ) {
+        m_Head = npos;
+    }
+    else {
+        m_Nodes[node.prev].next = node.next;
+        m_Nodes[node.next].prev = node.prev;
+        if( m_Head == _node )
+            m_Head = node.next;
+    }
+    node.prev = node.next = npos;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::link_front(Index _node) noexcept
+{
+    Node &node = m_Nodes[_node];
+    if( m_Head == npos ) {
+        node.prev = node.next = _node;
+    }
+    else {
+        Node &head = m_Nodes[m_Head];
+        node.next = m_Head;
+        node.prev = head.prev;
+        m_Nodes[head.prev].next = _node;
+        head.prev = _node;
+    }
+    m_Head = _node;
+}
+
+template <class _Key, class _Value, class _Hash, class _KeyEqual>
+void FlatLRUCache<_Key, _Value, _Hash, _KeyEqual>::make_front(Index _node) noexcept
+{
+    if( m_Head == _node )
+        return;
+    unlink(_node);
+    link_front(_node);
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::Shard::Shard(size_t _max_size, size_t _max_weight)
+    : cache(_max_size, _max_weight)
+{
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+template <size_t... _I>
+std::array<typename ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::Shard, _Shards>
+ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::make_shards(size_t _max_size,
+                                                                       size_t _max_weight,
+                                                                       std::index_sequence<_I...>)
+{
+    return {((void)_I, Shard{_max_size, _max_weight})...};
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::ShardedLRUCache(size_t _max_size, size_t _max_weight)
+    : m_Shards(make_shards((_max_size + _Shards - 1) / _Shards,
+                           (_max_weight + _Shards - 1) / _Shards,
+                           std::make_index_sequence<_Shards>{}))
+{
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+typename ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::Shard &
+ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::shard(const _Key &_key) const noexcept
+{
+    // mixed differently than in FlatLRUCache, so that the keys of a shard still spread over its table
+    const uint64_t hash = static_cast<uint64_t>(m_Hasher(_key)) * 0xC2B2AE3D27D4EB4FULL;
+    return m_Shards[static_cast<size_t>(hash >> 32) % _Shards];
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+size_t ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::size() const noexcept
+{
+    size_t size = 0;
+    for( auto &shard : m_Shards )
+        size += call_locked(shard.lock, [&] { return shard.cache.size(); });
+    return size;
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+size_t ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::weight() const noexcept
+{
+    size_t weight = 0;
+    for( auto &shard : m_Shards )
+        weight += call_locked(shard.lock, [&] { return shard.cache.weight(); });
+    return weight;
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+void ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::clear() noexcept
+{
+    for( auto &shard : m_Shards )
+        call_locked(shard.lock, [&] { shard.cache.clear(); });
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+void ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::insert(_Key _key, _Value _value, size_t _weight)
+{
+    Shard &s = shard(_key);
+    auto lock = std::lock_guard{s.lock};
+    s.cache.insert(std::move(_key), std::move(_value), _weight);
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+size_t ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::count(const _Key &_key) const noexcept
+{
+    Shard &s = shard(_key);
+    auto lock = std::lock_guard{s.lock};
+    return s.cache.count(_key);
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+std::optional<_Value> ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::get(const _Key &_key)
+{
+    Shard &s = shard(_key);
+    auto lock = std::lock_guard{s.lock};
+    if( _Value *value = s.cache.find(_key) )
+        return *value;
+    return std::nullopt;
+}
+
+template <class _Key, class _Value, size_t _Shards, class _Hash, class _KeyEqual>
+size_t ShardedLRUCache<_Key, _Value, _Shards, _Hash, _KeyEqual>::erase(const _Key &_key) noexcept
+{
+    Shard &s = shard(_key);
+    auto lock = std::lock_guard{s.lock};
+    return s.cache.erase(_key);
+}
+
+} // namespace nc::base
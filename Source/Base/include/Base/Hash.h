@@ -1,4 +1,4 @@
-// Copyright (C) 2014-2019 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <vector>
@@ -21,6 +21,9 @@ public:
         SHA2_256,
         SHA2_384,
         SHA2_512,
+        CRC32C, // Castagnoli, uses the CPU's CRC instructions when available
+        XXH64,  // xxHash, 64-bit, seed 0
+        BLAKE3, // 256-bit, large pieces of data are hashed by several threads
     };
     
     Hash(Mode _mode);
@@ -32,7 +35,7 @@ public:
     
 private:
     Mode    m_Mode;
-    uint8_t m_Stuff[1024];
+    alignas(16) uint8_t m_Stuff[2048];
 };
 
 }
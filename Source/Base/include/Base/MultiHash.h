@@ -0,0 +1,28 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include "Hash.h"
+#include <span>
+#include <vector>
+#include <stdint.h>
+
+namespace nc::base {
+
+// Calculates several digests of the same data in a single pass.
+// Large pieces of data are fed into all the algorithms concurrently, so the slowest of them sets the pace instead of
+// their sum.
+class MultiHash
+{
+public:
+    MultiHash(std::span<const Hash::Mode> _modes);
+
+    MultiHash &Feed(const void *_data, size_t _size);
+
+    // Returns the digests in the order of the modes passed to the constructor
+    std::vector<std::vector<uint8_t>> Final();
+
+private:
+    std::vector<Hash> m_Hashes;
+};
+
+} // namespace nc::base
@@ -0,0 +1,86 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nc::base {
+
+// A compact storage of the relative paths gathered while scanning directory trees.
+// Each node refers to its parent by index and to its name by a slice of a single shared character buffer, so that
+// appending a node costs no separate allocation and a path is composed in O(depth) without recursion.
+// Directories are supposed to be stored with a trailing slash in their names, so that the composed path is a plain
+// concatenation of the names from the root down to the node.
+// A parent must be appended before its children, thus the reversed order of the indices always visits children
+// before their parents, e.g. the depth-first post-order of a tree appended during a depth-first scan.
+class PathTree
+{
+public:
+    using Index = uint32_t;
+    static constexpr Index npos = std::numeric_limits<Index>::max();
+
+    // Appends a node with the specified name under the specified parent, npos means a root node.
+    // Returns the index of the new node.
+    Index push_back(std::string_view _name, Index _parent = npos);
+
+    // Returns the amount of nodes, O(1).
+    size_t size() const noexcept;
+
+    bool empty() const noexcept;
+
+    // Returns the name of the node, valid until the next push_back().
+    std::string_view name(Index _node) const noexcept;
+
+    // Returns the parent of the node, or npos for a root node.
+    Index parent(Index _node) const noexcept;
+
+    // Composes the path of the node into _buffer, replacing its contents, and returns a view of it.
+    // Reusing the same buffer for a sequence of paths avoids allocating them one by one.
+    std::string_view path(Index _node, std::string &_buffer) const;
+
+    // Composes the path of the node.
+    std::string path(Index _node) const;
+
+    // Returns the amount of memory used by the tree.
+    size_t memory_usage() const noexcept;
+
+    void reserve(size_t _nodes, size_t _characters);
+
+    void clear() noexcept;
+
+private:
+    struct Node {
+        uint64_t name_offset; // position of the name in m_Names
+        uint32_t name_length;
+        Index parent;
+    };
+
+    std::vector<Node> m_Nodes;
+    std::string m_Names; // the names are not null-terminated
+};
+
+inline size_t PathTree::size() const noexcept
+{
+    return m_Nodes.size();
+}
+
+inline bool PathTree::empty() const noexcept
+{
+    return m_Nodes.empty();
+}
+
+inline std::string_view PathTree::name(Index _node) const noexcept
+{
+    const Node &node = m_Nodes[_node];
+    return {m_Names.data() + node.name_offset, node.name_length};
+}
+
+inline PathTree::Index PathTree::parent(Index _node) const noexcept
+{
+    return m_Nodes[_node].parent;
+}
+
+} // namespace nc::base
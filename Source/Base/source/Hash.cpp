@@ -1,14 +1,460 @@
-// Copyright (C) 2014-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <Base/Hash.h>
+#include <Base/dispatch_cpp.h>
 #include <CommonCrypto/CommonDigest.h>
 #include <zlib.h>
 #include <assert.h>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#if defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#elif defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
 
 namespace nc::base {
 
 #pragma clang diagnostic push
 #pragma clang diagnostic ignored "-Wdeprecated-declarations"
 
+namespace {
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CRC32C
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// Tables for the slicing-by-8 software fallback, reflected polynomial 0x1EDC6F41
+constexpr std::array<std::array<uint32_t, 256>, 8> MakeCRC32CTables() noexcept
+{
+    std::array<std::array<uint32_t, 256>, 8> tables{};
+    for( uint32_t i = 0; i < 256; ++i ) {
+        uint32_t crc = i;
+        for( int bit = 0; bit < 8; ++bit )
+            crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+        tables[0][i] = crc;
+    }
+    for( uint32_t i = 0; i < 256; ++i )
+        for( size_t t = 1; t < 8; ++t )
+            tables[t][i] = (tables[t - 1][i] >> 8) ^ tables[0][tables[t - 1][i] & 0xFF];
+    return tables;
+}
+
+constexpr auto g_CRC32CTables = MakeCRC32CTables();
+
+uint32_t CRC32CSoftware(uint32_t _crc, const uint8_t *_p, size_t _n) noexcept
+{
+    const auto &t = g_CRC32CTables;
+    for( ; _n >= 8; _p += 8, _n -= 8 ) {
+        uint32_t lo, hi;
+        std::memcpy(&lo, _p, 4);
+        std::memcpy(&hi, _p + 4, 4);
+        lo ^= _crc;
+        _crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+               t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for( ; _n != 0; ++_p, --_n )
+        _crc = (_crc >> 8) ^ t[0][(_crc ^ *_p) & 0xFF];
+    return _crc;
+}
+
+#if defined(__ARM_FEATURE_CRC32)
+
+uint32_t CRC32CUpdate(uint32_t _crc, const uint8_t *_p, size_t _n) noexcept
+{
+    for( ; _n >= 8; _p += 8, _n -= 8 ) {
+        uint64_t v;
+        std::memcpy(&v, _p, 8);
+        _crc = __crc32cd(_crc, v);
+    }
+    for( ; _n != 0; ++_p, --_n )
+        _crc = __crc32cb(_crc, *_p);
+    return _crc;
+}
+
+#elif defined(__x86_64__)
+
+__attribute__((target("sse4.2"))) uint32_t CRC32CSSE42(uint32_t _crc, const uint8_t *_p, size_t _n) noexcept
+{
+    uint64_t crc = _crc;
+    for( ; _n >= 8; _p += 8, _n -= 8 ) {
+        uint64_t v;
+        std::memcpy(&v, _p, 8);
+        crc = _mm_crc32_u64(crc, v);
+    }
+    for( ; _n != 0; ++_p, --_n )
+        crc = _mm_crc32_u8(static_cast<uint32_t>(crc), *_p);
+    return static_cast<uint32_t>(crc);
+}
+
+uint32_t CRC32CUpdate(uint32_t _crc, const uint8_t *_p, size_t _n) noexcept
+{
+    static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    return has_sse42 ? CRC32CSSE42(_crc, _p, _n) : CRC32CSoftware(_crc, _p, _n);
+}
+
+#else
+
+uint32_t CRC32CUpdate(uint32_t _crc, const uint8_t *_p, size_t _n) noexcept
+{
+    return CRC32CSoftware(_crc, _p, _n);
+}
+
+#endif
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// XXH64
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint64_t g_XXH64P1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t g_XXH64P2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t g_XXH64P3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t g_XXH64P4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t g_XXH64P5 = 0x27D4EB2F165667C5ULL;
+
+struct XXH64State {
+    uint64_t acc[4];
+    uint64_t total_length;
+    uint8_t buffer[32];
+    uint32_t buffered;
+};
+
+uint64_t XXH64Read64(const uint8_t *_p) noexcept
+{
+    uint64_t v;
+    std::memcpy(&v, _p, 8);
+    return v; // the digest is defined in terms of little-endian reads, which all supported CPUs are
+}
+
+uint32_t XXH64Read32(const uint8_t *_p) noexcept
+{
+    uint32_t v;
+    std::memcpy(&v, _p, 4);
+    return v;
+}
+
+uint64_t XXH64Round(uint64_t _acc, uint64_t _input) noexcept
+{
+    _acc += _input * g_XXH64P2;
+    _acc = std::rotl(_acc, 31);
+    return _acc * g_XXH64P1;
+}
+
+uint64_t XXH64Merge(uint64_t _acc, uint64_t _value) noexcept
+{
+    _acc ^= XXH64Round(0, _value);
+    return _acc * g_XXH64P1 + g_XXH64P4;
+}
+
+void XXH64Init(XXH64State &_st) noexcept
+{
+    _st.acc[0] = g_XXH64P1 + g_XXH64P2;
+    _st.acc[1] = g_XXH64P2;
+    _st.acc[2] = 0;
+    _st.acc[3] = 0 - g_XXH64P1;
+    _st.total_length = 0;
+    _st.buffered = 0;
+}
+
+const uint8_t *XXH64Stripes(XXH64State &_st, const uint8_t *_p, const uint8_t *_end) noexcept
+{
+    for( ; _end - _p >= 32; _p += 32 ) {
+        _st.acc[0] = XXH64Round(_st.acc[0], XXH64Read64(_p));
+        _st.acc[1] = XXH64Round(_st.acc[1], XXH64Read64(_p + 8));
+        _st.acc[2] = XXH64Round(_st.acc[2], XXH64Read64(_p + 16));
+        _st.acc[3] = XXH64Round(_st.acc[3], XXH64Read64(_p + 24));
+    }
+    return _p;
+}
+
+void XXH64Update(XXH64State &_st, const uint8_t *_p, size_t _n) noexcept
+{
+    const uint8_t *const end = _p + _n;
+    _st.total_length += _n;
+
+    if( _st.buffered + _n < 32 ) {
+        std::memcpy(_st.buffer + _st.buffered, _p, _n);
+        _st.buffered += static_cast<uint32_t>(_n);
+        return;
+    }
+
+    if( _st.buffered != 0 ) {
+        const size_t fill = 32 - _st.buffered;
+        std::memcpy(_st.buffer + _st.buffered, _p, fill);
+        XXH64Stripes(_st, _st.buffer, _st.buffer + 32);
+        _p += fill;
+        _st.buffered = 0;
+    }
+
+    _p = XXH64Stripes(_st, _p, end);
+    _st.buffered = static_cast<uint32_t>(end - _p);
+    std::memcpy(_st.buffer, _p, _st.buffered);
+}
+
+uint64_t XXH64Digest(const XXH64State &_st) noexcept
+{
+    uint64_t h;
+    if( _st.total_length >= 32 ) {
+        h = std::rotl(_st.acc[0], 1) + std::rotl(_st.acc[1], 7) + std::rotl(_st.acc[2], 12) +
+            std::rotl(_st.acc[3], 18);
+        for( const uint64_t acc : _st.acc )
+            h = XXH64Merge(h, acc);
+    }
+    else {
+        h = _st.acc[2] + g_XXH64P5; // acc[2] holds the seed until the first stripe
+    }
+    h += _st.total_length;
+
+    const uint8_t *p = _st.buffer;
+    const uint8_t *const end = _st.buffer + _st.buffered;
+    for( ; end - p >= 8; p += 8 ) {
+        h ^= XXH64Round(0, XXH64Read64(p));
+        h = std::rotl(h, 27) * g_XXH64P1 + g_XXH64P4;
+    }
+    if( end - p >= 4 ) {
+        h ^= static_cast<uint64_t>(XXH64Read32(p)) * g_XXH64P1;
+        h = std::rotl(h, 23) * g_XXH64P2 + g_XXH64P3;
+        p += 4;
+    }
+    for( ; p != end; ++p ) {
+        h ^= *p * g_XXH64P5;
+        h = std::rotl(h, 11) * g_XXH64P1;
+    }
+
+    h ^= h >> 33;
+    h *= g_XXH64P2;
+    h ^= h >> 29;
+    h *= g_XXH64P3;
+    h ^= h >> 32;
+    return h;
+}
+
+static_assert(sizeof(XXH64State) <= 2048);
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// BLAKE3
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+constexpr uint32_t g_BLAKE3IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+constexpr size_t g_BLAKE3Permutation[16] = {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8};
+constexpr size_t g_BLAKE3BlockLen = 64;
+constexpr size_t g_BLAKE3ChunkLen = 1024;
+constexpr uint32_t g_BLAKE3ChunkStart = 1;
+constexpr uint32_t g_BLAKE3ChunkEnd = 2;
+constexpr uint32_t g_BLAKE3Parent = 4;
+constexpr uint32_t g_BLAKE3Root = 8;
+
+// Chunks are hashed concurrently only when a single Feed() brings at least this many of them
+constexpr size_t g_BLAKE3ParallelMinChunks = 256;
+
+// Amount of chunks hashed by a single concurrent task
+constexpr size_t g_BLAKE3ChunksPerTask = 64;
+
+struct BLAKE3State {
+    uint32_t cv[8]; // chaining value of the current chunk
+    uint64_t chunk_counter;
+    uint8_t block[g_BLAKE3BlockLen]; // the last block of the current chunk is compressed only when more input comes
+    uint8_t block_len;
+    uint8_t blocks_compressed;
+    uint8_t stack_size;
+    uint32_t stack[54][8]; // chaining values of the complete subtrees, enough for 2^64 bytes
+};
+
+void BLAKE3G(uint32_t *_s, size_t _a, size_t _b, size_t _c, size_t _d, uint32_t _x, uint32_t _y) noexcept
+{
+    _s[_a] = _s[_a] + _s[_b] + _x;
+    _s[_d] = std::rotr(_s[_d] ^ _s[_a], 16);
+    _s[_c] = _s[_c] + _s[_d];
+    _s[_b] = std::rotr(_s[_b] ^ _s[_c], 12);
+    _s[_a] = _s[_a] + _s[_b] + _y;
+    _s[_d] = std::rotr(_s[_d] ^ _s[_a], 8);
+    _s[_c] = _s[_c] + _s[_d];
+    _s[_b] = std::rotr(_s[_b] ^ _s[_c], 7);
+}
+
+void BLAKE3Compress(const uint32_t _cv[8],
+                    const uint8_t _block[g_BLAKE3BlockLen],
+                    uint64_t _counter,
+                    uint32_t _block_len,
+                    uint32_t _flags,
+                    uint32_t _out[16]) noexcept
+{
+    uint32_t m[16];
+    std::memcpy(m, _block, sizeof(m)); // little-endian words, as everywhere else
+    uint32_t s[16] = {_cv[0],
+                      _cv[1],
+                      _cv[2],
+                      _cv[3],
+                      _cv[4],
+                      _cv[5],
+                      _cv[6],
+                      _cv[7],
+                      g_BLAKE3IV[0],
+                      g_BLAKE3IV[1],
+                      g_BLAKE3IV[2],
+                      g_BLAKE3IV[3],
+                      static_cast<uint32_t>(_counter),
+                      static_cast<uint32_t>(_counter >> 32),
+                      _block_len,
+                      _flags};
+    for( int round = 0; round < 7; ++round ) {
+        BLAKE3G(s, 0, 4, 8, 12, m[0], m[1]);
+        BLAKE3G(s, 1, 5, 9, 13, m[2], m[3]);
+        BLAKE3G(s, 2, 6, 10, 14, m[4], m[5]);
+        BLAKE3G(s, 3, 7, 11, 15, m[6], m[7]);
+        BLAKE3G(s, 0, 5, 10, 15, m[8], m[9]);
+        BLAKE3G(s, 1, 6, 11, 12, m[10], m[11]);
+        BLAKE3G(s, 2, 7, 8, 13, m[12], m[13]);
+        BLAKE3G(s, 3, 4, 9, 14, m[14], m[15]);
+        uint32_t permuted[16];
+        for( size_t i = 0; i < 16; ++i )
+            permuted[i] = m[g_BLAKE3Permutation[i]];
+        std::memcpy(m, permuted, sizeof(m));
+    }
+    for( size_t i = 0; i < 8; ++i ) {
+        _out[i] = s[i] ^ s[i + 8];
+        _out[i + 8] = s[i + 8] ^ _cv[i];
+    }
+}
+
+// Chaining value of a complete chunk which is known not to be the root
+void BLAKE3ChunkCV(const uint8_t *_chunk, uint64_t _counter, uint32_t _cv[8]) noexcept
+{
+    std::memcpy(_cv, g_BLAKE3IV, sizeof(g_BLAKE3IV));
+    for( size_t block = 0; block < g_BLAKE3ChunkLen / g_BLAKE3BlockLen; ++block ) {
+        const uint32_t flags = (block == 0 ? g_BLAKE3ChunkStart : 0) |
+                               (block + 1 == g_BLAKE3ChunkLen / g_BLAKE3BlockLen ? g_BLAKE3ChunkEnd : 0);
+        uint32_t out[16];
+        BLAKE3Compress(_cv, _chunk + block * g_BLAKE3BlockLen, _counter, g_BLAKE3BlockLen, flags, out);
+        std::memcpy(_cv, out, 8 * sizeof(uint32_t));
+    }
+}
+
+void BLAKE3ParentCV(const uint32_t _left[8], const uint32_t _right[8], uint32_t _flags, uint32_t _out[16]) noexcept
+{
+    uint8_t block[g_BLAKE3BlockLen];
+    std::memcpy(block, _left, 32);
+    std::memcpy(block + 32, _right, 32);
+    BLAKE3Compress(g_BLAKE3IV, block, 0, g_BLAKE3BlockLen, g_BLAKE3Parent | _flags, _out);
+}
+
+void BLAKE3Init(BLAKE3State &_st) noexcept
+{
+    std::memcpy(_st.cv, g_BLAKE3IV, sizeof(g_BLAKE3IV));
+    _st.chunk_counter = 0;
+    _st.block_len = 0;
+    _st.blocks_compressed = 0;
+    _st.stack_size = 0;
+}
+
+size_t BLAKE3ChunkLen(const BLAKE3State &_st) noexcept
+{
+    return _st.blocks_compressed * g_BLAKE3BlockLen + _st.block_len;
+}
+
+// Adds a chaining value of a complete chunk, merging the complete subtrees it finishes
+void BLAKE3PushChunkCV(BLAKE3State &_st, const uint32_t _cv[8], uint64_t _total_chunks) noexcept
+{
+    uint32_t cv[16];
+    std::memcpy(cv, _cv, 8 * sizeof(uint32_t));
+    for( ; (_total_chunks & 1) == 0; _total_chunks >>= 1 )
+        BLAKE3ParentCV(_st.stack[--_st.stack_size], cv, 0, cv);
+    std::memcpy(_st.stack[_st.stack_size++], cv, 8 * sizeof(uint32_t));
+}
+
+// Hashes as many complete chunks as possible concurrently, leaving at least one byte for the current chunk
+size_t BLAKE3ParallelChunks(BLAKE3State &_st, const uint8_t *_p, size_t _n)
+{
+    const size_t chunks = (_n - 1) / g_BLAKE3ChunkLen;
+    std::vector<std::array<uint32_t, 8>> cvs(chunks);
+    const size_t tasks = (chunks + g_BLAKE3ChunksPerTask - 1) / g_BLAKE3ChunksPerTask;
+    dispatch_apply(tasks, [&](size_t _task) {
+        const size_t first = _task * g_BLAKE3ChunksPerTask;
+        const size_t last = std::min(first + g_BLAKE3ChunksPerTask, chunks);
+        for( size_t i = first; i != last; ++i )
+            BLAKE3ChunkCV(_p + i * g_BLAKE3ChunkLen, _st.chunk_counter + i, cvs[i].data());
+    });
+    for( size_t i = 0; i != chunks; ++i )
+        BLAKE3PushChunkCV(_st, cvs[i].data(), _st.chunk_counter + i + 1);
+    _st.chunk_counter += chunks;
+    return chunks * g_BLAKE3ChunkLen;
+}
+
+void BLAKE3Update(BLAKE3State &_st, const uint8_t *_p, size_t _n)
+{
+    while( _n != 0 ) {
+        if( BLAKE3ChunkLen(_st) == g_BLAKE3ChunkLen ) {
+            // more input has come, so the current chunk isn't the root
+            uint32_t out[16];
+            BLAKE3Compress(_st.cv, _st.block, _st.chunk_counter, g_BLAKE3BlockLen, g_BLAKE3ChunkEnd, out);
+            BLAKE3PushChunkCV(_st, out, _st.chunk_counter + 1);
+            std::memcpy(_st.cv, g_BLAKE3IV, sizeof(g_BLAKE3IV));
+            _st.chunk_counter += 1;
+            _st.block_len = 0;
+            _st.blocks_compressed = 0;
+        }
+
+        if( BLAKE3ChunkLen(_st) == 0 && _n > g_BLAKE3ParallelMinChunks * g_BLAKE3ChunkLen ) {
+            const size_t consumed = BLAKE3ParallelChunks(_st, _p, _n);
+            _p += consumed;
+            _n -= consumed;
+        }
+
+        size_t take = std::min(g_BLAKE3ChunkLen - BLAKE3ChunkLen(_st), _n);
+        _n -= take;
+        while( take != 0 ) {
+            if( _st.block_len == g_BLAKE3BlockLen ) {
+                const uint32_t flags = _st.blocks_compressed == 0 ? g_BLAKE3ChunkStart : 0;
+                uint32_t out[16];
+                BLAKE3Compress(_st.cv, _st.block, _st.chunk_counter, g_BLAKE3BlockLen, flags, out);
+                std::memcpy(_st.cv, out, sizeof(_st.cv));
+                _st.blocks_compressed += 1;
+                _st.block_len = 0;
+            }
+            const size_t fill = std::min(g_BLAKE3BlockLen - _st.block_len, take);
+            std::memcpy(_st.block + _st.block_len, _p, fill);
+            _st.block_len += static_cast<uint8_t>(fill);
+            _p += fill;
+            take -= fill;
+        }
+    }
+}
+
+std::array<uint8_t, 32> BLAKE3Digest(const BLAKE3State &_st) noexcept
+{
+    // the output of the current chunk, which is turned into a parent output while walking up the stack
+    uint32_t cv[8];
+    uint8_t block[g_BLAKE3BlockLen] = {};
+    uint32_t block_len = _st.block_len;
+    uint32_t flags = g_BLAKE3ChunkEnd | (_st.blocks_compressed == 0 ? g_BLAKE3ChunkStart : 0);
+    uint64_t counter = _st.chunk_counter;
+    std::memcpy(cv, _st.cv, sizeof(cv));
+    std::memcpy(block, _st.block, _st.block_len);
+
+    for( size_t i = _st.stack_size; i != 0; --i ) {
+        uint32_t out[16];
+        BLAKE3Compress(cv, block, counter, block_len, flags, out);
+        std::memcpy(block, _st.stack[i - 1], 32);
+        std::memcpy(block + 32, out, 32);
+        std::memcpy(cv, g_BLAKE3IV, sizeof(cv));
+        block_len = g_BLAKE3BlockLen;
+        flags = g_BLAKE3Parent;
+        counter = 0;
+    }
+
+    uint32_t out[16];
+    BLAKE3Compress(cv, block, 0, block_len, flags | g_BLAKE3Root, out);
+    std::array<uint8_t, 32> digest;
+    std::memcpy(digest.data(), out, digest.size());
+    return digest;
+}
+
+static_assert(sizeof(BLAKE3State) <= 2048);
+
+} // namespace
+
 Hash::Hash(Mode _mode) : m_Mode(_mode)
 {
     switch( m_Mode ) {
@@ -42,6 +488,15 @@ Hash::Hash(Mode _mode) : m_Mode(_mode)
         case CRC32:
             *reinterpret_cast<uint32_t *>(m_Stuff) = static_cast<uint32_t>(crc32(0, 0, 0));
             break;
+        case CRC32C:
+            *reinterpret_cast<uint32_t *>(m_Stuff) = 0xFFFFFFFFu;
+            break;
+        case XXH64:
+            XXH64Init(*reinterpret_cast<XXH64State *>(m_Stuff));
+            break;
+        case BLAKE3:
+            BLAKE3Init(*reinterpret_cast<BLAKE3State *>(m_Stuff));
+            break;
         default:
             assert(0);
     }
@@ -87,6 +542,16 @@ Hash &Hash::Feed(const void *_data, size_t _size)
                                             reinterpret_cast<const unsigned char *>(_data),
                                             usize));
             break;
+        case CRC32C:
+            *reinterpret_cast<uint32_t *>(m_Stuff) = CRC32CUpdate(
+                *reinterpret_cast<uint32_t *>(m_Stuff), reinterpret_cast<const uint8_t *>(_data), _size);
+            break;
+        case XXH64:
+            XXH64Update(*reinterpret_cast<XXH64State *>(m_Stuff), reinterpret_cast<const uint8_t *>(_data), _size);
+            break;
+        case BLAKE3:
+            BLAKE3Update(*reinterpret_cast<BLAKE3State *>(m_Stuff), reinterpret_cast<const uint8_t *>(_data), _size);
+            break;
         default:
             assert(0);
     }
@@ -139,6 +604,24 @@ std::vector<uint8_t> Hash::Final()
         case Adler32:
         case CRC32:
             return std::vector<uint8_t>{m_Stuff[3], m_Stuff[2], m_Stuff[1], m_Stuff[0]};
+        case CRC32C: {
+            const uint32_t crc = ~*reinterpret_cast<uint32_t *>(m_Stuff);
+            return std::vector<uint8_t>{static_cast<uint8_t>(crc >> 24),
+                                        static_cast<uint8_t>(crc >> 16),
+                                        static_cast<uint8_t>(crc >> 8),
+                                        static_cast<uint8_t>(crc)};
+        }
+        case XXH64: {
+            const uint64_t h = XXH64Digest(*reinterpret_cast<const XXH64State *>(m_Stuff));
+            std::vector<uint8_t> r(8);
+            for( int i = 0; i < 8; ++i )
+                r[i] = static_cast<uint8_t>(h >> (56 - 8 * i));
+            return r;
+        }
+        case BLAKE3: {
+            const auto digest = BLAKE3Digest(*reinterpret_cast<const BLAKE3State *>(m_Stuff));
+            return std::vector<uint8_t>(digest.begin(), digest.end());
+        }
         default:
             assert(0);
     }
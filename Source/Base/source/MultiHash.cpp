@@ -0,0 +1,36 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include <Base/MultiHash.h>
+#include <Base/dispatch_cpp.h>
+
+namespace nc::base {
+
+// Smaller pieces are not worth the cost of dispatching
+static constexpr size_t g_ConcurrentFeedMinSize = 64 * 1024;
+
+MultiHash::MultiHash(std::span<const Hash::Mode> _modes)
+{
+    m_Hashes.reserve(_modes.size());
+    for( const auto mode : _modes )
+        m_Hashes.emplace_back(mode);
+}
+
+MultiHash &MultiHash::Feed(const void *_data, size_t _size)
+{
+    if( m_Hashes.size() > 1 && _size >= g_ConcurrentFeedMinSize )
+        dispatch_apply(m_Hashes.size(), [&](size_t _index) { m_Hashes[_index].Feed(_data, _size); });
+    else
+        for( auto &hash : m_Hashes )
+            hash.Feed(_data, _size);
+    return *this;
+}
+
+std::vector<std::vector<uint8_t>> MultiHash::Final()
+{
+    std::vector<std::vector<uint8_t>> digests;
+    digests.reserve(m_Hashes.size());
+    for( auto &hash : m_Hashes )
+        digests.emplace_back(hash.Final());
+    return digests;
+}
+
+} // namespace nc::base
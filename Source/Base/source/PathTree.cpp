@@ -0,0 +1,68 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include <Base/PathTree.h>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+
+namespace nc::base {
+
+static_assert(sizeof(PathTree::Index) == 4);
+
+PathTree::Index PathTree::push_back(std::string_view _name, Index _parent)
+{
+    if( _parent != npos && _parent >= m_Nodes.size() )
+        throw std::out_of_range("PathTree::push_back(): invalid parent");
+    if( m_Nodes.size() >= npos || _name.size() > std::numeric_limits<uint32_t>::max() )
+        throw std::length_error("PathTree::push_back(): too many nodes or a too long name");
+
+    const Node node{m_Names.size(), static_cast<uint32_t>(_name.size()), _parent};
+    m_Names.append(_name);
+    m_Nodes.emplace_back(node);
+    return static_cast<Index>(m_Nodes.size() - 1);
+}
+
+std::string_view PathTree::path(Index _node, std::string &_buffer) const
+{
+    assert(_node < m_Nodes.size());
+
+    // the first pass finds the length, the second one fills the buffer from its end
+    size_t length = 0;
+    for( Index index = _node; index != npos; index = m_Nodes[index].parent )
+        length += m_Nodes[index].name_length;
+
+    _buffer.resize(length);
+    char *position = _buffer.data() + length;
+    for( Index index = _node; index != npos; index = m_Nodes[index].parent ) {
+        const Node &node = m_Nodes[index];
+        position -= node.name_length;
+        std::memcpy(position, m_Names.data() + node.name_offset, node.name_length);
+    }
+    assert(position == _buffer.data());
+    return _buffer;
+}
+
+std::string PathTree::path(Index _node) const
+{
+    std::string buffer;
+    path(_node, buffer);
+    return buffer;
+}
+
+size_t PathTree::memory_usage() const noexcept
+{
+    return sizeof(*this) + m_Nodes.capacity() * sizeof(Node) + m_Names.capacity();
+}
+
+void PathTree::reserve(size_t _nodes, size_t _characters)
+{
+    m_Nodes.reserve(_nodes);
+    m_Names.reserve(_characters);
+}
+
+void PathTree::clear() noexcept
+{
+    m_Nodes.clear();
+    m_Names.clear();
+}
+
+} // namespace nc::base
@@ -0,0 +1,164 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include <Base/FlatLRUCache.h>
+#include <Base/LRUCache.h>
+#include "UnitTests_main.h"
+#include <random>
+#include <string>
+#include <thread>
+
+using nc::base::FlatLRUCache;
+using nc::base::LRUCache;
+using nc::base::ShardedLRUCache;
+
+#define PREFIX "FlatLRUCache "
+
+TEST_CASE(PREFIX "empty")
+{
+    FlatLRUCache<std::string, std::string> cache(32);
+    CHECK(cache.size() == 0);
+    CHECK(cache.max_size() == 32);
+    CHECK(cache.empty() == true);
+    CHECK(cache.find("a") == nullptr);
+}
+
+TEST_CASE(PREFIX "eviction")
+{
+    FlatLRUCache<std::string, std::string> cache(2);
+    cache["a"] = "A";
+    cache["b"] = "B";
+    cache["c"] = "C";
+    CHECK(cache.count("a") == 0);
+    CHECK(cache.count("b") == 1);
+    CHECK(cache.count("c") == 1);
+
+    CHECK(*cache.find("b") == "B");
+    cache.insert("a", "A");
+    CHECK(cache.count("a") == 1);
+    CHECK(cache.count("b") == 1);
+    CHECK(cache.count("c") == 0);
+    CHECK_THROWS_AS(cache.at("c"), std::out_of_range);
+}
+
+TEST_CASE(PREFIX "erase")
+{
+    FlatLRUCache<int, int> cache(3);
+    cache.insert(1, 10);
+    cache.insert(2, 20);
+    cache.insert(3, 30);
+    CHECK(cache.erase(2) == 1);
+    CHECK(cache.erase(2) == 0);
+    CHECK(cache.size() == 2);
+
+    // the freed node is reused without evicting anything
+    cache.insert(4, 40);
+    CHECK(cache.size() == 3);
+    CHECK(cache.at(1) == 10);
+    CHECK(cache.at(3) == 30);
+    CHECK(cache.at(4) == 40);
+}
+
+TEST_CASE(PREFIX "weights")
+{
+    FlatLRUCache<int, std::string> cache(100, 10);
+    cache.insert(1, "a", 4);
+    cache.insert(2, "b", 4);
+    CHECK(cache.weight() == 8);
+
+    cache.insert(3, "c", 4);
+    CHECK(cache.count(1) == 0);
+    CHECK(cache.weight() == 8);
+
+    // reweighing an existing entry evicts the others, but never the entry itself
+    cache.insert(3, "c", 20);
+    CHECK(cache.size() == 1);
+    CHECK(cache.weight() == 20);
+    CHECK(cache.at(3) == "c");
+
+    cache.erase(3);
+    CHECK(cache.weight() == 0);
+}
+
+TEST_CASE(PREFIX "copy and move")
+{
+    FlatLRUCache<std::string, std::string> cache(2);
+    cache["a"] = "A";
+    cache["b"] = "B";
+
+    FlatLRUCache<std::string, std::string> copy(cache);
+    CHECK(cache.size() == 2);
+    CHECK(copy["a"] == "A");
+    CHECK(copy["b"] == "B");
+
+    FlatLRUCache<std::string, std::string> copy2(std::move(cache));
+    CHECK(cache.empty() == true);
+    CHECK(copy2["a"] == "A");
+    CHECK(copy2["b"] == "B");
+
+    cache = copy2;
+    CHECK(copy2.size() == 2);
+    CHECK(cache["a"] == "A");
+    CHECK(cache["b"] == "B");
+
+    copy = std::move(copy2);
+    CHECK(copy2.empty() == true);
+    CHECK(copy["a"] == "A");
+    CHECK(copy["b"] == "B");
+}
+
+TEST_CASE(PREFIX "behaves as LRUCache")
+{
+    std::mt19937 rng(42);
+    LRUCache<int, int, 37> reference;
+    FlatLRUCache<int, int> cache(37);
+    for( int i = 0; i < 100'000; ++i ) {
+        const int key = static_cast<int>(rng() % 100);
+        switch( rng() % 3 ) {
+            case 0:
+                reference.insert(key, i);
+                cache.insert(key, i);
+                break;
+            case 1:
+                REQUIRE(reference.count(key) == cache.count(key));
+                break;
+            default:
+                REQUIRE(reference[key] == cache[key]);
+                break;
+        }
+        REQUIRE(reference.size() == cache.size());
+    }
+}
+
+TEST_CASE(PREFIX "big cache")
+{
+    const int limit = 1'000'000;
+    FlatLRUCache<int, int> cache(limit);
+    for( int i = 0; i < limit; ++i )
+        cache[i] = -1;
+    for( int i = limit - 1; i >= 0; --i ) {
+        if( cache[i] != -1 ) {
+            CHECK(cache[i] == -1);
+        }
+    }
+
+    cache[limit] = -1;
+    CHECK(cache.count(limit - 1) == 0);
+}
+
+TEST_CASE("ShardedLRUCache concurrent access")
+{
+    ShardedLRUCache<int, int> cache(1000);
+    std::vector<std::thread> threads;
+    for( int t = 0; t < 4; ++t )
+        threads.emplace_back([&cache, t] {
+            for( int i = 0; i < 100'000; ++i ) {
+                cache.insert(i * 4 + t, i);
+                if( auto value = cache.get(i * 4 + t) )
+                    CHECK(*value == i);
+            }
+        });
+    for( auto &thread : threads )
+        thread.join();
+    CHECK(cache.size() <= 1008); // the capacity is rounded up to the shards
+    CHECK(cache.get(399'999) == 99'999);
+    CHECK(cache.get(0) == std::nullopt);
+}
@@ -0,0 +1,91 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "UnitTests_main.h"
+#include "Hash.h"
+#include "MultiHash.h"
+#include <thread>
+
+// NB! disabled by default, include in the BaseUT to enable
+
+using nc::base::Hash;
+using nc::base::MultiHash;
+
+#define PREFIX "Hash PT "
+
+static std::vector<uint8_t> MakeData(size_t _size)
+{
+    std::vector<uint8_t> data(_size);
+    for( size_t i = 0; i < _size; ++i )
+        data[i] = static_cast<uint8_t>(i * 2654435761u >> 13);
+    return data;
+}
+
+TEST_CASE(PREFIX "Throughput per algorithm", "[!benchmark]")
+{
+    const auto data = MakeData(64 * 1024 * 1024);
+    const std::pair<const char *, Hash::Mode> modes[] = {{"Adler32", Hash::Adler32},
+                                                         {"CRC32", Hash::CRC32},
+                                                         {"CRC32C", Hash::CRC32C},
+                                                         {"XXH64", Hash::XXH64},
+                                                         {"MD5", Hash::MD5},
+                                                         {"SHA1-160", Hash::SHA1_160},
+                                                         {"SHA2-256", Hash::SHA2_256},
+                                                         {"SHA2-512", Hash::SHA2_512},
+                                                         {"BLAKE3", Hash::BLAKE3}};
+    for( const auto &[name, mode] : modes ) {
+        BENCHMARK(std::string(name) + ", 64MB")
+        {
+            return Hash(mode).Feed(data.data(), data.size()).Final();
+        };
+    }
+
+    // BLAKE3 fed by small pieces can't hash its chunks concurrently
+    BENCHMARK("BLAKE3, 64MB by 16KB")
+    {
+        Hash hash(Hash::BLAKE3);
+        for( size_t i = 0; i < data.size(); i += 16 * 1024 )
+            hash.Feed(data.data() + i, 16 * 1024);
+        return hash.Final();
+    };
+}
+
+TEST_CASE(PREFIX "Several digests in one pass", "[!benchmark]")
+{
+    const auto data = MakeData(64 * 1024 * 1024);
+    const Hash::Mode modes[] = {Hash::MD5, Hash::SHA2_256, Hash::CRC32};
+    BENCHMARK("MD5+SHA2-256+CRC32, one by one")
+    {
+        std::vector<std::vector<uint8_t>> digests;
+        for( const auto mode : modes )
+            digests.emplace_back(Hash(mode).Feed(data.data(), data.size()).Final());
+        return digests;
+    };
+    BENCHMARK("MD5+SHA2-256+CRC32, MultiHash")
+    {
+        return MultiHash(modes).Feed(data.data(), data.size()).Final();
+    };
+}
+
+TEST_CASE(PREFIX "Several files per thread count", "[!benchmark]")
+{
+    // 16 files of 4MB each, hashed the way the checksum sheet does it - every thread takes the next file
+    const auto data = MakeData(4 * 1024 * 1024);
+    constexpr size_t files = 16;
+    for( const auto mode : {Hash::SHA2_256, Hash::XXH64} ) {
+        for( const size_t threads : {1, 2, 4, 8} ) {
+            BENCHMARK(std::string(mode == Hash::XXH64 ? "XXH64" : "SHA2-256") + ", x" + std::to_string(threads))
+            {
+                std::atomic_size_t next = 0;
+                std::vector<std::thread> workers;
+                for( size_t i = 0; i < threads; ++i )
+                    workers.emplace_back([&] {
+                        while( next++ < files )
+                            Hash(mode).Feed(data.data(), data.size()).Final();
+                    });
+                for( auto &worker : workers )
+                    worker.join();
+                return next.load();
+            };
+        }
+    }
+}
@@ -1,5 +1,6 @@
-// Copyright (C) 2014-2019 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Hash.h"
+#include "MultiHash.h"
 #include "UnitTests_main.h"
 
 using nc::base::Hash;
@@ -30,4 +31,75 @@ TEST_CASE(PREFIX"check the hash results")
               "e3d9270a" );
     CHECK( Hash::Hex( Hash(Hash::CRC32).Feed(d.c_str(), d.size()).Final() ) ==
               "d3ec3da8" );
+    CHECK( Hash::Hex( Hash(Hash::CRC32C).Feed(d.c_str(), d.size()).Final() ) ==
+              "ffe6e1b7" );
+    CHECK( Hash::Hex( Hash(Hash::XXH64).Feed(d.c_str(), d.size()).Final() ) ==
+              "e72f5889bd14174c" );
+    CHECK( Hash::Hex( Hash(Hash::BLAKE3).Feed(d.c_str(), d.size()).Final() ) ==
+              "83a5b839969295169b35488e9f7dfbf761d9cfc3c64daf1713f53d5d7aafecc4" );
+}
+
+TEST_CASE(PREFIX"check the fast hashes against the reference values")
+{
+    const std::string check = "123456789";
+    CHECK( Hash::Hex( Hash(Hash::CRC32C).Feed(check.c_str(), check.size()).Final() ) == "e3069283" );
+    CHECK( Hash::Hex( Hash(Hash::CRC32C).Final() ) == "00000000" );
+    CHECK( Hash::Hex( Hash(Hash::XXH64).Final() ) == "ef46db3751d8e999" );
+    CHECK( Hash::Hex( Hash(Hash::XXH64).Feed("abc", 3).Final() ) == "44bc2cf5ad770999" );
+    CHECK( Hash::Hex( Hash(Hash::BLAKE3).Final() ) ==
+              "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262" );
+    CHECK( Hash::Hex( Hash(Hash::BLAKE3).Feed("abc", 3).Final() ) ==
+              "6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85" );
+}
+
+TEST_CASE(PREFIX"BLAKE3 gives the same result for any shape of its tree")
+{
+    std::vector<uint8_t> d(1024 * 1024);
+    for( size_t i = 0; i < d.size(); ++i )
+        d[i] = static_cast<uint8_t>(i % 251);
+    CHECK( Hash::Hex( Hash(Hash::BLAKE3).Feed(d.data(), 1024).Final() ) ==
+              "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7" );
+    CHECK( Hash::Hex( Hash(Hash::BLAKE3).Feed(d.data(), 3073).Final() ) ==
+              "7124b49501012f81cc7f11ca069ec9226cecb8a2c850cfe644e327d22d3e1cd3" );
+
+    // the whole megabyte is hashed by several threads, the pieces are hashed sequentially
+    const std::string whole = "74cb441fd087764ca9c3694da742ebe30cbeb3060a17009ca81825c7a8d10343";
+    CHECK( Hash::Hex( Hash(Hash::BLAKE3).Feed(d.data(), d.size()).Final() ) == whole );
+    Hash hash(Hash::BLAKE3);
+    for( size_t i = 0; i < d.size(); i += 1000 )
+        hash.Feed(d.data() + i, std::min(size_t(1000), d.size() - i));
+    CHECK( Hash::Hex( hash.Final() ) == whole );
+}
+
+TEST_CASE(PREFIX"feeding by pieces gives the same result")
+{
+    std::vector<uint8_t> d(100'000);
+    for( size_t i = 0; i < d.size(); ++i )
+        d[i] = static_cast<uint8_t>(i * 7);
+    for( auto mode : {Hash::CRC32C, Hash::XXH64, Hash::BLAKE3, Hash::MD5} ) {
+        const auto whole = Hash(mode).Feed(d.data(), d.size()).Final();
+        for( size_t piece : {1, 3, 31, 32, 33, 4096} ) {
+            Hash hash(mode);
+            for( size_t i = 0; i < d.size(); i += piece )
+                hash.Feed(d.data() + i, std::min(piece, d.size() - i));
+            CHECK( hash.Final() == whole );
+        }
+    }
+    CHECK( Hash::Hex( Hash(Hash::XXH64).Feed(d.data(), d.size()).Final() ) == "8791b9cbd6d6cd70" );
+    CHECK( Hash::Hex( Hash(Hash::CRC32C).Feed(d.data(), 1000).Final() ) == "79a16ae6" );
+}
+
+TEST_CASE(PREFIX"MultiHash gives the same digests as the separate hashes")
+{
+    std::vector<uint8_t> d(1'000'000);
+    for( size_t i = 0; i < d.size(); ++i )
+        d[i] = static_cast<uint8_t>(i * 13);
+    const Hash::Mode modes[] = {Hash::MD5, Hash::SHA2_256, Hash::CRC32, Hash::BLAKE3};
+    nc::base::MultiHash multi(modes);
+    multi.Feed(d.data(), 10);
+    multi.Feed(d.data() + 10, d.size() - 10);
+    const auto digests = multi.Final();
+    REQUIRE( digests.size() == std::size(modes) );
+    for( size_t i = 0; i < std::size(modes); ++i )
+        CHECK( digests[i] == Hash(modes[i]).Feed(d.data(), d.size()).Final() );
 }
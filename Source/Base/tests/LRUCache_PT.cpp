@@ -0,0 +1,106 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "UnitTests_main.h"
+#include "FlatLRUCache.h"
+#include "LRUCache.h"
+#include <random>
+#include <string>
+
+// NB! disabled by default, include in the BaseUT to enable
+
+using nc::base::FlatLRUCache;
+using nc::base::LRUCache;
+using nc::base::ShardedLRUCache;
+
+#define PREFIX "LRUCache PT "
+
+static std::vector<std::string> MakeKeys(size_t _count)
+{
+    std::vector<std::string> keys;
+    std::mt19937 rng(42);
+    for( size_t i = 0; i < _count; ++i )
+        keys.emplace_back("/Users/someone/Documents/Project/file" + std::to_string(rng()) + ".txt");
+    return keys;
+}
+
+// 3/4 of the accesses hit the cache of 4096 entries
+static constexpr size_t g_Capacity = 4096;
+static const std::vector<std::string> &Keys()
+{
+    [[clang::no_destroy]] static const auto keys = MakeKeys(g_Capacity * 4 / 3);
+    return keys;
+}
+
+TEST_CASE(PREFIX "Mixed lookups and insertions", "[!benchmark]")
+{
+    const auto &keys = Keys();
+
+    BENCHMARK("LRUCache")
+    {
+        LRUCache<std::string, int, g_Capacity> cache;
+        int sum = 0;
+        for( size_t i = 0; i < 100'000; ++i ) {
+            const auto &key = keys[(i * 7919) % keys.size()];
+            if( cache.count(key) )
+                sum += cache.at(key);
+            else
+                cache.insert(key, static_cast<int>(i));
+        }
+        return sum;
+    };
+
+    BENCHMARK("FlatLRUCache")
+    {
+        FlatLRUCache<std::string, int> cache(g_Capacity);
+        int sum = 0;
+        for( size_t i = 0; i < 100'000; ++i ) {
+            const auto &key = keys[(i * 7919) % keys.size()];
+            if( auto value = cache.find(key) )
+                sum += *value;
+            else
+                cache.insert(key, static_cast<int>(i));
+        }
+        return sum;
+    };
+
+    BENCHMARK("ShardedLRUCache")
+    {
+        ShardedLRUCache<std::string, int> cache(g_Capacity);
+        int sum = 0;
+        for( size_t i = 0; i < 100'000; ++i ) {
+            const auto &key = keys[(i * 7919) % keys.size()];
+            if( auto value = cache.get(key) )
+                sum += *value;
+            else
+                cache.insert(key, static_cast<int>(i));
+        }
+        return sum;
+    };
+}
+
+TEST_CASE(PREFIX "Hits only", "[!benchmark]")
+{
+    const auto &keys = Keys();
+    LRUCache<std::string, int, g_Capacity> lru;
+    FlatLRUCache<std::string, int> flat(g_Capacity);
+    for( size_t i = 0; i < g_Capacity; ++i ) {
+        lru.insert(keys[i], static_cast<int>(i));
+        flat.insert(keys[i], static_cast<int>(i));
+    }
+
+    BENCHMARK("LRUCache")
+    {
+        int sum = 0;
+        for( size_t i = 0; i < g_Capacity; ++i )
+            sum += lru.at(keys[(i * 7919) % g_Capacity]);
+        return sum;
+    };
+
+    BENCHMARK("FlatLRUCache")
+    {
+        int sum = 0;
+        for( size_t i = 0; i < g_Capacity; ++i )
+            sum += *flat.find(keys[(i * 7919) % g_Capacity]);
+        return sum;
+    };
+}
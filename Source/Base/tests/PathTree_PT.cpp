@@ -0,0 +1,82 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "UnitTests_main.h"
+#include "PathTree.h"
+#include "chained_strings.h"
+#include <string>
+
+// NB! disabled by default, include in the BaseUT to enable
+
+using nc::base::chained_strings;
+using nc::base::PathTree;
+
+#define PREFIX "PathTree PT "
+
+// Mimics a scan of ~1.1M entries: 5 levels of 10 nested directories with 10 files in each of the deepest ones
+static constexpr int g_Fanout = 10;
+static constexpr int g_Depth = 5;
+
+static void Scan(PathTree &_tree, PathTree::Index _parent, int _depth)
+{
+    for( int i = 0; i < g_Fanout; ++i ) {
+        if( _depth == g_Depth ) {
+            _tree.push_back("some file number " + std::to_string(i) + ".txt", _parent);
+        }
+        else {
+            const auto dir = _tree.push_back("directory " + std::to_string(i) + "/", _parent);
+            Scan(_tree, dir, _depth + 1);
+        }
+    }
+}
+
+static void Scan(chained_strings &_strings, const chained_strings::node *_parent, int _depth)
+{
+    for( int i = 0; i < g_Fanout; ++i ) {
+        if( _depth == g_Depth ) {
+            _strings.push_back("some file number " + std::to_string(i) + ".txt", _parent);
+        }
+        else {
+            _strings.push_back("directory " + std::to_string(i) + "/", _parent);
+            Scan(_strings, &_strings.back(), _depth + 1);
+        }
+    }
+}
+
+TEST_CASE(PREFIX "Scanning and composing 1M paths", "[!benchmark]")
+{
+    BENCHMARK("chained_strings, scan")
+    {
+        chained_strings strings;
+        Scan(strings, nullptr, 0);
+        return strings.size();
+    };
+
+    BENCHMARK("PathTree, scan")
+    {
+        PathTree tree;
+        Scan(tree, PathTree::npos, 0);
+        return tree.size();
+    };
+
+    chained_strings strings;
+    Scan(strings, nullptr, 0);
+    BENCHMARK("chained_strings, paths")
+    {
+        size_t length = 0;
+        for( const auto &node : strings )
+            length += node.to_str_with_pref().length();
+        return length;
+    };
+
+    PathTree tree;
+    Scan(tree, PathTree::npos, 0);
+    BENCHMARK("PathTree, paths")
+    {
+        size_t length = 0;
+        std::string buffer;
+        for( size_t i = tree.size(); i-- > 0; )
+            length += tree.path(static_cast<PathTree::Index>(i), buffer).length();
+        return length;
+    };
+    WARN("PathTree memory usage: " << tree.memory_usage() << " bytes for " << tree.size() << " nodes");
+}
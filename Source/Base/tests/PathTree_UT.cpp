@@ -0,0 +1,68 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include <Base/PathTree.h>
+#include "UnitTests_main.h"
+
+using nc::base::PathTree;
+
+#define PREFIX "PathTree "
+
+TEST_CASE(PREFIX "empty")
+{
+    PathTree tree;
+    CHECK(tree.empty());
+    CHECK(tree.size() == 0);
+}
+
+TEST_CASE(PREFIX "composes the paths")
+{
+    PathTree tree;
+    const auto root = tree.push_back("dir/");
+    const auto file = tree.push_back("file.txt", root);
+    const auto subdir = tree.push_back("a very long name of a subdirectory/", root);
+    const auto subfile = tree.push_back("x", subdir);
+    const auto other = tree.push_back("other");
+
+    CHECK(tree.size() == 5);
+    CHECK(tree.parent(root) == PathTree::npos);
+    CHECK(tree.parent(subfile) == subdir);
+    CHECK(tree.name(subdir) == "a very long name of a subdirectory/");
+    CHECK(tree.path(root) == "dir/");
+    CHECK(tree.path(file) == "dir/file.txt");
+    CHECK(tree.path(subfile) == "dir/a very long name of a subdirectory/x");
+    CHECK(tree.path(other) == "other");
+
+    std::string buffer = "some garbage which is longer than the path";
+    CHECK(tree.path(subdir, buffer) == "dir/a very long name of a subdirectory/");
+    CHECK(buffer == "dir/a very long name of a subdirectory/");
+    CHECK(tree.path(file, buffer) == "dir/file.txt");
+}
+
+TEST_CASE(PREFIX "empty names")
+{
+    PathTree tree;
+    const auto root = tree.push_back("");
+    const auto child = tree.push_back("a", root);
+    CHECK(tree.path(root).empty());
+    CHECK(tree.path(child) == "a");
+}
+
+TEST_CASE(PREFIX "reversed order visits children before parents")
+{
+    PathTree tree;
+    const auto a = tree.push_back("a/");
+    const auto b = tree.push_back("b/", a);
+    tree.push_back("c", b);
+    tree.push_back("d", a);
+    for( size_t i = tree.size(); i-- > 0; )
+        for( size_t j = 0; j < i; ++j )
+            CHECK(tree.parent(static_cast<PathTree::Index>(j)) != i);
+}
+
+TEST_CASE(PREFIX "rejects invalid parents")
+{
+    PathTree tree;
+    CHECK_THROWS_AS(tree.push_back("a", 0), std::out_of_range);
+    tree.push_back("a");
+    CHECK_THROWS_AS(tree.push_back("b", 1), std::out_of_range);
+    CHECK_NOTHROW(tree.push_back("b", 0));
+}
@@ -168,7 +168,8 @@ static std::vector<std::string> CommaSeparatedStrings(const nc::config::Config &
                                directoryAccessProvider:self.directoryAccessProvider
                                    contextMenuProvider:[self makePanelContextMenuProvider]
                                        nativeFSManager:self.nativeFSManager
-                                            nativeHost:self.nativeHost];
+                                            nativeHost:self.nativeHost
+                               directorySizeCalculator:self.directorySizeCalculator];
     auto actions_dispatcher = [[NCPanelControllerActionsDispatcher alloc] initWithController:panel
                                                                                andActionsMap:self.panelActionsMap];
     [panel setNextAttachedResponder:actions_dispatcher];
@@ -42,6 +42,8 @@ class FavoriteLocationsStorage;
 class ClosedPanelsHistory;
 class ExternalToolsStorage;
 class TagsStorage;
+class DirectorySizeCalculator;
+class FileNameIndexes;
 }
 
 namespace viewer {
@@ -138,6 +140,10 @@ class NativeHost;
 
 @property(nonatomic, readonly) nc::vfs::NativeHost &nativeHost;
 
+@property(nonatomic, readonly) nc::panel::DirectorySizeCalculator &directorySizeCalculator;
+
+@property(nonatomic, readonly) nc::panel::FileNameIndexes &fileNameIndexes;
+
 @property(nonatomic, readonly) const std::shared_ptr<nc::vfs::NativeHost> &nativeHostPtr;
 
 @property(nonatomic, readonly) nc::utility::FSEventsFileUpdate &fsEventsFileUpdate;
@@ -88,6 +88,8 @@
 #include <Panel/Log.h>
 #include <Panel/ExternalTools.h>
 #include <Panel/TagsStorage.h>
+#include <Panel/DirectorySizeCalculator.h>
+#include <Panel/FileNameIndexes.h>
 
 #include <filesystem>
 #include <fstream>
@@ -844,6 +846,18 @@ static NCAppDelegate *g_Me = nil;
     return *instance;
 }
 
+- (nc::panel::DirectorySizeCalculator &)directorySizeCalculator
+{
+    static const auto instance = new nc::panel::DirectorySizeCalculator;
+    return *instance;
+}
+
+- (nc::panel::FileNameIndexes &)fileNameIndexes
+{
+    static const auto instance = new nc::panel::FileNameIndexes;
+    return *instance;
+}
+
 - (const std::shared_ptr<nc::panel::ClosedPanelsHistory> &)closedPanelsHistory
 {
     [[clang::no_destroy]] static const auto impl = std::make_shared<nc::panel::ClosedPanelsHistoryImpl>();
@@ -1,13 +1,20 @@
 // Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <Base/Hash.h>
+#include <Base/MultiHash.h>
 #include <Base/SerialQueue.h>
+#include <Base/dispatch_cpp.h>
 #include <NimbleCommander/Bootstrap/Config.h>
 #include <NimbleCommander/Core/Alert.h>
 #include "CalculateChecksumSheetController.h"
+#include <algorithm>
+#include <atomic>
 #include <numeric>
+#include <ranges>
 
 static const auto g_ConfigAlgo = "filePanel.general.checksumCalculationAlgorithm";
 [[clang::no_destroy]] const static std::string g_SumsFilename = "checksums.txt";
+static constexpr size_t g_ChunkSize = 8 * 1024 * 1024;
+static constexpr size_t g_NativeStreams = 4;
 using nc::base::Hash;
 
 [[clang::no_destroy]] const static std::vector<std::pair<NSString *, int>> g_Algos = {
@@ -21,13 +28,46 @@ using nc::base::Hash;
     {@"SHA2-256", Hash::SHA2_256},
     {@"SHA2-384", Hash::SHA2_384},
     {@"SHA2-512", Hash::SHA2_512},
+    {@"CRC32C", Hash::CRC32C},
+    {@"XXH64", Hash::XXH64},
+    {@"BLAKE3", Hash::BLAKE3},
 };
 
+// The checked algorithms are stored as a comma-separated list of their titles, e.g. "MD5,SHA2-256"
+static std::vector<size_t> LoadCheckedAlgos()
+{
+    const std::string config = GlobalConfig().Has(g_ConfigAlgo) ? GlobalConfig().GetString(g_ConfigAlgo) : "MD5";
+    std::vector<size_t> algos;
+    for( const auto title : std::views::split(config, ',') ) {
+        const std::string_view name(title.begin(), title.end());
+        for( size_t i = 0; i < g_Algos.size(); ++i )
+            if( name == g_Algos[i].first.UTF8String )
+                algos.push_back(i);
+    }
+    if( algos.empty() ) {
+        const auto md5 = std::ranges::find(g_Algos, int(Hash::MD5), [](auto &_algo) { return _algo.second; });
+        algos.push_back(static_cast<size_t>(md5 - g_Algos.begin()));
+    }
+    std::ranges::sort(algos);
+    algos.erase(std::unique(algos.begin(), algos.end()), algos.end());
+    return algos;
+}
+
+static void StoreCheckedAlgos(const std::vector<size_t> &_algos)
+{
+    std::string config;
+    for( const size_t algo : _algos )
+        config += (config.empty() ? "" : ",") + std::string(g_Algos[algo].first.UTF8String);
+    GlobalConfig().Set(g_ConfigAlgo, config.c_str());
+}
+
 @implementation CalculateChecksumSheetController {
     VFSHostPtr m_Host;
     std::vector<std::string> m_Filenames;
     std::vector<uint64_t> m_Sizes;
-    std::vector<std::string> m_Checksums;
+    std::vector<size_t> m_Algos;     // indices in g_Algos of the algorithms checked in the popup
+    std::vector<size_t> m_SumsAlgos; // indices in g_Algos of the algorithms m_Checksums were calculated with
+    std::vector<std::vector<std::string>> m_Checksums; // per file, in the order of m_SumsAlgos
     std::vector<std::string> m_Errors;
     std::string m_Path;
     nc::base::SerialQueue m_WorkQue;
@@ -69,8 +109,7 @@ using nc::base::Hash;
         m_WorkQue.SetOnDry([=] {
             dispatch_to_main_queue([self] {
                 self.isWorking = false;
-                self.sumsAvailable =
-                    count_if(begin(m_Checksums), end(m_Checksums), [](auto &i) { return !i.empty(); }) > 0;
+                self.sumsAvailable = std::ranges::any_of(m_Checksums, [](auto &i) { return !i.empty(); });
             });
         });
     }
@@ -82,59 +121,80 @@ using nc::base::Hash;
     if( !m_WorkQue.Empty() )
         return;
 
-    GlobalConfig().Set(g_ConfigAlgo, self.HashMethod.titleOfSelectedItem.UTF8String);
-
-    const int chunk_sz = 16 * 1024 * 1024;
+    StoreCheckedAlgos(m_Algos);
 
-    int method = g_Algos[self.HashMethod.indexOfSelectedItem].second;
+    // every file is read once and fed into all the checked algorithms at the same time
+    m_SumsAlgos = m_Algos;
+    std::vector<Hash::Mode> modes;
+    for( const size_t algo : m_SumsAlgos )
+        modes.push_back(static_cast<Hash::Mode>(g_Algos[algo].second));
+    m_Checksums.assign(m_Filenames.size(), {});
+    std::ranges::fill(m_Errors, std::string{});
+    [self.Table reloadData];
     self.Progress.doubleValue = 0;
 
     m_WorkQue.Run([=] {
-        auto buf = std::make_unique<uint8_t[]>(chunk_sz);
-        uint64_t total_fed = 0;
-        for( auto &i : m_Filenames ) {
-            if( m_WorkQue.IsStopped() )
-                break;
-            const auto item_index = int(&i - &m_Filenames[0]);
-
-            VFSFilePtr file;
-            int rc = m_Host->CreateFile(
-                (std::filesystem::path(m_Path) / i).c_str(), file, [self] { return m_WorkQue.IsStopped(); });
-            if( rc != 0 ) {
-                dispatch_to_main_queue([self, rc, item_index] { [self reportError:rc forFilenameAtIndex:item_index]; });
-                continue;
-            }
-
-            rc = file->Open(VFSFlags::OF_Read | VFSFlags::OF_ShLock | VFSFlags::OF_NoCache,
-                            [self] { return m_WorkQue.IsStopped(); });
-            if( rc != 0 ) {
-                dispatch_to_main_queue([self, rc, item_index] { [self reportError:rc forFilenameAtIndex:item_index]; });
-                continue;
-            }
-
-            Hash h(static_cast<Hash::Mode>(method));
-
-            ssize_t rn = 0;
-            while( (rn = file->Read(buf.get(), chunk_sz)) > 0 ) {
-                if( m_WorkQue.IsStopped() )
-                    break;
-                h.Feed(buf.get(), rn);
-                total_fed += rn;
-                dispatch_to_main_queue([self, progress = double(total_fed)] { self.Progress.doubleValue = progress; });
-            }
-
-            if( rn < 0 ) {
-                dispatch_to_main_queue(
-                    [self, rn, item_index] { [self reportError:static_cast<int>(rn) forFilenameAtIndex:item_index]; });
-                continue;
-            }
-
-            auto result = h.Final();
-
-            dispatch_to_main_queue([self, result = std::move(result), item_index] {
-                [self reportChecksum:Hash::Hex(result) forFilenameAtIndex:item_index];
-            });
-        }
+        // native files are hashed several at once, other hosts are not expected to cope well with concurrent reads
+        const size_t streams = std::min(m_Host->IsNativeFS() ? g_NativeStreams : size_t(1), m_Filenames.size());
+        std::atomic_size_t next_file = 0;
+        std::atomic_uint64_t total_fed = 0;
+        nc::dispatch_apply(streams, [&](size_t) {
+            const auto buf = std::make_unique<uint8_t[]>(g_ChunkSize);
+            for( size_t index = next_file++; index < m_Filenames.size() && !m_WorkQue.IsStopped(); index = next_file++ )
+                [self calculateChecksumOfFileAtIndex:static_cast<int>(index)
+                                           withModes:modes
+                                              buffer:buf.get()
+                                            totalFed:total_fed];
+        });
+    });
+}
+
+- (void)calculateChecksumOfFileAtIndex:(int)item_index
+                             withModes:(const std::vector<Hash::Mode> &)modes
+                                buffer:(uint8_t *)buf
+                              totalFed:(std::atomic_uint64_t &)total_fed
+{
+    VFSFilePtr file;
+    int rc = m_Host->CreateFile((std::filesystem::path(m_Path) / m_Filenames[item_index]).c_str(),
+                                file,
+                                [self] { return m_WorkQue.IsStopped(); });
+    if( rc != 0 ) {
+        dispatch_to_main_queue([self, rc, item_index] { [self reportError:rc forFilenameAtIndex:item_index]; });
+        return;
+    }
+
+    rc = file->Open(VFSFlags::OF_Read | VFSFlags::OF_ShLock | VFSFlags::OF_NoCache,
+                    [self] { return m_WorkQue.IsStopped(); });
+    if( rc != 0 ) {
+        dispatch_to_main_queue([self, rc, item_index] { [self reportError:rc forFilenameAtIndex:item_index]; });
+        return;
+    }
+
+    nc::base::MultiHash h(modes);
+
+    ssize_t rn = 0;
+    while( (rn = file->Read(buf, g_ChunkSize)) > 0 ) {
+        if( m_WorkQue.IsStopped() )
+            return;
+        h.Feed(buf, rn);
+        const uint64_t fed = total_fed += rn;
+        dispatch_to_main_queue([self, progress = double(fed)] {
+            self.Progress.doubleValue = std::max(self.Progress.doubleValue, progress);
+        });
+    }
+
+    if( rn < 0 ) {
+        dispatch_to_main_queue(
+            [self, rn, item_index] { [self reportError:static_cast<int>(rn) forFilenameAtIndex:item_index]; });
+        return;
+    }
+
+    std::vector<std::string> checksums;
+    for( const auto &digest : h.Final() )
+        checksums.emplace_back(Hash::Hex(digest));
+
+    dispatch_to_main_queue([self, checksums = std::move(checksums), item_index] {
+        [self reportChecksums:checksums forFilenameAtIndex:item_index];
     });
 }
 
@@ -142,13 +202,19 @@ using nc::base::Hash;
 {
     [super windowDidLoad];
 
-    for( auto &i : g_Algos )
-        [self.HashMethod addItemWithTitle:i.first];
-
-    NSString *def_algo = @"MD5";
-    if( GlobalConfig().Has(g_ConfigAlgo) )
-        def_algo = [NSString stringWithUTF8String:GlobalConfig().GetString(g_ConfigAlgo).c_str()];
-    [self.HashMethod selectItemWithTitle:def_algo];
+    // a pull-down button shows its first item as the title, the others are toggled independently
+    self.HashMethod.pullsDown = true;
+    [self.HashMethod addItemWithTitle:@""];
+    for( size_t i = 0; i < g_Algos.size(); ++i ) {
+        [self.HashMethod addItemWithTitle:g_Algos[i].first];
+        NSMenuItem *item = self.HashMethod.lastItem;
+        item.tag = static_cast<NSInteger>(i);
+        item.target = self;
+        item.action = @selector(OnToggleAlgorithm:);
+    }
+    m_Algos = LoadCheckedAlgos();
+    m_SumsAlgos = m_Algos;
+    [self updateCheckedAlgos];
 
     self.Table.delegate = self;
     self.Table.dataSource = self;
@@ -173,6 +239,34 @@ using nc::base::Hash;
     [self.Progress setIndeterminate:false];
 }
 
+- (IBAction)OnToggleAlgorithm:(id)_sender
+{
+    const auto algo = static_cast<size_t>(static_cast<NSMenuItem *>(_sender).tag);
+    if( const auto it = std::ranges::find(m_Algos, algo); it != m_Algos.end() ) {
+        if( m_Algos.size() > 1 ) // at least one algorithm stays checked
+            m_Algos.erase(it);
+    }
+    else {
+        m_Algos.insert(std::ranges::upper_bound(m_Algos, algo), algo);
+    }
+    [self updateCheckedAlgos];
+}
+
+- (void)updateCheckedAlgos
+{
+    NSMutableArray<NSString *> *titles = [NSMutableArray new];
+    for( size_t i = 0; i < g_Algos.size(); ++i ) {
+        const bool checked = std::ranges::find(m_Algos, i) != m_Algos.end();
+        [self.HashMethod itemAtIndex:static_cast<NSInteger>(i + 1)].state =
+            checked ? NSControlStateValueOn : NSControlStateValueOff;
+        if( checked )
+            [titles addObject:g_Algos[i].first];
+    }
+    NSString *title = [titles componentsJoinedByString:@", "];
+    self.HashMethod.itemArray.firstObject.title = title;
+    self.HashMethod.toolTip = title;
+}
+
 - (IBAction)OnClose:(id) [[maybe_unused]] _sender
 {
     m_WorkQue.Stop();
@@ -180,10 +274,17 @@ using nc::base::Hash;
     [self endSheet:NSModalResponseCancel];
 }
 
-- (void)reportChecksum:(std::string)checksum forFilenameAtIndex:(int)ind
+// The table has a row per file and algorithm, the rows of a file go one after another
+- (NSIndexSet *)rowsOfFilenameAtIndex:(int)ind
 {
-    m_Checksums[ind] = checksum;
-    [self.Table reloadDataForRowIndexes:[NSIndexSet indexSetWithIndex:ind]
+    const size_t algos = m_SumsAlgos.size();
+    return [NSIndexSet indexSetWithIndexesInRange:NSMakeRange(static_cast<size_t>(ind) * algos, algos)];
+}
+
+- (void)reportChecksums:(const std::vector<std::string> &)checksums forFilenameAtIndex:(int)ind
+{
+    m_Checksums[ind] = checksums;
+    [self.Table reloadDataForRowIndexes:[self rowsOfFilenameAtIndex:ind]
                           columnIndexes:[NSIndexSet indexSetWithIndex:1]];
 }
 
@@ -191,13 +292,13 @@ using nc::base::Hash;
 {
     m_Errors[ind] =
         [NSString stringWithFormat:@"Error: %@", VFSError::ToNSError(error).localizedDescription].UTF8String;
-    [self.Table reloadDataForRowIndexes:[NSIndexSet indexSetWithIndex:ind]
+    [self.Table reloadDataForRowIndexes:[self rowsOfFilenameAtIndex:ind]
                           columnIndexes:[NSIndexSet indexSetWithIndex:1]];
 }
 
 - (NSInteger)numberOfRowsInTableView:(NSTableView *) [[maybe_unused]] _tableView
 {
-    return m_Filenames.size();
+    return m_Filenames.size() * m_SumsAlgos.size();
 }
 
 - (NSView *)tableView:(NSTableView *) [[maybe_unused]] _tableView
@@ -214,18 +315,24 @@ using nc::base::Hash;
         return tf;
     };
 
-    assert(row < static_cast<int>(m_Filenames.size()));
+    const size_t algos = m_SumsAlgos.size();
+    const size_t file = static_cast<size_t>(row) / algos;
+    const size_t algo = static_cast<size_t>(row) % algos;
+    assert(file < m_Filenames.size());
     if( [tableColumn.identifier isEqualToString:@"filename"] ) {
         NSTextField *tf = mktf();
-        tf.stringValue = [NSString stringWithUTF8String:m_Filenames[row].c_str()];
+        tf.stringValue = [NSString stringWithUTF8String:m_Filenames[file].c_str()];
         return tf;
     }
     if( [tableColumn.identifier isEqualToString:@"checksum"] ) {
         NSString *val;
-        if( !m_Checksums[row].empty() )
-            val = [NSString stringWithUTF8String:m_Checksums[row].c_str()];
-        if( !val && !m_Errors[row].empty() )
-            val = [NSString stringWithUTF8String:m_Errors[row].c_str()];
+        if( !m_Checksums[file].empty() ) {
+            val = [NSString stringWithUTF8String:m_Checksums[file][algo].c_str()];
+            if( algos > 1 )
+                val = [NSString stringWithFormat:@"%@: %@", g_Algos[m_SumsAlgos[algo]].first, val];
+        }
+        if( !val && !m_Errors[file].empty() )
+            val = [NSString stringWithUTF8String:m_Errors[file].c_str()];
         if( !val )
             val = @"";
 
@@ -239,10 +346,17 @@ using nc::base::Hash;
 - (IBAction)OnSave:(id) [[maybe_unused]] _sender
 {
     // currently doing all stuff on main thread synchronously. may be bad for some vfs like ftp
+    // a single algorithm is saved in the plain "checksum  filename" format, several ones in the tagged
+    // "ALGO (filename) = checksum" format so that the lines can be told apart
     std::string str;
-    for( auto &i : m_Checksums )
-        if( !i.empty() )
-            str += i + "  " + m_Filenames[&i - &m_Checksums[0]] + "\n";
+    for( size_t file = 0; file < m_Checksums.size(); ++file )
+        for( size_t algo = 0; algo < m_Checksums[file].size(); ++algo ) {
+            if( m_SumsAlgos.size() == 1 )
+                str += m_Checksums[file][algo] + "  " + m_Filenames[file] + "\n";
+            else
+                str += std::string(g_Algos[m_SumsAlgos[algo]].first.UTF8String) + " (" + m_Filenames[file] +
+                       ") = " + m_Checksums[file][algo] + "\n";
+        }
 
     if( str.empty() )
         return;
@@ -14,6 +14,7 @@
 #include <NimbleCommander/Bootstrap/AppDelegate.h>
 
 static const auto g_ConfigModalInternalViewer = "viewer.modalMode";
+static const auto g_ConfigUseFileNameIndex = "filePanel.findFiles.useFileNameIndex";
 
 namespace nc::panel::actions {
 
@@ -52,6 +53,8 @@ void FindFiles::Perform(PanelController *_target, id) const
 {
     FindFilesSheetController *sheet = [FindFilesSheetController new];
     sheet.vfsInstanceManager = &_target.vfsInstanceManager;
+    if( GlobalConfig().GetBool(g_ConfigUseFileNameIndex) )
+        sheet.fileNameIndexes = &NCAppDelegate.me.fileNameIndexes;
     sheet.host = _target.isUniform ? _target.vfs : _target.view.item.Host();
     sheet.path = _target.isUniform ? _target.currentDirectoryPath : _target.view.item.Directory();
     __weak PanelController *wp = _target;
@@ -279,6 +279,7 @@ static std::vector<CFStringRef> GatherDisplayFilenames(const data::Model *_data)
     const auto &sorted_idices = _data->SortedDirectoryEntries();
     const auto &listing = _data->Listing();
     const auto count = static_cast<int>(sorted_idices.size());
+    listing.MaterializeCFStrings(sorted_idices);
     auto strings = std::vector<CFStringRef>(count, nullptr);
     for( int i = 0; i < count; ++i )
         strings[i] = listing.DisplayFilenameCF(sorted_idices[i]);
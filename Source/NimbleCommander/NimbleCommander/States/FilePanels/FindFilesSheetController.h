@@ -15,6 +15,8 @@ class Config;
 
 namespace nc::panel {
 
+class FileNameIndexes;
+
 struct FindFilesSheetControllerFoundItem {
     VFSHostPtr host;
     std::string filename;
@@ -47,6 +49,7 @@ struct FindFilesSheetViewRequest {
 @property(nonatomic) std::function<void(const std::vector<nc::vfs::VFSPath> &_filepaths)> onPanelize;
 @property(nonatomic) std::function<void(const nc::panel::FindFilesSheetViewRequest &)> onView;
 @property(nonatomic) nc::core::VFSInstanceManager *vfsInstanceManager;
+@property(nonatomic) nc::panel::FileNameIndexes *fileNameIndexes; // optional, consulted for recursive name searches
 - (const nc::panel::FindFilesSheetControllerFoundItem *)selectedItem; // may be nullptr
 
 @end
@@ -17,6 +17,7 @@
 #include <Utility/StringExtras.h>
 #include <Utility/ObjCpp.h>
 #include <Panel/FindFilesData.h>
+#include <Panel/FileNameIndexes.h>
 #include <iostream>
 
 static const auto g_StateMaskHistory = "filePanel.findFilesSheet.maskHistory";
@@ -253,6 +254,7 @@ private:
 @synthesize onPanelize = m_OnPanelize;
 @synthesize onView = m_OnView;
 @synthesize vfsInstanceManager;
+@synthesize fileNameIndexes;
 @synthesize didAnySearchStarted;
 @synthesize searchingNow;
 @synthesize CloseButton;
@@ -413,6 +415,7 @@ private:
     }
     if( self.SearchInArchivesButton.intValue )
         search_options |= SearchForFiles::Options::LookInArchives;
+    search_options |= SearchForFiles::Options::ParallelTraversal;
     return search_options;
 }
 
@@ -485,6 +488,14 @@ private:
 
     m_FileSearch->SetFilterSize(self.searchFilterSizeFromUI);
 
+    // an index serves only the recursive searches, it's being built for the following ones if it's not ready yet
+    const int search_options = self.searchOptionsFromUI;
+    std::shared_ptr<const nc::vfs::FileNameIndex> file_name_index;
+    if( self.fileNameIndexes != nullptr && (search_options & SearchForFiles::Options::GoIntoSubDirs) &&
+        !(search_options & SearchForFiles::Options::LookInArchives) )
+        file_name_index = self.fileNameIndexes->Find(m_Host, m_Path);
+    m_FileSearch->SetFileNameIndex(std::move(file_name_index));
+
     auto found_callback = [=](const char *_filename, const char *_in_path, VFSHost &_in_host, CFRange _cont_pos) {
         FindFilesSheetControllerFoundItem it;
         it.host = _in_host.SharedPtr();
@@ -526,7 +537,7 @@ private:
     };
     const bool started = m_FileSearch->Go(m_Path,
                                           m_Host,
-                                          self.searchOptionsFromUI,
+                                          search_options,
                                           std::move(found_callback),
                                           std::move(finish_callback),
                                           std::move(lookin_in_callback),
@@ -559,6 +559,15 @@ static View *RetrieveOrSpawnView(NSTableView *_tv, NSString *_identifier)
 
     IconRepositoryCleaner{*m_IconRepository, *m_Data}.SweepUnusedSlots();
 
+    // the names of the rows on the screen are needed right away, the rest are created when scrolled to
+    const NSRange visible_rows = [m_TableView rowsInRect:m_ScrollView.contentView.visibleRect];
+    if( static_cast<int>(visible_rows.location) < new_rows_count ) {
+        const auto sorted = std::span<const unsigned>{data->SortedDirectoryEntries()}.subspan(
+            visible_rows.location,
+            std::min<size_t>(visible_rows.length, new_rows_count - visible_rows.location));
+        data->Listing().MaterializeCFStrings(sorted);
+    }
+
     auto block = ^(PanelListViewRowView *row_view, NSInteger rowIndex) {
       const int row = static_cast<int>(rowIndex);
       if( row >= new_rows_count )
@@ -38,6 +38,7 @@ class Model;
 }
 
 class History;
+class DirectorySizeCalculator;
 struct PersistentLocation;
 class PanelViewLayoutsStorage;
 
@@ -151,7 +152,8 @@ using ContextMenuProvider = std::function<NSMenu *(std::vector<VFSListingItem> _
      directoryAccessProvider:(nc::panel::DirectoryAccessProvider &)_directory_access_provider
          contextMenuProvider:(nc::panel::ContextMenuProvider)_context_menu_provider
              nativeFSManager:(nc::utility::NativeFSManager &)_native_fs_mgr
-                  nativeHost:(nc::vfs::NativeHost &)_native_host;
+                  nativeHost:(nc::vfs::NativeHost &)_native_host
+     directorySizeCalculator:(nc::panel::DirectorySizeCalculator &)_directory_size_calculator;
 
 - (void)refreshPanel;                 // reload panel contents
 - (void)forceRefreshPanel;            // user pressed cmd+r by default
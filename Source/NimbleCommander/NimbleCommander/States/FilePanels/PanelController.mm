@@ -28,6 +28,8 @@
 #include "Actions/Enter.h"
 #include <Operations/Copying.h>
 #include <Panel/CursorBackup.h>
+#include <Panel/DirectorySizeCalculator.h>
+#include <Panel/ListingPrefetcher.h>
 #include <Panel/QuickSearch.h>
 #include <Panel/Log.h>
 #include "PanelViewHeader.h"
@@ -42,8 +44,29 @@ using namespace nc::core;
 using namespace nc::panel;
 using namespace std::literals;
 
-static constexpr size_t g_MaxSizeCalculationCommitBatches = 40;
+static constexpr std::chrono::nanoseconds g_SizeCalculationCommitPeriod = std::chrono::milliseconds{100};
 static constexpr std::chrono::nanoseconds g_FilesystemHintTriggerDelay = std::chrono::milliseconds{500}; // 0.5s
+static constexpr std::chrono::nanoseconds g_PrefetchDelay = std::chrono::milliseconds{150};
+
+// Returns the privacy-protected folder which contains _directory (or is it), or an empty view otherwise.
+// Listing these folders requires a user's consent which is asked for on the first access.
+static std::string_view ProtectedFolderOf(std::string_view _directory) noexcept
+{
+    using nc::base::CommonPaths;
+    static const std::string mobile_documents = CommonPaths::Library() + "Mobile Documents/";
+    static const std::string cloud_storage = CommonPaths::Library() + "CloudStorage/";
+    for( const std::string &folder : {std::cref(CommonPaths::Desktop()),
+                                      std::cref(CommonPaths::Documents()),
+                                      std::cref(CommonPaths::Downloads()),
+                                      std::cref(CommonPaths::Pictures()),
+                                      std::cref(CommonPaths::Music()),
+                                      std::cref(CommonPaths::Movies()),
+                                      std::cref(mobile_documents),
+                                      std::cref(cloud_storage)} )
+        if( _directory.starts_with(folder) )
+            return folder;
+    return {};
+}
 
 static const auto g_ConfigShowDotDotEntry = "filePanel.general.showDotDotEntry";
 static const auto g_ConfigIgnoreDirectoriesOnMaskSelection = "filePanel.general.ignoreDirectoriesOnSelectionWithMask";
@@ -183,6 +206,11 @@ static void HeatUpConfigValues()
     ContextMenuProvider m_ContextMenuProvider;
     nc::utility::NativeFSManager *m_NativeFSManager;
     nc::vfs::NativeHost *m_NativeHost;
+    nc::panel::DirectorySizeCalculator *m_DirectorySizeCalculator;
+
+    // listings of the parent and of the highlighted directories, fetched ahead of time
+    nc::panel::ListingPrefetcher m_ListingPrefetcher;
+    uint64_t m_PrefetchGeneration;
 
     unsigned long m_DataGeneration;
 }
@@ -201,6 +229,7 @@ static void HeatUpConfigValues()
          contextMenuProvider:(nc::panel::ContextMenuProvider)_context_menu_provider
              nativeFSManager:(nc::utility::NativeFSManager &)_native_fs_mgr
                   nativeHost:(nc::vfs::NativeHost &)_native_host
+     directorySizeCalculator:(nc::panel::DirectorySizeCalculator &)_directory_size_calculator
 {
     assert(_layouts);
     assert(_context_menu_provider);
@@ -214,12 +243,14 @@ static void HeatUpConfigValues()
         m_VFSInstanceManager = &_vfs_mgr;
         m_NativeFSManager = &_native_fs_mgr;
         m_NativeHost = &_native_host;
+        m_DirectorySizeCalculator = &_directory_size_calculator;
         m_DirectoryAccessProvider = &_directory_access_provider;
         m_ContextMenuProvider = std::move(_context_menu_provider);
         m_History.SetVFSInstanceManager(_vfs_mgr);
         m_VFSFetchingFlags = 0;
         m_NextActivityTicket = 1;
         m_DataGeneration = 0;
+        m_PrefetchGeneration = 0;
         m_IsAnythingWorksInBackground = false;
         m_ViewLayoutIndex = m_Layouts->DefaultLayoutIndex();
         m_AssignedViewLayout = m_Layouts->DefaultLayout();
@@ -404,6 +435,11 @@ static void HeatUpConfigValues()
     if( !m_DirectoryLoadingQ.Empty() )
         return; // reducing overhead
 
+    [self reloadListingForcingRefresh:_force];
+}
+
+- (void)reloadListingForcingRefresh:(bool)_force
+{
     // later: maybe check PanelType somehow
 
     if( self.isUniform ) {
@@ -489,78 +525,88 @@ static void HeatUpConfigValues()
     dispatch_assert_background_queue();
     assert(!_items.empty());
 
-    // divide all items into maximum of g_MaxSizeCalculationCommitBatches batches as equally as
-    // possible
-    const size_t items_count = _items.size();
-    const size_t batches = std::min(g_MaxSizeCalculationCommitBatches, items_count);
-    const size_t items_per_batch = items_count / batches;
-    const size_t items_leftover = items_count - items_per_batch * batches;
-
-    for( size_t batch = 0, items_first = 0, items_last = 0; batch != batches; ++batch ) {
-        items_first = items_last;
-        items_last += items_per_batch + (batch < items_leftover ? 1 : 0);
+    const auto path_of = [](const VFSListingItem &_item) {
+        return !_item.IsDotDot() ? _item.Path() : _item.Directory();
+    };
 
-        panel::CalculatedSizesBatch calculated;
-        calculated.items.reserve(items_last - items_first);
-        calculated.sizes.reserve(items_last - items_first);
-
-        for( size_t item_index = items_first; item_index != items_last; ++item_index ) {
-            if( m_DirectorySizeCountingQ.IsStopped() )
-                return;
-
-            auto &i = _items[item_index];
-            if( !i.IsDir() )
-                continue;
-
-            const auto result =
-                i.Host()->CalculateDirectorySize(!i.IsDotDot() ? i.Path().c_str() : i.Directory().c_str(),
-                                                 [=] { return m_DirectorySizeCountingQ.IsStopped(); });
+    // the remembered sizes go to the panel at once, before anything gets calculated
+    panel::CalculatedSizesBatch calculated;
+    std::vector<const VFSListingItem *> to_calculate;
+    for( auto &i : _items ) {
+        if( !i.IsDir() )
+            continue;
+        if( const auto size = m_DirectorySizeCalculator->Cached(*i.Host(), path_of(i)) ) {
+            calculated.items.emplace_back(i);
+            calculated.sizes.emplace_back(*size);
+        }
+        else {
+            to_calculate.emplace_back(&i);
+        }
+    }
+    if( !calculated.items.empty() ) {
+        [self commitCalculatedSizes:calculated];
+        calculated = {};
+    }
 
-            if( result < 0 )
-                continue; // silently skip items that caused erros while calculating size
+    // the rest are streamed into the panel as they arrive, but not more often than g_SizeCalculationCommitPeriod
+    auto last_commit = nc::base::machtime();
+    for( const VFSListingItem *i : to_calculate ) {
+        if( m_DirectorySizeCountingQ.IsStopped() )
+            return;
 
-            calculated.items.emplace_back(i);
+        const auto result = m_DirectorySizeCalculator->Calculate(
+            *i->Host(), path_of(*i), [=] { return m_DirectorySizeCountingQ.IsStopped(); });
+        if( result >= 0 ) { // silently skip items that caused erros while calculating size
+            calculated.items.emplace_back(*i);
             calculated.sizes.emplace_back(static_cast<uint64_t>(result));
         }
 
-        if( calculated.items.empty() )
-            continue;
+        if( !calculated.items.empty() && nc::base::machtime() - last_commit >= g_SizeCalculationCommitPeriod ) {
+            [self commitCalculatedSizes:calculated];
+            calculated = {};
+            last_commit = nc::base::machtime();
+        }
+    }
+    if( !calculated.items.empty() )
+        [self commitCalculatedSizes:calculated];
+}
 
-        auto commit_batch = [=, calculated = std::move(calculated)] {
-            assert(!calculated.items.empty());
+- (void)commitCalculatedSizes:(const panel::CalculatedSizesBatch &)_calculated
+{
+    auto commit_batch = [=, calculated = _calculated] {
+        assert(!calculated.items.empty());
 
-            // may cause re-sorting if current sorting is by size so save the cursor
-            const auto pers = CursorBackup{m_View.curpos, m_Data};
+        // may cause re-sorting if current sorting is by size so save the cursor
+        const auto pers = CursorBackup{m_View.curpos, m_Data};
 
-            size_t num_set = 0;
-            if( &m_Data.Listing() == calculated.items.front().Listing().get() ) {
-                // the listing is the same, can use indices directly
-                std::vector<unsigned> raw_indices(calculated.items.size());
-                std::transform(calculated.items.begin(), calculated.items.end(), raw_indices.begin(), [](auto &i) {
-                    return i.Index();
-                });
-                num_set = m_Data.SetCalculatedSizesForDirectories(raw_indices, calculated.sizes);
-            }
-            else {
-                // the listing has changed, need to use indirects: filename and directory
-                std::vector<std::string_view> filenames(calculated.items.size());
-                std::vector<std::string_view> directories(calculated.items.size());
-                std::transform(calculated.items.begin(), calculated.items.end(), filenames.begin(), [](auto &i) {
-                    return std::string_view{i.Filename()};
-                });
-                std::transform(calculated.items.begin(), calculated.items.end(), directories.begin(), [](auto &i) {
-                    return std::string_view{i.Directory()};
-                });
-                num_set = m_Data.SetCalculatedSizesForDirectories(filenames, directories, calculated.sizes);
-            }
-            if( num_set != 0 ) {
-                [m_View dataUpdated];
-                [m_View volatileDataChanged];
-                m_View.curpos = pers.RestoredCursorPosition();
-            }
-        };
-        dispatch_to_main_queue(std::move(commit_batch));
-    }
+        size_t num_set = 0;
+        if( &m_Data.Listing() == calculated.items.front().Listing().get() ) {
+            // the listing is the same, can use indices directly
+            std::vector<unsigned> raw_indices(calculated.items.size());
+            std::transform(calculated.items.begin(), calculated.items.end(), raw_indices.begin(), [](auto &i) {
+                return i.Index();
+            });
+            num_set = m_Data.SetCalculatedSizesForDirectories(raw_indices, calculated.sizes);
+        }
+        else {
+            // the listing has changed, need to use indirects: filename and directory
+            std::vector<std::string_view> filenames(calculated.items.size());
+            std::vector<std::string_view> directories(calculated.items.size());
+            std::transform(calculated.items.begin(), calculated.items.end(), filenames.begin(), [](auto &i) {
+                return std::string_view{i.Filename()};
+            });
+            std::transform(calculated.items.begin(), calculated.items.end(), directories.begin(), [](auto &i) {
+                return std::string_view{i.Directory()};
+            });
+            num_set = m_Data.SetCalculatedSizesForDirectories(filenames, directories, calculated.sizes);
+        }
+        if( num_set != 0 ) {
+            [m_View dataUpdated];
+            [m_View volatileDataChanged];
+            m_View.curpos = pers.RestoredCursorPosition();
+        }
+    };
+    dispatch_to_main_queue(std::move(commit_batch));
 }
 
 - (void)CancelBackgroundOperations
@@ -636,6 +682,7 @@ static void HeatUpConfigValues()
     [self onCursorChanged];
     [self updateAttachedBriefSystemOverview];
     m_History.Put(m_Data.Listing());
+    [self prefetchParentDirectory];
 
     [self markRestorableStateAsInvalid];
 }
@@ -649,6 +696,58 @@ static void HeatUpConfigValues()
 - (void)onCursorChanged
 {
     [self updateAttachedQuickLook];
+    [self schedulePrefetchOfHighlightedDirectory];
+}
+
+- (void)prefetchParentDirectory
+{
+    if( !self.isUniform )
+        return;
+    const std::filesystem::path directory = EnsureNoTrailingSlash(self.currentDirectoryPath);
+    if( directory == "/" )
+        return;
+    if( [self mayPrefetchDirectory:directory.parent_path().native() onHost:*self.vfs] )
+        m_ListingPrefetcher.Prefetch(self.vfs, directory.parent_path().native(), m_VFSFetchingFlags);
+}
+
+- (void)schedulePrefetchOfHighlightedDirectory
+{
+    // wait for the cursor to settle before fetching anything, so that scrolling through the directories doesn't
+    // trigger a fetch for each of them
+    const uint64_t generation = ++m_PrefetchGeneration;
+    __weak PanelController *weakself = self;
+    dispatch_to_main_queue_after(g_PrefetchDelay, [=] {
+        if( PanelController *strongself = weakself )
+            [strongself prefetchHighlightedDirectory:generation];
+    });
+}
+
+- (void)prefetchHighlightedDirectory:(uint64_t)_generation
+{
+    if( _generation != m_PrefetchGeneration )
+        return; // the cursor has moved since
+    const auto item = m_View.item;
+    if( !item || !item.IsDir() || item.IsDotDot() )
+        return;
+    if( [self mayPrefetchDirectory:item.Path() onHost:*item.Host()] )
+        m_ListingPrefetcher.Prefetch(item.Host(), item.Path(), m_VFSFetchingFlags);
+}
+
+// Tells if a directory can be listed in advance without bothering a slow volume or the user: only the local internal
+// volumes qualify, and the privacy-protected folders only while the panel is already browsing inside the same one -
+// otherwise merely highlighting such a folder could pop up an access request.
+- (bool)mayPrefetchDirectory:(const std::string &)_directory onHost:(const VFSHost &)_host
+{
+    if( !_host.IsNativeFS() )
+        return false;
+
+    const auto volume = m_NativeFSManager->VolumeFromPathFast(_directory);
+    if( !volume || !volume->mount_flags.local || !volume->mount_flags.internal )
+        return false;
+
+    const auto directory = EnsureTrailingSlash(_directory);
+    const auto protected_folder = ProtectedFolderOf(directory);
+    return protected_folder.empty() || EnsureTrailingSlash(self.currentDirectoryPath).starts_with(protected_folder);
 }
 
 - (void)updateAttachedQuickLook
@@ -874,8 +973,10 @@ static void ShowAlertAboutInvalidFilename(const std::string &_filename)
         auto directory = _request->RequestedDirectory;
         auto &vfs = *_request->VFS;
         const auto canceller = VFSCancelChecker([&] { return m_DirectoryLoadingQ.IsStopped(); });
-        VFSListingPtr listing;
-        const auto fetch_result = vfs.FetchDirectoryListing(directory.c_str(), listing, m_VFSFetchingFlags, canceller);
+        VFSListingPtr listing = m_ListingPrefetcher.Take(vfs, directory, m_VFSFetchingFlags);
+        int fetch_result = VFSError::Ok;
+        if( listing == nullptr )
+            fetch_result = vfs.FetchDirectoryListing(directory.c_str(), listing, m_VFSFetchingFlags, canceller);
         _request->LoadingResultCode = fetch_result;
         if( _request->LoadingResultCallback )
             _request->LoadingResultCallback(fetch_result);
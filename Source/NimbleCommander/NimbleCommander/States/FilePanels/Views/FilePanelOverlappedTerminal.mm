@@ -1,4 +1,4 @@
-// Copyright (C) 2015-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2015-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <Base/CommonPaths.h>
 #include <Term/ShellTask.h>
 #include <Term/Screen.h>
@@ -283,7 +283,8 @@ static const auto g_LongProcessDelay = 100ms;
 
     auto virgin = false;
     auto lock = m_TermScrollView.screen.AcquireLock();
-    if( auto line = m_TermScrollView.screen.Buffer().LineFromNo(m_BashCommandStartY); !line.empty() ) {
+    if( auto line = std::as_const(m_TermScrollView.screen.Buffer()).LineFromNo(m_BashCommandStartY);
+        !line.empty() ) {
         auto i = std::min(std::max(begin(line), std::begin(line) + m_BashCommandStartX), std::end(line));
         auto e = std::end(line);
         virgin = std::all_of(i, e, [](const ScreenBuffer::Space &sp) { return sp.l == 0 || sp.l == ' '; });
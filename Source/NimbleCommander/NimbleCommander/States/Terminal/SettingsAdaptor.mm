@@ -1,4 +1,4 @@
-// Copyright (C) 2017-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "SettingsAdaptor.h"
 #include <Term/Settings.h>
 #include <NimbleCommander/Core/Theming/Theme.h>
@@ -12,6 +12,8 @@ namespace nc::term {
 static const auto g_ConfigMaxFPS = "terminal.maxFPS";
 static const auto g_ConfigCursorMode = "terminal.cursorMode";
 static const auto g_ConfigHideScrollbar = "terminal.hideVerticalScrollbar";
+static const auto g_ConfigScrollbackMaxLines = "terminal.scrollbackMaxLines";
+static const auto g_ConfigScrollbackMaxMegabytes = "terminal.scrollbackMaxMegabytes";
 
 class SettingsImpl : public DefaultSettings
 {
@@ -99,6 +101,8 @@ public:
         return static_cast<enum CursorMode>(GlobalConfig().GetInt(g_ConfigCursorMode));
     }
     bool HideScrollbar() const override { return GlobalConfig().GetBool(g_ConfigHideScrollbar); }
+    int ScrollbackMaxLines() const override { return GlobalConfig().GetInt(g_ConfigScrollbackMaxLines); }
+    int ScrollbackMaxMegabytes() const override { return GlobalConfig().GetInt(g_ConfigScrollbackMaxMegabytes); }
 };
 
 std::shared_ptr<Settings> TerminalSettings()
@@ -1,4 +1,4 @@
-// Copyright (C) 2017-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "AttrsChangingJob.h"
 #include <Utility/PathManip.h>
 #include <sys/stat.h>
@@ -75,8 +75,7 @@ void AttrsChangingJob::ScanItem(unsigned _origin_item)
     m.stat = st;
     m.origin_item = _origin_item;
     m_Metas.emplace_back(m);
-    m_Filenames.push_back(item.IsDir() ? EnsureTrailingSlash(item.Filename()) : item.Filename(),
-                          nullptr);
+    const auto node = m_Filenames.push_back(item.IsDir() ? EnsureTrailingSlash(item.Filename()) : item.Filename());
     Statistics().CommitEstimated(Statistics::SourceType::Items, 1);
 
     if( m_Command.apply_to_subdirs && item.IsDir() ) {
@@ -100,16 +99,15 @@ void AttrsChangingJob::ScanItem(unsigned _origin_item)
             }
         }
 
-        const auto prefix = &m_Filenames.back();
         for( auto &dirent : dir_entries )
-            ScanItem(path + "/" + dirent.name, dirent.name, _origin_item, prefix);
+            ScanItem(path + "/" + dirent.name, dirent.name, _origin_item, node);
     }
 }
 
 void AttrsChangingJob::ScanItem(const std::string &_full_path,
                                 const std::string &_filename,
                                 unsigned _origin_item,
-                                const base::chained_strings::node *_prefix)
+                                base::PathTree::Index _prefix)
 {
     const auto &item = m_Command.items[_origin_item];
     auto &vfs = *item.Host();
@@ -134,7 +132,7 @@ void AttrsChangingJob::ScanItem(const std::string &_full_path,
     m.stat = st;
     m.origin_item = _origin_item;
     m_Metas.emplace_back(m);
-    m_Filenames.push_back(S_ISDIR(st.mode) ? EnsureTrailingSlash(_filename) : _filename, _prefix);
+    const auto node = m_Filenames.push_back(S_ISDIR(st.mode) ? EnsureTrailingSlash(_filename) : _filename, _prefix);
     Statistics().CommitEstimated(Statistics::SourceType::Items, 1);
 
     if( m_Command.apply_to_subdirs && S_ISDIR(st.mode) ) {
@@ -157,19 +155,18 @@ void AttrsChangingJob::ScanItem(const std::string &_full_path,
                     continue;
             }
         }
-        const auto prefix = &m_Filenames.back();
         for( auto &dirent : dir_entries )
-            ScanItem(_full_path + "/" + dirent.name, dirent.name, _origin_item, prefix);
+            ScanItem(_full_path + "/" + dirent.name, dirent.name, _origin_item, node);
     }
 }
 
 void AttrsChangingJob::DoChange()
 {
-    int n = 0;
-    for( auto i = std::begin(m_Filenames), e = std::end(m_Filenames); i != e; ++i, ++n ) {
+    for( size_t n = 0, e = m_Filenames.size(); n != e; ++n ) {
         const auto &meta = m_Metas[n];
         const auto &origin_item = m_Command.items[meta.origin_item];
-        const auto path = EnsureNoTrailingSlash(origin_item.Directory() + (*i).to_str_with_pref());
+        const auto path =
+            EnsureNoTrailingSlash(origin_item.Directory() + m_Filenames.path(static_cast<base::PathTree::Index>(n)));
 
         const auto success = AlterSingleItem(path, *origin_item.Host(), meta.stat);
 
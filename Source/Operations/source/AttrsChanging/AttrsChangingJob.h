@@ -1,10 +1,10 @@
-// Copyright (C) 2017-2019 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "../Job.h"
 #include "Options.h"
 #include <VFS/VFS.h>
-#include <Base/chained_strings.h>
+#include <Base/PathTree.h>
 
 namespace nc::ops {
 
@@ -49,7 +49,7 @@ private:
     void ScanItem(const std::string &_full_path,
                   const std::string &_filename,
                   unsigned _origin_item,
-                  const base::chained_strings::node *_prefix);
+                  base::PathTree::Index _prefix);
     void DoChange();
     bool AlterSingleItem( const std::string &_path, VFSHost &_vfs, const VFSStat &_stat );
     bool ChmodSingleItem( const std::string &_path, VFSHost &_vfs, const VFSStat &_stat );
@@ -61,7 +61,7 @@ private:
     const AttrsChangingCommand m_Command;
     std::optional<std::pair<uint16_t,uint16_t>> m_ChmodCommand;
     std::optional<std::pair<uint32_t,uint32_t>> m_ChflagCommand;
-    base::chained_strings m_Filenames;
+    base::PathTree m_Filenames;
     std::vector<Meta>    m_Metas;
 };
 
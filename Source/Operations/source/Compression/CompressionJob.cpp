@@ -28,7 +28,7 @@ struct CompressionJob::Source {
         uint16_t flags;
     };
 
-    base::chained_strings filenames;
+    base::PathTree filenames; // directories have trailing slashes, parallel to metas
     std::vector<ItemMeta> metas;
     std::vector<VFSHostPtr> base_hosts;
     std::vector<std::string> base_paths;
@@ -137,10 +137,9 @@ bool CompressionJob::BuildArchive()
 
 void CompressionJob::ProcessItems()
 {
-    int n = 0;
-    for( const auto &item : m_Source->filenames ) {
+    for( int n = 0, e = static_cast<int>(m_Source->filenames.size()); n != e; ++n ) {
 
-        ProcessItem(item, n++);
+        ProcessItem(n);
         Statistics().CommitProcessed(Statistics::SourceType::Items, 1);
 
         if( BlockIfPaused(); IsStopped() )
@@ -148,10 +147,10 @@ void CompressionJob::ProcessItems()
     }
 }
 
-void CompressionJob::ProcessItem(const base::chained_strings::node &_node, int _index)
+void CompressionJob::ProcessItem(int _index)
 {
     const auto meta = m_Source->metas[_index];
-    const auto rel_path = _node.to_str_with_pref();
+    const auto rel_path = m_Source->filenames.path(static_cast<base::PathTree::Index>(_index));
     const auto full_path =
         EnsureNoTrailingSlash(m_Source->base_paths[meta.base_path_indx] + rel_path);
 
@@ -401,7 +400,7 @@ bool CompressionJob::ScanItem(const VFSListingItem &_item, Source &_ctx)
         meta.base_vfs_indx = _ctx.FindOrInsertHost(_item.Host());
         meta.flags = static_cast<uint16_t>(Source::ItemFlags::no_flags);
         _ctx.metas.emplace_back(meta);
-        _ctx.filenames.push_back(_item.Filename(), nullptr);
+        _ctx.filenames.push_back(_item.Filename());
         Statistics().CommitEstimated(Statistics::SourceType::Bytes, _item.Size());
     } else if( _item.IsSymlink() ) {
         Source::ItemMeta meta;
@@ -409,14 +408,14 @@ bool CompressionJob::ScanItem(const VFSListingItem &_item, Source &_ctx)
         meta.base_vfs_indx = _ctx.FindOrInsertHost(_item.Host());
         meta.flags = static_cast<uint16_t>(Source::ItemFlags::symlink);
         _ctx.metas.emplace_back(meta);
-        _ctx.filenames.push_back(_item.Filename(), nullptr);
+        _ctx.filenames.push_back(_item.Filename());
     } else if( _item.IsDir() ) {
         Source::ItemMeta meta;
         meta.base_path_indx = _ctx.FindOrInsertBasePath(_item.Directory());
         meta.base_vfs_indx = _ctx.FindOrInsertHost(_item.Host());
         meta.flags = static_cast<uint16_t>(Source::ItemFlags::is_dir);
         _ctx.metas.emplace_back(meta);
-        _ctx.filenames.push_back(_item.Filename() + "/", nullptr);
+        const auto directory_node = _ctx.filenames.push_back(_item.Filename() + "/");
         auto &host = *_item.Host();
 
         std::vector<std::string> directory_entries;
@@ -439,7 +438,6 @@ bool CompressionJob::ScanItem(const VFSListingItem &_item, Source &_ctx)
             }
         }
 
-        const auto directory_node = &_ctx.filenames.back();
         for( const std::string &filename : directory_entries ) {
             const auto scan_ok = ScanItem(_item.Path() + "/" + filename,
                                           filename,
@@ -458,7 +456,7 @@ bool CompressionJob::ScanItem(const std::string &_full_path,
                               const std::string &_filename,
                               unsigned _vfs_no,
                               unsigned _basepath_no,
-                              const base::chained_strings::node *_prefix,
+                              base::PathTree::Index _prefix,
                               Source &_ctx)
 {
     VFSStat stat_buffer;
@@ -502,7 +500,7 @@ bool CompressionJob::ScanItem(const std::string &_full_path,
         meta.base_path_indx = _basepath_no;
         meta.flags = static_cast<uint16_t>(Source::ItemFlags::is_dir);
         _ctx.metas.emplace_back(meta);
-        _ctx.filenames.push_back(_filename + "/", _prefix);
+        const auto directory_node = _ctx.filenames.push_back(_filename + "/", _prefix);
 
         std::vector<std::string> directory_entries;
         while( true ) {
@@ -524,7 +522,6 @@ bool CompressionJob::ScanItem(const std::string &_full_path,
             }
         }
 
-        const auto directory_node = &_ctx.filenames.back();
         for( const std::string &filename : directory_entries )
             if( !ScanItem(_full_path + "/" + filename,
                           filename,
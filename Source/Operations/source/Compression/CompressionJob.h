@@ -1,9 +1,9 @@
-// Copyright (C) 2017-2020 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "../Job.h"
 #include <VFS/VFS.h>
-#include <Base/chained_strings.h>
+#include <Base/PathTree.h>
 
 struct archive;
 
@@ -72,11 +72,11 @@ private:
                   const std::string &_filename,
                   unsigned _vfs_no,
                   unsigned _basepath_no,
-                  const base::chained_strings::node *_prefix,
+                  base::PathTree::Index _prefix,
                   Source &_ctx);
     bool BuildArchive();
     void ProcessItems();
-    void ProcessItem(const base::chained_strings::node &_node, int _index);
+    void ProcessItem(int _index);
     StepResult ProcessDirectoryItem(int _index,
                                     const std::string &_relative_path,
                                     const std::string &_full_path);
@@ -1,25 +1,22 @@
-// Copyright (C) 2017-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "ChecksumExpectation.h"
 
 namespace nc::ops::copying {
 
 ChecksumExpectation::ChecksumExpectation(int _source_ind,
                                          std::string _destination,
-                                         const std::vector<uint8_t> &_md5 ):
+                                         std::vector<uint8_t> _checksum ):
     destination_path( std::move(_destination) ),
-    original_item( _source_ind )
+    original_item( _source_ind ),
+    checksum( std::move(_checksum) )
 {
-    if(_md5.size() != 16)
-        throw std::invalid_argument("ChecksumExpectation: _md5 should be 16 bytes long!");
-    std::copy(std::begin(_md5), std::end(_md5), std::begin(md5.buf));
+    if( checksum.empty() )
+        throw std::invalid_argument("ChecksumExpectation: _checksum can't be empty!");
 }
 
 bool operator==( const ChecksumExpectation &_lhs, const std::vector<uint8_t> &_rhs ) noexcept
 {
-    return _rhs.size() == 16 &&
-        std::equal(std::begin(_rhs),
-                   std::end(_rhs),
-                   std::begin(_lhs.md5.buf));
+    return _lhs.checksum == _rhs;
 }
 
 bool operator==( const std::vector<uint8_t> &_rhs, const ChecksumExpectation &_lhs ) noexcept
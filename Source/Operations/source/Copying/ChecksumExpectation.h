@@ -1,4 +1,4 @@
-// Copyright (C) 2017-2018 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <string>
@@ -11,12 +11,10 @@ struct ChecksumExpectation
 {
     ChecksumExpectation(int _source_ind,
                         std::string _destination,
-                        const std::vector<uint8_t> &_md5 );
+                        std::vector<uint8_t> _checksum );
     std::string destination_path;
     int original_item;
-    struct {
-        uint8_t buf[16];
-    } md5;
+    std::vector<uint8_t> checksum; // a digest of base::Hash, its length depends on the algorithm
 };
 
 bool operator==( const ChecksumExpectation &_lhs, const std::vector<uint8_t> &_rhs ) noexcept;
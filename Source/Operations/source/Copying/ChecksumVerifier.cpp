@@ -0,0 +1,120 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "ChecksumVerifier.h"
+#include <algorithm>
+#include <chrono>
+
+namespace nc::ops::copying {
+
+// How often Finish() checks for a stop while waiting for the worker
+static constexpr auto g_StopCheckPeriod = std::chrono::milliseconds{100};
+
+ChecksumVerifier::ChecksumVerifier(VFSHostPtr _host, bool _in_background)
+    : m_Host(std::move(_host)), m_InBackground(_in_background),
+      m_Buffer(std::make_unique<uint8_t[]>(m_BufferSize))
+{
+}
+
+ChecksumVerifier::~ChecksumVerifier()
+{
+    m_Stopped = true;
+    {
+        auto lock = std::lock_guard{m_Lock};
+        m_Pending.clear();
+    }
+    m_Workers.Wait();
+}
+
+void ChecksumVerifier::Schedule(ChecksumExpectation _expectation)
+{
+    auto lock = std::lock_guard{m_Lock};
+    m_Pending.emplace_back(std::move(_expectation));
+    if( m_InBackground && !m_Running ) {
+        m_Running = true;
+        m_Workers.Run([this] { Worker(); });
+    }
+}
+
+std::vector<ChecksumVerifier::Outcome> ChecksumVerifier::Finish(const std::function<bool()> &_should_stop)
+{
+    auto lock = std::unique_lock{m_Lock};
+    if( m_InBackground ) {
+        while( m_Running ) {
+            if( _should_stop() ) {
+                m_Stopped = true;
+                return {};
+            }
+            m_Verified.wait_for(lock, g_StopCheckPeriod);
+        }
+    }
+
+    // whatever is left is verified on the calling thread
+    while( !m_Pending.empty() ) {
+        auto expectation = std::move(m_Pending.front());
+        m_Pending.pop_front();
+        lock.unlock();
+        auto outcome = Verify(std::move(expectation), _should_stop);
+        lock.lock();
+        if( _should_stop() )
+            return {};
+        m_Outcomes.emplace_back(std::move(outcome));
+    }
+    return std::move(m_Outcomes);
+}
+
+void ChecksumVerifier::Worker()
+{
+    const auto stopped = [this] { return m_Stopped.load(); };
+    auto lock = std::unique_lock{m_Lock};
+    while( !m_Stopped && !m_Pending.empty() ) {
+        auto expectation = std::move(m_Pending.front());
+        m_Pending.pop_front();
+        lock.unlock();
+        auto outcome = Verify(std::move(expectation), stopped);
+        lock.lock();
+        m_Outcomes.emplace_back(std::move(outcome));
+    }
+    m_Running = false;
+    m_Verified.notify_all();
+}
+
+ChecksumVerifier::Outcome ChecksumVerifier::Verify(ChecksumExpectation _expectation,
+                                                   const std::function<bool()> &_should_stop)
+{
+    Outcome outcome{std::move(_expectation)};
+    const char *const path = outcome.expectation.destination_path.c_str();
+
+    VFSFilePtr file;
+    if( const int rc = m_Host->CreateFile(path, file, nullptr); rc != VFSError::Ok ) {
+        outcome.error = rc;
+        return outcome;
+    }
+
+    if( const int rc = file->Open(VFSFlags::OF_Read | VFSFlags::OF_ShLock | VFSFlags::OF_NoCache);
+        rc != VFSError::Ok ) {
+        outcome.error = rc;
+        return outcome;
+    }
+
+    base::Hash hash(Algorithm);
+    uint64_t left = file->Size();
+    while( left > 0 ) {
+        if( _should_stop() )
+            return outcome;
+
+        const ssize_t read = file->Read(m_Buffer.get(), std::min(left, uint64_t(m_BufferSize)));
+        if( read < 0 ) {
+            outcome.error = static_cast<int>(read);
+            return outcome;
+        }
+        if( read == 0 )
+            break; // the file got shorter, the checksum won't match
+        hash.Feed(m_Buffer.get(), static_cast<size_t>(read));
+        left -= static_cast<uint64_t>(read);
+    }
+    file->Close();
+
+    outcome.matched = outcome.expectation == hash.Final();
+    return outcome;
+}
+
+} // namespace nc::ops::copying
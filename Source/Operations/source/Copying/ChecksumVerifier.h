@@ -0,0 +1,64 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <Base/DispatchGroup.h>
+#include <Base/Hash.h>
+#include <VFS/VFS.h>
+#include "ChecksumExpectation.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nc::ops::copying {
+
+// Reads the copied files back and compares their checksums with the ones calculated while copying.
+// In the background mode each file is verified by a single serial worker as soon as it is scheduled, so the
+// verification overlaps with copying the next files. Otherwise the files are verified in Finish() on its caller's thread.
+// The errors are not reported by the verifier itself, they are returned along with the outcomes instead.
+class ChecksumVerifier
+{
+public:
+    // The algorithm used to calculate the checksums which are passed to Schedule()
+    static constexpr base::Hash::Mode Algorithm = base::Hash::CRC32C;
+
+    struct Outcome {
+        ChecksumExpectation expectation;
+        int error = VFSError::Ok; // failed to read the destination file
+        bool matched = false;
+    };
+
+    ChecksumVerifier(VFSHostPtr _host, bool _in_background);
+
+    // Abandons the verification and waits for the worker
+    ~ChecksumVerifier();
+
+    // Queues a file to be verified
+    void Schedule(ChecksumExpectation _expectation);
+
+    // Waits until all scheduled files are verified and returns the outcomes in the order of scheduling.
+    // _should_stop is polled between the blocks of data, an empty vector is returned if it says so.
+    std::vector<Outcome> Finish(const std::function<bool()> &_should_stop);
+
+private:
+    void Worker();
+    Outcome Verify(ChecksumExpectation _expectation, const std::function<bool()> &_should_stop);
+
+    static constexpr size_t m_BufferSize = 2 * 1024 * 1024;
+
+    const VFSHostPtr m_Host;
+    const bool m_InBackground;
+    const std::unique_ptr<uint8_t[]> m_Buffer;
+    std::mutex m_Lock;
+    std::condition_variable m_Verified;
+    std::deque<ChecksumExpectation> m_Pending;
+    std::vector<Outcome> m_Outcomes;
+    bool m_Running = false; // the worker is draining m_Pending
+    std::atomic_bool m_Stopped = false;
+    base::DispatchGroup m_Workers;
+};
+
+} // namespace nc::ops::copying
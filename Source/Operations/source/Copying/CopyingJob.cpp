@@ -6,6 +6,7 @@
 #include <sys/mount.h>
 #include <Base/algo.h>
 #include <Base/Hash.h>
+#include <Base/mach_time.h>
 #include <Utility/PathManip.h>
 #include <Utility/StringExtras.h>
 #include <RoutedIO/RoutedIO.h>
@@ -15,6 +16,8 @@
 #include <VFS/Native.h>
 #include "Helpers.h"
 #include <iostream>
+#include <bit>
+#include <cstring>
 
 using namespace nc::ops::copying;
 
@@ -28,6 +31,16 @@ static constexpr mode_t g_NewDirectoryMode = S_IRUSR | S_IXUSR | S_IWUSR | // Us
 // A bitmask of flags that have a meaning when passed to chmod()
 static constexpr mode_t g_ChModMask = S_IRWXU | S_IRWXG | S_IRWXO | S_ISUID | S_ISGID | S_ISVTX;
 
+// Size of the I/O blocks when copying between VFS files
+static constexpr uint32_t g_VFSBlockSize = 2 * 1024 * 1024;
+
+// Initial size of the buffers when copying native xattrs, larger ones make the buffers grow on demand
+static constexpr size_t g_XattrsBufferSize = 64 * 1024;
+
+// Limits of the read-ahead of small native files: amount of files and bytes held in memory at once
+static constexpr size_t g_ReadAheadMaxFiles = 256;
+static constexpr size_t g_ReadAheadMaxBytes = 32 * 1024 * 1024;
+
 // return true if _1st is older than _2nd
 static bool EntryIsOlder(const struct stat &_1st, const struct stat &_2nd);
 static bool EntryIsOlder(const VFSStat &_1st, const VFSStat &_2nd);
@@ -115,13 +128,22 @@ void CopyingJob::Perform()
         m_DestinationNativeFSInfo = fs_info;
     }
 
-    auto [scan_result, source_db] = ScanSourceItems();
-    if( scan_result != StepResult::Ok ) {
-        Stop();
-        return;
+    StartScanningSourceItems();
+    const auto discard_scanner = at_scope_end([this] { m_SourceScanner.reset(); });
+
+    // unless it's safe to process the items while the scan is still running, the scan has to be completed first.
+    // the dialogs ask whether a single item is processed, it has to be known before the processing starts - without
+    // a complete scan only a single top-level non-directory is surely the only item.
+    if( CanProcessWhileScanning() ) {
+        m_IsSingleScannedItemProcessing = m_VFSListingItems.size() == 1 && !m_VFSListingItems.front().IsDir();
+    }
+    else {
+        if( ScanSourceItems(true) != StepResult::Ok ) {
+            Stop();
+            return;
+        }
+        m_IsSingleScannedItemProcessing = m_SourceItems.ItemsAmount() == 1;
     }
-    m_SourceItems = std::move(source_db);
-    m_IsSingleScannedItemProcessing = m_SourceItems.ItemsAmount() == 1;
 
     ProcessItems();
 
@@ -135,9 +157,34 @@ void CopyingJob::ProcessItems()
 {
     SetStage(Stage::Process);
 
-    Statistics().CommitEstimated(Statistics::SourceType::Bytes, m_SourceItems.TotalRegBytes());
+    // small native files are opened and read in background while the current item is being written
+    if( m_Options.docopy && m_Options.read_ahead_streams > 0 && m_IsDestinationHostNative &&
+        !routedio::RoutedIO::Default.isrouted() )
+        m_ReadAhead = std::make_unique<copying::NativeReadAhead>(
+            m_Options.read_ahead_streams, g_ReadAheadMaxFiles, g_ReadAheadMaxBytes);
+    const auto discard_read_ahead = at_scope_end([this] { m_ReadAhead.reset(); });
+
+    // the copied files are read back while the next ones are being copied, unless the destination isn't native
+    if( m_Options.verification == ChecksumVerification::Always ||
+        (!m_Options.docopy && m_Options.verification >= ChecksumVerification::WhenMoves) )
+        m_Verifier = std::make_unique<copying::ChecksumVerifier>(m_DestinationHost, m_IsDestinationHostNative);
+    const auto discard_verifier = at_scope_end([this] { m_Verifier.reset(); });
+    int read_ahead_index = 0;
+
+    for( int index = 0;; ++index ) {
+        if( index == m_SourceItems.ItemsAmount() ) {
+            // pick up the items scanned meanwhile, if the scan is still running
+            if( ScanSourceItems(false) != StepResult::Ok ) {
+                Stop();
+                return;
+            }
+            if( index == m_SourceItems.ItemsAmount() )
+                break;
+        }
+
+        if( m_ReadAhead )
+            read_ahead_index = ScheduleReadAhead(std::max(read_ahead_index, index + 1));
 
-    for( int index = 0, index_end = m_SourceItems.ItemsAmount(); index != index_end; ++index ) {
         const auto step_result = ProcessItemNo(index);
 
         // check current item result
@@ -149,6 +196,8 @@ void CopyingJob::ProcessItems()
             return;
     }
 
+    m_ReadAhead.reset();
+
     // Do a permissions fixup if required afterwards
     ApplyPermissionFixups();
     if( BlockIfPaused(); IsStopped() )
@@ -160,13 +209,24 @@ void CopyingJob::ProcessItems()
         return;
 
     bool all_matched = true;
-    if( !m_Checksums.empty() ) {
+    if( m_Verifier ) {
         SetStage(Stage::Verify);
-        for( auto &item : m_Checksums ) {
-            bool matched = false;
-            auto step_result = VerifyCopiedFile(item, matched);
-            if( step_result != StepResult::Ok || matched != true ) {
-                m_OnFileVerificationFailed(item.destination_path, *m_DestinationHost);
+        const auto outcomes = m_Verifier->Finish([this] {
+            BlockIfPaused();
+            return IsStopped();
+        });
+        if( IsStopped() )
+            return;
+        for( auto &outcome : outcomes ) {
+            const auto &path = outcome.expectation.destination_path;
+            if( outcome.error != VFSError::Ok &&
+                m_OnDestinationFileReadError(outcome.error, path, *m_DestinationHost) ==
+                    DestinationFileReadErrorResolution::Stop ) {
+                Stop();
+                return;
+            }
+            if( !outcome.matched ) {
+                m_OnFileVerificationFailed(path, *m_DestinationHost);
                 all_matched = false;
             }
         }
@@ -212,14 +272,12 @@ CopyingJob::StepResult CopyingJob::ProcessItemNo(int _item_number)
         std::optional<base::Hash> hash; // this optional will be filled with the first call of hash_feedback
         auto hash_feedback = [&](const void *_data, unsigned _sz) {
             if( !hash )
-                hash.emplace(base::Hash::MD5);
+                hash.emplace(copying::ChecksumVerifier::Algorithm);
             hash->Feed(_data, _sz);
         };
 
         std::function<void(const void *_data, unsigned _sz)> data_feedback = nullptr;
-        if( m_Options.verification == ChecksumVerification::Always )
-            data_feedback = hash_feedback;
-        else if( !m_Options.docopy && m_Options.verification >= ChecksumVerification::WhenMoves )
+        if( m_Verifier )
             data_feedback = hash_feedback;
 
         if( source_host.IsNativeFS() && m_IsDestinationHostNative ) { // native -> native ///////////////////////
@@ -229,7 +287,8 @@ CopyingJob::StepResult CopyingJob::ProcessItemNo(int _item_number)
                                                          source_path,
                                                          destination_path,
                                                          data_feedback,
-                                                         nonexistent_dst_req_handler);
+                                                         nonexistent_dst_req_handler,
+                                                         m_ReadAhead ? m_ReadAhead->Take(_item_number) : nullptr);
             }
             else {
                 if( is_same_native_volume() ) { // rename
@@ -245,7 +304,8 @@ CopyingJob::StepResult CopyingJob::ProcessItemNo(int _item_number)
                                                              source_path,
                                                              destination_path,
                                                              data_feedback,
-                                                             nonexistent_dst_req_handler);
+                                                             nonexistent_dst_req_handler,
+                                                             nullptr);
                     if( step_result == StepResult::Ok )
                         m_SourceItemsToDelete.emplace_back(_item_number); // mark source file for deletion
                 }
@@ -289,7 +349,7 @@ CopyingJob::StepResult CopyingJob::ProcessItemNo(int _item_number)
 
         // check step result?
         if( hash )
-            m_Checksums.emplace_back(_item_number, destination_path, hash->Final());
+            m_Verifier->Schedule({_item_number, destination_path, hash->Final()});
     }
     else if( S_ISDIR(source_mode) )
         step_result = ProcessDirectoryItem(source_host, source_path, _item_number, destination_path);
@@ -305,6 +365,20 @@ CopyingJob::StepResult CopyingJob::ProcessItemNo(int _item_number)
     return step_result;
 }
 
+int CopyingJob::ScheduleReadAhead(int _from_item_index)
+{
+    assert(m_ReadAhead);
+    int index = _from_item_index;
+    for( const int index_end = m_SourceItems.ItemsAmount(); index != index_end; ++index ) {
+        if( !S_ISREG(m_SourceItems.ItemMode(index)) || !m_SourceItems.ItemHost(index).IsNativeFS() ||
+            m_SourceItems.ItemSize(index) > copying::NativeReadAhead::MaxFileSize )
+            continue;
+        if( !m_ReadAhead->Enqueue(index, m_SourceItems.ComposeFullPath(index), m_SourceItems.ItemSize(index)) )
+            break; // the read-ahead is full, will continue from this item later
+    }
+    return index;
+}
+
 CopyingJob::StepResult CopyingJob::ProcessDirectoryItem(VFSHost &_source_host,
                                                         const std::string &_source_path,
                                                         int _source_index,
@@ -421,27 +495,26 @@ CopyingJob::StepResult CopyingJob::ProcessSymlinkItem(VFSHost &_source_host,
     return StepResult::Stop;
 }
 
-std::string CopyingJob::ComposeDestinationNameForItemInDB(int _src_item_index, const copying::SourceItems &_db) const
+std::string CopyingJob::ComposeDestinationNameForRelativePath(const std::string &_relative_src_path) const
 {
-    const auto relative_src_path = _db.ComposeRelativePath(_src_item_index);
     if( m_PathCompositionType == PathCompositionType::PathPreffix ) {
         // PathPreffix, path = dest_path + source_rel_path
-        return m_DestinationPath + relative_src_path;
+        return m_DestinationPath + _relative_src_path;
     }
     else {
         // FixedPath, path = dest_path + [source_rel_path without heading]
         // for top level we need to just leave path without changes: skip top level's entry name.
         // for nested entries we need to cut the first part of a path.
         auto result = m_DestinationPath;
-        if( const auto slash = relative_src_path.find('/'); slash != std::string::npos )
-            result.append(relative_src_path, slash);
+        if( const auto slash = _relative_src_path.find('/'); slash != std::string::npos )
+            result.append(_relative_src_path, slash);
         return result;
     }
 }
 
 std::string CopyingJob::ComposeDestinationNameForItem(int _src_item_index) const
 {
-    return ComposeDestinationNameForItemInDB(_src_item_index, m_SourceItems);
+    return ComposeDestinationNameForRelativePath(m_SourceItems.ComposeRelativePath(_src_item_index));
 }
 
 static bool IsSingleDirectoryCaseRenaming(const CopyingOptions &_options,
@@ -571,126 +644,116 @@ CopyingJob::StepResult CopyingJob::BuildDestinationDirectory() const
     return StepResult::Ok;
 }
 
-std::tuple<CopyingJob::StepResult, SourceItems> CopyingJob::ScanSourceItems()
+void CopyingJob::StartScanningSourceItems()
 {
-    class SourceItems db;
-    auto stat_flags = m_Options.preserve_symlinks ? VFSFlags::F_NoFollow : 0;
+    SourceScanner::Callbacks callbacks;
+    callbacks.on_cant_access = [this](int _vfs_error, const std::string &_path, VFSHost &_host) {
+        return m_OnCantAccessSourceItem(_vfs_error, _path, _host);
+    };
+    callbacks.is_left_out =
+        [this](VFSHost &_host, const std::string &_path, const std::string &_name, const VFSStat &_st) {
+            // we're skipping "._xxx" files as they are processed by OS itself when we copy xattrs
+            return IsAnExternalExtenedAttributesStorage(_host, _path, _name, _st, m_NativeFSManager);
+        };
+    callbacks.should_go_inside = [this](VFSHost &_host, const std::string &_path, const std::string &_relative_path) {
+        return ShouldScanDirectoryContents(_host, _path, _relative_path);
+    };
+    callbacks.is_stopped = [this] { return IsStopped(); };
 
-    for( auto &i : m_VFSListingItems ) {
+    const auto stat_flags = m_Options.preserve_symlinks ? VFSFlags::F_NoFollow : 0;
+    m_SourceScanner = std::make_unique<SourceScanner>(
+        m_SourceItems, m_VFSListingItems, m_Options.scan_streams, stat_flags, std::move(callbacks));
+}
+
+CopyingJob::StepResult CopyingJob::ScanSourceItems(bool _till_the_end)
+{
+    while( m_SourceScanner ) {
         if( BlockIfPaused(); IsStopped() )
-            return {StepResult::Stop, {}};
-
-        auto host_indx = db.InsertOrFindHost(i.Host());
-        auto &host = db.Host(host_indx);
-        auto base_dir_indx = db.InsertOrFindBaseDir(i.Directory());
-        std::function<StepResult(int _parent_ind,
-                                 const std::string &_full_relative_path,
-                                 const std::string &_item_name)> // need function holder for recursion to work
-            scan_item = [this, &db, stat_flags, host_indx, &host, base_dir_indx, &scan_item](
-                            int _parent_ind,
-                            const std::string &_full_relative_path,
-                            const std::string &_item_name) -> StepResult {
-            // compose a full path for current entry
-            const std::string path = db.BaseDir(base_dir_indx) + _full_relative_path;
-
-            // gather stat() information regarding current entry
-            VFSStat st;
-            while( true ) {
-                const auto rc = host.Stat(path.c_str(), st, stat_flags, nullptr);
-                if( rc == VFSError::Ok )
-                    break;
-                switch( m_OnCantAccessSourceItem(rc, path, host) ) {
-                    case CantAccessSourceItemResolution::Skip:
-                        return StepResult::Skipped;
-                    case CantAccessSourceItemResolution::Stop:
-                        return StepResult::Stop;
-                    case CantAccessSourceItemResolution::Retry:
-                        continue;
-                }
-            }
+            return StepResult::Stop;
 
-            if( S_ISREG(st.mode) ) {
-                // check if file is an external EA
-                if( IsAnExternalExtenedAttributesStorage(host, path, _item_name, st, m_NativeFSManager) )
-                    // we're skipping "._xxx" files as they are processed by OS itself
-                    // when we copy xattrs
-                    return StepResult::Ok;
+        if( m_SourceScanner->Pull() == SourceScanner::Progress::Stopped )
+            return StepResult::Stop;
 
-                db.InsertItem(host_indx, base_dir_indx, _parent_ind, _item_name, st);
-            }
-            else if( S_ISLNK(st.mode) ) {
-                db.InsertItem(host_indx, base_dir_indx, _parent_ind, _item_name, st);
-            }
-            else if( S_ISDIR(st.mode) ) {
-                const int my_indx = db.InsertItem(host_indx, base_dir_indx, _parent_ind, _item_name, st);
-
-                bool should_go_inside = m_Options.docopy;
-                if( !should_go_inside ) {
-                    // if we're not copying - need to check if vfs is the same.
-                    // comparing hosts by their addresses, which is NOT GREAT at all
-                    if( &host != &*m_DestinationHost )
-                        should_go_inside = true;
-                }
-                if( !should_go_inside ) {
-                    // check if we're on the same native volume
-                    if( m_IsDestinationHostNative &&
-                        m_DestinationNativeFSInfo != m_NativeFSManager->VolumeFromPath(path) )
-                        should_go_inside = true;
-                }
-                if( !should_go_inside ) {
-                    // if we're renaming, and there's a destination file already
-                    if( !m_IsSingleDirectoryCaseRenaming ) {
-                        const auto dest_path = ComposeDestinationNameForItemInDB(my_indx, db);
-                        if( !LowercaseEqual(path, dest_path) && m_DestinationHost->Exists(dest_path.c_str()) )
-                            should_go_inside = true;
-                    }
-                }
+        Statistics().CommitEstimated(Statistics::SourceType::Bytes, m_SourceItems.TotalRegBytes() - m_EstimatedBytes);
+        m_EstimatedBytes = m_SourceItems.TotalRegBytes();
 
-                if( should_go_inside ) {
-                    std::vector<std::string> dir_ents;
-                    while( true ) {
-                        const auto callback = [&](auto &_) {
-                            dir_ents.emplace_back(_.name);
-                            return true;
-                        };
-                        const auto rc = host.IterateDirectoryListing(path.c_str(), callback);
-                        if( rc == VFSError::Ok )
-                            break;
-                        switch( m_OnCantAccessSourceItem(rc, path, host) ) {
-                            case CantAccessSourceItemResolution::Skip:
-                                return StepResult::Skipped;
-                            case CantAccessSourceItemResolution::Stop:
-                                return StepResult::Stop;
-                            case CantAccessSourceItemResolution::Retry:
-                                continue;
-                        }
-                    }
+        if( m_SourceScanner->Finished() )
+            m_SourceScanner.reset();
 
-                    for( auto &entry : dir_ents ) {
-                        if( BlockIfPaused(); IsStopped() )
-                            return StepResult::Stop;
+        if( !_till_the_end )
+            break;
+    }
+    return StepResult::Ok;
+}
 
-                        // go into recursion
-                        scan_item(my_indx, _full_relative_path + '/' + entry, entry);
-                    }
-                }
-            }
+bool CopyingJob::ShouldScanDirectoryContents(VFSHost &_host,
+                                             const std::string &_path,
+                                             const std::string &_relative_path) const
+{
+    if( m_Options.docopy )
+        return true;
 
-            return StepResult::Ok;
-        };
+    // if we're not copying - need to check if vfs is the same.
+    // comparing hosts by their addresses, which is NOT GREAT at all
+    if( &_host != &*m_DestinationHost )
+        return true;
+
+    // check if we're on the same native volume
+    if( m_IsDestinationHostNative && m_DestinationNativeFSInfo != m_NativeFSManager->VolumeFromPath(_path) )
+        return true;
 
-        auto result = scan_item(-1, i.Filename(), i.Filename());
-        if( result != StepResult::Ok )
-            return {result, {}};
+    // if we're renaming, and there's a destination file already
+    if( !m_IsSingleDirectoryCaseRenaming ) {
+        const auto dest_path = ComposeDestinationNameForRelativePath(_relative_path);
+        if( !LowercaseEqual(_path, dest_path) && m_DestinationHost->Exists(dest_path.c_str()) )
+            return true;
     }
 
-    return {StepResult::Ok, std::move(db)};
+    return false;
+}
+
+// Returns true if _path is _directory itself or is located somewhere inside it, ignoring the case
+static bool IsSameOrInside(std::string_view _path, std::string_view _directory) noexcept
+{
+    while( !_directory.empty() && _directory.back() == '/' )
+        _directory.remove_suffix(1);
+    if( _path.size() < _directory.size() || !LowercaseEqual(_path.substr(0, _directory.size()), _directory) )
+        return false;
+    return _path.size() == _directory.size() || _path[_directory.size()] == '/';
+}
+
+bool CopyingJob::CanProcessWhileScanning() const
+{
+    // moving changes the source items, the scan has to see them intact
+    if( !m_Options.docopy )
+        return false;
+
+    // neither should the copies be written somewhere into the items being scanned
+    for( auto &item : m_VFSListingItems ) {
+        if( item.Host() != m_DestinationHost && !(item.Host()->IsNativeFS() && m_IsDestinationHostNative) )
+            continue;
+        const auto source_path = item.Path();
+        const auto destination_path = ComposeDestinationNameForRelativePath(item.Filename());
+        if( IsSameOrInside(destination_path, source_path) || IsSameOrInside(source_path, destination_path) )
+            return false;
+    }
+    return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 // native file -> native file copying routine
 ////////////////////////////////////////////////////////////////////////////////////////////////////
 
+copying::IOTuner &CopyingJob::IOTunerFor(const utility::NativeFileSystemInfo &_source,
+                                         const utility::NativeFileSystemInfo &_destination)
+{
+    auto volumes = IOTuner::VolumesIdentity(_source, _destination);
+    if( auto it = m_IOTuners.find(volumes); it != m_IOTuners.end() )
+        return it->second;
+    const size_t initial_block_size = std::max(_source.basic.io_size, _destination.basic.io_size);
+    return m_IOTuners.emplace(volumes, IOTuner(volumes, initial_block_size)).first->second;
+}
+
 static void TurnIntoBlockingOrThrow(const int _fd)
 {
     // get current file descriptor's open flags
@@ -708,17 +771,44 @@ static void TurnIntoBlockingOrThrow(const int _fd)
     }
 }
 
+// Size of the buffers to read the next block into: the block size, unless less is left to read.
+// Rounded up to a power of two, so that a series of growing files doesn't reallocate the buffers over and over.
+static size_t BufferSizeFor(size_t _block_size, uint64_t _left_to_read) noexcept
+{
+    if( _left_to_read == 0 )
+        return 0;
+    return std::bit_ceil(static_cast<size_t>(
+        std::min<uint64_t>(_block_size, std::max<uint64_t>(_left_to_read, IOTuner::MinBlockSize))));
+}
+
+// Reopens a source file which was read ahead and closed, returns -1 if it's gone or was replaced meanwhile
+static int ReopenPrefetchedSource(const std::string &_path, const struct stat &_st)
+{
+    auto &io = routedio::RoutedIO::Default;
+    const int fd = io.open(_path.c_str(), O_RDONLY | O_NONBLOCK);
+    if( fd < 0 )
+        return -1;
+    struct stat st;
+    if( fstat(fd, &st) != 0 || st.st_dev != _st.st_dev || st.st_ino != _st.st_ino ) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
 CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_native_host,
                                                               const std::string &_src_path,
                                                               const std::string &_dst_path,
                                                               const SourceDataFeedback &_source_data_feedback,
-                                                              const RequestNonexistentDst &_new_dst_callback)
+                                                              const RequestNonexistentDst &_new_dst_callback,
+                                                              std::unique_ptr<NativeReadAhead::File> _prefetched_source)
 {
     auto &io = routedio::RoutedIO::Default;
 
     // we initially try to open a source file in non-blocking mode, so we can fail early.
+    // a file fetched by the read-ahead is already read and closed, it's reopened only to copy its xattrs.
     int source_fd = -1;
-    while( true ) {
+    while( !_prefetched_source && source_fd < 0 ) {
         source_fd = io.open(_src_path.c_str(), O_RDONLY | O_NONBLOCK | O_SHLOCK);
         if( source_fd == -1 )
             source_fd = io.open(_src_path.c_str(), O_RDONLY | O_NONBLOCK);
@@ -740,30 +830,36 @@ CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_
             close(source_fd);
     });
 
-    // do not waste OS file cache with one-way data
-    fcntl(source_fd, F_NOCACHE, 1);
-
-    TurnIntoBlockingOrThrow(source_fd);
-
     // get information about source file
     struct stat src_stat_buffer;
-    while( true ) {
-        const auto rc = fstat(source_fd, &src_stat_buffer);
-        if( rc == 0 )
-            break;
-        switch( m_OnCantAccessSourceItem(VFSError::FromErrno(), _src_path, _native_host) ) {
-            case CantAccessSourceItemResolution::Skip:
-                return StepResult::Skipped;
-            case CantAccessSourceItemResolution::Stop:
-                return StepResult::Stop;
-            case CantAccessSourceItemResolution::Retry:
-                continue;
+    if( _prefetched_source ) {
+        src_stat_buffer = _prefetched_source->st;
+    }
+    else {
+        // do not waste OS file cache with one-way data
+        fcntl(source_fd, F_NOCACHE, 1);
+
+        TurnIntoBlockingOrThrow(source_fd);
+
+        while( true ) {
+            const auto rc = fstat(source_fd, &src_stat_buffer);
+            if( rc == 0 )
+                break;
+            switch( m_OnCantAccessSourceItem(VFSError::FromErrno(), _src_path, _native_host) ) {
+                case CantAccessSourceItemResolution::Skip:
+                    return StepResult::Skipped;
+                case CantAccessSourceItemResolution::Stop:
+                    return StepResult::Stop;
+                case CantAccessSourceItemResolution::Retry:
+                    continue;
+            }
         }
     }
 
     // find fs info for source file.
     assert(m_NativeFSManager);
-    auto src_fs_info_holder = m_NativeFSManager->VolumeFromFD(source_fd);
+    auto src_fs_info_holder = _prefetched_source ? m_NativeFSManager->VolumeFromPath(_src_path)
+                                                 : m_NativeFSManager->VolumeFromFD(source_fd);
     if( !src_fs_info_holder ) {
         std::cerr << "Failed to find fs_info for dev_id: " << src_stat_buffer.st_dev << std::endl;
         return StepResult::Stop; // something VERY BAD has happened, can't go on
@@ -928,16 +1024,21 @@ CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_
         }
     }
 
+    auto &tuner = IOTunerFor(src_fs_info, dst_fs_info); // adjusts the block size on the go
+    ReserveBuffers(BufferSizeFor(tuner.BlockSize(), _prefetched_source ? 0 : src_stat_buffer.st_size));
     auto read_buffer = m_Buffers[0].get(), write_buffer = m_Buffers[1].get();
-    const uint32_t src_preferred_io_size =
-        src_fs_info.basic.io_size < m_BufferSize ? src_fs_info.basic.io_size : m_BufferSize;
-    const uint32_t dst_preferred_io_size =
-        dst_fs_info.basic.io_size < m_BufferSize ? dst_fs_info.basic.io_size : m_BufferSize;
     constexpr int max_io_loops = 5; // looked in Apple's copyfile() - treat 5 zero-resulting reads/writes as an error
     uint32_t bytes_to_write = 0;
     uint64_t source_bytes_read = 0;
     uint64_t destination_bytes_written = 0;
 
+    // the read-ahead has already fetched the whole file, so only the writing is left
+    if( _prefetched_source ) {
+        write_buffer = _prefetched_source->data.get();
+        bytes_to_write = static_cast<uint32_t>(src_stat_buffer.st_size);
+        source_bytes_read = bytes_to_write;
+    }
+
     // read from source within current thread and write to destination within secondary queue
     while( static_cast<uint64_t>(src_stat_buffer.st_size) != destination_bytes_written ) {
 
@@ -945,23 +1046,34 @@ CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_
         if( BlockIfPaused(); IsStopped() )
             return StepResult::Stop;
 
+        const auto step_start = base::machtime();
+        const auto block_size = static_cast<uint32_t>(tuner.BlockSize());
+
+        // the buffers grow along with the block size, carrying over the block which is yet to be written
+        ReserveBuffers(BufferSizeFor(block_size, src_stat_buffer.st_size - source_bytes_read),
+                       {&read_buffer, &write_buffer});
+
         // <<<--- writing in secondary thread --->>>
         std::optional<StepResult> write_return; // optional storage for error returning
+        std::chrono::nanoseconds write_time{0};
         m_IOGroup.Run([this,
                        bytes_to_write,
                        destination_fd,
                        write_buffer,
-                       dst_preferred_io_size,
+                       block_size,
                        &destination_bytes_written,
                        &write_return,
+                       &write_time,
                        &_dst_path,
                        &_native_host] {
+            const auto write_start = base::machtime();
+            const auto measure_write = at_scope_end([&] { write_time = base::machtime() - write_start; });
             uint32_t left_to_write = bytes_to_write;
             uint32_t has_written = 0; // amount of bytes written into destination this time
             int write_loops = 0;
             while( left_to_write > 0 ) {
                 int64_t n_written =
-                    write(destination_fd, write_buffer + has_written, std::min(left_to_write, dst_preferred_io_size));
+                    write(destination_fd, write_buffer + has_written, std::min(left_to_write, block_size));
                 if( n_written > 0 ) {
                     has_written += n_written;
                     left_to_write -= n_written;
@@ -982,9 +1094,15 @@ CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_
             }
         });
 
+        // <<<--- hashing the same data in yet another background thread --->>>
+        if( _source_data_feedback && bytes_to_write != 0 )
+            m_IOGroup.Run([&_source_data_feedback, write_buffer, bytes_to_write] {
+                _source_data_feedback(write_buffer, bytes_to_write);
+            });
+
         // <<<--- reading in current thread --->>>
-        // here we handle the case in which source io size is much smaller than dest's io size
-        uint32_t to_read = std::max(src_preferred_io_size, dst_preferred_io_size);
+        const auto read_start = base::machtime();
+        uint32_t to_read = block_size;
         if( src_stat_buffer.st_size - source_bytes_read < to_read )
             to_read = uint32_t(src_stat_buffer.st_size - source_bytes_read);
         uint32_t has_read = 0;                 // amount of bytes read into buffer this time
@@ -994,8 +1112,6 @@ CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_
             const int64_t read_result = read(source_fd, read_buffer + has_read, to_read);
             assert(read_result <= static_cast<int64_t>(to_read));
             if( read_result > 0 ) {
-                if( _source_data_feedback )
-                    _source_data_feedback(read_buffer + has_read, static_cast<unsigned>(read_result));
                 source_bytes_read += read_result;
                 has_read += read_result;
                 to_read -= read_result;
@@ -1015,6 +1131,8 @@ CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_
             }
         }
 
+        const auto read_time = base::machtime() - read_start;
+
         m_IOGroup.Wait();
 
         // if something bad happened in reading or writing - return from this routine
@@ -1025,6 +1143,17 @@ CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_
 
         Statistics().CommitProcessed(Statistics::SourceType::Bytes, bytes_to_write);
 
+        // let the tuner know how fast this step was and expose its decision
+        tuner.Report({.read_bytes = has_read,
+                      .read_time = read_time,
+                      .written_bytes = bytes_to_write,
+                      .write_time = write_time,
+                      .step_time = base::machtime() - step_start});
+        Statistics().CommitIO({.block_size = block_size,
+                               .queue_depth = std::size(m_Buffers),
+                               .read_speed = tuner.ReadSpeed(),
+                               .write_speed = tuner.WriteSpeed()});
+
         // swap buffers ang go again
         bytes_to_write = has_read;
         std::swap(read_buffer, write_buffer);
@@ -1039,8 +1168,12 @@ CopyingJob::StepResult CopyingJob::CopyNativeFileToNativeFile(vfs::NativeHost &_
         if( do_erase_xattrs ) // erase destination's xattrs
             EraseXattrsFromNativeFD(destination_fd);
 
-        if( do_copy_xattrs ) // copy xattrs from src to dest
-            CopyXattrsFromNativeFDToNativeFD(source_fd, destination_fd);
+        if( do_copy_xattrs ) { // copy xattrs from src to dest
+            if( _prefetched_source )
+                source_fd = ReopenPrefetchedSource(_src_path, src_stat_buffer);
+            if( source_fd >= 0 )
+                CopyXattrsFromNativeFDToNativeFD(source_fd, destination_fd);
+        }
     }
 
     // do flags things
@@ -1298,12 +1431,13 @@ CopyingJob::StepResult CopyingJob::CopyVFSFileToNativeFile(VFSHost &_src_vfs,
         }
     }
 
-    auto read_buffer = m_Buffers[0].get(), write_buffer = m_Buffers[1].get();
     const uint32_t dst_preffered_io_size =
-        dst_fs_info.basic.io_size < m_BufferSize ? dst_fs_info.basic.io_size : m_BufferSize;
+        dst_fs_info.basic.io_size < g_VFSBlockSize ? dst_fs_info.basic.io_size : g_VFSBlockSize;
     const uint32_t src_preffered_io_size =
         src_file->PreferredIOSize() > 0 ? src_file->PreferredIOSize() : // use custom IO size for this vfs
             dst_preffered_io_size;  // not sure if this is a good idea, but seems to be ok
+    ReserveBuffers(std::max(src_preffered_io_size, dst_preffered_io_size));
+    auto read_buffer = m_Buffers[0].get(), write_buffer = m_Buffers[1].get();
     constexpr int max_io_loops = 5; // looked in Apple's copyfile() - treat 5 zero-resulting reads/writes as an error
     uint32_t bytes_to_write = 0;
     uint64_t source_bytes_read = 0;
@@ -1353,6 +1487,12 @@ CopyingJob::StepResult CopyingJob::CopyVFSFileToNativeFile(VFSHost &_src_vfs,
             }
         });
 
+        // <<<--- hashing the same data in yet another background thread --->>>
+        if( _source_data_feedback && bytes_to_write != 0 )
+            m_IOGroup.Run([&_source_data_feedback, write_buffer, bytes_to_write] {
+                _source_data_feedback(write_buffer, bytes_to_write);
+            });
+
         // <<<--- reading in current thread --->>>
         // here we handle the case in which source io size is much smaller than dest's io size
         uint32_t to_read = std::max(src_preffered_io_size, dst_preffered_io_size);
@@ -1364,8 +1504,6 @@ CopyingJob::StepResult CopyingJob::CopyVFSFileToNativeFile(VFSHost &_src_vfs,
         while( to_read != 0 ) {
             int64_t read_result = src_file->Read(read_buffer + has_read, std::min(to_read, src_preffered_io_size));
             if( read_result > 0 ) {
-                if( _source_data_feedback )
-                    _source_data_feedback(read_buffer + has_read, static_cast<unsigned>(read_result));
                 source_bytes_read += read_result;
                 has_read += read_result;
                 assert(to_read >= read_result); // regression assert
@@ -1627,9 +1765,10 @@ CopyingJob::StepResult CopyingJob::CopyVFSFileToVFSFile(VFSHost &_src_vfs,
         }
     }
 
+    const uint32_t dst_preffered_io_size = g_VFSBlockSize;
+    const uint32_t src_preffered_io_size = g_VFSBlockSize;
+    ReserveBuffers(g_VFSBlockSize);
     auto read_buffer = m_Buffers[0].get(), write_buffer = m_Buffers[1].get();
-    const uint32_t dst_preffered_io_size = m_BufferSize;
-    const uint32_t src_preffered_io_size = m_BufferSize;
     constexpr int max_io_loops = 5; // looked in Apple's copyfile() - treat 5 zero-resulting reads/writes as an error
     uint32_t bytes_to_write = 0;
     uint64_t source_bytes_read = 0;
@@ -1681,6 +1820,12 @@ CopyingJob::StepResult CopyingJob::CopyVFSFileToVFSFile(VFSHost &_src_vfs,
             }
         });
 
+        // <<<--- hashing the same data in yet another background thread --->>>
+        if( _source_data_feedback && bytes_to_write != 0 )
+            m_IOGroup.Run([&_source_data_feedback, write_buffer, bytes_to_write] {
+                _source_data_feedback(write_buffer, bytes_to_write);
+            });
+
         // <<<--- reading in current thread --->>>
         // here we handle the case in which source io size is much smaller than dest's io size
         uint32_t to_read = std::max(src_preffered_io_size, dst_preffered_io_size);
@@ -1692,8 +1837,6 @@ CopyingJob::StepResult CopyingJob::CopyVFSFileToVFSFile(VFSHost &_src_vfs,
         while( to_read != 0 ) {
             int64_t read_result = src_file->Read(read_buffer + has_read, std::min(to_read, src_preffered_io_size));
             if( read_result > 0 ) {
-                if( _source_data_feedback )
-                    _source_data_feedback(read_buffer + has_read, static_cast<unsigned>(read_result));
                 source_bytes_read += read_result;
                 has_read += read_result;
                 to_read -= read_result;
@@ -1748,10 +1891,33 @@ CopyingJob::StepResult CopyingJob::CopyVFSFileToVFSFile(VFSHost &_src_vfs,
     return StepResult::Ok;
 }
 
+void CopyingJob::ReserveBuffers(size_t _size, std::initializer_list<uint8_t **> _pointers) const
+{
+    if( _size <= m_BufferSize )
+        return;
+
+    // the contents are preserved and the pointers into the old buffers are moved into the new ones
+    for( auto &buffer : m_Buffers ) {
+        auto grown = std::make_unique<uint8_t[]>(_size);
+        if( buffer ) {
+            std::memcpy(grown.get(), buffer.get(), m_BufferSize);
+            for( auto pointer : _pointers )
+                if( *pointer == buffer.get() )
+                    *pointer = grown.get();
+        }
+        buffer = std::move(grown);
+    }
+    m_BufferSize = _size;
+}
+
 // uses m_Buffer[0] to reduce mallocs
 // currently there's no error handling or reporting here. may need this in the future. maybe.
 void CopyingJob::EraseXattrsFromNativeFD(int _fd_in) const
 {
+    const auto names_size = flistxattr(_fd_in, nullptr, 0, 0);
+    if( names_size <= 0 )
+        return;
+    ReserveBuffers(names_size);
     auto xnames = reinterpret_cast<char *>(m_Buffers[0].get());
     auto xnamesizes = flistxattr(_fd_in, xnames, m_BufferSize, 0);
     for( auto s = xnames, e = xnames + xnamesizes; s < e; s += strlen(s) + 1 ) // iterate thru xattr names..
@@ -1762,18 +1928,34 @@ void CopyingJob::EraseXattrsFromNativeFD(int _fd_in) const
 // currently there's no error handling or reporting here. may need this in the future. maybe.
 void CopyingJob::CopyXattrsFromNativeFDToNativeFD(int _fd_from, int _fd_to) const
 {
+    const auto names_size = flistxattr(_fd_from, nullptr, 0, 0);
+    if( names_size <= 0 )
+        return;
+    ReserveBuffers(std::max(static_cast<size_t>(names_size), g_XattrsBufferSize));
     auto xnames = reinterpret_cast<char *>(m_Buffers[0].get());
-    auto xdata = m_Buffers[1].get();
     auto xnamesizes = flistxattr(_fd_from, xnames, m_BufferSize, 0);
     for( auto s = xnames, e = xnames + xnamesizes; s < e; s += strlen(s) + 1 ) { // iterate thru xattr names..
-        auto xattrsize = fgetxattr(_fd_from, s, xdata, m_BufferSize, 0, 0);      // and read all these xattrs
-        if( xattrsize >= 0 )                              // xattr can be zero-length, just a tag itself
-            fsetxattr(_fd_to, s, xdata, xattrsize, 0, 0); // write them into _fd_to
+        // and read all these xattrs
+        auto xattrsize = fgetxattr(_fd_from, s, m_Buffers[1].get(), m_BufferSize, 0, 0);
+        if( xattrsize < 0 && errno == ERANGE ) { // a large one, e.g. a resource fork - grow the buffers and try again
+            const auto required_size = fgetxattr(_fd_from, s, nullptr, 0, 0, 0);
+            if( required_size > 0 ) {
+                const auto names_offset = s - xnames;
+                ReserveBuffers(required_size);
+                xnames = reinterpret_cast<char *>(m_Buffers[0].get());
+                s = xnames + names_offset;
+                e = xnames + xnamesizes;
+                xattrsize = fgetxattr(_fd_from, s, m_Buffers[1].get(), m_BufferSize, 0, 0);
+            }
+        }
+        if( xattrsize >= 0 )                                           // xattr can be zero-length, just a tag itself
+            fsetxattr(_fd_to, s, m_Buffers[1].get(), xattrsize, 0, 0); // write them into _fd_to
     }
 }
 
 void CopyingJob::CopyXattrsFromVFSFileToNativeFD(VFSFile &_source, int _fd_to) const
 {
+    ReserveBuffers(g_VFSBlockSize);
     auto buf = m_Buffers[0].get();
     size_t buf_sz = m_BufferSize;
     _source.XAttrIterateNames([&](const char *name) {
@@ -1786,6 +1968,7 @@ void CopyingJob::CopyXattrsFromVFSFileToNativeFD(VFSFile &_source, int _fd_to) c
 
 void CopyingJob::CopyXattrsFromVFSFileToPath(VFSFile &_file, const char *_fn_to) const
 {
+    ReserveBuffers(g_VFSBlockSize);
     auto buf = m_Buffers[0].get();
     size_t buf_sz = m_BufferSize;
 
@@ -2543,58 +2726,6 @@ void CopyingJob::ApplyTimestampsFixups()
     }
 }
 
-CopyingJob::StepResult CopyingJob::VerifyCopiedFile(const ChecksumExpectation &_exp, bool &_matched)
-{
-    _matched = false;
-    VFSFilePtr file;
-    int rc;
-    if( (rc = m_DestinationHost->CreateFile(_exp.destination_path.c_str(), file, nullptr)) != 0 )
-        switch( m_OnDestinationFileReadError(rc, _exp.destination_path, *m_DestinationHost) ) {
-            case DestinationFileReadErrorResolution::Skip:
-                return StepResult::Skipped;
-            case DestinationFileReadErrorResolution::Stop:
-                return StepResult::Stop;
-        }
-
-    if( (rc = file->Open(VFSFlags::OF_Read | VFSFlags::OF_ShLock | VFSFlags::OF_NoCache)) != 0 )
-        switch( m_OnDestinationFileReadError(rc, _exp.destination_path, *m_DestinationHost) ) {
-            case DestinationFileReadErrorResolution::Skip:
-                return StepResult::Skipped;
-            case DestinationFileReadErrorResolution::Stop:
-                return StepResult::Stop;
-        }
-
-    base::Hash hash(base::Hash::MD5);
-
-    uint64_t sz = file->Size();
-    uint64_t szleft = sz;
-    void *buf = m_Buffers[0].get();
-    uint64_t buf_sz = m_BufferSize;
-
-    while( szleft > 0 ) {
-        if( BlockIfPaused(); IsStopped() )
-            return StepResult::Stop;
-
-        ssize_t r = file->Read(buf, std::min(szleft, buf_sz));
-        if( r < 0 ) {
-            switch( m_OnDestinationFileReadError(static_cast<int>(r), _exp.destination_path, *m_DestinationHost) ) {
-                case DestinationFileReadErrorResolution::Skip:
-                    return StepResult::Skipped;
-                case DestinationFileReadErrorResolution::Stop:
-                    return StepResult::Stop;
-            }
-        }
-        else {
-            szleft -= r;
-            hash.Feed(buf, r);
-        }
-    }
-    file->Close();
-
-    _matched = _exp == hash.Final();
-    return StepResult::Ok;
-}
-
 CopyingJob::StepResult CopyingJob::CopyNativeSymlinkToNative(vfs::NativeHost &_native_host,
                                                              const std::string &_src_path,
                                                              const std::string &_dst_path,
@@ -10,8 +10,13 @@
 #include "Options.h"
 #include "../Job.h"
 #include "SourceItems.h"
-#include "ChecksumExpectation.h"
+#include "SourceScanner.h"
+#include "ChecksumVerifier.h"
+#include "NativeReadAhead.h"
+#include "IOTuner.h"
 #include "CopyingJobCallbacks.h"
+#include <initializer_list>
+#include <unordered_map>
 
 namespace nc::ops {
 
@@ -93,9 +98,15 @@ private:
 
     PathCompositionType AnalyzeInitialDestination(std::string &_result_destination, bool &_need_to_build);
     StepResult BuildDestinationDirectory() const;
-    std::tuple<StepResult, copying::SourceItems> ScanSourceItems();
+    void StartScanningSourceItems();
+    StepResult ScanSourceItems(bool _till_the_end);
+    bool ShouldScanDirectoryContents(VFSHost &_host, const std::string &_path, const std::string &_relative_path) const;
+    bool CanProcessWhileScanning() const;
     std::string ComposeDestinationNameForItem(int _src_item_index) const;
-    std::string ComposeDestinationNameForItemInDB(int _src_item_index, const copying::SourceItems &_db) const;
+    std::string ComposeDestinationNameForRelativePath(const std::string &_relative_src_path) const;
+    int ScheduleReadAhead(int _from_item_index);
+    copying::IOTuner &IOTunerFor(const utility::NativeFileSystemInfo &_source,
+                                 const utility::NativeFileSystemInfo &_destination);
 
     // will be used for checksum calculation when copying verifiyng is enabled
     using SourceDataFeedback = std::function<void(const void *_data, unsigned _sz)>;
@@ -104,7 +115,8 @@ private:
                                           const std::string &_src_path,
                                           const std::string &_dst_path,
                                           const SourceDataFeedback &_source_data_feedback,
-                                          const RequestNonexistentDst &_new_dst_callback);
+                                          const RequestNonexistentDst &_new_dst_callback,
+                                          std::unique_ptr<copying::NativeReadAhead::File> _prefetched_source);
     StepResult CopyVFSFileToNativeFile(VFSHost &_src_vfs,
                                        const std::string &_src_path,
                                        vfs::NativeHost &_dst_host,
@@ -156,7 +168,6 @@ private:
                              const std::string &_src_path,
                              const std::string &_dst_path,
                              const RequestNonexistentDst &_new_dst_callback) const;
-    StepResult VerifyCopiedFile(const copying::ChecksumExpectation &_exp, bool &_matched);
     void ClearSourceItems();
     void ClearSourceItem(const std::string &_path, mode_t _mode, VFSHost &_host);
     void ApplyPermissionFixups();
@@ -164,6 +175,7 @@ private:
 
     void SetStage(enum Stage _stage);
 
+    void ReserveBuffers(size_t _size, std::initializer_list<uint8_t **> _pointers = {}) const;
     void EraseXattrsFromNativeFD(int _fd_in) const;
     void CopyXattrsFromNativeFDToNativeFD(int _fd_from, int _fd_to) const;
     void CopyXattrsFromVFSFileToNativeFD(VFSFile &_source, int _fd_to) const;
@@ -176,8 +188,9 @@ private:
 
     const std::vector<VFSListingItem> m_VFSListingItems;
     copying::SourceItems m_SourceItems;
+    std::unique_ptr<copying::SourceScanner> m_SourceScanner; // exists while the source items are being scanned
+    uint64_t m_EstimatedBytes = 0;                          // already committed to the statistics
     int m_CurrentlyProcessingSourceItemIndex = -1;
-    std::vector<copying::ChecksumExpectation> m_Checksums;
     std::vector<unsigned> m_SourceItemsToDelete;
     mutable std::vector<PermissionFixup> m_TargetPermissionsFixupEpilogue;
     mutable std::vector<TimestampFixup> m_TargetTimestampFixupEpilogue;
@@ -189,13 +202,21 @@ private:
     PathCompositionType m_PathCompositionType;
     nc::utility::NativeFSManager *const m_NativeFSManager;
 
-    // buffers are allocated once in job init and are used to manupulate files' bytes.
-    // thus no parallel routines should run using these buffers
-    static const int m_BufferSize = 2 * 1024 * 1024;
-    const std::unique_ptr<uint8_t[]> m_Buffers[2] = {std::make_unique<uint8_t[]>(m_BufferSize),
-                                                     std::make_unique<uint8_t[]>(m_BufferSize)};
+    // buffers are allocated on demand and are used to manupulate files' bytes, they only grow, up to the largest block
+    // actually used in this job. thus no parallel routines should run using these buffers
+    mutable std::unique_ptr<uint8_t[]> m_Buffers[2];
+    mutable size_t m_BufferSize = 0;
 
     const base::DispatchGroup m_IOGroup;
+
+    // block size controllers of the pairs of native volumes involved in this job
+    std::unordered_map<std::string, copying::IOTuner> m_IOTuners;
+
+    // reads the sources of small native files ahead while copying native->native, exists only in the Process stage
+    std::unique_ptr<copying::NativeReadAhead> m_ReadAhead;
+
+    // verifies the copied files when required, exists only in the Process and Verify stages
+    std::unique_ptr<copying::ChecksumVerifier> m_Verifier;
     bool m_IsSingleInitialItemProcessing = false;
     bool m_IsSingleScannedItemProcessing = false;
     bool m_IsSingleDirectoryCaseRenaming = false;
@@ -0,0 +1,167 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "IOTuner.h"
+#include <algorithm>
+#include <bit>
+#include <mutex>
+#include <unordered_map>
+
+namespace nc::ops::copying {
+
+// An epoch lasts at least this amount of blocks and time, so that a single hiccup doesn't decide anything
+static constexpr size_t g_EpochMinBlocks = 4;
+static constexpr std::chrono::nanoseconds g_EpochMinTime = std::chrono::milliseconds{100};
+
+// A probed size has to be that much faster to be chosen
+static constexpr double g_Improvement = 1.05;
+
+// How many epochs to stay with the chosen size before measuring again
+static constexpr int g_SettledEpochs = 32;
+
+// Weight of a new sample in the smoothed speeds
+static constexpr double g_SpeedSmoothing = 0.2;
+
+static std::mutex &RegistryLock()
+{
+    [[clang::no_destroy]] static std::mutex lock;
+    return lock;
+}
+
+static std::unordered_map<std::string, size_t> &Registry()
+{
+    [[clang::no_destroy]] static std::unordered_map<std::string, size_t> registry;
+    return registry;
+}
+
+static size_t Clamp(size_t _block_size) noexcept
+{
+    return std::clamp(std::bit_floor(std::max(_block_size, size_t(1))), IOTuner::MinBlockSize, IOTuner::MaxBlockSize);
+}
+
+static double Smooth(double _current, double _sample) noexcept
+{
+    return _current == 0. ? _sample : _current + (_sample - _current) * g_SpeedSmoothing;
+}
+
+static double BytesPerSecond(size_t _bytes, std::chrono::nanoseconds _time) noexcept
+{
+    return static_cast<double>(_bytes) * 1'000'000'000. / static_cast<double>(_time.count());
+}
+
+IOTuner::IOTuner(std::string _volumes, size_t _initial_block_size)
+    : m_Volumes(std::move(_volumes)), m_Base(Clamp(_initial_block_size))
+{
+    auto lock = std::lock_guard{RegistryLock()};
+    if( auto it = Registry().find(m_Volumes); it != Registry().end() )
+        m_Base = it->second;
+}
+
+std::string IOTuner::VolumesIdentity(const utility::NativeFileSystemInfo &_source,
+                                     const utility::NativeFileSystemInfo &_destination)
+{
+    return _source.mounted_from_name + '\n' + _source.mounted_at_path + '\n' + _destination.mounted_from_name + '\n' +
+           _destination.mounted_at_path;
+}
+
+size_t IOTuner::BlockSize() const noexcept
+{
+    switch( m_Phase ) {
+        case Phase::ProbeUp:
+            return m_Base * 2;
+        case Phase::ProbeDown:
+            return m_Base / 2;
+        default:
+            return m_Base;
+    }
+}
+
+double IOTuner::ReadSpeed() const noexcept
+{
+    return m_ReadSpeed;
+}
+
+double IOTuner::WriteSpeed() const noexcept
+{
+    return m_WriteSpeed;
+}
+
+void IOTuner::Report(const Step &_step)
+{
+    if( _step.read_bytes != 0 && _step.read_time.count() > 0 )
+        m_ReadSpeed = Smooth(m_ReadSpeed, BytesPerSecond(_step.read_bytes, _step.read_time));
+    if( _step.written_bytes != 0 && _step.write_time.count() > 0 )
+        m_WriteSpeed = Smooth(m_WriteSpeed, BytesPerSecond(_step.written_bytes, _step.write_time));
+
+    // a block which is smaller than requested is the tail of a file and tells nothing about the block size
+    if( _step.read_bytes < BlockSize() || _step.step_time.count() <= 0 )
+        return;
+
+    m_EpochBytes += _step.read_bytes;
+    m_EpochBlocks += 1;
+    m_EpochTime += _step.step_time;
+    if( m_EpochBlocks < g_EpochMinBlocks || m_EpochTime < g_EpochMinTime )
+        return;
+
+    const double speed = BytesPerSecond(m_EpochBytes, m_EpochTime);
+    m_EpochBytes = 0;
+    m_EpochBlocks = 0;
+    m_EpochTime = std::chrono::nanoseconds{0};
+    FinishEpoch(speed);
+}
+
+void IOTuner::FinishEpoch(double _speed)
+{
+    const bool can_grow = m_Base * 2 <= MaxBlockSize;
+    const bool can_shrink = m_Base / 2 >= MinBlockSize;
+    const auto probe_down_or_settle = [&] { m_Phase = can_shrink ? Phase::ProbeDown : Phase::Settled; };
+
+    switch( m_Phase ) {
+        case Phase::Measure:
+            m_BaseSpeed = _speed;
+            if( can_grow )
+                m_Phase = Phase::ProbeUp;
+            else
+                probe_down_or_settle();
+            break;
+        case Phase::ProbeUp:
+            if( _speed > m_BaseSpeed * g_Improvement ) {
+                m_Base *= 2;
+                m_BaseSpeed = _speed;
+                m_Phase = m_Base * 2 <= MaxBlockSize ? Phase::ProbeUp : Phase::Settled;
+            }
+            else
+                probe_down_or_settle();
+            break;
+        case Phase::ProbeDown:
+            if( _speed > m_BaseSpeed * g_Improvement ) {
+                m_Base /= 2;
+                m_BaseSpeed = _speed;
+                m_Phase = m_Base / 2 >= MinBlockSize ? Phase::ProbeDown : Phase::Settled;
+            }
+            else
+                m_Phase = Phase::Settled;
+            break;
+        case Phase::Settled:
+            if( ++m_SettledEpochs >= g_SettledEpochs ) {
+                m_SettledEpochs = 0;
+                m_Phase = Phase::Measure;
+            }
+            break;
+    }
+
+    if( m_Phase == Phase::Settled && m_SettledEpochs == 0 )
+        Remember();
+}
+
+void IOTuner::Remember() const
+{
+    auto lock = std::lock_guard{RegistryLock()};
+    Registry()[m_Volumes] = m_Base;
+}
+
+void IOTuner::ForgetAll()
+{
+    auto lock = std::lock_guard{RegistryLock()};
+    Registry().clear();
+}
+
+} // namespace nc::ops::copying
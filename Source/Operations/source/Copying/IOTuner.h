@@ -0,0 +1,75 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <Utility/NativeFSManager.h>
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace nc::ops::copying {
+
+// Picks the size of the I/O blocks used to copy data between a pair of native volumes, based on the measured
+// throughput. The tuner starts from the best size remembered for this pair of volumes, or from the given initial size
+// if there's none, and then periodically probes the twice larger and the twice smaller sizes, moving to whichever
+// gives a noticeably higher throughput. The best size found is remembered process-wide for the subsequent jobs.
+class IOTuner
+{
+public:
+    static constexpr size_t MinBlockSize = 64 * 1024;
+    static constexpr size_t MaxBlockSize = 8 * 1024 * 1024;
+
+    // Measurements of one step of the transfer, during which a block was read and the previous one was written
+    struct Step {
+        size_t read_bytes = 0;
+        std::chrono::nanoseconds read_time{0};
+        size_t written_bytes = 0;
+        std::chrono::nanoseconds write_time{0};
+        std::chrono::nanoseconds step_time{0}; // the whole step, with reading and writing overlapped
+    };
+
+    IOTuner(std::string _volumes, size_t _initial_block_size);
+
+    // Identity of a pair of volumes used to remember the best block size
+    static std::string VolumesIdentity(const utility::NativeFileSystemInfo &_source,
+                                       const utility::NativeFileSystemInfo &_destination);
+
+    // The block size to use for the next read and write
+    size_t BlockSize() const noexcept;
+
+    // Feeds the tuner with the measurements of a step made with the current BlockSize()
+    void Report(const Step &_step);
+
+    // Recently measured reading and writing speeds in bytes per second, 0 if unknown yet
+    double ReadSpeed() const noexcept;
+    double WriteSpeed() const noexcept;
+
+    // Drops all remembered block sizes
+    static void ForgetAll();
+
+private:
+    enum class Phase {
+        Measure,   // measuring the base size
+        ProbeUp,   // measuring the twice larger size
+        ProbeDown, // measuring the twice smaller size
+        Settled    // using the base size until the next measurement
+    };
+
+    void FinishEpoch(double _speed);
+    void Remember() const;
+
+    std::string m_Volumes;
+    size_t m_Base;
+    double m_BaseSpeed = 0.;
+    Phase m_Phase = Phase::Measure;
+    int m_SettledEpochs = 0;
+
+    // accumulators of the current epoch
+    size_t m_EpochBytes = 0;
+    size_t m_EpochBlocks = 0;
+    std::chrono::nanoseconds m_EpochTime{0};
+
+    double m_ReadSpeed = 0.;
+    double m_WriteSpeed = 0.;
+};
+
+} // namespace nc::ops::copying
@@ -0,0 +1,126 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "NativeReadAhead.h"
+#include <Base/algo.h>
+#include <algorithm>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace nc::ops::copying {
+
+NativeReadAhead::NativeReadAhead(size_t _streams, size_t _max_files, size_t _max_bytes)
+    : m_Streams(std::max(_streams, size_t(1))), m_MaxFiles(_max_files), m_MaxBytes(_max_bytes)
+{
+}
+
+NativeReadAhead::~NativeReadAhead()
+{
+    {
+        auto lock = std::lock_guard{m_Lock};
+        m_Stopped = true;
+        m_Pending.clear();
+    }
+    m_Workers.Wait();
+}
+
+bool NativeReadAhead::Enqueue(int _item, std::string _path, size_t _size)
+{
+    if( _size > MaxFileSize )
+        return false;
+
+    auto lock = std::lock_guard{m_Lock};
+    if( !m_Scheduled.empty() && (m_Scheduled.size() >= m_MaxFiles || m_ScheduledBytes + _size > m_MaxBytes) )
+        return false;
+    if( !m_Scheduled.emplace(_item, _size).second )
+        return true;
+    m_ScheduledBytes += _size;
+    m_Pending.emplace_back(Request{_item, std::move(_path), _size});
+    if( m_RunningWorkers < m_Streams ) {
+        ++m_RunningWorkers;
+        m_Workers.Run([this] { Worker(); });
+    }
+    return true;
+}
+
+std::unique_ptr<NativeReadAhead::File> NativeReadAhead::Take(int _item)
+{
+    auto lock = std::unique_lock{m_Lock};
+
+    // drop everything which was scheduled before _item and was not taken
+    std::erase_if(m_Pending, [_item](const Request &_request) { return _request.item < _item; });
+    for( auto it = m_Scheduled.begin(); it != m_Scheduled.end() && it->first < _item; ) {
+        m_ScheduledBytes -= it->second;
+        m_Done.erase(it->first);
+        it = m_Scheduled.erase(it);
+    }
+
+    const auto scheduled = m_Scheduled.find(_item);
+    if( scheduled == m_Scheduled.end() )
+        return nullptr;
+
+    m_Ready.wait(lock, [&] { return m_Done.contains(_item); });
+    m_ScheduledBytes -= scheduled->second;
+    m_Scheduled.erase(scheduled);
+    auto file = std::move(m_Done[_item]);
+    m_Done.erase(_item);
+    return file;
+}
+
+void NativeReadAhead::Worker()
+{
+    auto lock = std::unique_lock{m_Lock};
+    while( !m_Stopped && !m_Pending.empty() ) {
+        const Request request = std::move(m_Pending.front());
+        m_Pending.pop_front();
+
+        lock.unlock();
+        auto file = Read(request.path);
+        lock.lock();
+
+        // the item might have been discarded while it was being read
+        if( m_Scheduled.contains(request.item) ) {
+            m_Done[request.item] = std::move(file);
+            m_Ready.notify_all();
+        }
+    }
+    --m_RunningWorkers;
+}
+
+std::unique_ptr<NativeReadAhead::File> NativeReadAhead::Read(const std::string &_path) noexcept
+{
+    // open in non-blocking mode, the same way CopyingJob does
+    int fd = open(_path.c_str(), O_RDONLY | O_NONBLOCK | O_SHLOCK);
+    if( fd < 0 )
+        fd = open(_path.c_str(), O_RDONLY | O_NONBLOCK);
+    if( fd < 0 )
+        return nullptr;
+    const auto close_fd = at_scope_end([fd] { close(fd); });
+
+    auto file = std::make_unique<File>();
+
+    // do not waste OS file cache with one-way data
+    fcntl(fd, F_NOCACHE, 1);
+
+    const int flags = fcntl(fd, F_GETFL);
+    if( flags < 0 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0 )
+        return nullptr;
+
+    if( fstat(fd, &file->st) != 0 || !S_ISREG(file->st.st_mode) || file->st.st_size < 0 ||
+        static_cast<size_t>(file->st.st_size) > MaxFileSize )
+        return nullptr;
+
+    const size_t size = static_cast<size_t>(file->st.st_size);
+    file->data = std::make_unique<uint8_t[]>(size);
+    for( size_t has_read = 0; has_read < size; ) {
+        const ssize_t rc = read(fd, file->data.get() + has_read, size - has_read);
+        if( rc > 0 )
+            has_read += static_cast<size_t>(rc);
+        else if( rc < 0 && errno == EINTR )
+            continue;
+        else
+            return nullptr; // an error or the file was truncated meanwhile
+    }
+    return file;
+}
+
+} // namespace nc::ops::copying
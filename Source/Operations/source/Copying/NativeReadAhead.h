@@ -0,0 +1,72 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <Base/DispatchGroup.h>
+#include <sys/stat.h>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace nc::ops::copying {
+
+// Opens, stats and reads small native source files in background ahead of the copying job, so that the latency of
+// fetching the next files overlaps with writing the current one. The files are closed right after being read, so the
+// amount of files read ahead is not bound by the descriptors limit.
+// Only complete results are handed out - if anything goes wrong in background the file is simply dropped and the job
+// processes it as usual, which keeps the error reporting in a single place.
+class NativeReadAhead
+{
+public:
+    struct File {
+        struct stat st;                  // fstat() of the file when it was read
+        std::unique_ptr<uint8_t[]> data; // whole contents of the file, st.st_size bytes
+    };
+
+    // _streams - amount of files read concurrently
+    // _max_files - maximum amount of files either pending or read but not taken yet
+    // _max_bytes - maximum amount of bytes of such files
+    NativeReadAhead(size_t _streams, size_t _max_files, size_t _max_bytes);
+
+    // Discards pending requests and waits for the running ones
+    ~NativeReadAhead();
+
+    // Schedules reading of _path, which is expected to be _size bytes long, under the _item identifier.
+    // Returns false if the limits have been reached, nothing is scheduled in this case.
+    bool Enqueue(int _item, std::string _path, size_t _size);
+
+    // Returns the file read for _item, waiting for it to be read if necessary.
+    // Returns nullptr if _item wasn't scheduled or failed to be read.
+    // The results for items less than _item are discarded, so items should be taken in ascending order.
+    std::unique_ptr<File> Take(int _item);
+
+    // The largest file size which can be read ahead
+    static constexpr size_t MaxFileSize = 1024 * 1024;
+
+private:
+    struct Request {
+        int item;
+        std::string path;
+        size_t size;
+    };
+
+    void Worker();
+    static std::unique_ptr<File> Read(const std::string &_path) noexcept;
+
+    const size_t m_Streams;
+    const size_t m_MaxFiles;
+    const size_t m_MaxBytes;
+    std::mutex m_Lock;
+    std::condition_variable m_Ready;
+    std::deque<Request> m_Pending;
+    std::map<int, std::unique_ptr<File>> m_Done; // nullptr for the items which failed to be read
+    std::map<int, size_t> m_Scheduled;           // item -> size, until taken
+    size_t m_ScheduledBytes = 0;
+    size_t m_RunningWorkers = 0;
+    bool m_Stopped = false;
+    base::DispatchGroup m_Workers;
+};
+
+} // namespace nc::ops::copying
@@ -1,4 +1,4 @@
-// Copyright (C) 2017-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 namespace nc::ops {
@@ -39,6 +39,8 @@ struct CopyingOptions {
     ChecksumVerification verification = ChecksumVerification::Never;
     ExistBehavior exist_behavior = ExistBehavior::Ask;
     LockedItemBehavior locked_items_behaviour = LockedItemBehavior::Ask;
+    unsigned char read_ahead_streams = 4; // amount of small native files read concurrently ahead of copying, 0 - off
+    unsigned char scan_streams = 8;       // amount of native source directories scanned concurrently, 0 - serially
 };
 
 } // namespace nc::ops
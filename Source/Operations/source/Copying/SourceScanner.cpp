@@ -0,0 +1,279 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "SourceScanner.h"
+#include <Base/algo.h>
+#include <algorithm>
+#include <chrono>
+#include <sys/stat.h>
+
+namespace nc::ops::copying {
+
+// How often the pulling thread checks for a stop while waiting for a directory to be scanned
+static constexpr auto g_StopCheckPeriod = std::chrono::milliseconds{100};
+
+SourceScanner::SourceScanner(SourceItems &_db,
+                             const std::vector<VFSListingItem> &_items,
+                             size_t _streams,
+                             unsigned long _stat_flags,
+                             Callbacks _callbacks)
+    : m_DB(_db), m_Streams(_streams), m_StatFlags(_stat_flags), m_Callbacks(std::move(_callbacks))
+{
+    // hosts and base directories are registered upfront, so the workers can read them without locking
+    for( auto &item : _items ) {
+        auto root = std::make_unique<Directory>();
+        root->host_index = m_DB.InsertOrFindHost(item.Host());
+        root->base_dir_index = m_DB.InsertOrFindBaseDir(item.Directory());
+        root->in_background = m_Streams != 0 && item.Host()->IsNativeFS();
+        root->entries.emplace_back().name = item.Filename();
+        m_Roots.emplace_back(std::move(root));
+    }
+
+    for( auto it = m_Roots.rbegin(); it != m_Roots.rend(); ++it ) {
+        m_Frames.push_back(Frame{it->get(), 0, -1, false});
+        Schedule(**it);
+    }
+}
+
+SourceScanner::~SourceScanner()
+{
+    m_Stopped = true;
+    {
+        auto lock = std::lock_guard{m_Lock};
+        m_Queue.clear();
+    }
+    m_Workers.Wait();
+}
+
+SourceScanner::Progress SourceScanner::Pull()
+{
+    const int initial_amount = m_DB.ItemsAmount();
+    const auto appended = [&] { return m_DB.ItemsAmount() != initial_amount; };
+
+    while( !m_Frames.empty() ) {
+        if( !m_Frames.back().scanned ) {
+            // hand out what is ready before blocking on the directory
+            if( appended() )
+                return Progress::Appended;
+            if( !WaitUntilScanned(*m_Frames.back().directory) )
+                return Progress::Stopped;
+            m_Frames.back().scanned = true;
+        }
+
+        Frame &frame = m_Frames.back();
+        Directory &directory = *frame.directory;
+        VFSHost &host = m_DB.Host(directory.host_index);
+
+        if( directory.error != VFSError::Ok ) {
+            const auto path = m_DB.BaseDir(directory.base_dir_index) + directory.relative_path;
+            switch( m_Callbacks.on_cant_access(directory.error, path, host) ) {
+                case Resolution::Skip:
+                    // skipping the contents of a source item itself stops the job, as the recursive scan always did
+                    if( directory.relative_path.find('/') == std::string::npos )
+                        return Progress::Stopped;
+                    Release(directory);
+                    m_Frames.pop_back();
+                    continue;
+                case Resolution::Stop:
+                    return Progress::Stopped;
+                case Resolution::Retry:
+                    directory.error = VFSError::Ok;
+                    directory.scanned = false;
+                    frame.scanned = false;
+                    Schedule(directory);
+                    continue;
+            }
+        }
+
+        if( frame.next_entry == directory.entries.size() ) {
+            // all descendants are merged by now, release the shard
+            Release(directory);
+            m_Frames.pop_back();
+            continue;
+        }
+
+        Entry &entry = directory.entries[frame.next_entry++];
+        bool skipped = false;
+        while( entry.error != VFSError::Ok && !skipped ) {
+            const auto path = m_DB.BaseDir(directory.base_dir_index) +
+                              (directory.relative_path.empty() ? entry.name
+                                                               : directory.relative_path + '/' + entry.name);
+            switch( m_Callbacks.on_cant_access(entry.error, path, host) ) {
+                case Resolution::Skip:
+                    // same as above, skipping a source item stops the job
+                    if( directory.relative_path.empty() )
+                        return Progress::Stopped;
+                    skipped = true;
+                    break;
+                case Resolution::Stop:
+                    return Progress::Stopped;
+                case Resolution::Retry:
+                    Stat(directory, entry);
+                    if( entry.directory )
+                        Schedule(*entry.directory);
+                    break;
+            }
+        }
+        if( skipped || entry.left_out )
+            continue;
+
+        const int index = m_DB.InsertItem(
+            directory.host_index, directory.base_dir_index, frame.parent_index, std::move(entry.name), entry.st);
+        if( entry.directory )
+            m_Frames.push_back(Frame{entry.directory.get(), 0, index, false});
+    }
+
+    return appended() ? Progress::Appended : Progress::Finished;
+}
+
+bool SourceScanner::Finished() const noexcept
+{
+    return m_Frames.empty();
+}
+
+void SourceScanner::Schedule(Directory &_directory)
+{
+    if( !_directory.in_background )
+        return;
+
+    auto lock = std::lock_guard{m_Lock};
+    m_Queue.push_back(&_directory);
+    SpawnWorkers();
+}
+
+void SourceScanner::Release(Directory &_directory)
+{
+    _directory.entries.clear();
+    _directory.entries.shrink_to_fit();
+    if( !_directory.in_background )
+        return;
+
+    auto lock = std::lock_guard{m_Lock};
+    m_Ahead -= _directory.ahead;
+    _directory.ahead = 0;
+    SpawnWorkers();
+}
+
+void SourceScanner::SpawnWorkers()
+{
+    size_t wanted = m_Queue.size();
+    if( m_Ahead >= MaxEntriesAhead ) // beyond the limit a single worker is enough to scan the awaited directory
+        wanted = m_Awaited && std::ranges::find(m_Queue, m_Awaited) != m_Queue.end() ? 1 : 0;
+    while( m_RunningWorkers < std::min(m_Streams, wanted) ) {
+        ++m_RunningWorkers;
+        m_Workers.Run([this] { Worker(); });
+    }
+}
+
+bool SourceScanner::WaitUntilScanned(Directory &_directory)
+{
+    if( !_directory.in_background ) {
+        if( IsStopped() )
+            return false;
+        Scan(_directory);
+        _directory.scanned = true;
+        return !IsStopped();
+    }
+
+    auto lock = std::unique_lock{m_Lock};
+    m_Awaited = &_directory;
+    const auto reset_awaited = at_scope_end([this] { m_Awaited = nullptr; });
+    SpawnWorkers();
+    while( !_directory.scanned ) {
+        if( IsStopped() )
+            return false;
+        m_Scanned.wait_for(lock, g_StopCheckPeriod);
+    }
+    return !IsStopped();
+}
+
+void SourceScanner::Worker()
+{
+    auto lock = std::unique_lock{m_Lock};
+    while( !m_Stopped && !m_Queue.empty() ) {
+        // too far ahead of the merge - only the awaited directory is scanned, the rest waits for the shards' release
+        auto next = std::prev(m_Queue.end());
+        if( m_Ahead >= MaxEntriesAhead ) {
+            next = std::ranges::find(m_Queue, m_Awaited);
+            if( m_Awaited == nullptr || next == m_Queue.end() )
+                break;
+        }
+        Directory *const directory = *next;
+        m_Queue.erase(next);
+
+        lock.unlock();
+        Scan(*directory);
+        lock.lock();
+
+        directory->scanned = true;
+        directory->ahead += directory->entries.size();
+        m_Ahead += directory->entries.size();
+        // the subdirectories are pushed in reverse, so the first one is scanned first as it is merged first
+        for( auto it = directory->entries.rbegin(); it != directory->entries.rend(); ++it )
+            if( it->directory )
+                m_Queue.push_back(it->directory.get());
+        SpawnWorkers();
+        m_Scanned.notify_all();
+    }
+    --m_RunningWorkers;
+}
+
+void SourceScanner::Scan(Directory &_directory) const
+{
+    if( !_directory.relative_path.empty() ) {
+        VFSHost &host = m_DB.Host(_directory.host_index);
+        const auto path = m_DB.BaseDir(_directory.base_dir_index) + _directory.relative_path;
+        _directory.entries.clear();
+        _directory.error = host.IterateDirectoryListing(path.c_str(), [&](const VFSDirEnt &_dirent) {
+            _directory.entries.emplace_back().name = _dirent.name;
+            return true;
+        });
+        if( _directory.error != VFSError::Ok ) {
+            _directory.entries.clear();
+            return;
+        }
+    }
+
+    for( auto &entry : _directory.entries ) {
+        if( IsStopped() )
+            return;
+        Stat(_directory, entry);
+    }
+}
+
+void SourceScanner::Stat(const Directory &_directory, Entry &_entry) const
+{
+    VFSHost &host = m_DB.Host(_directory.host_index);
+    const auto relative_path =
+        _directory.relative_path.empty() ? _entry.name : _directory.relative_path + '/' + _entry.name;
+    const auto path = m_DB.BaseDir(_directory.base_dir_index) + relative_path;
+
+    _entry.left_out = false;
+    _entry.directory.reset();
+    _entry.error = host.Stat(path.c_str(), _entry.st, m_StatFlags, nullptr);
+    if( _entry.error != VFSError::Ok )
+        return;
+
+    if( S_ISREG(_entry.st.mode) ) {
+        _entry.left_out = m_Callbacks.is_left_out(host, path, _entry.name, _entry.st);
+    }
+    else if( S_ISDIR(_entry.st.mode) ) {
+        if( m_Callbacks.should_go_inside(host, path, relative_path) ) {
+            auto directory = std::make_unique<Directory>();
+            directory->host_index = _directory.host_index;
+            directory->base_dir_index = _directory.base_dir_index;
+            directory->relative_path = relative_path;
+            directory->in_background = _directory.in_background;
+            _entry.directory = std::move(directory);
+        }
+    }
+    else if( !S_ISLNK(_entry.st.mode) ) {
+        // only regular files, symlinks and directories are processed
+        _entry.left_out = true;
+    }
+}
+
+bool SourceScanner::IsStopped() const
+{
+    return m_Stopped || m_Callbacks.is_stopped();
+}
+
+} // namespace nc::ops::copying
@@ -0,0 +1,128 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <Base/DispatchGroup.h>
+#include <VFS/VFS.h>
+#include "SourceItems.h"
+#include "CopyingJobCallbacks.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace nc::ops::copying {
+
+// Scans the source items of a copying job into a SourceItems database.
+// Directories on native file systems are listed and their entries are stat()-ed by a bounded pool of background
+// workers, each directory producing a separate shard of entries. The shards are merged into the database on the
+// pulling thread in the depth-first order, so the directories precede their contents and the items get the same indices
+// as with a plain recursive scan. Items of the non-native hosts are scanned on the pulling thread itself.
+// The database can be consumed while the scan is still running - Pull() hands out whatever is ready so far.
+// The workers run ahead of the merge by at most MaxEntriesAhead entries, beyond that only the directory which the
+// merge waits for is scanned, so a huge tree neither piles up in memory nor floods the file system with stat()s.
+// The errors are reported only on the pulling thread and in the order of the items.
+class SourceScanner
+{
+public:
+    using Resolution = CopyingJobCallbacks::CantAccessSourceItemResolution;
+
+    static constexpr size_t MaxEntriesAhead = 65'536;
+
+    struct Callbacks {
+        // Decides what to do with an item which can't be accessed, called on the pulling thread
+        std::function<Resolution(int _vfs_error, const std::string &_path, VFSHost &_host)> on_cant_access;
+
+        // Tells if a regular file has to be left out, called on any thread
+        std::function<bool(VFSHost &_host, const std::string &_path, const std::string &_name, const VFSStat &_st)>
+            is_left_out;
+
+        // Tells if the contents of a directory have to be scanned, called on any thread
+        std::function<bool(VFSHost &_host, const std::string &_path, const std::string &_relative_path)>
+            should_go_inside;
+
+        // Tells if the scan has to be abandoned, called on any thread
+        std::function<bool()> is_stopped;
+    };
+
+    enum class Progress {
+        Appended, // some items were appended to the database
+        Finished, // the scan is over, nothing was appended
+        Stopped   // the scan was stopped
+    };
+
+    // _streams - amount of native directories scanned concurrently, 0 means scanning everything on the pulling thread
+    // _stat_flags - flags passed to VFSHost::Stat()
+    SourceScanner(SourceItems &_db,
+                  const std::vector<VFSListingItem> &_items,
+                  size_t _streams,
+                  unsigned long _stat_flags,
+                  Callbacks _callbacks);
+
+    // Abandons the scan and waits for the running workers
+    ~SourceScanner();
+
+    // Appends the items scanned so far to the database, waiting until at least one is available.
+    Progress Pull();
+
+    // Returns true if all items were appended to the database
+    bool Finished() const noexcept;
+
+private:
+    struct Directory;
+
+    struct Entry {
+        std::string name;
+        VFSStat st;
+        int error = VFSError::Ok; // result of Stat()
+        bool left_out = false;
+        std::unique_ptr<Directory> directory; // exists if the contents have to be scanned
+    };
+
+    struct Directory {
+        uint16_t host_index = 0;
+        unsigned base_dir_index = 0;
+        std::string relative_path; // empty for a source item itself, which has a single pre-filled entry
+        bool in_background = false;
+        bool scanned = false; // guarded by m_Lock if in_background
+        size_t ahead = 0;     // amount of entries accounted in m_Ahead, guarded by m_Lock
+        int error = VFSError::Ok; // result of IterateDirectoryListing()
+        std::vector<Entry> entries;
+    };
+
+    struct Frame {
+        Directory *directory;
+        size_t next_entry;
+        int parent_index;
+        bool scanned; // the directory was seen scanned, no need to look at it under the lock again
+    };
+
+    void Schedule(Directory &_directory);
+    void Release(Directory &_directory);
+    void SpawnWorkers(); // requires m_Lock to be held
+    bool WaitUntilScanned(Directory &_directory);
+    void Worker();
+    void Scan(Directory &_directory) const;
+    void Stat(const Directory &_directory, Entry &_entry) const;
+    bool IsStopped() const;
+
+    SourceItems &m_DB;
+    const size_t m_Streams;
+    const unsigned long m_StatFlags;
+    const Callbacks m_Callbacks;
+    std::vector<std::unique_ptr<Directory>> m_Roots;
+    std::vector<Frame> m_Frames; // the depth-first merge, touched only by the pulling thread
+
+    std::mutex m_Lock;
+    std::condition_variable m_Scanned;
+    std::vector<Directory *> m_Queue; // a stack to scan the deeper directories first, as they're merged first
+    size_t m_RunningWorkers = 0;
+    size_t m_Ahead = 0;             // amount of entries scanned by the workers and not yet merged
+    Directory *m_Awaited = nullptr; // the directory the merge waits for, is scanned regardless of m_Ahead
+    std::atomic_bool m_Stopped = false;
+    base::DispatchGroup m_Workers;
+};
+
+} // namespace nc::ops::copying
@@ -44,10 +44,9 @@ void DeletionJob::DoScan()
         Statistics().CommitEstimated(Statistics::SourceType::Items, 1);
 
         if( item.UnixType() == DT_DIR ) {
-            m_Paths.push_back(EnsureTrailingSlash(item.Filename()), nullptr);
             SourceItem si;
             si.listing_item_index = i;
-            si.filename = &m_Paths.back();
+            si.filename = m_Paths.push_back(EnsureTrailingSlash(item.Filename()));
             si.type = m_Type;
             m_Script.emplace(si);
 
@@ -58,10 +57,9 @@ void DeletionJob::DoScan()
         else {
             const auto is_ea_storage = IsEAStorage(*item.Host(), item.Directory(), item.FilenameC(), item.UnixType());
             if( !is_ea_storage ) {
-                m_Paths.push_back(item.Filename(), nullptr);
                 SourceItem si;
                 si.listing_item_index = i;
-                si.filename = &m_Paths.back();
+                si.filename = m_Paths.push_back(item.Filename());
                 si.type = m_Type;
                 m_Script.emplace(si);
             }
@@ -71,7 +69,7 @@ void DeletionJob::DoScan()
 
 void DeletionJob::ScanDirectory(const std::string &_path,
                                 int _listing_item_index,
-                                const base::chained_strings::node *_prefix)
+                                base::PathTree::Index _prefix)
 {
     auto &vfs = *m_SourceItems[_listing_item_index].Host();
 
@@ -104,10 +102,9 @@ void DeletionJob::ScanDirectory(const std::string &_path,
 
         Statistics().CommitEstimated(Statistics::SourceType::Items, 1);
         if( e.type == DT_DIR ) {
-            m_Paths.push_back(EnsureTrailingSlash(e.name), _prefix);
             SourceItem si;
             si.listing_item_index = _listing_item_index;
-            si.filename = &m_Paths.back();
+            si.filename = m_Paths.push_back(EnsureTrailingSlash(e.name), _prefix);
             si.type = DeletionType::Permanent;
             m_Script.emplace(si);
 
@@ -116,10 +113,9 @@ void DeletionJob::ScanDirectory(const std::string &_path,
         else {
             const auto is_ea_storage = IsEAStorage(vfs, _path, e.name, static_cast<uint8_t>(e.type));
             if( !is_ea_storage ) {
-                m_Paths.push_back(e.name, _prefix);
                 SourceItem si;
                 si.listing_item_index = _listing_item_index;
-                si.filename = &m_Paths.back();
+                si.filename = m_Paths.push_back(e.name, _prefix);
                 si.type = DeletionType::Permanent;
                 m_Script.emplace(si);
             }
@@ -129,6 +125,9 @@ void DeletionJob::ScanDirectory(const std::string &_path,
 
 void DeletionJob::DoDelete()
 {
+    // the buffers are reused for all the paths to avoid allocating them one by one
+    std::string path;
+    std::string relative_path;
     while( !m_Script.empty() ) {
         if( BlockIfPaused(); IsStopped() )
             return;
@@ -136,7 +135,8 @@ void DeletionJob::DoDelete()
         const auto entry = m_Script.top();
         m_Script.pop();
 
-        const auto path = m_SourceItems[entry.listing_item_index].Directory() + entry.filename->to_str_with_pref();
+        path = m_SourceItems[entry.listing_item_index].Directory();
+        path += m_Paths.path(entry.filename, relative_path);
         const auto &vfs = m_SourceItems[entry.listing_item_index].Host();
         const auto type = entry.type;
 
@@ -1,11 +1,11 @@
-// Copyright (C) 2017-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "../Job.h"
 #include "Options.h"
 #include "DeletionJobCallbacks.h"
 #include <VFS/VFS.h>
-#include <Base/chained_strings.h>
+#include <Base/PathTree.h>
 #include <stack>
 
 namespace nc::ops {
@@ -22,7 +22,7 @@ private:
     struct SourceItem {
         int listing_item_index;
         DeletionType type;
-        const base::chained_strings::node *filename;
+        base::PathTree::Index filename;
     };
 
     virtual void Perform() override;
@@ -34,13 +34,13 @@ private:
     bool DoUnlock(const std::string &_path, VFSHost &_vfs);
     void ScanDirectory(const std::string &_path,
                        int _listing_item_index,
-                       const base::chained_strings::node *_prefix);
+                       base::PathTree::Index _prefix);
     bool IsNativeLockedItem(int vfs_err, const std::string &_path, VFSHost &_vfs) const;
     int UnlockItem(const std::string &_path, VFSHost &_vfs) const;
 
     std::vector<VFSListingItem> m_SourceItems;
     DeletionType m_Type;
-    base::chained_strings m_Paths;
+    base::PathTree m_Paths; // directories have trailing slashes
     std::stack<SourceItem> m_Script;
 };
 
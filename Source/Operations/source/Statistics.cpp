@@ -1,4 +1,4 @@
-// Copyright (C) 2017-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Statistics.h"
 #include <Base/mach_time.h>
 
@@ -89,6 +89,18 @@ void Statistics::CommitSkipped(SourceType _type, uint64_t _delta)
     Timeline(_type).CommitSkipped(_delta);
 }
 
+Statistics::IOParameters Statistics::IO() const
+{
+    auto lock = std::lock_guard{m_IOLock};
+    return m_IO;
+}
+
+void Statistics::CommitIO(const IOParameters &_parameters)
+{
+    auto lock = std::lock_guard{m_IOLock};
+    m_IO = _parameters;
+}
+
 std::vector<Progress::TimePoint> Statistics::BytesPerSecond() const
 {
     return m_BytesTimeline.Data();
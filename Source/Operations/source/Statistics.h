@@ -1,7 +1,8 @@
-// Copyright (C) 2017-2018 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "Progress.h"
+#include <Base/spinlock.h>
 
 namespace nc::ops {
 
@@ -12,6 +13,14 @@ public:
         Bytes,
         Items
     };
+
+    // Parameters of the data transfer chosen by a job, reported for diagnostics
+    struct IOParameters {
+        size_t block_size = 0;   // size of the I/O blocks
+        size_t queue_depth = 0;  // amount of blocks in flight
+        double read_speed = 0.;  // measured reading speed, bytes per second
+        double write_speed = 0.; // measured writing speed, bytes per second
+    };
  
     Statistics();
     ~Statistics();
@@ -38,6 +47,9 @@ public:
     void CommitEstimated( SourceType _type, uint64_t _delta );
     void CommitProcessed( SourceType _type, uint64_t _delta );
     void CommitSkipped( SourceType _type, uint64_t _delta );
+
+    IOParameters                        IO() const;
+    void                                CommitIO( const IOParameters &_parameters );
     
 private:
     Progress &Timeline(SourceType _type) noexcept;
@@ -53,6 +65,9 @@ private:
     
     Progress m_BytesTimeline;
     Progress m_ItemsTimeline;
+
+    mutable spinlock m_IOLock;
+    IOParameters m_IO;
 };
 
 struct StatisticsTimingPauser
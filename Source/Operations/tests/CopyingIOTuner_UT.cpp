@@ -0,0 +1,94 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include "../source/Copying/IOTuner.h"
+
+using nc::ops::copying::IOTuner;
+
+#define PREFIX "nc::ops::copying::IOTuner "
+
+// A simulated device: a fixed latency per operation plus the transfer time, blocks larger than _slow_above are
+// processed slower.
+static std::chrono::nanoseconds
+DeviceTime(size_t _block_size, std::chrono::microseconds _latency, double _bytes_per_second, size_t _slow_above)
+{
+    double ns = static_cast<double>(std::chrono::nanoseconds{_latency}.count()) +
+                static_cast<double>(_block_size) / _bytes_per_second * 1'000'000'000.;
+    if( _block_size > _slow_above )
+        ns *= 1.3;
+    return std::chrono::nanoseconds{static_cast<int64_t>(ns)};
+}
+
+static void Run(IOTuner &_tuner, int _steps, std::chrono::microseconds _latency, size_t _slow_above)
+{
+    for( int i = 0; i < _steps; ++i ) {
+        const size_t block_size = _tuner.BlockSize();
+        const auto time = DeviceTime(block_size, _latency, 1'000'000'000., _slow_above);
+        _tuner.Report({.read_bytes = block_size,
+                       .read_time = time,
+                       .written_bytes = block_size,
+                       .write_time = time,
+                       .step_time = time});
+    }
+}
+
+TEST_CASE(PREFIX "grows the block size while it pays off")
+{
+    IOTuner::ForgetAll();
+    IOTuner tuner("a", 1024 * 1024);
+    CHECK(tuner.BlockSize() == 1024 * 1024);
+    Run(tuner, 1000, std::chrono::milliseconds{2}, 4 * 1024 * 1024);
+    CHECK(tuner.BlockSize() == 4 * 1024 * 1024);
+    CHECK(tuner.ReadSpeed() > 0.);
+    CHECK(tuner.WriteSpeed() > 0.);
+}
+
+TEST_CASE(PREFIX "shrinks the block size when smaller blocks are faster")
+{
+    IOTuner::ForgetAll();
+    IOTuner tuner("a", 1024 * 1024);
+    Run(tuner, 3000, std::chrono::microseconds{1}, 512 * 1024);
+    CHECK(tuner.BlockSize() == 512 * 1024);
+}
+
+TEST_CASE(PREFIX "keeps the block size when nothing is better")
+{
+    IOTuner::ForgetAll();
+    IOTuner tuner("a", 1024 * 1024);
+    Run(tuner, 3000, std::chrono::microseconds{1}, 1024 * 1024);
+    CHECK(tuner.BlockSize() == 1024 * 1024);
+}
+
+TEST_CASE(PREFIX "remembers the best block size per pair of volumes")
+{
+    IOTuner::ForgetAll();
+    {
+        IOTuner tuner("a", 1024 * 1024);
+        Run(tuner, 1000, std::chrono::milliseconds{2}, 4 * 1024 * 1024);
+    }
+    CHECK(IOTuner("a", 128 * 1024).BlockSize() == 4 * 1024 * 1024);
+    CHECK(IOTuner("b", 128 * 1024).BlockSize() == 128 * 1024);
+    IOTuner::ForgetAll();
+    CHECK(IOTuner("a", 128 * 1024).BlockSize() == 128 * 1024);
+}
+
+TEST_CASE(PREFIX "clamps the initial block size")
+{
+    IOTuner::ForgetAll();
+    CHECK(IOTuner("a", 0).BlockSize() == IOTuner::MinBlockSize);
+    CHECK(IOTuner("a", 4096).BlockSize() == IOTuner::MinBlockSize);
+    CHECK(IOTuner("a", 3 * 1024 * 1024).BlockSize() == 2 * 1024 * 1024);
+    CHECK(IOTuner("a", 1024 * 1024 * 1024).BlockSize() == IOTuner::MaxBlockSize);
+}
+
+TEST_CASE(PREFIX "tails of files don't affect the decision")
+{
+    IOTuner::ForgetAll();
+    IOTuner tuner("a", 1024 * 1024);
+    for( int i = 0; i < 1000; ++i )
+        tuner.Report({.read_bytes = 1000,
+                      .read_time = std::chrono::microseconds{1},
+                      .written_bytes = 1000,
+                      .write_time = std::chrono::microseconds{1},
+                      .step_time = std::chrono::microseconds{1}});
+    CHECK(tuner.BlockSize() == 1024 * 1024);
+}
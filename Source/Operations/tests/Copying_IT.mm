@@ -2,6 +2,7 @@
 #include "Tests.h"
 #include "TestEnv.h"
 #include <Operations/Copying.h>
+#include "../source/Statistics.h"
 #include <Utility/NativeFSManager.h>
 #include <VFS/Native.h>
 #include <VFS/XAttr.h>
@@ -12,13 +13,16 @@
 #include <Base/WriteAtomically.h>
 #include <set>
 #include <span>
+#include <cstring>
 #include <fstream>
 #include <compare>
 #include <thread>
 
 using nc::ops::Copying;
+using nc::ops::CopyingJobCallbacks;
 using nc::ops::CopyingOptions;
 using nc::ops::OperationState;
+using nc::ops::Statistics;
 using nc::utility::NativeFSManager;
 
 static std::vector<std::byte> MakeNoise(size_t _size);
@@ -1375,6 +1379,104 @@ TEST_CASE(PREFIX "Setting directory permissions in an epilogue - (vfs -> vfs)")
     VFSEasyDelete(target_dir.c_str(), host);
 }
 
+TEST_CASE(PREFIX "Copying a tree of small native files with read-ahead")
+{
+    TempTestDir dir;
+    const auto src = dir.directory / "src";
+    std::filesystem::create_directory(src);
+    std::vector<std::vector<std::byte>> contents;
+    for( int d = 0; d < 8; ++d ) {
+        std::filesystem::create_directory(src / std::to_string(d));
+        for( int f = 0; f < 64; ++f ) {
+            // mostly small files which are read ahead, some larger ones which are not
+            contents.emplace_back(MakeNoise(f % 16 == 0 ? 3'000'000 : std::rand() % 10'000));
+            REQUIRE(Save(src / std::to_string(d) / std::to_string(f), contents.back()));
+        }
+    }
+
+    auto host = TestEnv().vfs_native;
+    for( const int streams : {0, 1, 4} ) {
+        const auto dst = dir.directory / ("dst" + std::to_string(streams));
+        CopyingOptions opts;
+        opts.docopy = true;
+        opts.read_ahead_streams = static_cast<unsigned char>(streams);
+        opts.verification = CopyingOptions::ChecksumVerification::Always;
+        Copying op(FetchItems(dir.directory, {"src"}, *host), dst, host, opts);
+        RunOperationAndCheckSuccess(op);
+        CHECK(op.Statistics().VolumeProcessed(Statistics::SourceType::Bytes) ==
+              op.Statistics().VolumeTotal(Statistics::SourceType::Bytes));
+        CHECK(op.Statistics().IO().block_size >= 64 * 1024); // the larger files went through the tuned loop
+
+        size_t index = 0;
+        for( int d = 0; d < 8; ++d )
+            for( int f = 0; f < 64; ++f ) {
+                std::ifstream in(dst / std::to_string(d) / std::to_string(f), std::ios::binary);
+                const std::string copied{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+                const auto &orig = contents[index++];
+                REQUIRE(copied.size() == orig.size());
+                CHECK(std::memcmp(copied.data(), orig.data(), orig.size()) == 0);
+            }
+    }
+}
+
+TEST_CASE(PREFIX "Copying a deep tree scanned in parallel")
+{
+    TempTestDir dir;
+    const auto src = dir.directory / "src";
+    std::filesystem::create_directory(src);
+    size_t files = 0;
+    std::function<void(const std::filesystem::path &, int)> populate = [&](const std::filesystem::path &_path,
+                                                                           int _depth) {
+        for( int i = 0; i < 4; ++i ) {
+            REQUIRE(Save(_path / ("f" + std::to_string(i)), MakeNoise(std::rand() % 1000)));
+            ++files;
+        }
+        if( _depth < 4 )
+            for( int i = 0; i < 3; ++i ) {
+                std::filesystem::create_directory(_path / ("d" + std::to_string(i)));
+                populate(_path / ("d" + std::to_string(i)), _depth + 1);
+            }
+    };
+    populate(src, 0);
+
+    auto host = TestEnv().vfs_native;
+    for( const int streams : {0, 1, 8} ) {
+        const auto dst = dir.directory / ("dst" + std::to_string(streams));
+        CopyingOptions opts;
+        opts.docopy = true;
+        opts.scan_streams = static_cast<unsigned char>(streams);
+        Copying op(FetchItems(dir.directory, {"src"}, *host), dst, host, opts);
+        RunOperationAndCheckSuccess(op);
+        CHECK(op.Statistics().VolumeProcessed(Statistics::SourceType::Bytes) ==
+              op.Statistics().VolumeTotal(Statistics::SourceType::Bytes));
+
+        int result = 0;
+        REQUIRE(VFSCompareEntries(src, host, dst, host, result) == 0);
+        CHECK(result == 0);
+        size_t copied_files = 0;
+        for( auto &entry : std::filesystem::recursive_directory_iterator(dst) )
+            if( entry.is_regular_file() )
+                ++copied_files;
+        CHECK(copied_files == files);
+    }
+}
+
+TEST_CASE(PREFIX "Copying a directory into its own subdirectory copies it as it was")
+{
+    TempTestDir dir;
+    const auto src = dir.directory / "src";
+    std::filesystem::create_directories(src / "a" / "b");
+    REQUIRE(Save(src / "a" / "b" / "f", MakeNoise(1000)));
+
+    auto host = TestEnv().vfs_native;
+    CopyingOptions opts;
+    opts.docopy = true;
+    Copying op(FetchItems(dir.directory, {"src"}, *host), src / "a", host, opts);
+    RunOperationAndCheckSuccess(op);
+    CHECK(std::filesystem::exists(src / "a" / "src" / "a" / "b" / "f"));
+    CHECK(!std::filesystem::exists(src / "a" / "src" / "a" / "src"));
+}
+
 TEST_CASE(PREFIX "Copying a native file that is being written to")
 {
     TempTestDir dir;
@@ -1409,6 +1511,39 @@ TEST_CASE(PREFIX "Copying a native file that is being written to")
     CHECK(sz_b < sz_a);
 }
 
+TEST_CASE(PREFIX "Verifying checksums while copying native files")
+{
+    TempTestDir dir;
+    const auto src = dir.directory / "src";
+    std::filesystem::create_directory(src);
+    std::vector<std::vector<std::byte>> contents;
+    for( int f = 0; f < 32; ++f ) {
+        contents.emplace_back(MakeNoise(f % 8 == 0 ? 5'000'000 : std::rand() % 100'000));
+        REQUIRE(Save(src / std::to_string(f), contents.back()));
+    }
+    REQUIRE(Save(src / "empty", {}));
+
+    auto host = TestEnv().vfs_native;
+    int failed = 0;
+    CopyingJobCallbacks hooks;
+    hooks.m_OnFileVerificationFailed = [&](const std::string &, VFSHost &) { ++failed; };
+
+    CopyingOptions opts;
+    opts.docopy = true;
+    opts.verification = CopyingOptions::ChecksumVerification::Always;
+    Copying op(FetchItems(dir.directory, {"src"}, *host), dir.directory / "copied", host, opts);
+    op.SetCallbackHooks(&hooks);
+    RunOperationAndCheckSuccess(op);
+    CHECK(failed == 0);
+
+    for( int f = 0; f < 32; ++f ) {
+        std::ifstream in(dir.directory / "copied" / std::to_string(f), std::ios::binary);
+        const std::string copied{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+        REQUIRE(copied.size() == contents[f].size());
+        CHECK(std::memcmp(copied.data(), contents[f].data(), copied.size()) == 0);
+    }
+}
+
 static std::vector<std::byte> MakeNoise(size_t _size)
 {
     std::vector<std::byte> bytes(_size);
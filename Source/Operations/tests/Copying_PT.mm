@@ -0,0 +1,74 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include "TestEnv.h"
+#include <Operations/Copying.h>
+#include <VFS/Native.h>
+#include <fstream>
+#include <vector>
+
+// NB! disabled by default, include in the Operations tests target to enable.
+// Use a small --benchmark-samples value, each sample copies the whole data set.
+
+using nc::ops::Copying;
+using nc::ops::CopyingOptions;
+using nc::ops::OperationState;
+
+#define PREFIX "nc::ops::Copying PT "
+
+static std::vector<VFSListingItem>
+FetchItems(const std::string &_directory_path, const std::vector<std::string> &_filenames, VFSHost &_host)
+{
+    std::vector<VFSListingItem> items;
+    _host.FetchFlexibleListingItems(_directory_path, _filenames, 0, items, nullptr);
+    return items;
+}
+
+static bool Copy(const std::filesystem::path &_dir, const std::string &_name, const std::filesystem::path &_to, int _streams)
+{
+    CopyingOptions opts;
+    opts.docopy = true;
+    opts.read_ahead_streams = static_cast<unsigned char>(_streams);
+    auto host = TestEnv().vfs_native;
+    Copying op(FetchItems(_dir, {_name}, *host), _to, host, opts);
+    op.Start();
+    op.Wait();
+    std::filesystem::remove_all(_to);
+    return op.State() == OperationState::Completed;
+}
+
+TEST_CASE(PREFIX "100k files, 4KB each", "[!benchmark]")
+{
+    TempTestDir dir;
+    const auto src = dir.directory / "src";
+    std::filesystem::create_directory(src);
+    const std::vector<char> content(4096, 'x');
+    for( int d = 0; d < 100; ++d ) {
+        const auto sub = src / std::to_string(d);
+        std::filesystem::create_directory(sub);
+        for( int f = 0; f < 1000; ++f )
+            std::ofstream(sub / std::to_string(f), std::ios::binary).write(content.data(), content.size());
+    }
+
+    for( int streams : {0, 1, 4, 8} ) {
+        BENCHMARK("Read-ahead streams: " + std::to_string(streams))
+        {
+            return Copy(dir.directory, "src", dir.directory / "dst", streams);
+        };
+    }
+}
+
+TEST_CASE(PREFIX "One 20GB file", "[!benchmark]")
+{
+    TempTestDir dir;
+    {
+        const std::vector<char> chunk(64 * 1024 * 1024, 'x');
+        std::ofstream out(dir.directory / "src", std::ios::binary);
+        for( int i = 0; i < 20 * 16; ++i )
+            out.write(chunk.data(), chunk.size());
+    }
+
+    BENCHMARK("Copy")
+    {
+        return Copy(dir.directory, "src", dir.directory / "dst", 4);
+    };
+}
@@ -0,0 +1,82 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <VFS/VFS.h>
+#include <CoreServices/CoreServices.h>
+#include <sys/stat.h>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nc::panel {
+
+// Calculates the sizes of directories for the panels and remembers the sizes of the native ones.
+// A remembered size is given back while the directory keeps its inode and modification time and no change was
+// reported inside its tree by the file system events. The parent directories of the calculated ones are watched
+// recursively with a single events stream.
+// Sizes of the directories on other hosts are calculated anew each time.
+// Thread-safe, the calculations can run concurrently.
+class DirectorySizeCalculator
+{
+public:
+    // Amount of remembered sizes, the least recently used ones are forgotten beyond it
+    static constexpr size_t MaxCachedSizes = 16384;
+
+    DirectorySizeCalculator();
+    DirectorySizeCalculator(const DirectorySizeCalculator &) = delete;
+    ~DirectorySizeCalculator();
+    DirectorySizeCalculator &operator=(const DirectorySizeCalculator &) = delete;
+
+    // Returns the remembered size of the directory if it's still valid
+    std::optional<uint64_t> Cached(VFSHost &_host, std::string_view _path);
+
+    // Returns the remembered size of the directory if it's still valid, or calculates it with
+    // VFSHost::CalculateDirectorySize() and remembers it.
+    // Returns a negative VFSError on failure or cancellation.
+    ssize_t Calculate(VFSHost &_host, std::string_view _path, const VFSCancelChecker &_cancel_checker = nullptr);
+
+    // Forgets the sizes of the directory and of all its parents.
+    // With _recursive also forgets the sizes of the directories inside it.
+    void Invalidate(std::string_view _path, bool _recursive = false);
+
+private:
+    struct Entry {
+        uint64_t size = 0;
+        uint64_t inode = 0;
+        timespec mtime = {};
+        uint64_t last_used = 0;
+    };
+
+    struct InFlight {
+        std::string path;
+        bool invalidated = false;
+    };
+
+    std::optional<uint64_t> Lookup(const std::string &_canonical_path, const struct stat &_st);
+    static std::string Normalize(std::string_view _path);
+    static bool IsSameOrParent(std::string_view _parent, std::string_view _path) noexcept;
+    void Watch(const std::string &_path);
+    void RestartStream();
+    void Trim();
+    static void OnEvents(ConstFSEventStreamRef _stream,
+                         void *_user_data,
+                         size_t _num,
+                         void *_paths,
+                         const FSEventStreamEventFlags _flags[],
+                         const FSEventStreamEventId _ids[]);
+
+    std::mutex m_Lock;
+    std::map<std::string, Entry, std::less<>> m_Cache; // ordered, so that the subtrees are ranges
+    std::vector<InFlight *> m_InFlight;
+    std::vector<std::string> m_WatchedPaths;
+    uint64_t m_UseCounter = 0;
+
+    std::mutex m_StreamLock; // taken before m_Lock, never while holding it
+    FSEventStreamRef m_Stream = nullptr;
+};
+
+} // namespace nc::panel
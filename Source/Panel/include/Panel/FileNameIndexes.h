@@ -0,0 +1,41 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <VFS/VFS.h>
+#include <VFS/FileNameIndex.h>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace nc::panel {
+
+// Keeps the file name indices which Find Files consults instead of walking the native directories.
+// An index is built in background over a directory the first time it's searched in, afterwards it answers the
+// searches in that directory and below it, being kept in sync via the subtree-change notifications.
+// The indices live in memory only, the least recently used ones are dropped beyond MaxIndexes.
+// Thread-safe.
+class FileNameIndexes
+{
+public:
+    static constexpr size_t MaxIndexes = 4;
+
+    FileNameIndexes();
+    FileNameIndexes(const FileNameIndexes &) = delete;
+    ~FileNameIndexes();
+    FileNameIndexes &operator=(const FileNameIndexes &) = delete;
+
+    // Returns a ready index which covers _path on _host.
+    // Returns nullptr if _host is not native or there's no such index yet, in the latter case an index over _path
+    // is started to be built in background for the following searches.
+    std::shared_ptr<const vfs::FileNameIndex> Find(const VFSHostPtr &_host, std::string_view _path);
+
+private:
+    struct State;
+
+    static void Build(const std::shared_ptr<State> &_state, const VFSHostPtr &_host, const std::string &_root);
+
+    // shared with the background builds, which may outlive this object
+    std::shared_ptr<State> m_State;
+};
+
+} // namespace nc::panel
@@ -0,0 +1,64 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <VFS/VFS.h>
+#include <Base/SerialQueue.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nc::panel {
+
+// Fetches in background the listings of the directories a panel is likely to go to next, i.e. its parent directory
+// and the highlighted subdirectory, so that going there doesn't wait for the file system.
+// Only the native listings are prefetched. The prefetched directories are observed for changes from the moment they
+// are scheduled, a listing is handed out only while it's fresh and nothing has changed in its directory since.
+// Thread-safe.
+class ListingPrefetcher
+{
+public:
+    // Maximum amount of the prefetched and pending listings, the oldest ones are forgotten beyond it
+    static constexpr size_t Capacity = 4;
+
+    // A prefetched listing older than this is considered stale and is never handed out
+    static constexpr std::chrono::nanoseconds TimeToLive = std::chrono::seconds{3};
+
+    ListingPrefetcher();
+    ListingPrefetcher(const ListingPrefetcher &) = delete;
+    ~ListingPrefetcher();
+    ListingPrefetcher &operator=(const ListingPrefetcher &) = delete;
+
+    // Schedules fetching of the directory listing with the specified fetching flags, unless the listing is already
+    // prefetched or pending. Does nothing for the non-native hosts and for the directories which can't be observed.
+    void Prefetch(const VFSHostPtr &_host, std::string_view _directory, unsigned long _flags);
+
+    // Removes the prefetched listing of the directory and returns it if it's still fresh and its directory hasn't
+    // changed since the prefetch was scheduled, returns nullptr otherwise. Doesn't wait for a pending fetch.
+    VFSListingPtr Take(const VFSHost &_host, std::string_view _directory, unsigned long _flags);
+
+private:
+    struct Entry {
+        const VFSHost *host = nullptr;
+        std::string directory; // with a trailing slash
+        unsigned long flags = 0;
+        VFSListingPtr listing; // nullptr while pending
+        std::chrono::nanoseconds fetched_at{0};
+        uint64_t id = 0;
+        vfs::HostDirObservationTicket observation;
+        std::shared_ptr<std::atomic_bool> changed = std::make_shared<std::atomic_bool>(false);
+    };
+
+    void Fetch(const VFSHostPtr &_host, uint64_t _id);
+    std::vector<Entry>::iterator Find(const VFSHost &_host, std::string_view _directory, unsigned long _flags);
+
+    std::mutex m_Lock;
+    std::vector<Entry> m_Entries; // ordered from the oldest to the newest
+    uint64_t m_LastID = 0;
+    base::SerialQueue m_Queue{"nc::panel::ListingPrefetcher"};
+};
+
+} // namespace nc::panel
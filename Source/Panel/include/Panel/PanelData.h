@@ -1,10 +1,12 @@
-// Copyright (C) 2013-2020 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <VFS/VFSListing.h>
 #include "PanelDataSortMode.h"
 #include "PanelDataStatistics.h"
 #include "PanelDataFilter.h"
+#include "PanelDataNameSortKeys.h"
+#include "PanelDataFilterIndex.h"
 
 #include <vector>
 #include <string_view>
@@ -52,6 +54,9 @@ public:
     // updates statistics.
     void Load(const VFSListingPtr &_listing, PanelType _type);
         
+    // Replaces the listing with its newer version, keeping the volatile data of the entries which are still there.
+    // When only a small part of the entries were added, removed or changed, they are patched into the sorted and
+    // filtered indices and the statistics instead of rebuilding these from scratch.
     void ReLoad(const VFSListingPtr &_listing);
 
     /**
@@ -269,6 +274,11 @@ public:
 
 private:
     void DoSortWithHardFiltering();
+    void PatchSortingAfterReLoad(const VFSListing &_old_listing,
+                                 std::span<const ItemVolatileData> _old_vd,
+                                 std::span<const unsigned> _kept);
+    bool ApplyHardFiltering(unsigned _raw_index);
+    bool ApplySoftFiltering(unsigned _raw_index);
     void CustomFlagsSelectRaw(int _at_raw_pos, bool _is_selected);
     void ClearSelectedFlagsFromHiddenElements();
     void UpdateStatictics();
@@ -286,6 +296,10 @@ private:
         
     // sorted with customly defined sort
     std::vector<unsigned> m_EntriesByCustomSort;
+
+    // binary keys of the display names, built on the first sort of a listing and kept until the listing or the case
+    // sensitivity / numeric flags change
+    NameSortKeys m_NameSortKeys;
     
     // Reversed index: maps from the raw indices to the sorted indices. Can be
     // std::numeric_limits<unsigned>::max() if the entry is not present in the custom sort.
@@ -296,6 +310,10 @@ private:
     struct SortMode m_CustomSortMode;
     HardFilter m_HardFiltering;
     TextualFilter m_SoftFiltering;
+
+    // folded display names for the soft filtering, built when the filtering starts and dropped when it ends or the
+    // listing changes
+    FilterIndex m_SoftFilterIndex;
     Statistics m_Stats;
     PanelType m_Type;
 };
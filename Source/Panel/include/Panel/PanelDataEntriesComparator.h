@@ -1,21 +1,26 @@
-// Copyright (C) 2017-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <VFS/VFS.h>
 #include "PanelDataSortMode.h"
 #include "PanelDataItemVolatileData.h"
 #include <span>
+#include <string_view>
 
 namespace nc::panel::data {
 
 struct ExternalEntryKey;
+class NameSortKeys;
 
+// The comparators can be given the precomputed sort keys of the listing, which must be built with the same case
+// sensitivity and numeric flags as the sort mode. Without them the names are compared with CFStringCompare().
 class ListingComparatorBase
 {
 public:
     ListingComparatorBase(const VFSListing &_items,
                           std::span<const ItemVolatileData> _vd,
-                          SortMode _sort_mode);
+                          SortMode _sort_mode,
+                          const NameSortKeys *_keys);
 
 protected:
     int Compare(CFStringRef _1st, CFStringRef _2nd) const noexcept;
@@ -23,6 +28,7 @@ protected:
     const VFSListing &l;
     const std::span<const ItemVolatileData> vd;
     const SortMode sort_mode;
+    const NameSortKeys *const keys;
 
 private:
     const CFStringCompareFlags str_comp_flags;
@@ -35,7 +41,8 @@ class IndirectListingComparator : private ListingComparatorBase
 public:
     IndirectListingComparator(const VFSListing &_items,
                               std::span<const ItemVolatileData> _vd,
-                              SortMode sort_mode);
+                              SortMode sort_mode,
+                              const NameSortKeys *_keys = nullptr);
     bool operator()(unsigned _1, unsigned _2) const;
 
 private:
@@ -59,10 +66,16 @@ private:
 
 class ExternalListingComparator : private ListingComparatorBase {
 public:
+    // _name_key is the sort key of the display name of the external entries, used along with _keys
     ExternalListingComparator(const VFSListing &_items,
                               std::span<const ItemVolatileData> _vd,
-                              SortMode sort_mode);
+                              SortMode sort_mode,
+                              const NameSortKeys *_keys = nullptr,
+                              std::string_view _name_key = {});
     bool operator()(unsigned _1, const ExternalEntryKey &_val2) const;
+
+private:
+    const std::string_view name_key;
 };
 
 } // namespace nc::panel::data
@@ -0,0 +1,65 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <VFS/VFS.h>
+#include "PanelDataFilter.h"
+#include "PanelDataItemVolatileData.h"
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nc::panel::data {
+
+// Lowercased copies of the display filenames of a listing, which let a TextualFilter evaluate all items of the listing
+// at once without going through NSString.
+// Only the names consisting of ASCII characters are folded, the others are evaluated with TextualFilter::IsValidItem(),
+// same as all names are when the filtering text itself is not ASCII. The results are the same as IsValidItem() gives.
+// The verdicts of the latest evaluation are kept, so that when the text is extended, as it happens when typing in
+// quick search, the items which didn't match before are not evaluated again.
+class FilterIndex
+{
+public:
+    FilterIndex() noexcept = default;
+
+    // Folds the names of all items of the listing
+    explicit FilterIndex(const VFSListing &_listing);
+
+    // Returns true if the index was built for a listing of this size
+    bool Matches(size_t _count) const noexcept;
+
+    // Evaluates the filter for the items at _raw_indices, the large amounts are processed concurrently.
+    // Returns the highlights of the items at the same positions, or nullopt for the items which are filtered out.
+    std::vector<std::optional<QuickSearchHiglight>>
+    Evaluate(const VFSListing &_listing, const TextualFilter &_filter, std::span<const unsigned> _raw_indices);
+
+    // Same as FuzzySearch(), but for the lowercased ASCII strings
+    static std::optional<QuickSearchHiglight> FuzzySearch(std::string_view _filename, std::string_view _text) noexcept;
+
+private:
+    enum class Verdict : uint8_t {
+        Unknown = 0,
+        Rejected = 1,
+        Accepted = 2
+    };
+
+    std::optional<QuickSearchHiglight>
+    EvaluateItem(const VFSListing &_listing, const TextualFilter &_filter, std::string_view _text, unsigned _index)
+        const;
+    std::string_view Name(unsigned _index) const noexcept;
+    bool IsFolded(unsigned _index) const noexcept;
+
+    std::vector<unsigned> m_Offsets; // Count() + 1 offsets into m_Arena
+    std::vector<bool> m_Folded;      // the name of the item is in m_Arena
+    std::string m_Arena;
+
+    // the latest evaluation
+    std::string m_Text;
+    TextualFilter::Where m_Type = TextualFilter::Anywhere;
+    bool m_IgnoreDotDot = true;
+    std::vector<Verdict> m_Verdicts;
+};
+
+} // namespace nc::panel::data
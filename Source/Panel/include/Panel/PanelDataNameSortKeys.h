@@ -0,0 +1,55 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <VFS/VFS.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nc::panel::data {
+
+// Binary sort keys of the display filenames of a listing, built once per listing.
+// The keys compare bytewise in the same order as CFStringCompare() compares the names with the flags of a sort mode:
+// the names are case-folded unless the comparison is case-sensitive, UTF-16 units are stored big-endian, and with the
+// numeric sorting the runs of digits are stored as their lengths followed by the digits, so that longer numbers go
+// after the shorter ones. Different names can have the same key, e.g. "a01" and "a1", such ties have to be resolved
+// with CFStringCompare().
+class NameSortKeys
+{
+public:
+    NameSortKeys() noexcept = default;
+
+    // Builds the keys for all items of the listing, the large listings are processed concurrently
+    NameSortKeys(const VFSListing &_listing, bool _case_sensitive, bool _numeric);
+
+    // Builds the keys for a new version of a listing with the flags of _previous.
+    // _previous_indices[i] is the index of the i-th item of _listing in _previous if its display name didn't change, or
+    // std::numeric_limits<unsigned>::max() otherwise. Only the keys of the latter items are built anew.
+    NameSortKeys(const VFSListing &_listing, const NameSortKeys &_previous, std::span<const unsigned> _previous_indices);
+
+    // Builds a key of a single name with the same rules
+    static std::string Make(CFStringRef _name, bool _case_sensitive, bool _numeric);
+
+    // Returns true if the keys were built for a listing of this size with these flags
+    bool Matches(size_t _count, bool _case_sensitive, bool _numeric) const noexcept;
+
+    std::string_view Key(unsigned _index) const noexcept;
+
+    // Compares the keys of two items, returns a negative value, zero or a positive value
+    int Compare(unsigned _1, unsigned _2) const noexcept;
+
+    // Compares the key of an item with an external key
+    int Compare(unsigned _1, std::string_view _2) const noexcept;
+
+private:
+    // The first 8 bytes of each key in big-endian, most comparisons end with them without touching the arena
+    std::vector<uint64_t> m_Prefixes;
+    std::vector<unsigned> m_Offsets; // Count() + 1 offsets into m_Arena
+    std::string m_Arena;
+    bool m_CaseSensitive = false;
+    bool m_Numeric = false;
+};
+
+} // namespace nc::panel::data
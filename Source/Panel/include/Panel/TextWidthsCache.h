@@ -4,55 +4,92 @@
 #include <Cocoa/Cocoa.h>
 #include <Base/CFPtr.h>
 #include <Base/RobinHoodUtil.h>
+#include <Base/spinlock.h>
+#include <array>
+#include <atomic>
 #include <string>
-#include <mutex>
 #include <robin_hood.h>
 #include <span>
-#include <atomic>
+#include <vector>
 
 namespace nc::panel {
 
 // This class provides a caching facility to get pixel widths of strings, presumably filenames.
 // Under the hood it uses nc::utility::FontGeometryInfo::CalculateStringsWidths()
+// The cache of each font is split into shards by the hashes of the strings, each shard is locked on its own and holds
+// a bounded amount of widths, evicted with the CLOCK policy. The strings of a batch being served are never evicted in
+// favor of each other: a shard grows to hold its part of a batch larger than its capacity, so that huge listings, which
+// are asked for as a whole, are served from the cache the next time.
 class TextWidthsCache
 {
 public:
+    // Amount of independently locked parts of the cache of a font
+    static constexpr size_t ShardsNumber = 16;
+
+    // Maximum amount of widths stored in a shard, unless a single batch takes more
+    static constexpr size_t ShardCapacity = 4096;
+
+    struct Statistics {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        size_t size = 0; // amount of the widths currently stored
+    };
+
     static TextWidthsCache &Instance();
 
     std::vector<unsigned short> Widths(std::span<const CFStringRef> _strings, NSFont *_font);
 
+    // Returns the counters summed up across all fonts, for diagnostics
+    Statistics Stats() const;
+
 private:
-    struct CFStringHashEqual {
-        using is_transparent = void;
-
-        // hashes
-        size_t operator()(const base::CFPtr<CFStringRef> &_string) const noexcept;
-        size_t operator()(CFStringRef _string) const noexcept;
-
-        // equality
-        bool operator()(const base::CFPtr<CFStringRef> &_lhs, const base::CFPtr<CFStringRef> &_rhs) const noexcept;
-        bool operator()(const base::CFPtr<CFStringRef> &_lhs, CFStringRef _rhs) const noexcept;
-        bool operator()(CFStringRef _lhs, const base::CFPtr<CFStringRef> &_rhs) const noexcept;
-        bool operator()(CFStringRef _lhs, CFStringRef _rhs) const noexcept;
+    struct Key {
+        CFStringRef string;
+        size_t hash;
     };
+
+    struct KeyHashEqual {
+        size_t operator()(const Key &_key) const noexcept;
+        bool operator()(const Key &_lhs, const Key &_rhs) const noexcept;
+    };
+
+    // The widths are stored in a ring of slots, which is swept by a clock hand looking for a slot to evict.
+    // A hit only marks its slot as referenced, and the hand gives such slots a second chance.
+    struct Shard {
+        struct Slot {
+            base::CFPtr<CFStringRef> string;
+            size_t hash = 0;
+            unsigned short width = 0;
+            bool referenced = false;
+            uint64_t batch = 0; // the last batch which has asked for this string, such slots aren't evicted by it
+        };
+        robin_hood::unordered_flat_map<Key, uint32_t, KeyHashEqual, KeyHashEqual> index; // points into slots
+        std::vector<Slot> slots;
+        size_t capacity = ShardCapacity; // grows to the largest part of a batch, never shrinks
+        size_t hand = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+        mutable spinlock lock;
+
+        void Insert(const Key &_key, unsigned short _width, uint64_t _batch);
+    };
+
     struct Cache {
-        using WidthsT = robin_hood::
-            unordered_flat_map<base::CFPtr<CFStringRef>, unsigned short, CFStringHashEqual, CFStringHashEqual>;
-        WidthsT widths;
-        std::mutex lock;
-        std::atomic_bool purge_scheduled{false};
+        std::array<Shard, ShardsNumber> shards;
     };
+
     using CachesPerFontT =
         robin_hood::unordered_node_map<std::string, Cache, RHTransparentStringHashEqual, RHTransparentStringHashEqual>;
 
     TextWidthsCache();
     ~TextWidthsCache();
     Cache &ForFont(NSFont *_font);
-    void PurgeIfNeeded(Cache &_cache);
-    static void Purge(Cache &_cache);
 
     CachesPerFontT m_CachesPerFont;
-    std::mutex m_Lock;
+    mutable spinlock m_Lock;
+    std::atomic<uint64_t> m_LastBatch{0};
 };
 
 } // namespace nc::panel
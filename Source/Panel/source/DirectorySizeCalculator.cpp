@@ -0,0 +1,264 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "DirectorySizeCalculator.h"
+#include <Base/CFPtr.h>
+#include <Base/CFString.h>
+#include <algorithm>
+#include <dispatch/dispatch.h>
+#include <fcntl.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nc::panel {
+
+static const CFAbsoluteTime g_FSEventsLatency = 0.1; // 100ms
+
+namespace {
+
+struct CanonicalDirectory {
+    std::string path; // without a trailing slash, except for the root
+    struct stat st;
+};
+
+} // namespace
+
+static dispatch_queue_t EventsQueue()
+{
+    [[clang::no_destroy]] static const dispatch_queue_t queue =
+        dispatch_queue_create("nc::panel::DirectorySizeCalculator", DISPATCH_QUEUE_SERIAL);
+    return queue;
+}
+
+// Returns the path of a native directory in the form the file system events report it, i.e. with the symlinks
+// resolved, along with its stat
+static std::optional<CanonicalDirectory> OpenCanonicalDirectory(const std::string &_path)
+{
+    const int fd = open(_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if( fd < 0 )
+        return {};
+
+    CanonicalDirectory directory;
+    char path[MAXPATHLEN];
+    const bool ok = fcntl(fd, F_GETPATH, path) == 0 && fstat(fd, &directory.st) == 0;
+    close(fd);
+    if( !ok )
+        return {};
+
+    directory.path = path;
+    while( directory.path.length() > 1 && directory.path.back() == '/' )
+        directory.path.pop_back();
+    return directory;
+}
+
+DirectorySizeCalculator::DirectorySizeCalculator() = default;
+
+DirectorySizeCalculator::~DirectorySizeCalculator()
+{
+    auto stream_lock = std::lock_guard{m_StreamLock};
+    if( m_Stream ) {
+        FSEventStreamStop(m_Stream);
+        FSEventStreamInvalidate(m_Stream);
+        FSEventStreamRelease(m_Stream);
+    }
+}
+
+std::string DirectorySizeCalculator::Normalize(std::string_view _path)
+{
+    while( _path.length() > 1 && _path.back() == '/' )
+        _path.remove_suffix(1);
+    return std::string(_path);
+}
+
+bool DirectorySizeCalculator::IsSameOrParent(std::string_view _parent, std::string_view _path) noexcept
+{
+    if( _parent == "/" )
+        return true;
+    return _path.starts_with(_parent) && (_path.length() == _parent.length() || _path[_parent.length()] == '/');
+}
+
+std::optional<uint64_t> DirectorySizeCalculator::Cached(VFSHost &_host, std::string_view _path)
+{
+    if( !_host.IsNativeFS() )
+        return {};
+
+    const auto directory = OpenCanonicalDirectory(std::string(_path));
+    if( !directory )
+        return {};
+
+    return Lookup(directory->path, directory->st);
+}
+
+std::optional<uint64_t> DirectorySizeCalculator::Lookup(const std::string &_canonical_path, const struct stat &_st)
+{
+    auto lock = std::lock_guard{m_Lock};
+    const auto it = m_Cache.find(_canonical_path);
+    if( it == m_Cache.end() )
+        return {};
+
+    Entry &entry = it->second;
+    if( entry.inode != _st.st_ino || entry.mtime.tv_sec != _st.st_mtimespec.tv_sec ||
+        entry.mtime.tv_nsec != _st.st_mtimespec.tv_nsec ) {
+        m_Cache.erase(it); // the directory was replaced or its entries have changed
+        return {};
+    }
+    entry.last_used = ++m_UseCounter;
+    return entry.size;
+}
+
+ssize_t DirectorySizeCalculator::Calculate(VFSHost &_host,
+                                           std::string_view _path,
+                                           const VFSCancelChecker &_cancel_checker)
+{
+    const std::string path(_path);
+    if( !_host.IsNativeFS() )
+        return _host.CalculateDirectorySize(path.c_str(), _cancel_checker);
+
+    const auto directory = OpenCanonicalDirectory(path);
+    if( !directory )
+        return _host.CalculateDirectorySize(path.c_str(), _cancel_checker);
+
+    if( const auto cached = Lookup(directory->path, directory->st) )
+        return static_cast<ssize_t>(*cached);
+
+    // the watching starts before the walk, so that any change made during it is noticed
+    InFlight in_flight{directory->path};
+    {
+        auto lock = std::lock_guard{m_Lock};
+        m_InFlight.push_back(&in_flight);
+    }
+    const auto slash = directory->path.rfind('/');
+    Watch(slash == 0 || slash == std::string::npos ? std::string("/") : directory->path.substr(0, slash));
+
+    const ssize_t result = _host.CalculateDirectorySize(path.c_str(), _cancel_checker);
+
+    auto lock = std::lock_guard{m_Lock};
+    std::erase(m_InFlight, &in_flight);
+    if( result >= 0 && !in_flight.invalidated ) {
+        Entry &entry = m_Cache[directory->path];
+        entry.size = static_cast<uint64_t>(result);
+        entry.inode = directory->st.st_ino;
+        entry.mtime = directory->st.st_mtimespec;
+        entry.last_used = ++m_UseCounter;
+        Trim();
+    }
+    return result;
+}
+
+void DirectorySizeCalculator::Invalidate(std::string_view _path, bool _recursive)
+{
+    const std::string path = Normalize(_path);
+    auto lock = std::lock_guard{m_Lock};
+
+    // the directory and its parents
+    for( std::string_view parent = path; !parent.empty(); ) {
+        if( const auto it = m_Cache.find(parent); it != m_Cache.end() )
+            m_Cache.erase(it);
+        if( parent == "/" )
+            break;
+        const auto slash = parent.rfind('/');
+        if( slash == std::string_view::npos )
+            break;
+        parent = slash == 0 ? std::string_view("/") : parent.substr(0, slash);
+    }
+
+    // the directories inside it, which are stored as a range of keys
+    if( _recursive ) {
+        const std::string prefix = path == "/" ? path : path + '/';
+        auto it = m_Cache.lower_bound(prefix);
+        while( it != m_Cache.end() && it->first.starts_with(prefix) )
+            it = m_Cache.erase(it);
+    }
+
+    for( InFlight *in_flight : m_InFlight )
+        if( IsSameOrParent(in_flight->path, path) || (_recursive && IsSameOrParent(path, in_flight->path)) )
+            in_flight->invalidated = true;
+}
+
+void DirectorySizeCalculator::Trim()
+{
+    if( m_Cache.size() <= MaxCachedSizes )
+        return;
+
+    // forget the least recently used quarter at once
+    std::vector<uint64_t> uses;
+    uses.reserve(m_Cache.size());
+    for( auto &entry : m_Cache )
+        uses.push_back(entry.second.last_used);
+    const auto threshold = uses.begin() + static_cast<ptrdiff_t>(uses.size() / 4);
+    std::nth_element(uses.begin(), threshold, uses.end());
+    std::erase_if(m_Cache, [&](auto &_entry) { return _entry.second.last_used <= *threshold; });
+}
+
+void DirectorySizeCalculator::Watch(const std::string &_path)
+{
+    {
+        auto lock = std::lock_guard{m_Lock};
+        if( std::any_of(m_WatchedPaths.begin(), m_WatchedPaths.end(), [&](const std::string &_watched) {
+                return IsSameOrParent(_watched, _path);
+            }) )
+            return;
+        std::erase_if(m_WatchedPaths, [&](const std::string &_watched) { return IsSameOrParent(_path, _watched); });
+        m_WatchedPaths.push_back(_path);
+    }
+    RestartStream();
+}
+
+void DirectorySizeCalculator::RestartStream()
+{
+    auto stream_lock = std::lock_guard{m_StreamLock};
+
+    std::vector<std::string> watched_paths;
+    {
+        auto lock = std::lock_guard{m_Lock};
+        watched_paths = m_WatchedPaths;
+    }
+
+    const auto paths = base::CFPtr<CFMutableArrayRef>::adopt(
+        CFArrayCreateMutable(nullptr, static_cast<CFIndex>(watched_paths.size()), &kCFTypeArrayCallBacks));
+    for( auto &path : watched_paths )
+        if( const auto cf_path = base::CFPtr<CFStringRef>::adopt(base::CFStringCreateWithUTF8StdString(path)) )
+            CFArrayAppendValue(paths.get(), cf_path.get());
+
+    // the new stream picks up from the current moment, while the old one delivers whatever is pending before going
+    // away, so no event is lost in between
+    const FSEventStreamEventId since = m_Stream ? FSEventsGetCurrentEventId() : kFSEventStreamEventIdSinceNow;
+    auto context = FSEventStreamContext{0, this, nullptr, nullptr, nullptr};
+    const FSEventStreamRef stream = FSEventStreamCreate(nullptr,
+                                                        &DirectorySizeCalculator::OnEvents,
+                                                        &context,
+                                                        paths.get(),
+                                                        since,
+                                                        g_FSEventsLatency,
+                                                        kFSEventStreamCreateFlagNoDefer);
+    if( stream == nullptr )
+        return; // keep the old stream, if any
+    FSEventStreamSetDispatchQueue(stream, EventsQueue());
+    FSEventStreamStart(stream);
+
+    if( m_Stream ) {
+        FSEventStreamFlushSync(m_Stream);
+        FSEventStreamStop(m_Stream);
+        FSEventStreamInvalidate(m_Stream);
+        FSEventStreamRelease(m_Stream);
+    }
+    m_Stream = stream;
+}
+
+void DirectorySizeCalculator::OnEvents([[maybe_unused]] ConstFSEventStreamRef _stream,
+                                       void *_user_data,
+                                       size_t _num,
+                                       void *_paths,
+                                       const FSEventStreamEventFlags _flags[],
+                                       [[maybe_unused]] const FSEventStreamEventId _ids[])
+{
+    auto &me = *static_cast<DirectorySizeCalculator *>(_user_data);
+    const auto paths = static_cast<const char **>(_paths);
+    constexpr FSEventStreamEventFlags whole_tree = kFSEventStreamEventFlagMustScanSubDirs |
+                                                   kFSEventStreamEventFlagRootChanged | kFSEventStreamEventFlagMount |
+                                                   kFSEventStreamEventFlagUnmount;
+    for( size_t i = 0; i != _num; ++i )
+        if( paths[i] != nullptr && paths[i][0] == '/' )
+            me.Invalidate(paths[i], (_flags[i] & whole_tree) != 0);
+}
+
+} // namespace nc::panel
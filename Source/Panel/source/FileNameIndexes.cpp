@@ -0,0 +1,126 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "FileNameIndexes.h"
+#include <Base/dispatch_cpp.h>
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace nc::panel {
+
+namespace {
+
+struct Entry {
+    std::string root;                          // with a trailing slash
+    std::shared_ptr<vfs::FileNameIndex> index; // nullptr while being built
+    vfs::HostDirObservationTicket observation;
+    uint64_t last_used = 0;
+};
+
+} // namespace
+
+struct FileNameIndexes::State {
+    std::mutex lock;
+    std::vector<Entry> entries;
+    uint64_t use_counter = 0;
+    std::atomic_bool stopped{false};
+};
+
+FileNameIndexes::FileNameIndexes() : m_State(std::make_shared<State>())
+{
+}
+
+FileNameIndexes::~FileNameIndexes()
+{
+    m_State->stopped = true;
+}
+
+std::shared_ptr<const vfs::FileNameIndex> FileNameIndexes::Find(const VFSHostPtr &_host, std::string_view _path)
+{
+    if( !_host || !_host->IsNativeFS() || _path.empty() )
+        return nullptr;
+
+    std::string root(_path);
+    if( root.back() != '/' )
+        root += '/';
+
+    auto lock = std::lock_guard{m_State->lock};
+    auto &entries = m_State->entries;
+    bool building = false;
+    for( auto &entry : entries )
+        if( root.starts_with(entry.root) ) {
+            entry.last_used = ++m_State->use_counter;
+            if( entry.index )
+                return entry.index;
+            building = true;
+        }
+    if( building )
+        return nullptr;
+
+    // a new index supersedes the ones below its root
+    std::erase_if(entries, [&](const Entry &_entry) { return _entry.root.starts_with(root); });
+    entries.emplace_back(Entry{root, nullptr, {}, ++m_State->use_counter});
+    if( entries.size() > MaxIndexes )
+        entries.erase(std::ranges::min_element(entries, {}, &Entry::last_used));
+
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_LOW, 0),
+                   [state = m_State, host = _host, root] { Build(state, host, root); });
+    return nullptr;
+}
+
+void FileNameIndexes::Build(const std::shared_ptr<State> &_state, const VFSHostPtr &_host, const std::string &_root)
+{
+    // the changes made while the directories are being walked are recorded and caught up with afterwards
+    struct Changes {
+        std::mutex lock;
+        std::map<std::string, bool> dirs; // path -> recursive
+    };
+    auto changes = std::make_shared<Changes>();
+    auto walk_observation =
+        _host->DirSubtreeChangeObserve(_root.c_str(), [changes](std::string_view _dir, bool _recursive) {
+            auto lock = std::lock_guard{changes->lock};
+            auto &recursive = changes->dirs[std::string(_dir)];
+            recursive = recursive || _recursive;
+        });
+
+    const auto is_dropped = [&] {
+        auto lock = std::lock_guard{_state->lock};
+        return std::ranges::none_of(_state->entries, [&](const Entry &_entry) { return _entry.root == _root; });
+    };
+    const auto cancel_checker = [&] { return _state->stopped.load() || is_dropped(); };
+
+    std::shared_ptr<vfs::FileNameIndex> index;
+    vfs::HostDirObservationTicket observation;
+    if( walk_observation ) {
+        index = vfs::FileNameIndex::Build(*_host, _root, cancel_checker);
+        if( index )
+            observation = index->Observe(_host, _root);
+        walk_observation.reset();
+    }
+
+    if( index && observation ) {
+        std::map<std::string, bool> dirs;
+        {
+            auto lock = std::lock_guard{changes->lock};
+            dirs.swap(changes->dirs);
+        }
+        for( const auto &[dir, recursive] : dirs )
+            index->Refresh(*_host, dir, recursive);
+    }
+
+    auto lock = std::lock_guard{_state->lock};
+    auto &entries = _state->entries;
+    const auto it = std::ranges::find_if(entries, [&](const Entry &_entry) { return _entry.root == _root; });
+    if( it == entries.end() )
+        return; // dropped meanwhile
+    if( !index || !observation ) {
+        // the directory can't be indexed or kept in sync, searches there will walk it as usual
+        entries.erase(it);
+        return;
+    }
+    it->index = std::move(index);
+    it->observation = std::move(observation);
+}
+
+} // namespace nc::panel
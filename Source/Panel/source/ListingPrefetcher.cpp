@@ -0,0 +1,118 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "ListingPrefetcher.h"
+#include <Base/mach_time.h>
+#include <Utility/PathManip.h>
+#include <algorithm>
+
+namespace nc::panel {
+
+ListingPrefetcher::ListingPrefetcher() = default;
+
+ListingPrefetcher::~ListingPrefetcher()
+{
+    m_Queue.Stop();
+    m_Queue.Wait();
+}
+
+std::vector<ListingPrefetcher::Entry>::iterator
+ListingPrefetcher::Find(const VFSHost &_host, std::string_view _directory, unsigned long _flags)
+{
+    return std::ranges::find_if(m_Entries, [&](const Entry &_entry) {
+        return _entry.host == &_host && _entry.flags == _flags && _entry.directory == _directory;
+    });
+}
+
+void ListingPrefetcher::Prefetch(const VFSHostPtr &_host, std::string_view _directory, unsigned long _flags)
+{
+    if( !_host || !_host->IsNativeFS() || _directory.empty() || _directory.front() != '/' )
+        return;
+
+    const std::string directory = EnsureTrailingSlash(std::string(_directory));
+    const auto now = base::machtime();
+    uint64_t id = 0;
+    std::shared_ptr<std::atomic_bool> changed;
+    {
+        auto lock = std::lock_guard{m_Lock};
+        if( auto it = Find(*_host, directory, _flags); it != m_Entries.end() ) {
+            if( it->listing == nullptr || (now - it->fetched_at < TimeToLive && !*it->changed) )
+                return; // already pending or fresh
+            m_Entries.erase(it);
+        }
+        if( m_Entries.size() == Capacity )
+            m_Entries.erase(m_Entries.begin());
+
+        Entry entry;
+        entry.host = _host.get();
+        entry.directory = directory;
+        entry.flags = _flags;
+        entry.id = id = ++m_LastID;
+        changed = entry.changed;
+        m_Entries.emplace_back(std::move(entry));
+    }
+
+    // the observation is set up before the fetch starts, so the changes made while fetching are caught as well.
+    // it's done outside of the lock since the host might need to sync with the main thread.
+    auto observation = _host->DirChangeObserve(directory.c_str(), [changed] { *changed = true; });
+
+    {
+        auto lock = std::lock_guard{m_Lock};
+        auto it = std::ranges::find_if(m_Entries, [id](const Entry &_entry) { return _entry.id == id; });
+        if( it == m_Entries.end() )
+            return;
+        if( !observation ) {
+            m_Entries.erase(it); // without the observation the listing couldn't be trusted anyway
+            return;
+        }
+        it->observation = std::move(observation);
+    }
+
+    m_Queue.Run([this, _host, id] { Fetch(_host, id); });
+}
+
+void ListingPrefetcher::Fetch(const VFSHostPtr &_host, uint64_t _id)
+{
+    std::string directory;
+    unsigned long flags = 0;
+    {
+        auto lock = std::lock_guard{m_Lock};
+        auto it = std::ranges::find_if(m_Entries, [_id](const Entry &_entry) { return _entry.id == _id; });
+        if( it == m_Entries.end() )
+            return; // was taken or forgotten before the fetch started, nothing to do
+        directory = it->directory;
+        flags = it->flags;
+    }
+
+    VFSListingPtr listing;
+    const int rc =
+        _host->FetchDirectoryListing(directory.c_str(), listing, flags, [this] { return m_Queue.IsStopped(); });
+
+    auto lock = std::lock_guard{m_Lock};
+    auto it = std::ranges::find_if(m_Entries, [_id](const Entry &_entry) { return _entry.id == _id; });
+    if( it == m_Entries.end() )
+        return;
+    if( rc != VFSError::Ok || listing == nullptr ) {
+        m_Entries.erase(it);
+        return;
+    }
+    it->listing = std::move(listing);
+    it->fetched_at = base::machtime();
+}
+
+VFSListingPtr ListingPrefetcher::Take(const VFSHost &_host, std::string_view _directory, unsigned long _flags)
+{
+    if( _directory.empty() )
+        return nullptr;
+    const std::string directory = EnsureTrailingSlash(std::string(_directory));
+
+    auto lock = std::lock_guard{m_Lock};
+    auto it = Find(_host, directory, _flags);
+    if( it == m_Entries.end() || it->listing == nullptr )
+        return nullptr;
+    VFSListingPtr listing;
+    if( base::machtime() - it->fetched_at < TimeToLive && !*it->changed )
+        listing = std::move(it->listing);
+    m_Entries.erase(it);
+    return listing;
+}
+
+} // namespace nc::panel
@@ -6,7 +6,9 @@
 #include <VFS/VFS.h>
 #include "PanelDataExternalEntryKey.h"
 #include "Log.h"
+#include <iterator>
 #include <numeric>
+#include <robin_hood.h>
 #include <magic_enum.hpp>
 #include <pstld/pstld.h>
 
@@ -15,6 +17,11 @@ namespace nc::panel::data {
 // Don't bother with parallelism unless we have at least 10'000 items in a listing
 constexpr inline size_t g_ParallelSortThresh = 10'000;
 
+// ReLoad() patches the sorted indices in place unless more than 1/g_ReLoadPatchRatio of the entries have changed
+constexpr inline size_t g_ReLoadPatchRatio = 4;
+
+constexpr inline unsigned g_NoIndex = std::numeric_limits<unsigned>::max();
+
 static void DoRawSort(const VFSListing &_from, std::vector<unsigned> &_to);
 
 static inline SortMode DefaultSortMode()
@@ -116,6 +123,8 @@ void Model::Load(const VFSListingPtr &_listing, PanelType _type)
 
     m_Listing = _listing;
     m_Type = _type;
+    m_NameSortKeys = {};
+    m_SoftFilterIndex = {};
     InitVolatileDataWithListing(m_VolatileData, *m_Listing);
 
     m_HardFiltering.text.OnPanelDataLoad();
@@ -143,6 +152,73 @@ static void UpdateWithExisingVD(ItemVolatileData &_new_vd, const ItemVolatileDat
     }
 }
 
+// Finds the entries of _new which have the same filenames as the entries of _old.
+// Returns false if a filename was met twice, which can't happen in a single directory, the entries matched before that
+// are still valid.
+static bool MatchByFilenames(const VFSListing &_old, const VFSListing &_new, std::vector<unsigned> &_new_to_old)
+{
+    robin_hood::unordered_flat_map<std::string_view, unsigned> old_indices;
+    old_indices.reserve(_old.Count());
+    for( unsigned i = 0, e = _old.Count(); i != e; ++i )
+        if( !old_indices.emplace(_old.Filename(i), i).second )
+            return false;
+
+    std::vector<bool> matched(_old.Count(), false);
+    for( unsigned i = 0, e = _new.Count(); i != e; ++i )
+        if( const auto it = old_indices.find(_new.Filename(i)); it != old_indices.end() ) {
+            if( matched[it->second] )
+                return false;
+            matched[it->second] = true;
+            _new_to_old[i] = it->second;
+        }
+    return true;
+}
+
+// Produces the raw C name order of _new from the order of the previous listing, only the added entries get sorted
+static std::vector<unsigned> PatchRawSort(std::span<const unsigned> _old_by_raw_name,
+                                          const VFSListing &_new,
+                                          std::span<const unsigned> _new_to_old)
+{
+    std::vector<unsigned> old_to_new(_old_by_raw_name.size(), g_NoIndex);
+    std::vector<unsigned> added;
+    for( unsigned i = 0, e = _new.Count(); i != e; ++i ) {
+        if( _new_to_old[i] == g_NoIndex )
+            added.push_back(i);
+        else
+            old_to_new[_new_to_old[i]] = i;
+    }
+
+    std::vector<unsigned> kept;
+    kept.reserve(_new.Count() - added.size());
+    for( const unsigned old_index : _old_by_raw_name )
+        if( old_to_new[old_index] != g_NoIndex )
+            kept.push_back(old_to_new[old_index]);
+
+    const auto less = [&_new](unsigned _1, unsigned _2) { return _new.Filename(_1) < _new.Filename(_2); };
+    std::sort(added.begin(), added.end(), less);
+
+    std::vector<unsigned> by_raw_name;
+    by_raw_name.reserve(_new.Count());
+    std::merge(kept.begin(), kept.end(), added.begin(), added.end(), std::back_inserter(by_raw_name), less);
+    return by_raw_name;
+}
+
+// Tells if two entries of different listings are sorted, filtered and counted the same way
+static bool IsSameForSorting(const VFSListing &_l1, unsigned _i1, const VFSListing &_l2, unsigned _i2) noexcept
+{
+    const auto same_time = [&](auto _has, auto _time) {
+        const bool has1 = (_l1.*_has)(_i1);
+        return has1 == (_l2.*_has)(_i2) && (!has1 || (_l1.*_time)(_i1) == (_l2.*_time)(_i2));
+    };
+    return _l1.UnixMode(_i1) == _l2.UnixMode(_i2) && _l1.UnixFlags(_i1) == _l2.UnixFlags(_i2) &&
+           _l1.HasSize(_i1) == _l2.HasSize(_i2) && _l1.Size(_i1) == _l2.Size(_i2) &&
+           same_time(&VFSListing::HasMTime, &VFSListing::MTime) &&
+           same_time(&VFSListing::HasBTime, &VFSListing::BTime) &&
+           same_time(&VFSListing::HasATime, &VFSListing::ATime) &&
+           same_time(&VFSListing::HasAddTime, &VFSListing::AddTime) &&
+           _l1.DisplayFilename(_i1) == _l2.DisplayFilename(_i2);
+}
+
 void Model::ReLoad(const VFSListingPtr &_listing)
 {
     assert(dispatch_is_main_queue()); // STA api design
@@ -152,39 +228,22 @@ void Model::ReLoad(const VFSListingPtr &_listing)
               _listing->Count(),
               _listing->IsUniform() ? _listing->Directory().c_str() : "N/A");
 
-    // sort new entries by raw c name for sync-swapping needs
-    std::vector<unsigned> dirbyrawcname;
-    DoRawSort(*_listing, dirbyrawcname);
+    // for each new entry - an index of the same entry in the current listing or g_NoIndex
+    std::vector<unsigned> new_to_old(_listing->Count(), g_NoIndex);
 
-    std::vector<ItemVolatileData> new_vd;
-    InitVolatileDataWithListing(new_vd, *_listing);
+    // new entries sorted by raw c name for sync-swapping needs
+    std::vector<unsigned> dirbyrawcname;
 
     if( _listing->IsUniform() && m_Listing->IsUniform() ) {
-        // transfer custom data to new array using sorted indeces arrays based in raw C filename.
-        // assumes that there can't be more than one file with same filenamr
-        unsigned dst_i = 0, dst_e = _listing->Count(), src_i = 0, src_e = m_Listing->Count();
-        for( ; src_i != src_e && dst_i != dst_e; ++src_i ) {
-            int src = m_EntriesByRawName[src_i];
-        check:
-            int dst = dirbyrawcname[dst_i];
-            int cmp = m_Listing->Filename(src).compare(_listing->Filename(dst));
-            if( cmp == 0 ) {
-
-                //                new_vd[ dst ] = m_VolatileData[ src ];
-                UpdateWithExisingVD(new_vd[dst], m_VolatileData[src]);
-
-                ++dst_i; // check this! we assume that normal directory can't hold two files with a
-                         // same name
-            }
-            else if( cmp > 0 ) {
-                dst_i++;
-                if( dst_i == dst_e )
-                    break;
-                goto check;
-            }
-        }
+        // the filenames are unique within a directory, so they identify the entries
+        if( MatchByFilenames(*m_Listing, *_listing, new_to_old) )
+            dirbyrawcname = PatchRawSort(m_EntriesByRawName, *_listing, new_to_old);
+        else
+            DoRawSort(*_listing, dirbyrawcname);
     }
     else if( !_listing->IsUniform() && !m_Listing->IsUniform() ) {
+        DoRawSort(*_listing, dirbyrawcname);
+
         auto src_keys = ProduceLongKeysForListing(*m_Listing);
         auto src_keys_ind = ProduceSortedIndirectIndecesForLongKeys(src_keys);
         auto dst_keys = ProduceLongKeysForListing(*_listing);
@@ -199,8 +258,7 @@ void Model::ReLoad(const VFSListingPtr &_listing)
             int dst = dst_keys_ind[dst_i];
             int cmp = src_keys[src].compare(dst_keys[dst]);
             if( cmp == 0 ) {
-                //                new_vd[ dst ] = m_VolatileData[ src ];
-                UpdateWithExisingVD(new_vd[dst], m_VolatileData[src]);
+                new_to_old[dst] = src;
                 ++dst_i;
             }
             else if( cmp > 0 ) {
@@ -214,15 +272,203 @@ void Model::ReLoad(const VFSListingPtr &_listing)
     else
         throw std::invalid_argument("PanelData::ReLoad: incompatible listing type!");
 
+    // transfer custom data to the new array
+    std::vector<ItemVolatileData> new_vd;
+    InitVolatileDataWithListing(new_vd, *_listing);
+    for( unsigned i = 0, e = _listing->Count(); i != e; ++i )
+        if( new_to_old[i] != g_NoIndex )
+            UpdateWithExisingVD(new_vd[i], m_VolatileData[new_to_old[i]]);
+
+    // the entries which keep their places in the sorted indices, everything else is placed anew.
+    // the dot-dot entry is never kept as it isn't sorted.
+    std::vector<unsigned> &kept = new_to_old;
+    size_t kept_amount = 0;
+    for( unsigned i = 0, e = _listing->Count(); i != e; ++i ) {
+        if( kept[i] == g_NoIndex )
+            continue;
+        if( _listing->IsDotDot(i) || new_vd[i].size != m_VolatileData[kept[i]].size ||
+            !IsSameForSorting(*m_Listing, kept[i], *_listing, i) )
+            kept[i] = g_NoIndex;
+        else
+            ++kept_amount;
+    }
+
+    const size_t changed_amount = (m_Listing->Count() - kept_amount) + (_listing->Count() - kept_amount);
+    const bool patch = m_CustomSortMode.sort != SortMode::SortNoSort &&
+                       changed_amount * g_ReLoadPatchRatio <= std::max(m_Listing->Count(), _listing->Count()) &&
+                       (!m_Listing->Empty() && m_Listing->IsDotDot(0)) == (!_listing->Empty() && _listing->IsDotDot(0));
+
     // put a new data in a place
-    m_Listing = std::move(_listing);
-    m_VolatileData = std::move(new_vd);
+    const VFSListingPtr old_listing = std::exchange(m_Listing, _listing);
+    const std::vector<ItemVolatileData> old_vd = std::exchange(m_VolatileData, std::move(new_vd));
     m_EntriesByRawName = std::move(dirbyrawcname);
+    m_SoftFilterIndex = {};
 
-    // now sort our new data with custom sortings
-    DoSortWithHardFiltering();
-    BuildSoftFilteringIndeces();
-    UpdateStatictics();
+    if( patch ) {
+        PatchSortingAfterReLoad(*old_listing, old_vd, kept);
+    }
+    else {
+        // now sort our new data with custom sortings
+        m_NameSortKeys = {};
+        DoSortWithHardFiltering();
+        BuildSoftFilteringIndeces();
+        UpdateStatictics();
+    }
+}
+
+// Adds (_sign=1) or removes (_sign=-1) an entry to/from the statistics, as UpdateStatictics() would count it
+static void AccountEntry(Statistics &_stats,
+                         const VFSListing &_listing,
+                         unsigned _index,
+                         const ItemVolatileData &_vd,
+                         bool _is_sorted,
+                         int _sign) noexcept
+{
+    if( _listing.IsReg(_index) ) {
+        _stats.bytes_in_raw_reg_files += _sign * static_cast<int64_t>(_listing.Size(_index));
+        _stats.raw_reg_files_amount += _sign;
+    }
+    if( _is_sorted && _vd.is_selected() ) {
+        _stats.bytes_in_selected_entries += _sign * static_cast<int64_t>(_vd.is_size_calculated() ? _vd.size : 0);
+        _stats.selected_entries_amount += _sign;
+        if( _listing.IsDir(_index) )
+            _stats.selected_dirs_amount += _sign;
+        else
+            _stats.selected_reg_amount += _sign;
+    }
+}
+
+void Model::PatchSortingAfterReLoad(const VFSListing &_old_listing,
+                                    std::span<const ItemVolatileData> _old_vd,
+                                    std::span<const unsigned> _kept)
+{
+    const unsigned old_size = _old_listing.Count();
+    const unsigned size = m_Listing->Count();
+    const bool has_dotdot = size != 0 && m_Listing->IsDotDot(0);
+    const auto was_sorted = [&](unsigned _old_index) {
+        return _old_index < m_ReverseToCustomSort.size() && m_ReverseToCustomSort[_old_index] != g_NoIndex;
+    };
+
+    std::vector<unsigned> old_to_new(old_size, g_NoIndex);
+    for( unsigned i = 0; i != size; ++i )
+        if( _kept[i] != g_NoIndex )
+            old_to_new[_kept[i]] = i;
+
+    // the statistics lose the entries which are gone or changed, and get the new or changed ones later
+    m_Stats.total_entries_amount = static_cast<int32_t>(size) - (has_dotdot ? 1 : 0);
+    for( unsigned i = 0; i != old_size; ++i )
+        if( old_to_new[i] == g_NoIndex )
+            AccountEntry(m_Stats, _old_listing, i, _old_vd[i], was_sorted(i), -1);
+
+    // the kept entries stay in the same order as before, along with their state of the soft filtering
+    const bool soft_filtering = m_SoftFiltering.IsFiltering();
+    std::vector<bool> soft_filtered_in;
+    if( soft_filtering ) {
+        std::vector<bool> was_soft_filtered_in(m_EntriesByCustomSort.size(), false);
+        for( const unsigned sorted_index : m_EntriesBySoftFiltering )
+            was_soft_filtered_in[sorted_index] = true;
+        soft_filtered_in.resize(size, false);
+        for( size_t i = 0, e = m_EntriesByCustomSort.size(); i != e; ++i )
+            if( const unsigned new_index = old_to_new[m_EntriesByCustomSort[i]]; new_index != g_NoIndex )
+                soft_filtered_in[new_index] = was_soft_filtered_in[i];
+    }
+
+    std::vector<unsigned> kept_sorted;
+    kept_sorted.reserve(m_EntriesByCustomSort.size());
+    for( const unsigned old_index : m_EntriesByCustomSort )
+        if( const unsigned new_index = old_to_new[old_index]; new_index != g_NoIndex )
+            kept_sorted.push_back(new_index);
+
+    // the rest go through the filters and get sorted on their own
+    std::vector<unsigned> placed_anew;
+    bool dotdot_is_sorted = false;
+    for( unsigned i = 0; i != size; ++i ) {
+        if( _kept[i] != g_NoIndex )
+            continue;
+        const bool is_sorted = ApplyHardFiltering(i);
+        if( is_sorted ) {
+            if( has_dotdot && i == 0 )
+                dotdot_is_sorted = true;
+            else
+                placed_anew.push_back(i);
+            if( soft_filtering )
+                soft_filtered_in[i] = ApplySoftFiltering(i);
+        }
+        AccountEntry(m_Stats, *m_Listing, i, m_VolatileData[i], is_sorted, 1);
+    }
+
+    if( m_CustomSortMode.sort != SortMode::SortByRawCName ) {
+        const bool case_sens = m_CustomSortMode.case_sens;
+        const bool numeric = m_CustomSortMode.numeric_sort;
+        if( m_NameSortKeys.Matches(old_size, case_sens, numeric) )
+            m_NameSortKeys = NameSortKeys(*m_Listing, m_NameSortKeys, _kept);
+        else
+            m_NameSortKeys = NameSortKeys(*m_Listing, case_sens, numeric);
+    }
+    else {
+        m_NameSortKeys = {};
+    }
+
+    const NameSortKeys *keys = m_CustomSortMode.sort != SortMode::SortByRawCName ? &m_NameSortKeys : nullptr;
+    const IndirectListingComparator comparator{*m_Listing, m_VolatileData, m_CustomSortMode, keys};
+    std::sort(placed_anew.begin(), placed_anew.end(), comparator);
+
+    // do not touch dotdot directory, it goes first
+    m_EntriesByCustomSort.clear();
+    m_EntriesByCustomSort.reserve(kept_sorted.size() + placed_anew.size() + 1);
+    if( dotdot_is_sorted )
+        m_EntriesByCustomSort.push_back(0);
+    std::merge(kept_sorted.begin(),
+               kept_sorted.end(),
+               placed_anew.begin(),
+               placed_anew.end(),
+               std::back_inserter(m_EntriesByCustomSort),
+               comparator);
+
+    m_ReverseToCustomSort.clear();
+    if( !m_EntriesByCustomSort.empty() ) {
+        m_ReverseToCustomSort.resize(size, g_NoIndex);
+        for( unsigned i = 0, e = static_cast<unsigned>(m_EntriesByCustomSort.size()); i != e; ++i )
+            m_ReverseToCustomSort[m_EntriesByCustomSort[i]] = i;
+    }
+
+    if( soft_filtering ) {
+        m_EntriesBySoftFiltering.clear();
+        for( unsigned i = 0, e = static_cast<unsigned>(m_EntriesByCustomSort.size()); i != e; ++i )
+            if( soft_filtered_in[m_EntriesByCustomSort[i]] )
+                m_EntriesBySoftFiltering.push_back(i);
+    }
+    else {
+        m_EntriesBySoftFiltering.resize(m_EntriesByCustomSort.size());
+        std::iota(m_EntriesBySoftFiltering.begin(), m_EntriesBySoftFiltering.end(), 0);
+    }
+}
+
+bool Model::ApplyHardFiltering(unsigned _raw_index)
+{
+    auto &vd = m_VolatileData[_raw_index];
+    vd.highlight = {};
+    vd.toggle_shown(true);
+    if( !m_HardFiltering.IsFiltering() )
+        return true;
+
+    QuickSearchHiglight found_range;
+    if( !m_HardFiltering.IsValidItem(m_Listing->Item(_raw_index), found_range) ) {
+        vd.toggle_shown(false);
+        return false;
+    }
+    if( m_HardFiltering.text.hightlight_results )
+        vd.highlight = found_range;
+    return true;
+}
+
+bool Model::ApplySoftFiltering(unsigned _raw_index)
+{
+    QuickSearchHiglight found_range;
+    const bool valid = m_SoftFiltering.IsValidItem(m_Listing->Item(_raw_index), found_range);
+    if( m_SoftFiltering.hightlight_results )
+        m_VolatileData[_raw_index].highlight = found_range;
+    return valid;
 }
 
 const std::shared_ptr<VFSHost> &Model::Host() const
@@ -810,10 +1056,19 @@ void Model::DoSortWithHardFiltering()
     const auto first = std::next(m_EntriesByCustomSort.begin(), m_Listing->IsDotDot(0) ? 1 : 0);
     const auto last = std::end(m_EntriesByCustomSort);
 
+    // every sort except the raw one compares the names, at least as a fallback
+    const NameSortKeys *keys = nullptr;
+    if( m_CustomSortMode.sort != SortMode::SortByRawCName ) {
+        if( !m_NameSortKeys.Matches(size, m_CustomSortMode.case_sens, m_CustomSortMode.numeric_sort) )
+            m_NameSortKeys = NameSortKeys(*m_Listing, m_CustomSortMode.case_sens, m_CustomSortMode.numeric_sort);
+        keys = &m_NameSortKeys;
+    }
+
+    const IndirectListingComparator comparator{*m_Listing, m_VolatileData, m_CustomSortMode, keys};
     if( m_EntriesByCustomSort.size() < g_ParallelSortThresh )
-        std::sort(first, last, IndirectListingComparator{*m_Listing, m_VolatileData, m_CustomSortMode});
+        std::sort(first, last, comparator);
     else
-        pstld::sort(first, last, IndirectListingComparator{*m_Listing, m_VolatileData, m_CustomSortMode});
+        pstld::sort(first, last, comparator);
 
     m_ReverseToCustomSort.resize(size);
     std::fill(m_ReverseToCustomSort.begin(), m_ReverseToCustomSort.end(), std::numeric_limits<unsigned>::max());
@@ -843,22 +1098,22 @@ const std::vector<unsigned> &Model::EntriesBySoftFiltering() const noexcept
 void Model::BuildSoftFilteringIndeces()
 {
     if( m_SoftFiltering.IsFiltering() ) {
+        if( !m_SoftFilterIndex.Matches(m_Listing->Count()) )
+            m_SoftFilterIndex = FilterIndex(*m_Listing);
+        const auto found_ranges = m_SoftFilterIndex.Evaluate(*m_Listing, m_SoftFiltering, m_EntriesByCustomSort);
+
         m_EntriesBySoftFiltering.clear();
         m_EntriesBySoftFiltering.reserve(m_EntriesByCustomSort.size());
-
-        int i = 0, e = static_cast<int>(m_EntriesByCustomSort.size());
-        for( ; i != e; ++i ) {
-            QuickSearchHiglight found_range;
-            const int raw_index = m_EntriesByCustomSort[i];
-            if( m_SoftFiltering.IsValidItem(m_Listing->Item(raw_index), found_range) )
+        const bool hightlight_results = m_SoftFiltering.hightlight_results;
+        for( unsigned i = 0, e = static_cast<unsigned>(m_EntriesByCustomSort.size()); i != e; ++i ) {
+            if( found_ranges[i] )
                 m_EntriesBySoftFiltering.push_back(i);
-
-            if( m_SoftFiltering.hightlight_results ) {
-                m_VolatileData[raw_index].highlight = found_range;
-            }
+            if( hightlight_results )
+                m_VolatileData[m_EntriesByCustomSort[i]].highlight = found_ranges[i].value_or(QuickSearchHiglight{});
         }
     }
     else {
+        m_SoftFilterIndex = {};
         m_EntriesBySoftFiltering.resize(m_EntriesByCustomSort.size());
         iota(begin(m_EntriesBySoftFiltering), end(m_EntriesBySoftFiltering), 0);
     }
@@ -877,10 +1132,19 @@ int Model::SortLowerBoundForEntrySortKeys(const ExternalEntryKey &_keys) const
     if( !_keys.is_valid() )
         return -1;
 
-    auto it = std::lower_bound(std::begin(m_EntriesByCustomSort),
-                               std::end(m_EntriesByCustomSort),
-                               _keys,
-                               ExternalListingComparator(*m_Listing, m_VolatileData, m_CustomSortMode));
+    // the entries were sorted with the name keys, so the search has to use them too
+    const bool has_name_keys =
+        m_NameSortKeys.Matches(m_Listing->Count(), m_CustomSortMode.case_sens, m_CustomSortMode.numeric_sort);
+    const std::string name_key =
+        has_name_keys
+            ? NameSortKeys::Make(_keys.display_name.get(), m_CustomSortMode.case_sens, m_CustomSortMode.numeric_sort)
+            : std::string{};
+    auto it = std::lower_bound(
+        std::begin(m_EntriesByCustomSort),
+        std::end(m_EntriesByCustomSort),
+        _keys,
+        ExternalListingComparator(
+            *m_Listing, m_VolatileData, m_CustomSortMode, has_name_keys ? &m_NameSortKeys : nullptr, name_key));
     if( it != std::end(m_EntriesByCustomSort) )
         return static_cast<int>(std::distance(std::begin(m_EntriesByCustomSort), it));
     return -1;
@@ -1,19 +1,22 @@
-// Copyright (C) 2017-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "PanelDataEntriesComparator.h"
 #include "PanelDataItemVolatileData.h"
 #include "PanelDataExternalEntryKey.h"
+#include "PanelDataNameSortKeys.h"
 
 namespace nc::panel::data {
 
 ListingComparatorBase::ListingComparatorBase(const VFSListing &_items,
                                              std::span<const ItemVolatileData> _vd,
-                                             SortMode _sort_mode)
-    : l{_items}, vd{_vd}, sort_mode{_sort_mode},
+                                             SortMode _sort_mode,
+                                             const NameSortKeys *_keys)
+    : l{_items}, vd{_vd}, sort_mode{_sort_mode}, keys{_keys},
       str_comp_flags{(_sort_mode.case_sens ? 0 : kCFCompareCaseInsensitive) |
                      (_sort_mode.numeric_sort ? kCFCompareNumerically : 0)},
       plain_compare{_sort_mode.case_sens ? strcmp : strcasecmp}
 {
     assert( _vd.size() == _items.Count() );
+    assert( !_keys || _keys->Matches(_items.Count(), _sort_mode.case_sens, _sort_mode.numeric_sort) );
 }
 
 int ListingComparatorBase::Compare(CFStringRef _1st, CFStringRef _2nd) const noexcept
@@ -28,8 +31,9 @@ int ListingComparatorBase::Compare(const char *_1st, const char *_2nd) const noe
 
 IndirectListingComparator::IndirectListingComparator(const VFSListing &_items,
                                                      std::span<const ItemVolatileData> _vd,
-                                                     SortMode sort_mode)
-    : ListingComparatorBase(_items, _vd, sort_mode)
+                                                     SortMode sort_mode,
+                                                     const NameSortKeys *_keys)
+    : ListingComparatorBase(_items, _vd, sort_mode, _keys)
 {
 }
 
@@ -248,13 +252,20 @@ bool IndirectListingComparator::IsLessByNameReversed(unsigned _1, unsigned _2) c
 
 int IndirectListingComparator::CompareNames(unsigned _1, unsigned _2) const
 {
+    if( keys ) {
+        // only the ties of the keys need the full comparison
+        if( const int r = keys->Compare(_1, _2); r != 0 )
+            return r;
+    }
     return Compare(l.DisplayFilenameCF(_1), l.DisplayFilenameCF(_2));
 }
 
 ExternalListingComparator::ExternalListingComparator(const VFSListing &_items,
                                                      std::span<const ItemVolatileData> _vd,
-                                                     SortMode sort_mode)
-    : ListingComparatorBase(_items, _vd, sort_mode)
+                                                     SortMode sort_mode,
+                                                     const NameSortKeys *_keys,
+                                                     std::string_view _name_key)
+    : ListingComparatorBase(_items, _vd, sort_mode, _keys), name_key{_name_key}
 {
 }
 
@@ -271,6 +282,10 @@ bool ExternalListingComparator::operator()(unsigned _1, const ExternalEntryKey &
     }
 
     const auto by_name = [&] {
+        if( keys ) {
+            if( const int r = keys->Compare(_1, name_key); r != 0 )
+                return r;
+        }
         return Compare(l.DisplayFilenameCF(_1), _val2.display_name.get());
     };
 
@@ -0,0 +1,204 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "PanelDataFilterIndex.h"
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory_resource>
+#include <pstld/pstld.h>
+
+namespace nc::panel::data {
+
+// Don't bother with parallelism unless there are at least 10'000 items to evaluate
+static constexpr size_t g_ParallelEvaluationThresh = 10'000;
+
+static bool IsASCII(std::string_view _str) noexcept
+{
+    return std::all_of(_str.begin(), _str.end(), [](char _c) { return static_cast<unsigned char>(_c) < 0x80; });
+}
+
+static void AppendLowercase(std::string &_to, std::string_view _str)
+{
+    for( const char c : _str )
+        _to += (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static QuickSearchHiglight Highlight(size_t _offset, size_t _length) noexcept
+{
+    const QuickSearchHiglight::Range range{_offset, _length};
+    return QuickSearchHiglight({&range, 1});
+}
+
+FilterIndex::FilterIndex(const VFSListing &_listing)
+{
+    const unsigned count = _listing.Count();
+    m_Offsets.reserve(count + 1);
+    m_Folded.resize(count, false);
+    m_Offsets.push_back(0);
+    for( unsigned i = 0; i != count; ++i ) {
+        const std::string &name = _listing.DisplayFilename(i);
+        if( IsASCII(name) ) {
+            AppendLowercase(m_Arena, name);
+            m_Folded[i] = true;
+        }
+        m_Offsets.push_back(static_cast<unsigned>(m_Arena.size()));
+    }
+}
+
+bool FilterIndex::Matches(size_t _count) const noexcept
+{
+    return m_Offsets.size() == _count + 1;
+}
+
+std::string_view FilterIndex::Name(unsigned _index) const noexcept
+{
+    return std::string_view(m_Arena).substr(m_Offsets[_index], m_Offsets[_index + 1] - m_Offsets[_index]);
+}
+
+bool FilterIndex::IsFolded(unsigned _index) const noexcept
+{
+    return m_Folded[_index];
+}
+
+std::vector<std::optional<QuickSearchHiglight>>
+FilterIndex::Evaluate(const VFSListing &_listing, const TextualFilter &_filter, std::span<const unsigned> _raw_indices)
+{
+    assert(Matches(_listing.Count()));
+
+    std::string text;
+    if( _filter.text != nil ) {
+        const char *utf8 = _filter.text.UTF8String;
+        if( utf8 != nullptr && IsASCII(utf8) )
+            AppendLowercase(text, utf8);
+    }
+
+    // typing more characters can only narrow down the results of these filters, while with the ending-based ones
+    // the end of the text moves.
+    // non-ASCII texts are not considered, as with the canonical equivalence a longer text can match a name which a
+    // shorter one didn't, e.g. "cafe" + U+0301 and "café".
+    const bool narrows_down = !text.empty() && !m_Text.empty() && text.starts_with(m_Text) &&
+                              _filter.type == m_Type && _filter.ignore_dot_dot == m_IgnoreDotDot &&
+                              (m_Type == TextualFilter::Anywhere || m_Type == TextualFilter::Beginning ||
+                               m_Type == TextualFilter::Fuzzy) &&
+                              m_Verdicts.size() == _listing.Count();
+    if( !narrows_down )
+        m_Verdicts.assign(_listing.Count(), Verdict::Unknown);
+    m_Text = text;
+    m_Type = _filter.type;
+    m_IgnoreDotDot = _filter.ignore_dot_dot;
+
+    // each item is touched by only one task, so the verdicts can be updated concurrently
+    const auto evaluate = [&](unsigned _index) -> std::optional<QuickSearchHiglight> {
+        if( m_Verdicts[_index] == Verdict::Rejected )
+            return {};
+        auto found = EvaluateItem(_listing, _filter, text, _index);
+        m_Verdicts[_index] = found ? Verdict::Accepted : Verdict::Rejected;
+        return found;
+    };
+
+    std::vector<std::optional<QuickSearchHiglight>> found_ranges(_raw_indices.size());
+    if( _raw_indices.size() >= g_ParallelEvaluationThresh )
+        pstld::transform(_raw_indices.begin(), _raw_indices.end(), found_ranges.begin(), evaluate);
+    else
+        std::transform(_raw_indices.begin(), _raw_indices.end(), found_ranges.begin(), evaluate);
+    return found_ranges;
+}
+
+std::optional<QuickSearchHiglight> FilterIndex::EvaluateItem(const VFSListing &_listing,
+                                                            const TextualFilter &_filter,
+                                                            std::string_view _text,
+                                                            unsigned _index) const
+{
+    // an empty _text means that the filtering text is not ASCII or there's no text at all
+    if( _text.empty() || !IsFolded(_index) ) {
+        QuickSearchHiglight found_range;
+        if( _filter.IsValidItem(_listing.Item(_index), found_range) )
+            return found_range;
+        return {};
+    }
+
+    if( _filter.ignore_dot_dot && _listing.IsDotDot(_index) )
+        return QuickSearchHiglight{}; // never filter out the Holy Dot-Dot directory!
+
+    const std::string_view name = Name(_index);
+    const size_t textlen = _text.length();
+    const size_t namelen = name.length();
+    if( textlen > namelen )
+        return {}; // unsatisfiable by definition
+
+    switch( _filter.type ) {
+        case TextualFilter::Anywhere:
+            if( const size_t pos = name.find(_text); pos != std::string_view::npos )
+                return Highlight(pos, textlen);
+            return {};
+        case TextualFilter::Beginning:
+            if( name.starts_with(_text) )
+                return Highlight(0, textlen);
+            return {};
+        case TextualFilter::Ending:
+        case TextualFilter::BeginningOrEnding:
+            if( _filter.type == TextualFilter::BeginningOrEnding && name.starts_with(_text) )
+                return Highlight(0, textlen);
+            if( _listing.HasExtension(_index) ) {
+                // look before the extension
+                const size_t dot = name.rfind('.');
+                if( dot != std::string_view::npos && dot > textlen && name.substr(dot - textlen, textlen) == _text )
+                    return Highlight(dot - textlen, textlen);
+            }
+            if( name.ends_with(_text) )
+                return Highlight(namelen - textlen, textlen);
+            return {};
+        case TextualFilter::Fuzzy:
+            return FuzzySearch(name, _text);
+    }
+    return {};
+}
+
+static bool FuzzySearchSatisfiable(std::string_view _hay,
+                                   size_t _hay_start,
+                                   std::string_view _needle,
+                                   size_t _needle_start) noexcept
+{
+    size_t pos = _hay_start;
+    for( size_t idx = _needle_start; idx < _needle.length(); ++idx ) {
+        pos = _hay.find(_needle[idx], pos);
+        if( pos == std::string_view::npos )
+            return false;
+        ++pos;
+    }
+    return true;
+}
+
+std::optional<QuickSearchHiglight> FilterIndex::FuzzySearch(std::string_view _filename, std::string_view _text) noexcept
+{
+    // the same greedy algorithm as nc::panel::data::FuzzySearch() has, so that the highlights are the same
+    if( !FuzzySearchSatisfiable(_filename, 0, _text, 0) )
+        return {};
+
+    std::array<char, 4096> mem_buffer;
+    std::pmr::monotonic_buffer_resource mem_resource(mem_buffer.data(), mem_buffer.size());
+    std::pmr::vector<QuickSearchHiglight::Range> found(&mem_resource);
+    size_t filename_pos = 0;
+    std::string_view text = _text;
+    while( !text.empty() ) {
+        for( size_t length = text.length(); true; --length ) {
+            if( length == 0 )
+                return {};
+
+            const size_t result = _filename.find(text.substr(0, length), filename_pos);
+            if( result == std::string_view::npos )
+                continue; // cannot found a substring this long
+
+            if( !FuzzySearchSatisfiable(_filename, result + length, text, length) )
+                continue; // too greedy - the rest of the criterion is not satisfiable
+
+            found.push_back({result, length});
+            filename_pos = result + length;
+            text.remove_prefix(length);
+            break;
+        }
+    }
+
+    return QuickSearchHiglight({found.data(), found.size()});
+}
+
+} // namespace nc::panel::data
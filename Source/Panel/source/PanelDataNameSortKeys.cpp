@@ -0,0 +1,191 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "PanelDataNameSortKeys.h"
+#include <Base/CFPtr.h>
+#include <Base/dispatch_cpp.h>
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <limits>
+
+namespace nc::panel::data {
+
+// Listings smaller than this are processed on the calling thread
+static constexpr size_t g_ParallelBuildThresh = 10'000;
+
+// Amount of items processed by a single concurrent task
+static constexpr size_t g_ItemsPerTask = 4'096;
+
+static bool IsDigit(uint16_t _unit) noexcept
+{
+    return _unit >= '0' && _unit <= '9';
+}
+
+template <class Unit>
+static void AppendKey(std::string &_key, const Unit *_units, size_t _count, bool _numeric)
+{
+    for( size_t i = 0; i < _count; ) {
+        const auto unit = static_cast<uint16_t>(_units[i]);
+        if( _numeric && IsDigit(unit) ) {
+            size_t end = i + 1;
+            while( end < _count && IsDigit(static_cast<uint16_t>(_units[end])) )
+                ++end;
+            while( i + 1 < end && _units[i] == '0' ) // leading zeros don't change the value
+                ++i;
+            // the '0' unit keeps the number in place among the other characters, its length goes next so that the
+            // shorter numbers go first, then the digits themselves
+            const size_t length = end - i;
+            _key += '\0';
+            _key += '0';
+            _key += static_cast<char>(length >> 8);
+            _key += static_cast<char>(length & 0xFF);
+            for( ; i != end; ++i )
+                _key += static_cast<char>(_units[i]);
+        }
+        else {
+            _key += static_cast<char>(unit >> 8);
+            _key += static_cast<char>(unit & 0xFF);
+            ++i;
+        }
+    }
+}
+
+static std::string ItemKey(const VFSListing &_listing, unsigned _index, bool _case_sensitive, bool _numeric)
+{
+    if( !_listing.HasDisplayFilename(_index) ) {
+        // plain ASCII names can be folded without going through CoreFoundation
+        const std::string &name = _listing.Filename(_index);
+        if( std::all_of(name.begin(), name.end(), [](char _c) { return static_cast<unsigned char>(_c) < 0x80; }) ) {
+            std::string key;
+            key.reserve(name.size() * 2);
+            if( _case_sensitive ) {
+                AppendKey(key, reinterpret_cast<const unsigned char *>(name.data()), name.size(), _numeric);
+            }
+            else {
+                std::string lowercase = name;
+                for( char &c : lowercase )
+                    if( c >= 'A' && c <= 'Z' )
+                        c = static_cast<char>(c - 'A' + 'a');
+                AppendKey(key, reinterpret_cast<const unsigned char *>(lowercase.data()), lowercase.size(), _numeric);
+            }
+            return key;
+        }
+    }
+    return NameSortKeys::Make(_listing.DisplayFilenameCF(_index), _case_sensitive, _numeric);
+}
+
+static uint64_t Prefix(std::string_view _key) noexcept
+{
+    uint64_t prefix = 0;
+    for( size_t i = 0; i < 8; ++i )
+        prefix = (prefix << 8) | (i < _key.size() ? static_cast<unsigned char>(_key[i]) : 0);
+    return prefix;
+}
+
+NameSortKeys::NameSortKeys(const VFSListing &_listing, bool _case_sensitive, bool _numeric)
+    : m_CaseSensitive(_case_sensitive), m_Numeric(_numeric)
+{
+    const size_t count = _listing.Count();
+    std::vector<std::string> keys(count);
+    const auto build = [&](size_t _first, size_t _last) {
+        for( size_t i = _first; i != _last; ++i )
+            keys[i] = ItemKey(_listing, static_cast<unsigned>(i), _case_sensitive, _numeric);
+    };
+    if( count < g_ParallelBuildThresh )
+        build(0, count);
+    else
+        dispatch_apply((count + g_ItemsPerTask - 1) / g_ItemsPerTask, [&](size_t _task) {
+            build(_task * g_ItemsPerTask, std::min((_task + 1) * g_ItemsPerTask, count));
+        });
+
+    size_t total = 0;
+    for( const auto &key : keys )
+        total += key.size();
+    m_Arena.reserve(total);
+    m_Offsets.reserve(count + 1);
+    m_Prefixes.reserve(count);
+    for( const auto &key : keys ) {
+        m_Offsets.push_back(static_cast<unsigned>(m_Arena.size()));
+        m_Prefixes.push_back(Prefix(key));
+        m_Arena += key;
+    }
+    m_Offsets.push_back(static_cast<unsigned>(m_Arena.size()));
+}
+
+NameSortKeys::NameSortKeys(const VFSListing &_listing,
+                           const NameSortKeys &_previous,
+                           std::span<const unsigned> _previous_indices)
+    : m_CaseSensitive(_previous.m_CaseSensitive), m_Numeric(_previous.m_Numeric)
+{
+    const size_t count = _listing.Count();
+    assert(_previous_indices.size() == count);
+    m_Arena.reserve(_previous.m_Arena.size());
+    m_Offsets.reserve(count + 1);
+    m_Prefixes.reserve(count);
+    for( size_t i = 0; i != count; ++i ) {
+        m_Offsets.push_back(static_cast<unsigned>(m_Arena.size()));
+        if( const unsigned previous = _previous_indices[i]; previous != std::numeric_limits<unsigned>::max() ) {
+            m_Prefixes.push_back(_previous.m_Prefixes[previous]);
+            m_Arena += _previous.Key(previous);
+        }
+        else {
+            const std::string key = ItemKey(_listing, static_cast<unsigned>(i), m_CaseSensitive, m_Numeric);
+            m_Prefixes.push_back(Prefix(key));
+            m_Arena += key;
+        }
+    }
+    m_Offsets.push_back(static_cast<unsigned>(m_Arena.size()));
+}
+
+std::string NameSortKeys::Make(CFStringRef _name, bool _case_sensitive, bool _numeric)
+{
+    if( _name == nullptr )
+        return {};
+
+    CFStringRef source = _name;
+    base::CFPtr<CFMutableStringRef> folded;
+    if( !_case_sensitive ) {
+        folded = base::CFPtr<CFMutableStringRef>::adopt(CFStringCreateMutableCopy(nullptr, 0, _name));
+        CFStringFold(folded.get(), kCFCompareCaseInsensitive, nullptr);
+        source = folded.get();
+    }
+
+    const size_t length = static_cast<size_t>(CFStringGetLength(source));
+    std::string key;
+    key.reserve(length * 2);
+    if( const UniChar *units = CFStringGetCharactersPtr(source) ) {
+        AppendKey(key, units, length, _numeric);
+    }
+    else {
+        std::vector<UniChar> units(length);
+        CFStringGetCharacters(source, CFRangeMake(0, static_cast<CFIndex>(length)), units.data());
+        AppendKey(key, units.data(), length, _numeric);
+    }
+    return key;
+}
+
+bool NameSortKeys::Matches(size_t _count, bool _case_sensitive, bool _numeric) const noexcept
+{
+    return m_Offsets.size() == _count + 1 && m_CaseSensitive == _case_sensitive && m_Numeric == _numeric;
+}
+
+std::string_view NameSortKeys::Key(unsigned _index) const noexcept
+{
+    assert(_index + 1 < m_Offsets.size());
+    return {m_Arena.data() + m_Offsets[_index], m_Offsets[_index + 1] - m_Offsets[_index]};
+}
+
+int NameSortKeys::Compare(unsigned _1, unsigned _2) const noexcept
+{
+    const uint64_t prefix1 = m_Prefixes[_1];
+    const uint64_t prefix2 = m_Prefixes[_2];
+    if( prefix1 != prefix2 )
+        return prefix1 < prefix2 ? -1 : 1;
+    return Key(_1).compare(Key(_2));
+}
+
+int NameSortKeys::Compare(unsigned _1, std::string_view _2) const noexcept
+{
+    return Key(_1).compare(_2);
+}
+
+} // namespace nc::panel::data
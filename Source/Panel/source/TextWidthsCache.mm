@@ -1,23 +1,24 @@
-// Copyright (C) 2017-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "TextWidthsCache.h"
 #include <Utility/FontExtras.h>
-#include <Base/dispatch_cpp.h>
 #include <charconv>
 #include <array>
 #include <memory_resource>
+#include <limits>
+#include <algorithm>
 
 namespace nc::panel {
 
-using namespace std::literals;
 using nc::utility::FontGeometryInfo;
 
-// it was deliberately chosen to use the most dumb method to purge the cache.
-// assuming that one record on average taken about 100bytes, 10'000 would take around 1Mb of memory.
-// the purge is executed after a significant delay, thus allowing NC to temporary cache a huge
-// amount of width values in case of an extreme workload, e.g. browsing in temporary panel with a
-// million entries inside.
-static const auto g_MaxStrings = 10'000;
-static const auto g_PurgeDelay = 20min;
+static_assert(TextWidthsCache::ShardCapacity <= std::numeric_limits<uint32_t>::max());
+
+// CFHash of a string is rather weak in its lower bits, so the shard is picked from the upper bits of a mixed value
+static size_t ShardOf(size_t _hash) noexcept
+{
+    return static_cast<size_t>((static_cast<uint64_t>(_hash) * 0x9E3779B97F4A7C15ULL) >> 32) %
+           TextWidthsCache::ShardsNumber;
+}
 
 TextWidthsCache::TextWidthsCache() = default;
 
@@ -33,6 +34,7 @@ std::vector<unsigned short> TextWidthsCache::Widths(std::span<const CFStringRef>
 {
     assert(_font != nullptr);
     auto &cache = ForFont(_font);
+    const uint64_t batch = ++m_LastBatch;
 
     // the result widths to return
     std::vector<unsigned short> widths(_strings.size(), 0);
@@ -40,20 +42,46 @@ std::vector<unsigned short> TextWidthsCache::Widths(std::span<const CFStringRef>
     // store the temp data on stack whether possible
     std::array<char, 16384> mem_buffer;
     std::pmr::monotonic_buffer_resource mem_resource(mem_buffer.data(), mem_buffer.size());
+    std::pmr::vector<size_t> hashes(_strings.size(), &mem_resource);
+    std::pmr::vector<size_t> ordered_indices(_strings.size(), &mem_resource); // grouped by the shards
     std::pmr::vector<size_t> unknown_strings_indices(&mem_resource);
     std::pmr::vector<CFStringRef> unknown_strings(&mem_resource);
 
+    // hash every string once and group the strings by their shards, so that each shard is locked once per batch
+    std::array<size_t, ShardsNumber + 1> shard_bounds = {};
+    for( size_t index = 0; index != _strings.size(); ++index ) {
+        assert(_strings[index] != nullptr);
+        hashes[index] = CFHash(_strings[index]);
+        ++shard_bounds[ShardOf(hashes[index]) + 1];
+    }
+    for( size_t shard = 0; shard != ShardsNumber; ++shard )
+        shard_bounds[shard + 1] += shard_bounds[shard];
     {
-        auto lock = std::lock_guard{cache.lock};
-        for( size_t index = 0; index != _strings.size(); ++index ) {
-            const auto string = _strings[index];
-            const auto it = cache.widths.find(string);
-            if( it != cache.widths.end() ) {
-                widths[index] = it->second;
+        auto positions = shard_bounds;
+        for( size_t index = 0; index != _strings.size(); ++index )
+            ordered_indices[positions[ShardOf(hashes[index])]++] = index;
+    }
+
+    for( size_t shard_index = 0; shard_index != ShardsNumber; ++shard_index ) {
+        if( shard_bounds[shard_index] == shard_bounds[shard_index + 1] )
+            continue;
+        Shard &shard = cache.shards[shard_index];
+        auto lock = std::lock_guard{shard.lock};
+        shard.capacity = std::max(shard.capacity, shard_bounds[shard_index + 1] - shard_bounds[shard_index]);
+        for( size_t pos = shard_bounds[shard_index]; pos != shard_bounds[shard_index + 1]; ++pos ) {
+            const auto index = ordered_indices[pos];
+            const auto it = shard.index.find(Key{_strings[index], hashes[index]});
+            if( it != shard.index.end() ) {
+                auto &slot = shard.slots[it->second];
+                slot.referenced = true;
+                slot.batch = batch;
+                widths[index] = slot.width;
+                ++shard.hits;
             }
             else {
-                unknown_strings.emplace_back(string);
+                unknown_strings.emplace_back(_strings[index]);
                 unknown_strings_indices.emplace_back(index);
+                ++shard.misses;
             }
         }
     }
@@ -64,39 +92,46 @@ std::vector<unsigned short> TextWidthsCache::Widths(std::span<const CFStringRef>
         const auto new_widths_sz = new_widths.size();
         assert(new_widths_sz == unknown_strings_indices.size());
 
-        {
-            // insert the new widths into the cache
-            auto lock = std::lock_guard{cache.lock};
-            for( size_t index = 0; index < new_widths_sz; ++index ) {
-                const auto src_index = unknown_strings_indices[index];
+        // insert the new widths into the cache, the unknown strings are still grouped by the shards
+        for( size_t first = 0; first < new_widths_sz; ) {
+            const auto shard_index = ShardOf(hashes[unknown_strings_indices[first]]);
+            Shard &shard = cache.shards[shard_index];
+            auto lock = std::lock_guard{shard.lock};
+            for( ; first < new_widths_sz && ShardOf(hashes[unknown_strings_indices[first]]) == shard_index; ++first ) {
+                const auto src_index = unknown_strings_indices[first];
                 assert(src_index < _strings.size());
-                CFStringRef src_string = _strings[src_index];
-                assert(new_widths[index] > 0 || CFStringGetLength(_strings[src_index]) == 0);
-                cache.widths[base::CFPtr<CFStringRef>(src_string)] = new_widths[index];
+                assert(new_widths[first] > 0 || CFStringGetLength(_strings[src_index]) == 0);
+                shard.Insert(Key{_strings[src_index], hashes[src_index]}, new_widths[first], batch);
             }
         }
 
-        // merge the newly calculated data into the widths to be returned
-        if( unknown_strings_indices.size() == _strings.size() ) {
-            // we're building the entire set => can just snatch the result vector without copying by element by element
-            widths = std::move(new_widths);
-        }
-        else {
-            // fill the unknowns with the newly calculated data
-            for( size_t index = 0; index < new_widths_sz; ++index ) {
-                const auto src_index = unknown_strings_indices[index];
-                assert(src_index < widths.size());
-                widths[src_index] = new_widths[index];
-            }
+        // fill the unknowns with the newly calculated data, they were calculated in the order of the shards
+        for( size_t index = 0; index < new_widths_sz; ++index ) {
+            const auto src_index = unknown_strings_indices[index];
+            assert(src_index < widths.size());
+            widths[src_index] = new_widths[index];
         }
-
-        // If we're getting too large - schedule a future trimming
-        PurgeIfNeeded(cache);
     }
 
     return widths;
 }
 
+TextWidthsCache::Statistics TextWidthsCache::Stats() const
+{
+    Statistics stats;
+    auto lock = std::lock_guard{m_Lock};
+    for( auto &font : m_CachesPerFont ) {
+        for( auto &shard : font.second.shards ) {
+            auto shard_lock = std::lock_guard{shard.lock};
+            stats.hits += shard.hits;
+            stats.misses += shard.misses;
+            stats.evictions += shard.evictions;
+            stats.size += shard.index.size();
+        }
+    }
+    return stats;
+}
+
 TextWidthsCache::Cache &TextWidthsCache::ForFont(NSFont *_font)
 {
     // compose e.g. "12Times New Roman Regular" as a key
@@ -116,56 +151,47 @@ TextWidthsCache::Cache &TextWidthsCache::ForFont(NSFont *_font)
     }
 }
 
-void TextWidthsCache::PurgeIfNeeded(Cache &_cache)
+void TextWidthsCache::Shard::Insert(const Key &_key, unsigned short _width, uint64_t _batch)
 {
-    auto lock = std::lock_guard{_cache.lock};
-    if( _cache.widths.size() >= g_MaxStrings && !_cache.purge_scheduled ) {
-        _cache.purge_scheduled = true;
-        dispatch_to_background_after(g_PurgeDelay, [&] { Purge(_cache); });
+    if( const auto it = index.find(_key); it != index.end() ) {
+        // another thread has calculated the same string meanwhile
+        slots[it->second].width = _width;
+        slots[it->second].batch = _batch;
+        return;
     }
-}
 
-void TextWidthsCache::Purge(Cache &_cache)
-{
-    {
-        auto lock = std::lock_guard{_cache.lock};
-        _cache.widths.clear();
+    if( slots.size() < capacity ) {
+        const auto slot_index = static_cast<uint32_t>(slots.size());
+        auto &slot =
+            slots.emplace_back(Slot{base::CFPtr<CFStringRef>(_key.string), _key.hash, _width, false, _batch});
+        index.emplace(Key{slot.string.get(), slot.hash}, slot_index);
+        return;
     }
-    _cache.purge_scheduled = false;
-}
-
-size_t TextWidthsCache::CFStringHashEqual::operator()(const base::CFPtr<CFStringRef> &_string) const noexcept
-{
-    return (*this)(_string.get());
-}
 
-size_t TextWidthsCache::CFStringHashEqual::operator()(CFStringRef _string) const noexcept
-{
-    assert(_string != nil);
-    return CFHash(_string);
-}
-
-bool TextWidthsCache::CFStringHashEqual::operator()(const base::CFPtr<CFStringRef> &_lhs,
-                                                    const base::CFPtr<CFStringRef> &_rhs) const noexcept
-{
-    return (*this)(_lhs.get(), _rhs.get());
-}
+    // sweep the clock hand, clearing the marks of the recently used slots, until an unmarked one is found.
+    // the capacity is not less than this shard's part of the batch, so there's always a slot of another batch.
+    while( slots[hand].referenced || slots[hand].batch == _batch ) {
+        slots[hand].referenced = false;
+        hand = (hand + 1) % slots.size();
+    }
 
-bool TextWidthsCache::CFStringHashEqual::operator()(const base::CFPtr<CFStringRef> &_lhs,
-                                                    CFStringRef _rhs) const noexcept
-{
-    return (*this)(_lhs.get(), _rhs);
+    auto &victim = slots[hand];
+    index.erase(Key{victim.string.get(), victim.hash}); // before the victim's string is released
+    victim = Slot{base::CFPtr<CFStringRef>(_key.string), _key.hash, _width, false, _batch};
+    index.emplace(Key{victim.string.get(), victim.hash}, static_cast<uint32_t>(hand));
+    hand = (hand + 1) % slots.size();
+    ++evictions;
 }
 
-bool TextWidthsCache::CFStringHashEqual::operator()(CFStringRef _lhs,
-                                                    const base::CFPtr<CFStringRef> &_rhs) const noexcept
+size_t TextWidthsCache::KeyHashEqual::operator()(const Key &_key) const noexcept
 {
-    return (*this)(_lhs, _rhs.get());
+    return _key.hash;
 }
 
-bool TextWidthsCache::CFStringHashEqual::operator()(CFStringRef _lhs, CFStringRef _rhs) const noexcept
+bool TextWidthsCache::KeyHashEqual::operator()(const Key &_lhs, const Key &_rhs) const noexcept
 {
-    return (_lhs == _rhs) || (CFStringCompare(_lhs, _rhs, 0) == kCFCompareEqualTo);
+    return (_lhs.string == _rhs.string) ||
+           (_lhs.hash == _rhs.hash && CFStringCompare(_lhs.string, _rhs.string, 0) == kCFCompareEqualTo);
 }
 
 } // namespace nc::panel
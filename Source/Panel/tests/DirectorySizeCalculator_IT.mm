@@ -0,0 +1,82 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "DirectorySizeCalculator.h"
+#include "Tests.h"
+#include <VFS/Native.h>
+#include <Base/mach_time.h>
+#include <fstream>
+#include <thread>
+
+#define PREFIX "nc::panel::DirectorySizeCalculator "
+
+using namespace nc;
+using namespace nc::panel;
+using namespace std::chrono_literals;
+
+static void WriteFile(const std::filesystem::path &_path, size_t _size)
+{
+    std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+    file << std::string(_size, 'x');
+}
+
+TEST_CASE(PREFIX "calculates and remembers the sizes")
+{
+    TempTestDir dir;
+    const auto root = dir.directory / "root";
+    std::filesystem::create_directories(root / "a" / "b");
+    std::filesystem::create_directories(root / "c");
+    WriteFile(root / "1", 100);
+    WriteFile(root / "a" / "2", 20);
+    WriteFile(root / "a" / "b" / "3", 3);
+    WriteFile(root / "c" / "4", 4000);
+
+    VFSHost &host = *TestEnv().vfs_native;
+    DirectorySizeCalculator calculator;
+    CHECK(calculator.Cached(host, root.native()) == std::nullopt);
+    CHECK(calculator.Calculate(host, root.native()) == 4123);
+    CHECK(calculator.Cached(host, root.native()) == 4123);
+    CHECK(calculator.Cached(host, root.native() + "/") == 4123);
+    CHECK(calculator.Calculate(host, (root / "a").native()) == 23);
+
+    SECTION("invalidating a subdirectory forgets its parents")
+    {
+        calculator.Invalidate((root / "a" / "b").native());
+        CHECK(calculator.Cached(host, root.native()) == std::nullopt);
+        CHECK(calculator.Cached(host, (root / "a").native()) == std::nullopt);
+    }
+    SECTION("invalidating a sibling keeps the size")
+    {
+        calculator.Invalidate((root / "c").native());
+        CHECK(calculator.Cached(host, (root / "a").native()) == 23);
+    }
+    SECTION("invalidating recursively forgets the subdirectories")
+    {
+        calculator.Invalidate(root.native(), true);
+        CHECK(calculator.Cached(host, (root / "a").native()) == std::nullopt);
+    }
+    SECTION("adding an entry changes the modification time")
+    {
+        WriteFile(root / "5", 5);
+        CHECK(calculator.Cached(host, root.native()) == std::nullopt);
+        CHECK(calculator.Calculate(host, root.native()) == 4128);
+    }
+    SECTION("a change deep inside the tree is noticed via the file system events")
+    {
+        WriteFile(root / "a" / "b" / "3", 30000);
+        const auto deadline = base::machtime() + 10s;
+        while( calculator.Cached(host, root.native()) && base::machtime() < deadline )
+            std::this_thread::sleep_for(10ms);
+        CHECK(calculator.Cached(host, root.native()) == std::nullopt);
+        CHECK(calculator.Calculate(host, root.native()) == 34120);
+    }
+}
+
+TEST_CASE(PREFIX "doesn't remember cancelled calculations")
+{
+    TempTestDir dir;
+    WriteFile(dir.directory / "1", 100);
+    VFSHost &host = *TestEnv().vfs_native;
+    DirectorySizeCalculator calculator;
+    CHECK(calculator.Calculate(host, dir.directory.native(), [] { return true; }) == VFSError::Cancelled);
+    CHECK(calculator.Cached(host, dir.directory.native()) == std::nullopt);
+    CHECK(calculator.Calculate(host, dir.directory.native()) == 100);
+}
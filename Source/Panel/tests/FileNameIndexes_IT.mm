@@ -0,0 +1,56 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "FileNameIndexes.h"
+#include "Tests.h"
+#include <VFS/Native.h>
+#include <Base/dispatch_cpp.h>
+#include <fstream>
+
+#define PREFIX "nc::panel::FileNameIndexes "
+
+using namespace nc;
+using namespace nc::panel;
+using namespace std::chrono_literals;
+
+static bool RunMainLoopUntilExpectationOrTimeout(std::chrono::nanoseconds _timeout,
+                                                 std::function<bool()> _expectation)
+{
+    dispatch_assert_main_queue();
+    const auto start_tp = std::chrono::steady_clock::now();
+    const auto time_slice = 1. / 100.; // 10 ms;
+    while( true ) {
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, time_slice, false);
+        if( std::chrono::steady_clock::now() - start_tp > _timeout )
+            return false;
+        if( _expectation() )
+            return true;
+    }
+}
+
+TEST_CASE(PREFIX "builds an index in background and then gives it back")
+{
+    TempTestDir dir;
+    const auto root = dir.directory / "root";
+    std::filesystem::create_directories(root / "a" / "b");
+    std::ofstream{root / "a" / "b" / "main.cpp"};
+
+    const auto host = TestEnv().vfs_native;
+    FileNameIndexes indexes;
+    CHECK(indexes.Find(host, root.native()) == nullptr);
+    std::shared_ptr<const vfs::FileNameIndex> index;
+    REQUIRE(RunMainLoopUntilExpectationOrTimeout(10s, [&] {
+        index = indexes.Find(host, root.native());
+        return index != nullptr;
+    }));
+    CHECK(index->Root() == root.native() + "/");
+    CHECK(index->Size() == 3);
+
+    SECTION("the subdirectories are served by the same index")
+    {
+        CHECK(indexes.Find(host, (root / "a" / "b").native()) == index);
+    }
+    SECTION("the changes are picked up")
+    {
+        std::ofstream{root / "a" / "b" / "main.h"};
+        CHECK(RunMainLoopUntilExpectationOrTimeout(10s, [&] { return index->Size() == 4; }));
+    }
+}
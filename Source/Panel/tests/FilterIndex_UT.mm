@@ -0,0 +1,157 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include <sys/dirent.h>
+#include <VFS/VFS.h>
+#include <VFS/VFSListingInput.h>
+#include "PanelDataFilterIndex.h"
+#include "Tests.h"
+#include <numeric>
+
+#define PREFIX "nc::panel::data::FilterIndex "
+
+using namespace nc;
+using namespace nc::base;
+using namespace nc::panel::data;
+
+static VFSListingPtr ProduceDummyListing(const std::vector<std::string> &_filenames)
+{
+    vfs::ListingInput l;
+    l.directories.reset(variable_container<>::type::common);
+    l.directories[0] = "/";
+    l.hosts.reset(variable_container<>::type::common);
+    l.hosts[0] = VFSHost::DummyHost();
+    for( auto &filename : _filenames ) {
+        l.filenames.emplace_back(filename);
+        l.unix_modes.emplace_back(S_IRUSR | S_IWUSR | S_IFREG);
+        l.unix_types.emplace_back(DT_REG);
+    }
+    return VFSListing::Build(std::move(l));
+}
+
+static std::vector<std::optional<QuickSearchHiglight>> Reference(const VFSListing &_listing,
+                                                                 const TextualFilter &_filter)
+{
+    std::vector<std::optional<QuickSearchHiglight>> found_ranges;
+    for( unsigned i = 0; i != _listing.Count(); ++i ) {
+        QuickSearchHiglight found_range;
+        if( _filter.IsValidItem(_listing.Item(i), found_range) )
+            found_ranges.emplace_back(found_range);
+        else
+            found_ranges.emplace_back(std::nullopt);
+    }
+    return found_ranges;
+}
+
+TEST_CASE(PREFIX "gives the same results as TextualFilter")
+{
+    const auto listing = ProduceDummyListing({"..",
+                                              "Calculator.app",
+                                              "calc.txt",
+                                              "README.md",
+                                              "a.tar.gz",
+                                              "archive",
+                                              ".hidden",
+                                              "ABCabc",
+                                              "Makefile",
+                                              reinterpret_cast<const char *>(u8"Café.txt"),
+                                              reinterpret_cast<const char *>(u8"Приложение.app"),
+                                              "Straße"});
+    std::vector<unsigned> indices(listing->Count());
+    std::iota(indices.begin(), indices.end(), 0);
+
+    NSString *texts[] = {@"a",
+                         @"c",
+                         @"ca",
+                         @"calc",
+                         @"CALC",
+                         @"app",
+                         @".app",
+                         @"tar",
+                         @"gz",
+                         @"abc",
+                         @"ac",
+                         @"make",
+                         @"file",
+                         @"md",
+                         @"hidden",
+                         @".",
+                         @"é",
+                         @"Café",
+                         @"caf",
+                         @"прил",
+                         @"ss",
+                         @"strasse",
+                         @"Calculator.app.x"};
+    for( const auto type : {TextualFilter::Anywhere,
+                            TextualFilter::Beginning,
+                            TextualFilter::Ending,
+                            TextualFilter::BeginningOrEnding,
+                            TextualFilter::Fuzzy} ) {
+        for( const bool ignore_dot_dot : {false, true} ) {
+            FilterIndex index(*listing);
+            for( NSString *text : texts ) {
+                TextualFilter filter;
+                filter.text = text;
+                filter.type = type;
+                filter.ignore_dot_dot = ignore_dot_dot;
+                INFO(text.UTF8String);
+                INFO(static_cast<int>(type));
+                CHECK(index.Evaluate(*listing, filter, indices) == Reference(*listing, filter));
+            }
+        }
+    }
+}
+
+TEST_CASE(PREFIX "narrows down the previous results when the text is extended")
+{
+    const auto listing = ProduceDummyListing({"abc", "abd", "xabc", "bcd", "ab"});
+    std::vector<unsigned> indices(listing->Count());
+    std::iota(indices.begin(), indices.end(), 0);
+    FilterIndex index(*listing);
+
+    TextualFilter filter;
+    filter.type = TextualFilter::Anywhere;
+    for( NSString *text : {@"a", @"ab", @"abc", @"ab", @"b", @"bc", @"bcd"} ) {
+        filter.text = text;
+        INFO(text.UTF8String);
+        CHECK(index.Evaluate(*listing, filter, indices) == Reference(*listing, filter));
+    }
+
+    // only a part of the items was evaluated before, the rest has to be evaluated anew
+    filter.text = @"a";
+    CHECK(index.Evaluate(*listing, filter, std::vector<unsigned>{0, 1}) ==
+          std::vector<std::optional<QuickSearchHiglight>>{Reference(*listing, filter)[0],
+                                                          Reference(*listing, filter)[1]});
+    filter.text = @"ab";
+    CHECK(index.Evaluate(*listing, filter, indices) == Reference(*listing, filter));
+}
+
+TEST_CASE(PREFIX "Fuzzy search")
+{
+    const std::pair<const char *, const char *> test_cases[] = {
+        {"", ""},
+        {"", "a"},
+        {"a", ""},
+        {"a", "b"},
+        {"a", "a"},
+        {"a", "ab"},
+        {"ab", "ab"},
+        {"ba", "ab"},
+        {"aaa", "aa"},
+        {"abc", "ac"},
+        {"aab", "ab"},
+        {"abcabc", "abab"},
+        {"abcabc", "cabc"},
+        {"abcabc", "bbc"},
+        {"abcabc", "acc"},
+        {"calculator.app", "calap"},
+        {"calculator.app", "calcapp"},
+        {"calculator.app", "culap"},
+        {"calculator.app", "app"},
+    };
+    for( auto &tc : test_cases ) {
+        INFO(tc.first);
+        INFO(tc.second);
+        CHECK(FilterIndex::FuzzySearch(tc.first, tc.second) ==
+              FuzzySearch([NSString stringWithUTF8String:tc.first], [NSString stringWithUTF8String:tc.second]));
+    }
+}
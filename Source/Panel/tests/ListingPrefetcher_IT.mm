@@ -0,0 +1,99 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "ListingPrefetcher.h"
+#include "Tests.h"
+#include <VFS/Native.h>
+#include <Base/mach_time.h>
+#include <Base/dispatch_cpp.h>
+#include <fstream>
+#include <thread>
+
+#define PREFIX "nc::panel::ListingPrefetcher "
+
+using namespace nc;
+using namespace nc::panel;
+using namespace std::chrono_literals;
+
+static VFSListingPtr TakeWhenReady(ListingPrefetcher &_prefetcher,
+                                   const VFSHost &_host,
+                                   const std::string &_directory,
+                                   unsigned long _flags)
+{
+    const auto deadline = base::machtime() + 10s;
+    while( base::machtime() < deadline ) {
+        if( auto listing = _prefetcher.Take(_host, _directory, _flags) )
+            return listing;
+        std::this_thread::sleep_for(1ms);
+    }
+    return nullptr;
+}
+
+static void RunMainLoopFor(std::chrono::nanoseconds _duration)
+{
+    dispatch_assert_main_queue();
+    const auto deadline = base::machtime() + _duration;
+    while( base::machtime() < deadline )
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 1. / 100., false);
+}
+
+TEST_CASE(PREFIX "prefetches a listing and hands it out once")
+{
+    TempTestDir dir;
+    std::ofstream(dir.directory / "a.txt") << "a";
+    std::filesystem::create_directory(dir.directory / "b");
+
+    const VFSHostPtr host = TestEnv().vfs_native;
+    ListingPrefetcher prefetcher;
+    prefetcher.Prefetch(host, dir.directory.native(), 0);
+
+    const auto listing = TakeWhenReady(prefetcher, *host, dir.directory.native(), 0);
+    REQUIRE(listing);
+    CHECK(listing->Count() == 3); // "..", "a.txt" and "b"
+    CHECK(prefetcher.Take(*host, dir.directory.native(), 0) == nullptr);
+}
+
+TEST_CASE(PREFIX "distinguishes the fetching flags")
+{
+    TempTestDir dir;
+    const VFSHostPtr host = TestEnv().vfs_native;
+    ListingPrefetcher prefetcher;
+    prefetcher.Prefetch(host, dir.directory.native(), VFSFlags::F_NoDotDot);
+    REQUIRE(TakeWhenReady(prefetcher, *host, dir.directory.native(), VFSFlags::F_NoDotDot));
+
+    prefetcher.Prefetch(host, dir.directory.native(), VFSFlags::F_NoDotDot);
+    std::this_thread::sleep_for(100ms);
+    CHECK(prefetcher.Take(*host, dir.directory.native(), 0) == nullptr);
+}
+
+TEST_CASE(PREFIX "forgets the oldest listings beyond the capacity")
+{
+    TempTestDir dir;
+    const VFSHostPtr host = TestEnv().vfs_native;
+    ListingPrefetcher prefetcher;
+    for( size_t i = 0; i <= ListingPrefetcher::Capacity; ++i ) {
+        const auto path = dir.directory / std::to_string(i);
+        std::filesystem::create_directory(path);
+        prefetcher.Prefetch(host, path.native(), 0);
+    }
+    const auto last = dir.directory / std::to_string(ListingPrefetcher::Capacity);
+    REQUIRE(TakeWhenReady(prefetcher, *host, last.native(), 0));
+    CHECK(prefetcher.Take(*host, (dir.directory / "0").native(), 0) == nullptr);
+}
+
+TEST_CASE(PREFIX "doesn't hand out a listing whose directory has changed since")
+{
+    TempTestDir dir;
+    const VFSHostPtr host = TestEnv().vfs_native;
+    ListingPrefetcher prefetcher;
+    prefetcher.Prefetch(host, dir.directory.native(), 0);
+    SECTION("unchanged")
+    {
+        RunMainLoopFor(1s); // let the fetch finish and the file system events arrive
+        CHECK(prefetcher.Take(*host, dir.directory.native(), 0) != nullptr);
+    }
+    SECTION("changed")
+    {
+        std::ofstream(dir.directory / "a.txt") << "a";
+        RunMainLoopFor(1s);
+        CHECK(prefetcher.Take(*host, dir.directory.native(), 0) == nullptr);
+    }
+}
@@ -0,0 +1,89 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include <sys/dirent.h>
+#include <VFS/VFS.h>
+#include <VFS/VFSListingInput.h>
+#include <Base/CFString.h>
+#include "PanelDataNameSortKeys.h"
+#include "Tests.h"
+
+#define PREFIX "NameSortKeys "
+
+using namespace nc;
+using namespace nc::base;
+using namespace nc::panel::data;
+
+static VFSListingPtr ProduceDummyListing(const std::vector<std::string> &_filenames)
+{
+    vfs::ListingInput l;
+    l.directories.reset(variable_container<>::type::common);
+    l.directories[0] = "/";
+    l.hosts.reset(variable_container<>::type::common);
+    l.hosts[0] = VFSHost::DummyHost();
+    for( auto &i : _filenames ) {
+        l.filenames.emplace_back(i);
+        l.unix_modes.emplace_back(S_IRUSR | S_IWUSR | S_IFREG);
+        l.unix_types.emplace_back(DT_REG);
+    }
+    return VFSListing::Build(std::move(l));
+}
+
+static int Sign(int _v) noexcept
+{
+    return _v < 0 ? -1 : (_v > 0 ? 1 : 0);
+}
+
+TEST_CASE(PREFIX "Keys order names the same way as CFStringCompare")
+{
+    const std::vector<std::string> names = {
+        "a",      "A",     "b",      "B",       "Zebra",   "zebra",  "file1",    "file2",   "file10",  "file01",
+        "File1",  "file",  "a-b",    "a_b",     "a.b",     "a b",    "a:",       "a5",      "a~",      "1",
+        "01",     "10",    "9",      "x9y",     "x10y",    "x010y",  "résumé",   "Résumé",  "resume",  "über",
+        "Über",   "uber",  "αβγ",    "ΑΒΓ",     "😀",      "a😀",    "a😀b",     "日本語",  "0",       "00",
+        "v1.2.9", "v1.10", "v1.2.10", "Makefile", "makefile", ".hidden", "..double", "~tilde", "a1b2c3", "a1b2c10"};
+    const auto listing = ProduceDummyListing(names);
+
+    for( const bool case_sensitive : {false, true} )
+        for( const bool numeric : {false, true} ) {
+            const NameSortKeys keys(*listing, case_sensitive, numeric);
+            REQUIRE(keys.Matches(names.size(), case_sensitive, numeric));
+            const CFStringCompareFlags flags =
+                (case_sensitive ? 0 : kCFCompareCaseInsensitive) | (numeric ? kCFCompareNumerically : 0);
+            for( unsigned i = 0; i < names.size(); ++i ) {
+                // the keys of the plain ASCII names are built without CoreFoundation, they must be the same
+                CHECK(keys.Key(i) == NameSortKeys::Make(CFString(names[i]).get(), case_sensitive, numeric));
+                for( unsigned j = 0; j < names.size(); ++j ) {
+                    const int by_keys = Sign(keys.Compare(i, j));
+                    CHECK(by_keys == Sign(keys.Compare(i, keys.Key(j))));
+                    if( by_keys == 0 )
+                        continue; // a tie, resolved by CFStringCompare() itself
+                    const int by_cf = Sign(static_cast<int>(
+                        CFStringCompare(listing->DisplayFilenameCF(i), listing->DisplayFilenameCF(j), flags)));
+                    INFO(names[i] + " vs " + names[j]);
+                    CHECK(by_keys == by_cf);
+                }
+            }
+        }
+}
+
+TEST_CASE(PREFIX "Numeric runs are compared by their values")
+{
+    const auto listing = ProduceDummyListing({"file10", "file9", "file0010", "file100", "file"});
+    const NameSortKeys keys(*listing, false, true);
+    CHECK(keys.Compare(1, 0) < 0);  // file9 < file10
+    CHECK(keys.Compare(0, 3) < 0);  // file10 < file100
+    CHECK(keys.Compare(0, 2) == 0); // file10 ~ file0010
+    CHECK(keys.Compare(4, 1) < 0);  // file < file9
+
+    const NameSortKeys plain_keys(*listing, false, false);
+    CHECK(plain_keys.Compare(1, 0) > 0); // file9 > file10
+}
+
+TEST_CASE(PREFIX "Keys of an empty listing")
+{
+    const NameSortKeys empty;
+    CHECK(!empty.Matches(0, false, false));
+    const auto listing = ProduceDummyListing({});
+    const NameSortKeys keys(*listing, false, false);
+    CHECK(keys.Matches(0, false, false));
+    CHECK(!keys.Matches(0, true, false));
+}
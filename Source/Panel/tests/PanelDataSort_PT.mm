@@ -0,0 +1,138 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include <sys/dirent.h>
+#include <VFS/VFS.h>
+#include <VFS/VFSListingInput.h>
+#include "PanelData.h"
+#include "PanelDataEntriesComparator.h"
+#include "PanelDataItemVolatileData.h"
+#include "PanelDataNameSortKeys.h"
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include "Tests.h"
+
+// NB! disabled by default, include in the PanelUT to enable
+
+#define PREFIX "PanelData sorting "
+
+using namespace nc;
+using namespace nc::base;
+using namespace nc::panel::data;
+
+// Produces names like "IMG_1234 (2).JPG" or "report-v17-final.pdf", a mix of cases and numeric runs
+static VFSListingPtr ProduceRandomListing(size_t _count)
+{
+    static constexpr std::string_view stems[] = {"IMG_", "img_", "report-v", "Report-v", "track ", "Track ", "build."};
+    static constexpr std::string_view extensions[] = {".JPG", ".jpg", ".pdf", ".mp3", ".txt", ""};
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> number(0, 99999);
+
+    vfs::ListingInput l;
+    l.directories.reset(variable_container<>::type::common);
+    l.directories[0] = "/";
+    l.hosts.reset(variable_container<>::type::common);
+    l.hosts[0] = VFSHost::DummyHost();
+    for( size_t i = 0; i < _count; ++i ) {
+        std::string name;
+        name += stems[rng() % std::size(stems)];
+        name += std::to_string(number(rng));
+        if( rng() % 4 == 0 )
+            name += " (" + std::to_string(number(rng) % 10) + ")";
+        name += extensions[rng() % std::size(extensions)];
+        name += "-" + std::to_string(i); // names must be unique
+        l.filenames.emplace_back(std::move(name));
+        l.unix_modes.emplace_back(S_IRUSR | S_IWUSR | S_IFREG);
+        l.unix_types.emplace_back(DT_REG);
+    }
+    return VFSListing::Build(std::move(l));
+}
+
+TEST_CASE(PREFIX "by name", "[!benchmark]")
+{
+    for( const size_t count : {10'000, 100'000, 1'000'000} ) {
+        const auto listing = ProduceRandomListing(count);
+        const std::vector<ItemVolatileData> vd(count);
+        std::vector<unsigned> indices(count);
+        for( const bool numeric : {false, true} ) {
+            SortMode mode;
+            mode.sort = SortMode::SortByName;
+            mode.numeric_sort = numeric;
+            const auto suffix = " - " + std::to_string(count) + (numeric ? " entries, numeric" : " entries");
+
+            BENCHMARK("CFStringCompare()" + suffix)
+            {
+                std::iota(indices.begin(), indices.end(), 0);
+                std::sort(indices.begin(), indices.end(), IndirectListingComparator{*listing, vd, mode});
+                return indices.front();
+            };
+            BENCHMARK("building the keys" + suffix)
+            {
+                return NameSortKeys(*listing, mode.case_sens, mode.numeric_sort).Matches(count, false, numeric);
+            };
+            const NameSortKeys keys(*listing, mode.case_sens, mode.numeric_sort);
+            BENCHMARK("sorting by the keys" + suffix)
+            {
+                std::iota(indices.begin(), indices.end(), 0);
+                std::sort(indices.begin(), indices.end(), IndirectListingComparator{*listing, vd, mode, &keys});
+                return indices.front();
+            };
+        }
+
+        Model model;
+        model.Load(listing, Model::PanelType::Directory);
+        BENCHMARK("Model: switching between name and size - " + std::to_string(count) + " entries")
+        {
+            SortMode mode;
+            mode.sort = SortMode::SortByName;
+            mode.numeric_sort = true;
+            model.SetSortMode(mode);
+            mode.sort = SortMode::SortBySize;
+            model.SetSortMode(mode);
+            return model.SortedEntriesCount();
+        };
+    }
+}
+
+TEST_CASE(PREFIX "ReLoad with a single changed entry", "[!benchmark]")
+{
+    for( const size_t count : {10'000, 100'000, 1'000'000} ) {
+        const auto listing1 = ProduceRandomListing(count);
+        const auto listing2 = ProduceRandomListing(count + 1); // the same entries plus one
+        SortMode mode;
+        mode.sort = SortMode::SortByName;
+        mode.numeric_sort = true;
+        Model model;
+        model.SetSortMode(mode);
+        model.Load(listing1, Model::PanelType::Directory);
+        BENCHMARK("ReLoad - " + std::to_string(count) + " entries")
+        {
+            model.ReLoad(model.ListingPtr() == listing1 ? listing2 : listing1);
+            return model.SortedEntriesCount();
+        };
+    }
+}
+
+TEST_CASE(PREFIX "typing in quick search", "[!benchmark]")
+{
+    for( const size_t count : {10'000, 100'000, 1'000'000} ) {
+        const auto listing = ProduceRandomListing(count);
+        Model model;
+        model.Load(listing, Model::PanelType::Directory);
+        for( const auto type : {TextualFilter::Anywhere, TextualFilter::Fuzzy} ) {
+            const auto suffix = std::string(type == TextualFilter::Anywhere ? " - anywhere, " : " - fuzzy, ") +
+                                std::to_string(count) + " entries";
+            BENCHMARK("Model: typing \"report\"" + suffix)
+            {
+                TextualFilter filter;
+                filter.type = type;
+                for( NSString *text : {@"r", @"re", @"rep", @"repo", @"repor", @"report"} ) {
+                    filter.text = text;
+                    model.SetSoftFiltering(filter);
+                }
+                model.SetSoftFiltering(TextualFilter::NoFilter());
+                return model.EntriesBySoftFiltering().size();
+            };
+        }
+    }
+}
@@ -1,4 +1,4 @@
-// Copyright (C) 2014-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <sys/dirent.h>
 #include <VFS/VFS.h>
 #include <VFS/VFSListingInput.h>
@@ -75,6 +75,28 @@ ProduceNonUniformDummyListing(const std::vector<std::tuple<std::string, std::str
     return VFSListing::Build(std::move(l));
 }
 
+// filename, size
+static VFSListingPtr ProduceSizedDummyListing(const std::vector<std::pair<std::string, uint64_t>> &_entries)
+{
+    vfs::ListingInput l;
+
+    l.directories.reset(variable_container<>::type::common);
+    l.directories[0] = "/";
+
+    l.hosts.reset(variable_container<>::type::common);
+    l.hosts[0] = VFSHost::DummyHost();
+
+    l.sizes.reset(variable_container<>::type::dense);
+    for( size_t i = 0; i < _entries.size(); ++i ) {
+        const bool is_dotdot = _entries[i].first == "..";
+        l.filenames.emplace_back(_entries[i].first);
+        l.unix_modes.emplace_back(is_dotdot ? (S_IRUSR | S_IWUSR | S_IFDIR) : (S_IRUSR | S_IWUSR | S_IFREG));
+        l.unix_types.emplace_back(is_dotdot ? DT_DIR : DT_REG);
+        l.sizes.insert(i, _entries[i].second);
+    }
+    return VFSListing::Build(std::move(l));
+}
+
 TEST_CASE(PREFIX "Empty model")
 {
     Model model;
@@ -724,3 +746,78 @@ TEST_CASE(PREFIX "ReLoad a temporary listing")
         CHECK(data.SortedIndexForName("meow.txt") == -1);
     }
 }
+
+TEST_CASE(PREFIX "ReLoad patches the sorting, the filtering and the statistics")
+{
+    std::vector<std::pair<std::string, uint64_t>> entries1{{"..", 0}};
+    std::vector<std::pair<std::string, uint64_t>> entries2{{"..", 0}};
+    for( uint64_t i = 0; i < 200; ++i ) {
+        const std::string name = std::string(i % 11 == 0 ? "." : "") + (i % 2 ? "File" : "file") + std::to_string(i);
+        const uint64_t size = 1000 + (i * 37 % 200); // unique sizes
+        entries1.emplace_back(name, size);
+        if( i % 29 == 0 )
+            continue; // removed
+        entries2.emplace_back(name, i % 23 == 0 ? size + 500 : size); // changed or not
+    }
+    for( uint64_t i = 0; i < 10; ++i )
+        entries2.emplace_back((i % 3 == 0 ? ".new" : "new") + std::to_string(i * 10), 1500 + i); // added
+    std::swap(entries2[5], entries2[100]); // the raw order doesn't matter
+    const auto listing1 = ProduceSizedDummyListing(entries1);
+    const auto listing2 = ProduceSizedDummyListing(entries2);
+
+    data::SortMode sorting;
+    data::HardFilter hard_filtering;
+    data::TextualFilter soft_filtering;
+    SECTION("By name, numeric")
+    {
+        sorting.sort = data::SortMode::SortByName;
+        sorting.numeric_sort = true;
+    }
+    SECTION("By name, case-sensitive, hidden files are shown")
+    {
+        sorting.sort = data::SortMode::SortByName;
+        sorting.case_sens = true;
+        hard_filtering.show_hidden = true;
+    }
+    SECTION("By size, soft filtering")
+    {
+        sorting.sort = data::SortMode::SortBySize;
+        soft_filtering.type = data::TextualFilter::Anywhere;
+        soft_filtering.text = @"1";
+    }
+    SECTION("By raw name, hard filtering")
+    {
+        sorting.sort = data::SortMode::SortByRawCName;
+        hard_filtering.text.type = data::TextualFilter::Anywhere;
+        hard_filtering.text.text = @"e1";
+    }
+
+    Model model;
+    model.SetSortMode(sorting);
+    model.SetHardFiltering(hard_filtering);
+    model.SetSoftFiltering(soft_filtering);
+    model.Load(listing1, Model::PanelType::Directory);
+    for( int i = 0; i < model.SortedEntriesCount(); i += 3 )
+        model.CustomFlagsSelectSorted(i, true);
+    model.ReLoad(listing2);
+
+    Model reference;
+    reference.SetSortMode(sorting);
+    reference.SetHardFiltering(hard_filtering);
+    reference.SetSoftFiltering(soft_filtering);
+    reference.Load(listing2, Model::PanelType::Directory);
+    for( int i = 0; i < model.SortedEntriesCount(); ++i )
+        if( model.VolatileDataAtSortPosition(i).is_selected() )
+            reference.CustomFlagsSelectSorted(reference.SortedIndexForName(model.EntryAtSortPosition(i).Filename()),
+                                              true);
+
+    REQUIRE(model.SortedEntriesCount() == reference.SortedEntriesCount());
+    for( int i = 0; i < model.SortedEntriesCount(); ++i ) {
+        CHECK(model.EntryAtSortPosition(i).Filename() == reference.EntryAtSortPosition(i).Filename());
+        CHECK(model.SortedIndexForRawIndex(model.RawIndexForSortIndex(i)) == i);
+    }
+    CHECK(model.EntriesBySoftFiltering() == reference.EntriesBySoftFiltering());
+    CHECK(model.Stats() == reference.Stats());
+    CHECK(model.RawIndexForName("new50") >= 0);
+    CHECK(model.RawIndexForName("file58") == -1);
+}
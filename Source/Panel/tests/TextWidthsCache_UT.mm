@@ -0,0 +1,89 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "TextWidthsCache.h"
+#include "Tests.h"
+#include <Utility/FontExtras.h>
+
+#define PREFIX "nc::panel::TextWidthsCache "
+
+using namespace nc;
+using namespace nc::panel;
+
+static std::vector<base::CFPtr<CFStringRef>> MakeStrings(size_t _first, size_t _count)
+{
+    std::vector<base::CFPtr<CFStringRef>> strings;
+    for( size_t i = _first; i != _first + _count; ++i )
+        strings.emplace_back(base::CFPtr<CFStringRef>::adopt(
+            CFStringCreateWithFormat(nullptr, nullptr, CFSTR("file number %zu.txt"), i)));
+    return strings;
+}
+
+static std::vector<CFStringRef> Raw(const std::vector<base::CFPtr<CFStringRef>> &_strings)
+{
+    std::vector<CFStringRef> raw;
+    for( auto &string : _strings )
+        raw.emplace_back(string.get());
+    return raw;
+}
+
+TEST_CASE(PREFIX "gives the same widths as FontGeometryInfo and remembers them")
+{
+    auto &cache = TextWidthsCache::Instance();
+    NSFont *font = [NSFont systemFontOfSize:13.];
+    const auto strings = MakeStrings(0, 1000);
+    const auto raw = Raw(strings);
+    const auto expected = utility::FontGeometryInfo::CalculateStringsWidths(raw, font);
+
+    const auto before = cache.Stats();
+    CHECK(cache.Widths(raw, font) == expected);
+    const auto after_first = cache.Stats();
+    CHECK(after_first.misses - before.misses == 1000);
+
+    // the strings are looked up by their contents, not by their pointers
+    const auto copies = MakeStrings(0, 1000);
+    CHECK(cache.Widths(Raw(copies), font) == expected);
+    const auto after_second = cache.Stats();
+    CHECK(after_second.hits - after_first.hits == 1000);
+    CHECK(after_second.misses == after_first.misses);
+}
+
+TEST_CASE(PREFIX "stays within its capacity")
+{
+    auto &cache = TextWidthsCache::Instance();
+    NSFont *font = [NSFont systemFontOfSize:17.];
+    constexpr size_t capacity = TextWidthsCache::ShardsNumber * TextWidthsCache::ShardCapacity;
+    const auto before = cache.Stats();
+
+    // the batches are small enough for each one to fit into the capacity
+    const auto strings = MakeStrings(0, capacity * 2);
+    const auto raw = Raw(strings);
+    std::vector<unsigned short> widths;
+    for( size_t first = 0; first < raw.size(); first += 1000 ) {
+        const std::span<const CFStringRef> batch(raw.data() + first, std::min<size_t>(1000, raw.size() - first));
+        const auto batch_widths = cache.Widths(batch, font);
+        widths.insert(widths.end(), batch_widths.begin(), batch_widths.end());
+    }
+    const auto after = cache.Stats();
+    CHECK(after.evictions - before.evictions >= capacity);
+    CHECK(after.size - before.size <= capacity);
+
+    // the evicted widths are calculated anew and are the same
+    const std::span<const CFStringRef> head(raw.data(), 100);
+    CHECK(cache.Widths(head, font) == std::vector<unsigned short>(widths.begin(), widths.begin() + 100));
+}
+
+TEST_CASE(PREFIX "grows to hold a batch larger than its capacity")
+{
+    auto &cache = TextWidthsCache::Instance();
+    NSFont *font = [NSFont systemFontOfSize:19.];
+    constexpr size_t capacity = TextWidthsCache::ShardsNumber * TextWidthsCache::ShardCapacity;
+    const auto strings = MakeStrings(0, capacity * 3);
+    const auto raw = Raw(strings);
+
+    const auto first = cache.Widths(raw, font);
+    const auto before = cache.Stats();
+    CHECK(cache.Widths(raw, font) == first);
+    const auto after = cache.Stats();
+    CHECK(after.hits - before.hits == raw.size());
+    CHECK(after.misses == before.misses);
+    CHECK(after.evictions == before.evictions);
+}
@@ -1,9 +1,10 @@
-// Copyright (C) 2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2023-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 #include <stdint.h>
 #include <CoreFoundation/CoreFoundation.h>
 #include <cassert>
 #include <compare>
+#include <string>
 #include <string_view>
 #include <vector>
 #include <Base/CFPtr.h>
@@ -44,6 +45,10 @@ public:
     // If '_code' is a base character this function will return an empty pointer.
     base::CFPtr<CFStringRef> Decode(char32_t _code) const noexcept;
 
+    // Provides the UTF16 characters of an encoded extended char '_code'.
+    // If '_code' is a base character this function will return an empty string.
+    std::u16string DecodeUTF16(char32_t _code) const;
+
 #ifdef __OBJC__
     // Provides a NSString for an encoded extended char '_code'.
     // If '_code' is a base character this function will return nil.
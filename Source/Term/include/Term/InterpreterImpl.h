@@ -1,4 +1,4 @@
-// Copyright (C) 2020-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2020-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "Interpreter.h"
@@ -7,6 +7,8 @@
 #include "ExtendedCharRegistry.h"
 #include <bitset>
 #include <optional>
+#include <string>
+#include <string_view>
 
 namespace nc::term {
 
@@ -35,6 +37,9 @@ private:
     static void ResetToDefaultTabStops(TabStops &_tab_stops);
     void InterpretSingleCommand(const input::Command &_command);
     void ProcessText(const input::UTF8Text &_text);
+    void ProcessASCIIText(std::string_view _ascii);
+    void ProcessUnicodeText(std::string_view _utf8, bool _append_to_current);
+    bool CurrentLineEndsWithMCG() const;
     void ProcessLF();
     void ProcessCR();
     void ProcessBS();
@@ -120,6 +125,7 @@ private:
     Extent m_Extent;
     TabStops m_TabStops;
     const unsigned short *m_TranslateMap = nullptr;
+    std::u16string m_UTF16Buffer;
     CharacterSets m_CS;
     bool m_OriginLineMode = false;
     bool m_AllowScreenResize = true;
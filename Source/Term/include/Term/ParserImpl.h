@@ -1,4 +1,4 @@
-// Copyright (C) 2020-2022 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2020-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Parser.h"
 
 #include <array>
@@ -42,14 +42,14 @@ private:
     void EatByte(unsigned char _byte);
     void FlushAllText();
     void FlushCompleteText();
-    void ConsumeNextUTF8TextChar(unsigned char _byte);
+    void ConsumeUTF8Text(const unsigned char *_bytes, size_t _count);
     void LogMissedEscChar(unsigned char _c);
     void LogMissedOSCRequest(unsigned _ps, std::string_view _pt);
     void LogMissedCSIRequest(std::string_view _request);
 
     void SSTextEnter() noexcept;
     void SSTextExit() noexcept;
-    bool SSTextConsume(unsigned char _byte) noexcept;
+    bool SSTextConsume(unsigned char _byte); // may flush the text, i.e. allocate
 
     void SSControlEnter() noexcept;
     void SSControlExit() noexcept;
@@ -125,7 +125,7 @@ private:
     constexpr static struct SubStates {
         void (Me::*enter)() noexcept;
         void (Me::*exit)() noexcept;
-        bool (Me::*consume)(unsigned char _byte) noexcept;
+        bool (Me::*consume)(unsigned char _byte);
     } m_SubStates[6] = {
         {&Me::SSTextEnter, &Me::SSTextExit, &Me::SSTextConsume},
         {&Me::SSControlEnter, &Me::SSControlExit, &Me::SSControlConsume},
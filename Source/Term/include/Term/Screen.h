@@ -1,9 +1,10 @@
-// Copyright (C) 2013-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "ScreenBuffer.h"
 #include "ExtendedCharRegistry.h"
 #include <mutex>
+#include <string_view>
 
 namespace nc::term {
 
@@ -30,6 +31,13 @@ public:
     
     void PutCh(char32_t _char);
 
+    /**
+     * Puts a run of printable ASCII characters starting from the cursor position, up to the end of the line.
+     * The cursor is moved past the put characters exactly as PutCh() followed by moving to the right would do for
+     * each of them. Returns the amount of characters put.
+     */
+    size_t PutASCII(std::string_view _ascii);
+
     /**
      * Marks current screen line as wrapped. That means that the next line is continuation of current line.
      */
@@ -96,7 +104,6 @@ private:
         int pos_y = 0;
     };
 
-    void CopyLineChars(int _from, int _to);
     void ClearLine(int _ind);
     SavedScreen CaptureScreen() const;
 
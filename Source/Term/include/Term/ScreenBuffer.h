@@ -1,4 +1,4 @@
-// Copyright (C) 2015-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2015-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <optional>
@@ -12,6 +12,8 @@
 
 namespace nc::term {
 
+class Scrollback;
+
 struct ScreenPoint {
     int x = 0;
     int y = 0;
@@ -62,13 +64,34 @@ public:
 
     static const unsigned short MultiCellGlyph = 0xFFFE;
 
+    struct BackScreenLimits {
+        size_t max_lines = 0; // zero means unlimited
+        size_t max_bytes = 0; // zero means unlimited
+    };
+
     ScreenBuffer(unsigned _width,
                  unsigned _height,
                  ExtendedCharRegistry &_reg = ExtendedCharRegistry::SharedInstance());
+    ~ScreenBuffer();
 
     inline unsigned Width() const { return m_Width; }
     inline unsigned Height() const { return m_Height; }
-    inline unsigned BackScreenLines() const { return static_cast<unsigned>(m_BackScreenLines.size()); }
+    inline const ExtendedCharRegistry &Registry() const noexcept { return m_Registry; }
+    unsigned BackScreenLines() const noexcept;
+
+    // the oldest backscreen lines are dropped once either of the limits is exceeded
+    void SetBackScreenLimits(BackScreenLimits _limits);
+
+    // memory taken by the backscreen lines
+    size_t BackScreenBytes() const noexcept;
+
+    // amount of the oldest backscreen lines dropped so far because of the limits.
+    // the line _line_number was the (BackScreenDroppedLines() + BackScreenLines() + _line_number)-th line of the buffer
+    // since the last layout change, this position stays the same while the lines are being scrolled.
+    size_t BackScreenDroppedLines() const noexcept;
+
+    // changes each time all lines are laid out anew, i.e. on a resize, making the previously taken positions invalid
+    uint64_t LayoutGeneration() const noexcept;
 
     // negative _line_number means backscreen, zero and positive - current screen
     // backscreen: [-BackScreenLines(), -1]
@@ -76,7 +99,12 @@ public:
     // -1 is the last (most recent) backscreen line
     // return an iterator pair [i,e)
     // on invalid input parameters return [nullptr,nullptr)
-    std::span<const Space> LineFromNo(int _line_number) const noexcept;
+    // backscreen lines are stored compressed and are expanded on access, a returned backscreen line stays valid only
+    // until a few other backscreen lines are accessed, see Scrollback for details
+    std::span<const Space> LineFromNo(int _line_number) const;
+
+    // the same for the onscreen lines only, which can be altered in place. backscreen lines are read-only, so a
+    // negative _line_number gives [nullptr,nullptr) - use the const overload to read them
     std::span<Space> LineFromNo(int _line_number) noexcept;
 
     Space At(int x, int y) const;
@@ -88,6 +116,19 @@ public:
     bool LineWrapped(int _line_number) const;
     void SetLineWrapped(int _line_number, bool _wrapped);
 
+    // rotates the onscreen lines [_first, _last) the same way std::rotate does, i.e. _middle becomes the first one.
+    // the characters stay in place, only the order of the lines is changed, so scrolling doesn't move the lines' data.
+    void RotateLines(int _first, int _middle, int _last);
+
+    // identifies the current contents of an onscreen line and is unique among them. a new generation is given each time
+    // the line is changed, while rotating the lines moves the generations along with the lines, so a scrolled line keeps
+    // its own. this allows telling which lines have changed and which have merely moved since some moment.
+    // backscreen lines never change, their generation is zero, as well as the one of the invalid line numbers.
+    uint64_t LineGeneration(int _line_number) const noexcept;
+
+    // must be called after changing the characters of an onscreen line obtained via LineFromNo()
+    void MarkLineChanged(int _line_number) noexcept;
+
     Space EraseChar() const;
     void SetEraseChar(Space _ch);
     static Space DefaultEraseChar() noexcept;
@@ -128,10 +169,13 @@ private:
         unsigned start_index = 0;
         unsigned line_length = 0;
         bool is_wrapped = false;
+        uint64_t generation = 0;
     };
 
     LineMeta *MetaFromLineNo(int _line_number);
     const LineMeta *MetaFromLineNo(int _line_number) const;
+    size_t BackScreenIndex(int _line_number) const noexcept;
+    void MarkAllLinesChanged() noexcept;
 
     static void
     FixupOnScreenLinesIndeces(std::vector<LineMeta>::iterator _i, std::vector<LineMeta>::iterator _e, unsigned _width);
@@ -147,9 +191,10 @@ private:
     unsigned m_Height = 0; // onscreen height, backscreen has arbitrary height
     const ExtendedCharRegistry &m_Registry;
     std::vector<LineMeta> m_OnScreenLines;
-    std::vector<LineMeta> m_BackScreenLines;
     std::unique_ptr<Space[]> m_OnScreenSpaces; // rebuilt on screeen size change
-    std::vector<Space> m_BackScreenSpaces;     // will be growing
+    std::unique_ptr<Scrollback> m_BackScreen;
+    uint64_t m_LayoutGeneration = 0;
+    uint64_t m_LinesGeneration = 0; // the last one given to an onscreen line
 
     Space m_EraseChar = DefaultEraseChar();
 };
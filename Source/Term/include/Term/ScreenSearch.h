@@ -0,0 +1,143 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include "ScreenBuffer.h"
+#include <Base/SerialQueue.h>
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace nc::term {
+
+class Screen;
+
+// Finds text in the lines of a terminal, both in the onscreen and in the backscreen ones.
+// A logical line wrapped over several screen lines is matched as a whole, extended graphemes are matched by their full
+// text and a multi-cell glyph is matched as a single character. The text is matched as UTF-8, a match never spans
+// more than one logical line.
+// The search runs incrementally in a background queue: the onscreen lines are looked through first, then the newly
+// scrolled-off lines and then the history, from the newest lines to the oldest ones, a limited chunk of lines at a
+// time to not hold the screen lock for long. The backscreen lines are looked through only once, so appending new
+// output costs only the amount of the new lines, while the onscreen lines are looked through on every update.
+// The matches are tracked by positions which don't change when the lines are scrolled, those are converted into the
+// current line numbers of the screen upon request.
+class ScreenSearch
+{
+public:
+    struct Options {
+        bool case_sensitive = false;
+        bool regex = false; // RE2 syntax, otherwise the text is looked for literally
+    };
+
+    // A compiled query. Immutable, can be shared between threads and searches.
+    class Query;
+
+    // [begin, end) in the line numbers of ScreenBuffer, i.e. 'end' points right after the last matched screen space
+    struct Match {
+        ScreenPoint begin;
+        ScreenPoint end;
+        bool operator==(const Match &) const noexcept = default;
+    };
+
+    // Amount of the screen lines looked through in one go, while holding the screen lock
+    static constexpr int ChunkLines = 1024;
+
+    // Compiles a query, returns nullptr if the text is empty or is a malformed regular expression
+    static std::shared_ptr<const Query> Compile(std::string_view _text, Options _options);
+
+    // Synchronously finds all matches in the logical lines which overlap the lines [_first_line, _last_line).
+    // The lines numbers are the same as in ScreenBuffer::LineFromNo(), the range is clamped to the existing lines.
+    static std::vector<Match>
+    Find(const ScreenBuffer &_buffer, const Query &_query, int _first_line, int _last_line);
+
+    ScreenSearch(Screen &_screen);
+
+    // Stops the search and waits for the background queue to become dry
+    ~ScreenSearch();
+
+    // Starts looking for the query anew, nullptr stops the search and clears the matches
+    void SetQuery(std::shared_ptr<const Query> _query);
+
+    // Notifies that the screen has changed, i.e. that new output has arrived or the screen has been resized.
+    // Cheap to call often, the updates are coalesced.
+    void Update();
+
+    // Is set to be called when the matches have changed, from the background queue
+    void SetOnChanged(std::function<void()> _on_changed);
+
+    // Checks if some lines are not looked through yet
+    bool InProgress() const;
+
+    // Synchronously waits until the background queue becomes dry
+    void Wait();
+
+    // Amount of the matches found so far
+    size_t Count() const;
+
+    // The functions below must be called with the screen lock being held, since the positions of the matches are
+    // converted into the current line numbers of the screen.
+
+    // Returns the matches found so far which overlap the lines [_first_line, _last_line), in their order on the screen
+    std::vector<Match> Matches(int _first_line, int _last_line) const;
+
+    // Returns the first match which begins after _point
+    std::optional<Match> Next(ScreenPoint _point) const;
+
+    // Returns the last match which begins before _point
+    std::optional<Match> Previous(ScreenPoint _point) const;
+
+private:
+    // A position which stays the same while the lines are scrolled, see ScreenBuffer::BackScreenDroppedLines()
+    struct Position {
+        uint64_t line = 0;
+        int x = 0;
+        auto operator<=>(const Position &) const noexcept = default;
+    };
+
+    struct Found {
+        Position begin;
+        Position end;
+    };
+
+    enum class Region
+    {
+        OnScreen, // the lines starting from m_Settled, looked through again on each update
+        Newest,   // [m_Scanned.second, m_Settled)
+        Oldest    // lines before m_Scanned.first
+    };
+
+    struct Chunk;
+
+    void Schedule();
+    void Work();
+    std::optional<Chunk> ExtractNextChunk();
+    static std::vector<Found> FindInChunk(const Chunk &_chunk, const Query &_query);
+    void Merge(const Chunk &_chunk, std::vector<Found> _found);
+    uint64_t Origin() const noexcept;
+    std::vector<Found>::const_iterator FoundOnScreenBegin() const noexcept;
+    static Match ToMatch(const Found &_found, uint64_t _origin) noexcept;
+
+    Screen &m_Screen;
+    base::SerialQueue m_Queue{"nc::term::ScreenSearch"};
+    std::atomic_bool m_Scheduled{false};
+
+    // everything below is guarded by m_Lock
+    mutable std::mutex m_Lock;
+    std::shared_ptr<const Query> m_Query;
+    uint64_t m_Generation = 0;       // changes when the query is set or the layout of the buffer changes
+    uint64_t m_LayoutGeneration = 0; // ScreenBuffer::LayoutGeneration() the positions are valid for
+    bool m_Started = false;          // m_Scanned and m_Settled are meaningful
+    bool m_OnScreenDirty = false;    // the onscreen lines have to be looked through again
+    std::pair<uint64_t, uint64_t> m_Scanned; // [first, second) lines which were looked through once and for all
+    uint64_t m_Settled = 0;                  // the lines before are in the backscreen, i.e. won't change anymore
+    std::deque<Found> m_Found;               // in m_Scanned
+    std::vector<Found> m_FoundOnScreen;      // starting from m_Settled at the moment of the last look-through
+    std::function<void()> m_OnChanged;
+};
+
+} // namespace nc::term
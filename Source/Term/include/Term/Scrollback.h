@@ -0,0 +1,122 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include "ScreenBuffer.h"
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <limits>
+#include <deque>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace nc::term {
+
+// Stores the lines scrolled off the terminal screen, i.e. the backscreen of ScreenBuffer.
+// The lines are kept in a ring of pages with up to a fixed amount of lines each. Only the newest page is kept as is to be
+// appended to, the filled pages are compressed: the trailing empty spaces of the lines are omitted, the characters are
+// stored as UTF-8 and the attributes as runs of identical values. A compressed page is expanded on demand when one of
+// its lines is accessed, a few recently expanded pages are cached.
+// The oldest pages are dropped once the stored lines exceed either the lines or the bytes budget.
+// The lines are re-laid out for another width page by page: the pages without wrapped lines and with all lines fitting
+// the new width are kept compressed as they are, only the rest are expanded and compressed anew.
+class Scrollback
+{
+public:
+    using Space = ScreenBuffer::Space;
+
+    // Maximum amount of lines in a page
+    static constexpr size_t PageLines = 256;
+
+    // Amount of expanded pages kept around, the span of an accessed line stays valid until that many other pages
+    // were accessed afterwards
+    static constexpr size_t CachedPages = 4;
+
+    struct Limits {
+        size_t max_lines = 100'000;         // rounded up to the whole pages
+        size_t max_bytes = 64 * 1024 * 1024; // memory taken by the stored lines, rounded up to the whole pages
+    };
+
+    Scrollback();
+    explicit Scrollback(Limits _limits);
+    Scrollback(const Scrollback &) = delete;
+    ~Scrollback();
+    Scrollback &operator=(const Scrollback &) = delete;
+
+    // Changes the budget, drops the oldest lines if it's already exceeded
+    void SetLimits(Limits _limits);
+    Limits GetLimits() const noexcept;
+
+    // Amount of the stored lines
+    size_t Size() const noexcept;
+
+    // Amount of the oldest lines dropped so far to stay within the budget, i.e. the line with the index 0 was the
+    // Dropped()-th appended one. Reset by Clear().
+    size_t Dropped() const noexcept;
+
+    // Memory taken by the stored lines, not counting the cache of the expanded pages
+    size_t Bytes() const noexcept;
+
+    // Appends a line after the newest one, may drop the oldest lines to stay within the budget
+    void Append(std::span<const Space> _line, bool _wrapped);
+
+    // Removes the newest line
+    void PopBack();
+
+    // Returns the line with the index in [0, Size()), where 0 is the oldest line. Returns an empty span for an
+    // invalid index.
+    std::span<const Space> Line(size_t _index) const;
+
+    bool Wrapped(size_t _index) const noexcept;
+    void SetWrapped(size_t _index, bool _wrapped) noexcept;
+
+    // Joins the wrapped lines and splits them again to be at most _width spaces long, the trailing empty spaces are
+    // not kept. The newest line, if it's wrapped, continues somewhere outside, e.g. on the screen - the spaces of its
+    // unfinished joined line are removed and returned for the caller to lay out. Resets Dropped().
+    std::optional<std::vector<Space>> Rewrap(size_t _width);
+
+    void Clear();
+
+private:
+    struct Page {
+        uint64_t id = 0;
+        size_t first = 0; // index of the first line, counting the dropped ones
+        size_t lines = 0;
+        uint32_t longest = 0;                                // the longest line without its trailing empty spaces
+        uint32_t cut = std::numeric_limits<uint32_t>::max(); // the lines are cut to this length, only empty spaces go
+        std::bitset<PageLines> wrapped;
+        std::vector<Space> spaces;       // the newest page only
+        std::vector<uint32_t> offsets;   // the newest page only: start of each line in the spaces
+        std::vector<uint8_t> compressed; // the filled pages only
+        size_t Bytes() const noexcept;
+        bool Sealed() const noexcept { return !compressed.empty(); }
+    };
+
+    struct Expanded {
+        uint64_t page_id = 0; // zero means an unused entry
+        uint64_t last_used = 0;
+        std::vector<Space> spaces;
+        std::vector<uint32_t> offsets; // start of each line in the spaces, plus the end
+    };
+
+    static std::vector<uint8_t> Compress(const Page &_page);
+    static void Expand(std::span<const uint8_t> _compressed, Expanded &_expanded);
+    const Expanded &ExpandedPage(const Page &_page) const;
+    static std::span<const Space> PageLine(const Page &_page, const Expanded *_expanded, size_t _index) noexcept;
+    size_t PageIndex(size_t _index) const noexcept;
+    void AppendLine(std::span<const Space> _line, bool _wrapped);
+    void SealNewestPage();
+    void UnsealNewestPage();
+    void Trim();
+
+    Limits m_Limits;
+    std::deque<Page> m_Pages; // from the oldest to the newest
+    size_t m_Bytes = 0;       // sum of Bytes() of the sealed pages
+    size_t m_Dropped = 0;
+    uint64_t m_LastPageID = 0;
+    mutable std::array<Expanded, CachedPages> m_Expanded;
+    mutable uint64_t m_UseCounter = 0;
+};
+
+} // namespace nc::term
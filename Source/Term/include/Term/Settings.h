@@ -1,4 +1,4 @@
-// Copyright (C) 2017-2018 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "CursorMode.h"
@@ -43,6 +43,8 @@ public:
     virtual int MaxFPS() const = 0;
     virtual enum CursorMode CursorMode() const = 0;
     virtual bool HideScrollbar() const = 0;
+    virtual int ScrollbackMaxLines() const = 0;     // zero means unlimited
+    virtual int ScrollbackMaxMegabytes() const = 0; // zero means unlimited
     
     virtual int StartChangesObserving( std::function<void()> _callback ) = 0;
     virtual void StopChangesObserving( int _ticket ) = 0;
@@ -78,6 +80,8 @@ public:
     int MaxFPS() const override;
     enum CursorMode CursorMode() const override;
     bool HideScrollbar() const override;
+    int ScrollbackMaxLines() const override;
+    int ScrollbackMaxMegabytes() const override;
     
     int StartChangesObserving( std::function<void()> _callback ) override;
     void StopChangesObserving( int _ticket ) override;
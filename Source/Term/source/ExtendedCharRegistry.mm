@@ -1,4 +1,4 @@
-// Copyright (C) 2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2023-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "ExtendedCharRegistry.h"
 #include <CoreFoundation/CoreFoundation.h>
 #include <Base/CFPtr.h>
@@ -183,6 +183,18 @@ base::CFPtr<CFStringRef> ExtendedCharRegistry::Decode(char32_t _code) const noex
     return m_Chars[idx].cf_str;
 }
 
+std::u16string ExtendedCharRegistry::DecodeUTF16(char32_t _code) const
+{
+    if( IsBase(_code) )
+        return {};
+
+    const uint32_t idx = ToExtIdx(_code);
+    std::lock_guard lock{m_Lock};
+    if( idx >= m_Chars.size() )
+        return {};
+    return m_Chars[idx].str;
+}
+
 NSString *ExtendedCharRegistry::DecodeNS(char32_t _code) const noexcept
 {
     if( IsBase(_code) )
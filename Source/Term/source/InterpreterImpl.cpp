@@ -1,11 +1,11 @@
 // Copyright (C) 2020-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "InterpreterImpl.h"
-#include <Base/CFString.h>
-#include <Base/CFPtr.h>
 #include <Utility/CharInfo.h>
+#include <Utility/Encodings.h>
 #include <magic_enum.hpp>
 #include "OrthodoxMonospace.h"
 #include "TranslateMaps.h"
+#include "TextScan.h"
 #include "Log.h"
 #include <fmt/format.h>
 
@@ -13,8 +13,7 @@ namespace nc::term {
 
 using utility::CharInfo;
 
-static std::u16string ConvertUTF8ToUTF16(std::string_view _utf8);
-static void ApplyTranslateMap(std::u16string &_utf16, const unsigned short *_map);
+static void ApplyTranslateMap(std::span<char16_t> _utf16, const unsigned short *_map);
 
 InterpreterImpl::InterpreterImpl(Screen &_screen, ExtendedCharRegistry &_reg) : m_Screen(_screen), m_Registry(_reg)
 {
@@ -149,19 +148,78 @@ void InterpreterImpl::SetBell(Bell _bell)
 
 void InterpreterImpl::ProcessText(const input::UTF8Text &_text)
 {
-    // TODO: convert iteratively, avoid CF for conversion and use raw local stack buffers
-    auto whole_input = ConvertUTF8ToUTF16(_text.characters);
+    std::string_view input = _text.characters;
+    if( m_TranslateMap != nullptr || m_InsertMode ) {
+        ProcessUnicodeText(input, true);
+        return;
+    }
+
+    // Printable ASCII is neither composed nor double-width, so runs of it are put straight into the screen. The last
+    // character of a run followed by something else goes the generic way since it can start a grapheme cluster.
+    const auto bytes = reinterpret_cast<const unsigned char *>(input.data());
+    for( size_t pos = 0; pos != input.size(); ) {
+        const size_t ascii = FindNonPrintableASCII(bytes + pos, input.size() - pos);
+        if( pos + ascii == input.size() ) {
+            ProcessASCIIText(input.substr(pos));
+            break;
+        }
+        if( ascii > 1 ) {
+            ProcessASCIIText(input.substr(pos, ascii - 1));
+            pos += ascii - 1;
+        }
+
+        // a printable ASCII byte never continues a UTF-8 sequence, so the generic part can safely end before it
+        size_t end = pos + 1;
+        while( end != input.size() && (bytes[end] < 0x20 || bytes[end] > 0x7E) )
+            ++end;
+        ProcessUnicodeText(input.substr(pos, end - pos), pos == 0);
+        pos = end;
+    }
+}
+
+void InterpreterImpl::ProcessASCIIText(std::string_view _ascii)
+{
+    const int sx = m_Screen.Width();
+    while( !_ascii.empty() ) {
+        if( m_AutoWrapMode == true && m_Screen.LineOverflown() &&
+            (m_Screen.CursorX() >= sx - 1 || (m_Screen.CursorX() == sx - 2 && CurrentLineEndsWithMCG())) ) {
+            m_Screen.PutWrap();
+            ProcessCR();
+            ProcessLF();
+        }
+        _ascii.remove_prefix(m_Screen.PutASCII(_ascii));
+    }
+}
+
+bool InterpreterImpl::CurrentLineEndsWithMCG() const
+{
+    const auto line = m_Screen.Buffer().LineFromNo(m_Screen.CursorY());
+    return !line.empty() && line.back().l == Screen::MultiCellGlyph;
+}
+
+void InterpreterImpl::ProcessUnicodeText(std::string_view _utf8, bool _append_to_current)
+{
+    // the buffer keeps its capacity between the calls, so the conversion doesn't allocate
+    m_UTF16Buffer.resize(_utf8.size() + 1); // the conversion also writes a null-terminator
+    size_t utf16_len = 0;
+    InterpretUTF8BufferAsUTF16(reinterpret_cast<const uint8_t *>(_utf8.data()),
+                               _utf8.size(),
+                               reinterpret_cast<uint16_t *>(m_UTF16Buffer.data()),
+                               &utf16_len,
+                               0xFFFD);
+    const std::span<char16_t> utf16(m_UTF16Buffer.data(), utf16_len);
     if( m_TranslateMap != nullptr ) {
-        ApplyTranslateMap(whole_input, m_TranslateMap);
+        ApplyTranslateMap(utf16, m_TranslateMap);
     }
 
     // 'input' will gradually decrease after being eaten from the front
-    std::u16string_view input = whole_input;
+    std::u16string_view input(utf16.data(), utf16.size());
     if( input.empty() )
         return; // ignore empty inputs
 
     // first try to append a whatever character currently stored at the current position
-    if( const char32_t curr = m_Screen.GetCh(); curr != 0 && curr != Screen::MultiCellGlyph ) {
+    const char32_t curr = _append_to_current ? m_Screen.GetCh() : 0;
+    if( curr != 0 && curr != Screen::MultiCellGlyph ) {
         const auto ar = m_Registry.Append(input, curr);
         if( ar.eaten != 0 ) {
             // managed to append something to the current character
@@ -174,11 +232,6 @@ void InterpreterImpl::ProcessText(const input::UTF8Text &_text)
 
     const int sx = m_Screen.Width();
 
-    auto curr_line_ends_with_mcg = [&]() -> bool {
-        auto line = m_Screen.Buffer().LineFromNo(m_Screen.CursorY());
-        return line.back().l == Screen::MultiCellGlyph;
-    };
-
     while( !input.empty() ) {
         const auto ar = m_Registry.Append(input);
         assert(ar.eaten <= input.size());
@@ -188,7 +241,7 @@ void InterpreterImpl::ProcessText(const input::UTF8Text &_text)
         }
 
         if( m_AutoWrapMode == true && m_Screen.LineOverflown() &&
-            (m_Screen.CursorX() >= sx - 1 || (m_Screen.CursorX() == sx - 2 && curr_line_ends_with_mcg())) ) {
+            (m_Screen.CursorX() >= sx - 1 || (m_Screen.CursorX() == sx - 2 && CurrentLineEndsWithMCG())) ) {
             m_Screen.PutWrap();
             ProcessCR();
             ProcessLF();
@@ -675,24 +728,7 @@ void InterpreterImpl::Response(std::string_view _text)
     m_Output(bytes);
 }
 
-static std::u16string ConvertUTF8ToUTF16(std::string_view _utf8)
-{
-    // temp and slow implementation
-    auto str = base::CFPtr<CFStringRef>::adopt(base::CFStringCreateWithUTF8StringNoCopy(_utf8));
-    if( !str )
-        return {};
-
-    const auto utf16_len = CFStringGetLength(str.get());
-
-    std::u16string result;
-    result.resize(utf16_len);
-
-    CFStringGetCharacters(str.get(), CFRangeMake(0, utf16_len), reinterpret_cast<uint16_t *>(result.data()));
-
-    return result;
-}
-
-static void ApplyTranslateMap(std::u16string &_utf16, const unsigned short *_map)
+static void ApplyTranslateMap(std::span<char16_t> _utf16, const unsigned short *_map)
 {
     for( auto &c : _utf16 ) {
         if( c <= 0x7f ) {
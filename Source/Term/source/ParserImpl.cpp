@@ -5,6 +5,7 @@
 #include <Carbon/Carbon.h>
 #include <CoreFoundation/CoreFoundation.h>
 #include "TranslateMaps.h"
+#include "TextScan.h"
 #include <charconv>
 
 #include <iostream>
@@ -27,8 +28,19 @@ void ParserImpl::Reset()
 
 std::vector<input::Command> ParserImpl::Parse(Bytes _to_parse)
 {
-    for( auto c : _to_parse )
-        EatByte(static_cast<unsigned char>(c));
+    const auto bytes = reinterpret_cast<const unsigned char *>(_to_parse.data());
+    const size_t size = _to_parse.size();
+    for( size_t pos = 0; pos != size; ) {
+        if( m_SubState == EscState::Text ) {
+            // swallow the whole run of text up to the next control character at once
+            if( const size_t text = FindControlByte(bytes + pos, size - pos); text != 0 ) {
+                ConsumeUTF8Text(bytes + pos, text);
+                pos += text;
+                continue;
+            }
+        }
+        EatByte(bytes[pos++]);
+    }
     FlushCompleteText();
 
     return std::move(m_Output);
@@ -68,22 +80,32 @@ void ParserImpl::SSTextExit() noexcept
     FlushAllText();
 }
 
-bool ParserImpl::SSTextConsume(unsigned char _byte) noexcept
+bool ParserImpl::SSTextConsume(unsigned char _byte)
 {
     const unsigned char c = _byte;
     if( c < 32 ) {
         SwitchTo(EscState::Control);
         return false;
     }
-    ConsumeNextUTF8TextChar(c);
+    ConsumeUTF8Text(&c, 1);
     return true;
 }
 
-void ParserImpl::ConsumeNextUTF8TextChar(unsigned char _byte)
+void ParserImpl::ConsumeUTF8Text(const unsigned char *_bytes, size_t _count)
 {
     auto &ts = m_TextState;
-    if( ts.UTF8StockLen < ts.UTF8CharsStockSize ) {
-        ts.UTF8CharsStock[ts.UTF8StockLen++] = static_cast<char>(_byte);
+    while( _count != 0 ) {
+        if( ts.UTF8StockLen == ts.UTF8CharsStockSize ) {
+            // the stock is full - pass the text further instead of dropping the input
+            FlushCompleteText();
+            if( ts.UTF8StockLen == ts.UTF8CharsStockSize )
+                FlushAllText();
+        }
+        const size_t chunk = std::min(_count, static_cast<size_t>(ts.UTF8CharsStockSize - ts.UTF8StockLen));
+        std::memcpy(ts.UTF8CharsStock.data() + ts.UTF8StockLen, _bytes, chunk);
+        ts.UTF8StockLen += static_cast<int>(chunk);
+        _bytes += chunk;
+        _count -= chunk;
     }
 }
 
@@ -1,4 +1,4 @@
-// Copyright (C) 2013-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <Utility/FontCache.h>
 #include <Utility/CharInfo.h>
 #include "Screen.h"
@@ -47,6 +47,32 @@ void Screen::PutCh(char32_t _char)
         m_LineOverflown = true;
     }
     m_Buffer.SetLineWrapped(m_PosY, false); // do we need it EVERY time?????
+    m_Buffer.MarkLineChanged(m_PosY);
+}
+
+size_t Screen::PutASCII(std::string_view _ascii)
+{
+    const std::span<ScreenBuffer::Space> line = m_Buffer.LineFromNo(m_PosY);
+    if( line.empty() || _ascii.empty() )
+        return _ascii.size();
+
+    const int line_len = static_cast<int>(line.size());
+    const size_t count = std::min(_ascii.size(), static_cast<size_t>(line_len - m_PosX));
+
+    Screen::Space sp = m_EraseChar;
+    Screen::Space *const chars = line.data() + m_PosX;
+    for( size_t i = 0; i != count; ++i ) {
+        sp.l = static_cast<unsigned char>(_ascii[i]);
+        chars[i] = sp;
+    }
+
+    m_PosX += static_cast<int>(count);
+    m_LineOverflown = m_PosX == line_len;
+    if( m_LineOverflown )
+        m_PosX = line_len - 1;
+    m_Buffer.SetLineWrapped(m_PosY, false);
+    m_Buffer.MarkLineChanged(m_PosY);
+    return count;
 }
 
 void Screen::PutWrap()
@@ -66,6 +92,7 @@ void Screen::DoEraseScreen(int _mode)
     if( _mode == 1 ) {
         for( int i = 0; i < Height(); ++i ) {
             auto l = m_Buffer.LineFromNo(i);
+            m_Buffer.MarkLineChanged(i);
             if( i != m_PosY )
                 std::fill(begin(l), end(l), m_EraseChar);
             else {
@@ -80,6 +107,7 @@ void Screen::DoEraseScreen(int _mode)
             auto l = m_Buffer.LineFromNo(i);
             std::fill(begin(l), end(l), m_EraseChar);
             m_Buffer.SetLineWrapped(i, false);
+            m_Buffer.MarkLineChanged(i);
         }
     }
     else {
@@ -88,6 +116,7 @@ void Screen::DoEraseScreen(int _mode)
             auto chars = m_Buffer.LineFromNo(i).data();
             for( int j = (i == m_PosY ? m_PosX : 0); j < Width(); ++j )
                 chars[j] = m_EraseChar;
+            m_Buffer.MarkLineChanged(i);
         }
     }
 }
@@ -145,6 +174,7 @@ void Screen::EraseInLine(int _mode)
     else if( _mode == 1 )
         e = std::min(i + m_PosX + 1, e);
     std::fill(i, e, m_EraseChar);
+    m_Buffer.MarkLineChanged(m_PosY);
 }
 
 void Screen::EraseInLineCount(unsigned _n)
@@ -155,6 +185,7 @@ void Screen::EraseInLineCount(unsigned _n)
     auto i = std::begin(line) + m_PosX;
     auto e = std::min(i + _n, std::end(line));
     std::fill(i, e, m_EraseChar);
+    m_Buffer.MarkLineChanged(m_PosY);
 }
 
 void Screen::FillScreenWithSpace(ScreenBuffer::Space _space)
@@ -165,6 +196,7 @@ void Screen::FillScreenWithSpace(ScreenBuffer::Space _space)
         for( auto &line_char : line ) {
             line_char = _space;
         }
+        m_Buffer.MarkLineChanged(y);
     }
 }
 
@@ -283,6 +315,7 @@ void Screen::DoShiftRowLeft(int _chars)
 
     for( int i = 0; i < _chars; ++i )
         chars[Width() - i - 1] = m_EraseChar; // why m_Width here???
+    m_Buffer.MarkLineChanged(m_PosY);
 }
 
 void Screen::DoShiftRowRight(int _chars)
@@ -299,6 +332,7 @@ void Screen::DoShiftRowRight(int _chars)
 
     for( int i = 0; i < _chars; ++i )
         chars[m_PosX + i] = m_EraseChar;
+    m_Buffer.MarkLineChanged(m_PosY);
 }
 
 void Screen::EraseAt(unsigned _x, unsigned _y, unsigned _count)
@@ -307,23 +341,16 @@ void Screen::EraseAt(unsigned _x, unsigned _y, unsigned _count)
         auto i = std::begin(line) + _x;
         auto e = std::min(i + _count, std::end(line));
         std::fill(i, e, m_EraseChar);
+        m_Buffer.MarkLineChanged(_y);
     }
 }
 
-void Screen::CopyLineChars(int _from, int _to)
-{
-    auto src = m_Buffer.LineFromNo(_from);
-    auto dst = m_Buffer.LineFromNo(_to);
-    if( !src.empty() && !dst.empty() )
-        std::copy_n(
-            begin(src), std::min(std::end(src) - std::begin(src), std::end(dst) - std::begin(dst)), std::begin(dst));
-}
-
 void Screen::ClearLine(int _ind)
 {
     if( auto line = m_Buffer.LineFromNo(_ind); !line.empty() ) {
         std::fill(std::begin(line), std::end(line), m_EraseChar);
         m_Buffer.SetLineWrapped(_ind, false);
+        m_Buffer.MarkLineChanged(_ind);
     }
 }
 
@@ -339,10 +366,9 @@ void Screen::ScrollDown(const unsigned _top, const unsigned _bottom, const unsig
     if( lines < 1 )
         return;
 
-    for( int n_dst = bottom - 1, n_src = bottom - 1 - lines; n_dst > top && n_src >= top; --n_dst, --n_src ) {
-        CopyLineChars(n_src, n_dst);
-        m_Buffer.SetLineWrapped(n_dst, m_Buffer.LineWrapped(n_src));
-    }
+    // move the lines instead of copying their characters, the ones which went off the region reappear at the top
+    if( lines < bottom - top )
+        m_Buffer.RotateLines(top, bottom - lines, bottom);
 
     for( int i = _top; i < std::min(top + lines, bottom); ++i )
         ClearLine(i);
@@ -368,10 +394,9 @@ void Screen::DoScrollUp(const unsigned _top, const unsigned _bottom, const unsig
             m_Buffer.FeedBackscreen(line.data(), line.data() + line.size(), m_Buffer.LineWrapped(i));
         }
 
-    for( int n_src = top + lines, n_dst = top; n_src < bottom && n_dst < bottom; ++n_src, ++n_dst ) {
-        CopyLineChars(n_src, n_dst);
-        m_Buffer.SetLineWrapped(n_dst, m_Buffer.LineWrapped(n_src));
-    }
+    // move the lines instead of copying their characters, the ones which went off the region reappear at the bottom
+    if( lines < bottom - top )
+        m_Buffer.RotateLines(top, top + lines, bottom);
 
     for( int i = bottom - 1; i >= std::max(bottom - lines, top); --i )
         ClearLine(i);
@@ -1,5 +1,6 @@
 // Copyright (C) 2015-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "ScreenBuffer.h"
+#include "Scrollback.h"
 #include <CoreFoundation/CoreFoundation.h>
 
 namespace nc::term {
@@ -9,11 +10,48 @@ static_assert(sizeof(ScreenBuffer::Space) == 8);
 static void Append(CFStringRef _what, std::u32string &_where);
 
 ScreenBuffer::ScreenBuffer(unsigned _width, unsigned _height, ExtendedCharRegistry &_reg)
-    : m_Width(_width), m_Height(_height), m_Registry(_reg)
+    : m_Width(_width), m_Height(_height), m_Registry(_reg), m_BackScreen(std::make_unique<Scrollback>())
 {
     m_OnScreenSpaces = ProduceRectangularSpaces(m_Width, m_Height);
     m_OnScreenLines.resize(m_Height);
     FixupOnScreenLinesIndeces(begin(m_OnScreenLines), end(m_OnScreenLines), m_Width);
+    MarkAllLinesChanged();
+}
+
+ScreenBuffer::~ScreenBuffer() = default;
+
+unsigned ScreenBuffer::BackScreenLines() const noexcept
+{
+    return static_cast<unsigned>(m_BackScreen->Size());
+}
+
+void ScreenBuffer::SetBackScreenLimits(BackScreenLimits _limits)
+{
+    Scrollback::Limits limits;
+    limits.max_lines = _limits.max_lines != 0 ? _limits.max_lines : std::numeric_limits<size_t>::max();
+    limits.max_bytes = _limits.max_bytes != 0 ? _limits.max_bytes : std::numeric_limits<size_t>::max();
+    m_BackScreen->SetLimits(limits);
+}
+
+size_t ScreenBuffer::BackScreenBytes() const noexcept
+{
+    return m_BackScreen->Bytes();
+}
+
+size_t ScreenBuffer::BackScreenDroppedLines() const noexcept
+{
+    return m_BackScreen->Dropped();
+}
+
+uint64_t ScreenBuffer::LayoutGeneration() const noexcept
+{
+    return m_LayoutGeneration;
+}
+
+size_t ScreenBuffer::BackScreenIndex(int _line_number) const noexcept
+{
+    assert(_line_number < 0);
+    return static_cast<size_t>(static_cast<long>(m_BackScreen->Size()) + _line_number);
 }
 
 std::unique_ptr<ScreenBuffer::Space[]> ScreenBuffer::ProduceRectangularSpaces(unsigned _width, unsigned _height)
@@ -40,8 +78,10 @@ void ScreenBuffer::FixupOnScreenLinesIndeces(std::vector<LineMeta>::iterator _i,
     }
 }
 
-std::span<const ScreenBuffer::Space> ScreenBuffer::LineFromNo(int _line_number) const noexcept
+std::span<const ScreenBuffer::Space> ScreenBuffer::LineFromNo(int _line_number) const
 {
+    if( _line_number < 0 && -_line_number <= static_cast<int>(BackScreenLines()) )
+        return m_BackScreen->Line(BackScreenIndex(_line_number)); // points into the cache of the expanded lines
     return const_cast<ScreenBuffer *>(this)->LineFromNo(_line_number);
 }
 
@@ -52,12 +92,6 @@ std::span<ScreenBuffer::Space> ScreenBuffer::LineFromNo(int _line_number) noexce
         assert(l.start_index + l.line_length <= m_Height * m_Width);
         return {&m_OnScreenSpaces[l.start_index], l.line_length};
     }
-    else if( _line_number < 0 && -_line_number <= static_cast<int>(m_BackScreenLines.size()) ) {
-        unsigned ind = unsigned(static_cast<int>(m_BackScreenLines.size()) + _line_number);
-        auto &l = m_BackScreenLines[ind];
-        assert(l.start_index + l.line_length <= m_BackScreenSpaces.size());
-        return {&m_BackScreenSpaces[l.start_index], l.line_length};
-    }
     else
         return {};
 }
@@ -76,10 +110,6 @@ ScreenBuffer::LineMeta *ScreenBuffer::MetaFromLineNo(int _line_number)
 {
     if( _line_number >= 0 && _line_number < static_cast<int>(m_OnScreenLines.size()) )
         return &m_OnScreenLines[_line_number];
-    else if( _line_number < 0 && -_line_number <= static_cast<int>(m_BackScreenLines.size()) ) {
-        unsigned ind = unsigned(static_cast<signed>(m_BackScreenLines.size()) + _line_number);
-        return &m_BackScreenLines[ind];
-    }
     else
         return nullptr;
 }
@@ -88,10 +118,6 @@ const ScreenBuffer::LineMeta *ScreenBuffer::MetaFromLineNo(int _line_number) con
 {
     if( _line_number >= 0 && _line_number < static_cast<int>(m_OnScreenLines.size()) )
         return &m_OnScreenLines[_line_number];
-    else if( _line_number < 0 && -_line_number <= static_cast<int>(m_BackScreenLines.size()) ) {
-        unsigned ind = unsigned(static_cast<signed>(m_BackScreenLines.size()) + _line_number);
-        return &m_BackScreenLines[ind];
-    }
     else
         return nullptr;
 }
@@ -221,9 +247,9 @@ std::string ScreenBuffer::DumpScreenAsANSI() const
 std::string ScreenBuffer::DumpBackScreenAsANSI() const
 {
     std::string result;
-    for( auto &l : m_BackScreenLines )
-        for( auto *i = &m_BackScreenSpaces[l.start_index], *e = i + l.line_length; i != e; ++i )
-            result += ((i->l >= 32 && i->l <= 127) ? static_cast<char>(i->l) : ' ');
+    for( size_t line = 0, lines = m_BackScreen->Size(); line != lines; ++line )
+        for( const Space &sp : m_BackScreen->Line(line) )
+            result += ((sp.l >= 32 && sp.l <= 127) ? static_cast<char>(sp.l) : ' ');
     return result;
 }
 
@@ -269,6 +295,7 @@ std::u32string ScreenBuffer::DumpScreenAsUTF32(const int _opts) const
 
 void ScreenBuffer::LoadScreenFromANSI(std::string_view _dump)
 {
+    MarkAllLinesChanged();
     for( auto &l : m_OnScreenLines ) {
         for( auto i = &m_OnScreenSpaces[l.start_index], e = i + l.line_length; i != e; ++i ) {
             if( _dump.empty() )
@@ -281,6 +308,9 @@ void ScreenBuffer::LoadScreenFromANSI(std::string_view _dump)
 
 bool ScreenBuffer::LineWrapped(int _line_number) const
 {
+    if( _line_number < 0 )
+        return -_line_number <= static_cast<int>(BackScreenLines()) &&
+               m_BackScreen->Wrapped(BackScreenIndex(_line_number));
     if( auto l = MetaFromLineNo(_line_number) )
         return l->is_wrapped;
     return false;
@@ -288,8 +318,43 @@ bool ScreenBuffer::LineWrapped(int _line_number) const
 
 void ScreenBuffer::SetLineWrapped(int _line_number, bool _wrapped)
 {
-    if( auto l = MetaFromLineNo(_line_number) )
+    if( _line_number < 0 ) {
+        if( -_line_number <= static_cast<int>(BackScreenLines()) )
+            m_BackScreen->SetWrapped(BackScreenIndex(_line_number), _wrapped);
+        return;
+    }
+    if( auto l = MetaFromLineNo(_line_number); l && l->is_wrapped != _wrapped ) {
         l->is_wrapped = _wrapped;
+        l->generation = ++m_LinesGeneration;
+    }
+}
+
+void ScreenBuffer::RotateLines(int _first, int _middle, int _last)
+{
+    if( _first < 0 || _first > _middle || _middle > _last || _last > static_cast<int>(m_OnScreenLines.size()) )
+        return;
+    std::rotate(std::next(m_OnScreenLines.begin(), _first),
+                std::next(m_OnScreenLines.begin(), _middle),
+                std::next(m_OnScreenLines.begin(), _last));
+}
+
+uint64_t ScreenBuffer::LineGeneration(int _line_number) const noexcept
+{
+    if( auto l = MetaFromLineNo(_line_number) )
+        return l->generation;
+    return 0;
+}
+
+void ScreenBuffer::MarkLineChanged(int _line_number) noexcept
+{
+    if( auto l = MetaFromLineNo(_line_number) )
+        l->generation = ++m_LinesGeneration;
+}
+
+void ScreenBuffer::MarkAllLinesChanged() noexcept
+{
+    for( auto &l : m_OnScreenLines )
+        l.generation = ++m_LinesGeneration;
 }
 
 ScreenBuffer::Space ScreenBuffer::EraseChar() const
@@ -326,43 +391,50 @@ void ScreenBuffer::ResizeScreen(unsigned _new_sx, unsigned _new_sy, bool _merge_
         }
     };
     auto fill_bkscr_from_declines = [this](ConstIt _i, ConstIt _e) {
-        for( ; _i != _e; ++_i ) {
-            LineMeta lm;
-            lm.start_index = static_cast<int>(m_BackScreenSpaces.size());
-            lm.line_length = static_cast<int>(std::get<0>(*_i).size());
-            lm.is_wrapped = std::get<1>(*_i);
-            m_BackScreenLines.emplace_back(lm);
-            m_BackScreenSpaces.insert(
-                std::end(m_BackScreenSpaces), std::begin(std::get<0>(*_i)), std::end(std::get<0>(*_i)));
-        }
+        for( ; _i != _e; ++_i )
+            m_BackScreen->Append(std::get<0>(*_i), std::get<1>(*_i));
     };
 
+    // only the backscreen pages which do need it are re-laid out, and nothing is if the width stays the same
+    auto unfinished = _new_sx != m_Width ? m_BackScreen->Rewrap(_new_sx) : std::nullopt;
+
     if( _merge_with_backscreen ) {
-        auto comp_lines = ComposeContinuousLines(-BackScreenLines(), Height());
+        // the newest backscreen line continues onto the screen if it was wrapped
+        auto comp_lines = ComposeContinuousLines(0, Height());
+        if( unfinished ) {
+            if( comp_lines.empty() )
+                comp_lines.emplace_back();
+            comp_lines.front().insert(comp_lines.front().begin(), unfinished->begin(), unfinished->end());
+        }
         auto decomp_lines = DecomposeContinuousLines(comp_lines, _new_sx);
 
-        m_BackScreenLines.clear();
-        m_BackScreenSpaces.clear();
         if( decomp_lines.size() > _new_sy ) {
             fill_bkscr_from_declines(begin(decomp_lines), end(decomp_lines) - _new_sy);
-
-            m_OnScreenSpaces = ProduceRectangularSpaces(_new_sx, _new_sy, m_EraseChar);
-            m_OnScreenLines.resize(_new_sy);
-            FixupOnScreenLinesIndeces(begin(m_OnScreenLines), end(m_OnScreenLines), _new_sx);
-            fill_scr_from_declines(end(decomp_lines) - _new_sy, end(decomp_lines));
+            decomp_lines.erase(begin(decomp_lines), end(decomp_lines) - _new_sy);
         }
         else {
-            m_OnScreenSpaces = ProduceRectangularSpaces(_new_sx, _new_sy, m_EraseChar);
-            m_OnScreenLines.resize(_new_sy);
-            FixupOnScreenLinesIndeces(begin(m_OnScreenLines), end(m_OnScreenLines), _new_sx);
-            fill_scr_from_declines(begin(decomp_lines), end(decomp_lines));
+            // the screen has grown - the newest backscreen lines are moved back onto it
+            while( decomp_lines.size() < _new_sy && BackScreenLines() != 0 ) {
+                const auto line = m_BackScreen->Line(BackScreenLines() - 1);
+                const bool wrapped = m_BackScreen->Wrapped(BackScreenLines() - 1);
+                decomp_lines.emplace(begin(decomp_lines), std::vector<Space>(line.begin(), line.end()), wrapped);
+                m_BackScreen->PopBack();
+            }
         }
+
+        m_OnScreenSpaces = ProduceRectangularSpaces(_new_sx, _new_sy, m_EraseChar);
+        m_OnScreenLines.resize(_new_sy);
+        FixupOnScreenLinesIndeces(begin(m_OnScreenLines), end(m_OnScreenLines), _new_sx);
+        fill_scr_from_declines(begin(decomp_lines), end(decomp_lines));
     }
     else {
-        auto bkscr_decomp_lines = DecomposeContinuousLines(ComposeContinuousLines(-BackScreenLines(), 0), _new_sx);
-        m_BackScreenLines.clear();
-        m_BackScreenSpaces.clear();
-        fill_bkscr_from_declines(begin(bkscr_decomp_lines), end(bkscr_decomp_lines));
+        if( unfinished ) {
+            auto bkscr_decomp_lines = DecomposeContinuousLines({std::move(*unfinished)}, _new_sx);
+            fill_bkscr_from_declines(begin(bkscr_decomp_lines), end(bkscr_decomp_lines));
+        }
+        else if( BackScreenLines() != 0 ) {
+            m_BackScreen->SetWrapped(BackScreenLines() - 1, false); // the screen is laid out on its own
+        }
 
         auto onscr_decomp_lines = DecomposeContinuousLines(ComposeContinuousLines(0, Height()), _new_sx);
         m_OnScreenSpaces = ProduceRectangularSpaces(_new_sx, _new_sy, m_EraseChar);
@@ -374,6 +446,8 @@ void ScreenBuffer::ResizeScreen(unsigned _new_sx, unsigned _new_sy, bool _merge_
 
     m_Width = _new_sx;
     m_Height = _new_sy;
+    ++m_LayoutGeneration;
+    MarkAllLinesChanged();
 }
 
 void ScreenBuffer::FeedBackscreen(const Space *_from, const Space *_to, bool _wrapped)
@@ -382,11 +456,7 @@ void ScreenBuffer::FeedBackscreen(const Space *_from, const Space *_to, bool _wr
     while( _from < _to ) {
         unsigned line_len = std::min(m_Width, unsigned(_to - _from));
 
-        m_BackScreenLines.emplace_back();
-        m_BackScreenLines.back().start_index = static_cast<unsigned>(m_BackScreenSpaces.size());
-        m_BackScreenLines.back().line_length = line_len;
-        m_BackScreenLines.back().is_wrapped = _wrapped ? true : (m_Width < _to - _from);
-        m_BackScreenSpaces.insert(std::end(m_BackScreenSpaces), _from, _from + line_len);
+        m_BackScreen->Append(std::span<const Space>(_from, line_len), _wrapped ? true : (m_Width < _to - _from));
 
         _from += line_len;
     }
@@ -503,24 +573,29 @@ ScreenBuffer::Snapshot::Snapshot(unsigned _w, unsigned _h)
 
 ScreenBuffer::Snapshot ScreenBuffer::MakeSnapshot() const
 {
+    // the onscreen lines can be stored in any order, the snapshot keeps them in the order of appearance
     Snapshot snapshot(m_Width, m_Height);
-    std::copy_n(m_OnScreenSpaces.get(), m_Width * m_Height, snapshot.chars.get());
+    for( unsigned y = 0; y != m_Height; ++y )
+        std::copy_n(&m_OnScreenSpaces[m_OnScreenLines[y].start_index], m_Width, snapshot.chars.get() + y * m_Width);
     return snapshot;
 }
 
 void ScreenBuffer::RevertToSnapshot(const Snapshot &_snapshot)
 {
     if( m_Height == _snapshot.height && m_Width == _snapshot.width ) {
-        std::copy_n(_snapshot.chars.get(), m_Width * m_Height, m_OnScreenSpaces.get());
+        for( unsigned y = 0; y != m_Height; ++y )
+            std::copy_n(
+                _snapshot.chars.get() + y * m_Width, m_Width, &m_OnScreenSpaces[m_OnScreenLines[y].start_index]);
     }
     else { // TODO: anchor?
         std::fill_n(m_OnScreenSpaces.get(), m_Width * m_Height, m_EraseChar);
         for( int y = 0, e = std::min(_snapshot.height, m_Height); y != e; ++y ) {
             std::copy_n(_snapshot.chars.get() + y * _snapshot.width,
                         std::min(_snapshot.width, m_Width),
-                        m_OnScreenSpaces.get() + y * m_Width);
+                        &m_OnScreenSpaces[m_OnScreenLines[y].start_index]);
         }
     }
+    MarkAllLinesChanged();
 }
 
 std::optional<std::pair<int, int>> ScreenBuffer::OccupiedOnScreenLines() const
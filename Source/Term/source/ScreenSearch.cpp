@@ -0,0 +1,503 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "ScreenSearch.h"
+#include "Screen.h"
+#include <Utility/Encodings.h>
+#include <re2/re2.h>
+#include <algorithm>
+
+namespace nc::term {
+
+class ScreenSearch::Query
+{
+public:
+    Query(const std::string &_pattern, const re2::RE2::Options &_options) : re(_pattern, _options) {}
+    re2::RE2 re;
+};
+
+// The text of a range of lines as UTF-8 with the logical lines separated by '\n', along with the way back from the
+// offsets in the text to the screen spaces.
+struct ScreenSearch::Chunk {
+    Region region = Region::OnScreen;
+    uint64_t generation = 0;
+    std::shared_ptr<const Query> query;
+    uint64_t first = 0; // [first, last) lines
+    uint64_t last = 0;
+    std::string text;
+
+    void AddLine(std::span<const ScreenBuffer::Space> _line,
+                 uint64_t _position,
+                 bool _wrapped,
+                 const ExtendedCharRegistry &_registry);
+
+    // Position of the screen space which the byte at _offset belongs to
+    Position Begin(size_t _offset) const noexcept;
+
+    // Position right after the screen space which the byte at _offset belongs to
+    Position End(size_t _offset) const noexcept;
+
+private:
+    struct Row {
+        size_t offset = 0;
+        uint64_t line = 0;
+        bool ascii = true; // each space is exactly one byte, the cells are not stored
+        size_t cells_begin = 0;
+        size_t cells_end = 0;
+    };
+
+    struct Cell {
+        size_t offset = 0;
+        int x = 0;
+        int width = 1;
+    };
+
+    std::pair<const Row *, Cell> Locate(size_t _offset) const noexcept;
+
+    std::vector<Row> m_Rows;
+    std::vector<Cell> m_Cells;
+};
+
+static void AppendUTF8(std::string &_text, char32_t _c)
+{
+    const uint32_t c = _c;
+    const size_t size = _text.size();
+    _text.resize(size + 5); // up to 4 bytes and a null-terminator
+    size_t written = 0;
+    InterpretUnicodeAsUTF8(&c, 1, reinterpret_cast<unsigned char *>(_text.data() + size), 5, written, nullptr);
+    _text.resize(size + written);
+}
+
+static void AppendUTF8(std::string &_text, std::u16string_view _utf16)
+{
+    const size_t size = _text.size();
+    const size_t capacity = _utf16.size() * 3 + 1; // up to 3 bytes per UTF-16 unit and a null-terminator
+    _text.resize(size + capacity);
+    size_t written = 0;
+    InterpretUnicharsAsUTF8(reinterpret_cast<const uint16_t *>(_utf16.data()),
+                            _utf16.size(),
+                            reinterpret_cast<unsigned char *>(_text.data() + size),
+                            capacity,
+                            written,
+                            nullptr);
+    _text.resize(size + written);
+}
+
+void ScreenSearch::Chunk::AddLine(std::span<const ScreenBuffer::Space> _line,
+                                  uint64_t _position,
+                                  bool _wrapped,
+                                  const ExtendedCharRegistry &_registry)
+{
+    Row row;
+    row.offset = text.size();
+    row.line = _position;
+    row.cells_begin = row.cells_end = m_Cells.size();
+
+    // most of the lines are plain ASCII, those are stored without a per-space layout
+    const size_t occupied = ScreenBuffer::OccupiedChars(_line);
+    text.resize(row.offset + occupied);
+    char *const ascii = text.data() + row.offset;
+    size_t x = 0;
+    for( ; x < occupied && _line[x].l < 0x80; ++x )
+        ascii[x] = _line[x].l != 0 ? static_cast<char>(_line[x].l) : ' ';
+
+    if( x < occupied ) {
+        text.resize(row.offset);
+        row.ascii = false;
+        for( x = 0; x < occupied; ++x ) {
+            const char32_t c = _line[x].l;
+            if( c == ScreenBuffer::MultiCellGlyph )
+                continue;
+            const bool wide = x + 1 < _line.size() && _line[x + 1].l == ScreenBuffer::MultiCellGlyph;
+            m_Cells.push_back({text.size(), static_cast<int>(x), wide ? 2 : 1});
+            if( c == 0 )
+                text.push_back(' ');
+            else if( ExtendedCharRegistry::IsBase(c) )
+                AppendUTF8(text, c);
+            else
+                AppendUTF8(text, _registry.DecodeUTF16(c));
+        }
+        row.cells_end = m_Cells.size();
+    }
+
+    if( !_wrapped )
+        text.push_back('\n');
+    m_Rows.push_back(row);
+}
+
+std::pair<const ScreenSearch::Chunk::Row *, ScreenSearch::Chunk::Cell>
+ScreenSearch::Chunk::Locate(size_t _offset) const noexcept
+{
+    assert(!m_Rows.empty());
+    const auto row = std::prev(std::upper_bound(
+        m_Rows.begin(), m_Rows.end(), _offset, [](size_t _o, const Row &_row) { return _o < _row.offset; }));
+    if( row->ascii || row->cells_begin == row->cells_end )
+        return {&*row, Cell{_offset, static_cast<int>(_offset - row->offset), 1}};
+
+    const auto cells_begin = std::next(m_Cells.begin(), row->cells_begin);
+    const auto cells_end = std::next(m_Cells.begin(), row->cells_end);
+    const auto cell = std::upper_bound(
+        cells_begin, cells_end, _offset, [](size_t _o, const Cell &_cell) { return _o < _cell.offset; });
+    return {&*row, *std::prev(cell)};
+}
+
+ScreenSearch::Position ScreenSearch::Chunk::Begin(size_t _offset) const noexcept
+{
+    const auto [row, cell] = Locate(_offset);
+    return {row->line, cell.x};
+}
+
+ScreenSearch::Position ScreenSearch::Chunk::End(size_t _offset) const noexcept
+{
+    const auto [row, cell] = Locate(_offset);
+    return {row->line, cell.x + cell.width};
+}
+
+std::shared_ptr<const ScreenSearch::Query> ScreenSearch::Compile(std::string_view _text, Options _options)
+{
+    if( _text.empty() )
+        return nullptr;
+
+    re2::RE2::Options options;
+    options.set_case_sensitive(_options.case_sensitive);
+    options.set_literal(!_options.regex);
+    options.set_never_nl(true); // the logical lines are separated by newlines, a match can't go over them
+    options.set_log_errors(false);
+    // let ^ and $ match at the beginning and the end of each line
+    auto query = std::make_shared<Query>(_options.regex ? "(?m)" + std::string(_text) : std::string(_text), options);
+    if( !query->re.ok() )
+        return nullptr;
+    return query;
+}
+
+std::vector<ScreenSearch::Found> ScreenSearch::FindInChunk(const Chunk &_chunk, const Query &_query)
+{
+    std::vector<Found> found;
+    const std::string_view text = _chunk.text;
+    const re2::StringPiece piece(text.data(), text.size());
+    size_t pos = 0;
+    while( pos < text.size() ) {
+        re2::StringPiece match;
+        if( !_query.re.Match(piece, pos, text.size(), re2::RE2::UNANCHORED, &match, 1) )
+            break;
+        const auto offset = static_cast<size_t>(match.data() - text.data());
+        if( match.empty() ) {
+            pos = offset + 1; // skip empty matches
+            continue;
+        }
+        found.push_back({_chunk.Begin(offset), _chunk.End(offset + match.size() - 1)});
+        pos = offset + match.size();
+    }
+    return found;
+}
+
+ScreenSearch::Match ScreenSearch::ToMatch(const Found &_found, uint64_t _origin) noexcept
+{
+    const auto number = [_origin](uint64_t _line) {
+        return static_cast<int>(static_cast<int64_t>(_line) - static_cast<int64_t>(_origin));
+    };
+    return {{_found.begin.x, number(_found.begin.line)}, {_found.end.x, number(_found.end.line)}};
+}
+
+std::vector<ScreenSearch::Match>
+ScreenSearch::Find(const ScreenBuffer &_buffer, const Query &_query, int _first_line, int _last_line)
+{
+    const int height = static_cast<int>(_buffer.Height());
+    const int top = -static_cast<int>(_buffer.BackScreenLines());
+    int first = std::max(_first_line, top);
+    int last = std::min(_last_line, height);
+    if( first >= last )
+        return {};
+    while( first > top && _buffer.LineWrapped(first - 1) )
+        --first; // take the beginning of the first logical line
+    while( last < height && _buffer.LineWrapped(last - 1) )
+        ++last; // take the rest of the last logical line
+
+    const uint64_t origin = _buffer.BackScreenDroppedLines() + _buffer.BackScreenLines();
+    Chunk chunk;
+    for( int y = first; y < last; ++y )
+        chunk.AddLine(_buffer.LineFromNo(y),
+                      static_cast<uint64_t>(static_cast<int64_t>(origin) + y),
+                      _buffer.LineWrapped(y),
+                      _buffer.Registry());
+
+    const auto found = FindInChunk(chunk, _query);
+    std::vector<Match> matches;
+    matches.reserve(found.size());
+    for( const Found &f : found )
+        matches.push_back(ToMatch(f, origin));
+    return matches;
+}
+
+ScreenSearch::ScreenSearch(Screen &_screen) : m_Screen(_screen)
+{
+}
+
+ScreenSearch::~ScreenSearch()
+{
+    m_Queue.Stop();
+    m_Queue.Wait();
+}
+
+void ScreenSearch::SetQuery(std::shared_ptr<const Query> _query)
+{
+    {
+        const std::lock_guard lock{m_Lock};
+        m_Query = std::move(_query);
+        ++m_Generation;
+        m_Started = false;
+        m_Found = {};
+        m_FoundOnScreen = {};
+    }
+    Schedule();
+}
+
+void ScreenSearch::Update()
+{
+    {
+        const std::lock_guard lock{m_Lock};
+        if( !m_Query )
+            return;
+        m_OnScreenDirty = true;
+    }
+    Schedule();
+}
+
+void ScreenSearch::SetOnChanged(std::function<void()> _on_changed)
+{
+    const std::lock_guard lock{m_Lock};
+    m_OnChanged = std::move(_on_changed);
+}
+
+bool ScreenSearch::InProgress() const
+{
+    return !m_Queue.Empty();
+}
+
+void ScreenSearch::Wait()
+{
+    m_Queue.Wait();
+}
+
+void ScreenSearch::Schedule()
+{
+    if( m_Scheduled.exchange(true) == false )
+        m_Queue.Run([this] { Work(); });
+}
+
+void ScreenSearch::Work()
+{
+    // an update which comes from now on will be picked up by another run
+    m_Scheduled = false;
+
+    while( !m_Queue.IsStopped() ) {
+        const auto chunk = ExtractNextChunk();
+        if( !chunk )
+            return;
+        Merge(*chunk, FindInChunk(*chunk, *chunk->query));
+    }
+}
+
+std::optional<ScreenSearch::Chunk> ScreenSearch::ExtractNextChunk()
+{
+    const auto screen_lock = m_Screen.AcquireLock();
+    const ScreenBuffer &buffer = m_Screen.Buffer();
+    const std::lock_guard lock{m_Lock};
+    if( !m_Query )
+        return std::nullopt;
+
+    const uint64_t dropped = buffer.BackScreenDroppedLines();
+    const uint64_t origin = dropped + buffer.BackScreenLines();
+    const uint64_t end = origin + buffer.Height();
+    const auto number = [origin](uint64_t _line) {
+        return static_cast<int>(static_cast<int64_t>(_line) - static_cast<int64_t>(origin));
+    };
+    const auto wrapped = [&](uint64_t _line) { return buffer.LineWrapped(number(_line)); };
+
+    if( !m_Started || m_LayoutGeneration != buffer.LayoutGeneration() ) {
+        // all positions are new, start from the onscreen lines
+        if( m_Started )
+            ++m_Generation;
+        m_Started = true;
+        m_LayoutGeneration = buffer.LayoutGeneration();
+        m_Found = {};
+        m_FoundOnScreen = {};
+        m_Settled = origin;
+        while( m_Settled > dropped && wrapped(m_Settled - 1) )
+            --m_Settled;
+        m_Scanned = {m_Settled, m_Settled};
+        m_OnScreenDirty = true;
+    }
+
+    // the lines beyond the backscreen limits are gone for good
+    m_Scanned.first = std::max(m_Scanned.first, dropped);
+    m_Scanned.second = std::max(m_Scanned.second, dropped);
+    while( !m_Found.empty() && m_Found.front().begin.line < dropped )
+        m_Found.pop_front();
+
+    // a logical line is settled once it's entirely in the backscreen
+    m_Settled = origin;
+    while( m_Settled > m_Scanned.second && wrapped(m_Settled - 1) )
+        --m_Settled;
+
+    Chunk chunk;
+    chunk.generation = m_Generation;
+    chunk.query = m_Query;
+    if( m_OnScreenDirty ) {
+        m_OnScreenDirty = false;
+        chunk.region = Region::OnScreen;
+        chunk.first = m_Settled;
+        chunk.last = end;
+    }
+    else if( m_Scanned.second < m_Settled ) {
+        chunk.region = Region::Newest;
+        chunk.first = m_Scanned.second;
+        chunk.last = std::min(m_Settled, chunk.first + ChunkLines);
+        while( chunk.last < m_Settled && wrapped(chunk.last - 1) )
+            ++chunk.last;
+    }
+    else if( m_Scanned.first > dropped ) {
+        chunk.region = Region::Oldest;
+        chunk.last = m_Scanned.first;
+        chunk.first = std::max(dropped, chunk.last - std::min<uint64_t>(chunk.last, ChunkLines));
+        while( chunk.first > dropped && wrapped(chunk.first - 1) )
+            --chunk.first;
+    }
+    else {
+        return std::nullopt;
+    }
+
+    for( uint64_t line = chunk.first; line < chunk.last; ++line )
+        chunk.AddLine(buffer.LineFromNo(number(line)), line, wrapped(line), buffer.Registry());
+    return chunk;
+}
+
+void ScreenSearch::Merge(const Chunk &_chunk, std::vector<Found> _found)
+{
+    std::function<void()> on_changed;
+    {
+        const std::lock_guard lock{m_Lock};
+        if( _chunk.generation != m_Generation )
+            return; // the query or the layout has changed meanwhile
+
+        bool changed = !_found.empty();
+        switch( _chunk.region ) {
+            case Region::OnScreen:
+                changed = !std::equal(_found.begin(),
+                                      _found.end(),
+                                      m_FoundOnScreen.begin(),
+                                      m_FoundOnScreen.end(),
+                                      [](const Found &_lhs, const Found &_rhs) {
+                                          return _lhs.begin == _rhs.begin && _lhs.end == _rhs.end;
+                                      });
+                m_FoundOnScreen = std::move(_found);
+                break;
+            case Region::Newest:
+                m_Found.insert(m_Found.end(), _found.begin(), _found.end());
+                m_Scanned.second = _chunk.last;
+                break;
+            case Region::Oldest:
+                m_Found.insert(m_Found.begin(), _found.begin(), _found.end());
+                m_Scanned.first = _chunk.first;
+                break;
+        }
+        if( changed )
+            on_changed = m_OnChanged;
+    }
+    if( on_changed )
+        on_changed();
+}
+
+uint64_t ScreenSearch::Origin() const noexcept
+{
+    const ScreenBuffer &buffer = m_Screen.Buffer();
+    return buffer.BackScreenDroppedLines() + buffer.BackScreenLines();
+}
+
+std::vector<ScreenSearch::Found>::const_iterator ScreenSearch::FoundOnScreenBegin() const noexcept
+{
+    // the lines which were looked through once and for all since then are already in m_Found
+    return std::partition_point(m_FoundOnScreen.begin(), m_FoundOnScreen.end(), [this](const Found &_found) {
+        return _found.begin.line < m_Scanned.second;
+    });
+}
+
+size_t ScreenSearch::Count() const
+{
+    const std::lock_guard lock{m_Lock};
+    return m_Found.size() + static_cast<size_t>(std::distance(FoundOnScreenBegin(), m_FoundOnScreen.end()));
+}
+
+std::vector<ScreenSearch::Match> ScreenSearch::Matches(int _first_line, int _last_line) const
+{
+    const ScreenBuffer &buffer = m_Screen.Buffer();
+    const uint64_t origin = Origin();
+    const std::lock_guard lock{m_Lock};
+    if( !m_Started || m_LayoutGeneration != buffer.LayoutGeneration() || _first_line >= _last_line )
+        return {};
+
+    const auto position = [origin](int _line) {
+        return static_cast<uint64_t>(std::max(static_cast<int64_t>(origin) + _line, int64_t(0)));
+    };
+    const uint64_t first = std::max(position(_first_line), uint64_t(buffer.BackScreenDroppedLines()));
+    const uint64_t last = position(_last_line);
+
+    std::vector<Match> matches;
+    const auto collect = [&](auto _begin, auto _end) {
+        // the matches don't overlap, so their ends are in the same order as their beginnings
+        auto it = std::partition_point(_begin, _end, [first](const Found &_found) { return _found.end.line < first; });
+        for( ; it != _end && it->begin.line < last; ++it )
+            matches.push_back(ToMatch(*it, origin));
+    };
+    collect(m_Found.begin(), m_Found.end());
+    collect(FoundOnScreenBegin(), m_FoundOnScreen.end());
+    return matches;
+}
+
+std::optional<ScreenSearch::Match> ScreenSearch::Next(ScreenPoint _point) const
+{
+    const ScreenBuffer &buffer = m_Screen.Buffer();
+    const uint64_t origin = Origin();
+    const std::lock_guard lock{m_Lock};
+    if( !m_Started || m_LayoutGeneration != buffer.LayoutGeneration() )
+        return std::nullopt;
+
+    const int64_t line = static_cast<int64_t>(origin) + _point.y;
+    const Position point = line >= 0 ? Position{static_cast<uint64_t>(line), _point.x} : Position{0, -1};
+    const auto after = [&point](const Found &_found) { return _found.begin <= point; };
+    const auto dropped = buffer.BackScreenDroppedLines();
+    if( auto it = std::partition_point(m_Found.begin(), m_Found.end(), after); it != m_Found.end() ) {
+        while( it != m_Found.end() && it->begin.line < dropped )
+            ++it;
+        if( it != m_Found.end() )
+            return ToMatch(*it, origin);
+    }
+    if( auto it = std::partition_point(FoundOnScreenBegin(), m_FoundOnScreen.end(), after);
+        it != m_FoundOnScreen.end() )
+        return ToMatch(*it, origin);
+    return std::nullopt;
+}
+
+std::optional<ScreenSearch::Match> ScreenSearch::Previous(ScreenPoint _point) const
+{
+    const ScreenBuffer &buffer = m_Screen.Buffer();
+    const uint64_t origin = Origin();
+    const std::lock_guard lock{m_Lock};
+    if( !m_Started || m_LayoutGeneration != buffer.LayoutGeneration() )
+        return std::nullopt;
+
+    const int64_t line = static_cast<int64_t>(origin) + _point.y;
+    if( line < 0 )
+        return std::nullopt;
+
+    const Position point{static_cast<uint64_t>(line), _point.x};
+    const auto before = [&point](const Found &_found) { return _found.begin < point; };
+    const auto onscreen_begin = FoundOnScreenBegin();
+    if( auto it = std::partition_point(onscreen_begin, m_FoundOnScreen.end(), before); it != onscreen_begin )
+        return ToMatch(*std::prev(it), origin);
+    if( auto it = std::partition_point(m_Found.begin(), m_Found.end(), before); it != m_Found.begin() ) {
+        if( std::prev(it)->begin.line >= buffer.BackScreenDroppedLines() )
+            return ToMatch(*std::prev(it), origin);
+    }
+    return std::nullopt;
+}
+
+} // namespace nc::term
@@ -54,6 +54,10 @@ static const NSEdgeInsets g_Insets = {2., 5., 2., 5.};
 
         m_Screen = std::make_unique<term::Screen>(floor(rc.size.width / m_View.charWidth),
                                                   floor(rc.size.height / m_View.charHeight));
+        term::ScreenBuffer::BackScreenLimits backscreen_limits;
+        backscreen_limits.max_lines = std::max(m_Settings->ScrollbackMaxLines(), 0);
+        backscreen_limits.max_bytes = size_t(std::max(m_Settings->ScrollbackMaxMegabytes(), 0)) * 1024 * 1024;
+        m_Screen->Buffer().SetBackScreenLimits(backscreen_limits);
 
         [m_View AttachToScreen:m_Screen.get()];
 
@@ -0,0 +1,471 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Scrollback.h"
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <iterator>
+
+namespace nc::term {
+
+// A compressed page is laid out as follows:
+// - the amount of lines, varint;
+// - for each line: its length in spaces and the amount of stored spaces, varints. The rest of a line are the empty
+//   spaces, i.e. all zeroes;
+// - the characters of the stored spaces, UTF-8. Characters beyond the UTF-8 range, i.e. the extended ones, are written
+//   as a marker byte followed by 4 raw bytes;
+// - the attributes of the stored spaces, as runs of: run length, varint, and the upper 4 bytes of a space.
+
+static_assert(sizeof(ScreenBuffer::Space) == sizeof(uint64_t));
+
+static constexpr uint8_t g_RawCharMarker = 0xFF;
+
+static const ScreenBuffer::Space g_NoSpace = ScreenBuffer::DefaultEraseChar();
+
+static uint64_t Bits(const ScreenBuffer::Space &_space) noexcept
+{
+    return std::bit_cast<uint64_t>(_space);
+}
+
+static void PutVarInt(std::vector<uint8_t> &_out, uint32_t _value)
+{
+    while( _value >= 0x80 ) {
+        _out.push_back(static_cast<uint8_t>(_value | 0x80));
+        _value >>= 7;
+    }
+    _out.push_back(static_cast<uint8_t>(_value));
+}
+
+static uint32_t GetVarInt(const uint8_t *&_p, const uint8_t *_end) noexcept
+{
+    uint32_t value = 0;
+    for( int shift = 0; _p < _end && shift < 35; shift += 7 ) {
+        const uint8_t byte = *_p++;
+        value |= uint32_t(byte & 0x7F) << shift;
+        if( (byte & 0x80) == 0 )
+            break;
+    }
+    return value;
+}
+
+static void PutChar(std::vector<uint8_t> &_out, char32_t _c)
+{
+    const uint32_t c = _c;
+    if( c < 0x80 ) {
+        _out.push_back(static_cast<uint8_t>(c));
+    }
+    else if( c < 0x800 ) {
+        _out.push_back(static_cast<uint8_t>(0xC0 | (c >> 6)));
+        _out.push_back(static_cast<uint8_t>(0x80 | (c & 0x3F)));
+    }
+    else if( c < 0x10000 ) {
+        _out.push_back(static_cast<uint8_t>(0xE0 | (c >> 12)));
+        _out.push_back(static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F)));
+        _out.push_back(static_cast<uint8_t>(0x80 | (c & 0x3F)));
+    }
+    else if( c < 0x200000 ) {
+        _out.push_back(static_cast<uint8_t>(0xF0 | (c >> 18)));
+        _out.push_back(static_cast<uint8_t>(0x80 | ((c >> 12) & 0x3F)));
+        _out.push_back(static_cast<uint8_t>(0x80 | ((c >> 6) & 0x3F)));
+        _out.push_back(static_cast<uint8_t>(0x80 | (c & 0x3F)));
+    }
+    else {
+        _out.push_back(g_RawCharMarker);
+        for( int i = 0; i != 4; ++i )
+            _out.push_back(static_cast<uint8_t>(c >> (i * 8)));
+    }
+}
+
+static uint32_t GetChar(const uint8_t *&_p, const uint8_t *_end) noexcept
+{
+    const auto next = [&]() -> uint32_t { return _p < _end ? *_p++ : 0; };
+    const uint32_t b0 = next();
+    if( b0 < 0x80 )
+        return b0;
+    if( b0 == g_RawCharMarker ) {
+        uint32_t c = 0;
+        for( int i = 0; i != 4; ++i )
+            c |= next() << (i * 8);
+        return c;
+    }
+    if( (b0 & 0xE0) == 0xC0 )
+        return ((b0 & 0x1F) << 6) | (next() & 0x3F);
+    if( (b0 & 0xF0) == 0xE0 ) {
+        const uint32_t b1 = next();
+        return ((b0 & 0x0F) << 12) | ((b1 & 0x3F) << 6) | (next() & 0x3F);
+    }
+    const uint32_t b1 = next();
+    const uint32_t b2 = next();
+    return ((b0 & 0x07) << 18) | ((b1 & 0x3F) << 12) | ((b2 & 0x3F) << 6) | (next() & 0x3F);
+}
+
+// Amount of spaces in the line up to the last one which is not all zeroes
+static uint32_t StoredSpaces(std::span<const ScreenBuffer::Space> _line) noexcept
+{
+    uint32_t stored = static_cast<uint32_t>(_line.size());
+    while( stored > 0 && Bits(_line[stored - 1]) == 0 )
+        --stored;
+    return stored;
+}
+
+Scrollback::Scrollback() = default;
+
+Scrollback::Scrollback(Limits _limits) : m_Limits(_limits)
+{
+}
+
+Scrollback::~Scrollback() = default;
+
+size_t Scrollback::Page::Bytes() const noexcept
+{
+    return sizeof(Page) + spaces.capacity() * sizeof(Space) + offsets.capacity() * sizeof(uint32_t) +
+           compressed.capacity();
+}
+
+void Scrollback::SetLimits(Limits _limits)
+{
+    m_Limits = _limits;
+    Trim();
+}
+
+Scrollback::Limits Scrollback::GetLimits() const noexcept
+{
+    return m_Limits;
+}
+
+size_t Scrollback::Size() const noexcept
+{
+    return m_Pages.empty() ? 0 : m_Pages.back().first + m_Pages.back().lines - m_Pages.front().first;
+}
+
+size_t Scrollback::Dropped() const noexcept
+{
+    return m_Dropped;
+}
+
+size_t Scrollback::Bytes() const noexcept
+{
+    return m_Pages.empty() ? 0 : m_Bytes + m_Pages.back().Bytes();
+}
+
+void Scrollback::Append(std::span<const Space> _line, bool _wrapped)
+{
+    AppendLine(_line, _wrapped);
+    Trim();
+}
+
+void Scrollback::AppendLine(std::span<const Space> _line, bool _wrapped)
+{
+    if( m_Pages.empty() || m_Pages.back().lines == PageLines || m_Pages.back().Sealed() ) {
+        size_t first = m_Dropped;
+        if( !m_Pages.empty() ) {
+            if( !m_Pages.back().Sealed() )
+                SealNewestPage();
+            first = m_Pages.back().first + m_Pages.back().lines;
+        }
+        Page &page = m_Pages.emplace_back();
+        page.id = ++m_LastPageID;
+        page.first = first;
+    }
+
+    Page &page = m_Pages.back();
+    if( page.lines == 0 ) {
+        page.spaces.reserve(PageLines * _line.size()); // the lines are usually of the same width
+        page.offsets.reserve(PageLines);
+    }
+    page.offsets.push_back(static_cast<uint32_t>(page.spaces.size()));
+    page.spaces.insert(page.spaces.end(), _line.begin(), _line.end());
+    page.wrapped[page.lines] = _wrapped;
+    page.longest = std::max(page.longest, StoredSpaces(_line));
+    ++page.lines;
+}
+
+void Scrollback::PopBack()
+{
+    if( m_Pages.empty() )
+        return;
+
+    Page &page = m_Pages.back();
+    --page.lines;
+    page.wrapped[page.lines] = false;
+    page.spaces.resize(page.offsets[page.lines]);
+    page.offsets.pop_back();
+    if( page.lines == 0 ) {
+        m_Pages.pop_back();
+        if( !m_Pages.empty() )
+            UnsealNewestPage();
+    }
+}
+
+void Scrollback::SealNewestPage()
+{
+    Page &page = m_Pages.back();
+    page.compressed = Compress(page);
+    page.spaces.clear();
+    page.spaces.shrink_to_fit();
+    page.offsets.clear();
+    page.offsets.shrink_to_fit();
+    m_Bytes += page.Bytes();
+}
+
+void Scrollback::UnsealNewestPage()
+{
+    Page &page = m_Pages.back();
+    if( !page.Sealed() )
+        return;
+
+    m_Bytes -= page.Bytes();
+    Expanded expanded;
+    Expand(page.compressed, expanded);
+    page.spaces.clear();
+    page.offsets.clear();
+    for( size_t i = 0; i != page.lines; ++i ) {
+        const uint32_t start = expanded.offsets[i];
+        const uint32_t length = std::min(expanded.offsets[i + 1] - start, page.cut);
+        page.offsets.push_back(static_cast<uint32_t>(page.spaces.size()));
+        page.spaces.insert(page.spaces.end(),
+                           std::next(expanded.spaces.begin(), start),
+                           std::next(expanded.spaces.begin(), start + length));
+    }
+    page.compressed.clear();
+    page.compressed.shrink_to_fit();
+    page.cut = std::numeric_limits<uint32_t>::max();
+    page.id = ++m_LastPageID; // the page will be sealed with other contents, its cached expansion must not be reused
+}
+
+void Scrollback::Trim()
+{
+    while( m_Pages.size() > 1 && (Size() > m_Limits.max_lines || Bytes() > m_Limits.max_bytes) ) {
+        m_Bytes -= m_Pages.front().Bytes();
+        m_Dropped += m_Pages.front().lines;
+        m_Pages.pop_front();
+    }
+}
+
+std::vector<uint8_t> Scrollback::Compress(const Page &_page)
+{
+    std::vector<uint8_t> out;
+    out.reserve(_page.spaces.size() + _page.lines * 2 + 64);
+
+    std::vector<std::span<const Space>> stored_lines(_page.lines);
+    PutVarInt(out, static_cast<uint32_t>(_page.lines));
+    for( size_t i = 0; i != _page.lines; ++i ) {
+        const uint32_t start = _page.offsets[i];
+        const uint32_t end = i + 1 < _page.lines ? _page.offsets[i + 1] : static_cast<uint32_t>(_page.spaces.size());
+        const std::span<const Space> line(_page.spaces.data() + start, end - start);
+        const uint32_t stored = StoredSpaces(line);
+        PutVarInt(out, static_cast<uint32_t>(line.size()));
+        PutVarInt(out, stored);
+        stored_lines[i] = line.subspan(0, stored);
+    }
+
+    for( auto line : stored_lines )
+        for( const Space &space : line )
+            PutChar(out, space.l);
+
+    uint32_t run_attrs = 0;
+    uint32_t run_length = 0;
+    const auto put_run = [&] {
+        PutVarInt(out, run_length);
+        for( int i = 0; i != 4; ++i )
+            out.push_back(static_cast<uint8_t>(run_attrs >> (i * 8)));
+    };
+    for( auto line : stored_lines )
+        for( const Space &space : line ) {
+            const uint32_t attrs = static_cast<uint32_t>(Bits(space) >> 32);
+            if( run_length != 0 && attrs != run_attrs ) {
+                put_run();
+                run_length = 0;
+            }
+            run_attrs = attrs;
+            ++run_length;
+        }
+    if( run_length != 0 )
+        put_run();
+
+    out.shrink_to_fit();
+    return out;
+}
+
+void Scrollback::Expand(std::span<const uint8_t> _compressed, Expanded &_expanded)
+{
+    const uint8_t *p = _compressed.data();
+    const uint8_t *const end = p + _compressed.size();
+
+    const uint32_t lines = std::min(GetVarInt(p, end), static_cast<uint32_t>(PageLines));
+    std::array<uint32_t, PageLines> stored;
+    _expanded.offsets.resize(lines + 1);
+    _expanded.offsets[0] = 0;
+    for( uint32_t i = 0; i != lines; ++i ) {
+        const uint32_t length = GetVarInt(p, end);
+        stored[i] = std::min(GetVarInt(p, end), length);
+        _expanded.offsets[i + 1] = _expanded.offsets[i] + length;
+    }
+
+    _expanded.spaces.assign(_expanded.offsets[lines], g_NoSpace);
+    Space *const spaces = _expanded.spaces.data();
+
+    for( uint32_t i = 0; i != lines; ++i )
+        for( uint32_t j = _expanded.offsets[i], e = j + stored[i]; j != e; ++j )
+            spaces[j] = std::bit_cast<Space>(uint64_t(GetChar(p, end)));
+
+    uint32_t run_left = 0;
+    uint64_t run_attrs = 0;
+    for( uint32_t i = 0; i != lines; ++i )
+        for( uint32_t j = _expanded.offsets[i], e = j + stored[i]; j != e; ++j ) {
+            if( run_left == 0 ) {
+                run_left = GetVarInt(p, end);
+                uint32_t attrs = 0;
+                for( int k = 0; k != 4; ++k )
+                    attrs |= uint32_t(p < end ? *p++ : 0) << (k * 8);
+                run_attrs = uint64_t(attrs) << 32;
+            }
+            spaces[j] = std::bit_cast<Space>(Bits(spaces[j]) | run_attrs);
+            if( run_left != 0 )
+                --run_left;
+        }
+}
+
+const Scrollback::Expanded &Scrollback::ExpandedPage(const Page &_page) const
+{
+    Expanded *victim = &m_Expanded[0];
+    for( Expanded &expanded : m_Expanded ) {
+        if( expanded.page_id == _page.id ) {
+            expanded.last_used = ++m_UseCounter;
+            return expanded;
+        }
+        if( expanded.last_used < victim->last_used )
+            victim = &expanded;
+    }
+
+    Expand(_page.compressed, *victim);
+    victim->page_id = _page.id;
+    victim->last_used = ++m_UseCounter;
+    return *victim;
+}
+
+size_t Scrollback::PageIndex(size_t _index) const noexcept
+{
+    const size_t line = m_Pages.front().first + _index;
+    const auto it = std::upper_bound(
+        m_Pages.begin(), m_Pages.end(), line, [](size_t _line, const Page &_page) { return _line < _page.first; });
+    return static_cast<size_t>(std::distance(m_Pages.begin(), it)) - 1;
+}
+
+std::span<const Scrollback::Space>
+Scrollback::PageLine(const Page &_page, const Expanded *_expanded, size_t _index) noexcept
+{
+    const Space *spaces = nullptr;
+    uint32_t start = 0;
+    uint32_t end = 0;
+    if( _expanded ) {
+        spaces = _expanded->spaces.data();
+        start = _expanded->offsets[_index];
+        end = _expanded->offsets[_index + 1];
+    }
+    else {
+        spaces = _page.spaces.data();
+        start = _page.offsets[_index];
+        end = _index + 1 < _page.lines ? _page.offsets[_index + 1] : static_cast<uint32_t>(_page.spaces.size());
+    }
+
+    if( end - start > _page.cut )
+        end = start + _page.cut;
+
+    if( start == end )
+        return {&g_NoSpace, 0}; // an empty line is still a valid one, hence a non-null pointer
+    return {spaces + start, end - start};
+}
+
+std::span<const Scrollback::Space> Scrollback::Line(size_t _index) const
+{
+    if( _index >= Size() )
+        return {};
+
+    const Page &page = m_Pages[PageIndex(_index)];
+    return PageLine(page, page.Sealed() ? &ExpandedPage(page) : nullptr, m_Pages.front().first + _index - page.first);
+}
+
+bool Scrollback::Wrapped(size_t _index) const noexcept
+{
+    if( _index >= Size() )
+        return false;
+    const Page &page = m_Pages[PageIndex(_index)];
+    return page.wrapped[m_Pages.front().first + _index - page.first];
+}
+
+void Scrollback::SetWrapped(size_t _index, bool _wrapped) noexcept
+{
+    if( _index >= Size() )
+        return;
+    Page &page = m_Pages[PageIndex(_index)];
+    page.wrapped[m_Pages.front().first + _index - page.first] = _wrapped;
+}
+
+std::optional<std::vector<Scrollback::Space>> Scrollback::Rewrap(size_t _width)
+{
+    assert(_width > 0);
+    std::deque<Page> pages;
+    pages.swap(m_Pages);
+    m_Bytes = 0;
+    m_Dropped = 0;
+
+    std::vector<Space> joined; // the line being joined from the wrapped ones
+    bool joining = false;
+    const auto split = [&] {
+        const std::span<const Space> line = joined;
+        if( line.empty() )
+            AppendLine({}, false);
+        for( size_t i = 0; i < line.size(); i += _width ) {
+            const size_t length = std::min(_width, line.size() - i);
+            AppendLine(line.subspan(i, length), i + length < line.size());
+        }
+    };
+
+    while( !pages.empty() ) {
+        Page page = std::move(pages.front());
+        pages.pop_front();
+
+        if( page.Sealed() && !joining && page.wrapped.none() && page.longest <= _width ) {
+            // nothing to re-lay out on this page - it's taken as is, the lines beyond the width are only empty spaces
+            if( !m_Pages.empty() && !m_Pages.back().Sealed() )
+                SealNewestPage();
+            page.first = m_Pages.empty() ? 0 : m_Pages.back().first + m_Pages.back().lines;
+            page.cut = static_cast<uint32_t>(std::min<size_t>(page.cut, _width));
+            m_Bytes += page.Bytes();
+            m_Pages.push_back(std::move(page));
+            continue;
+        }
+
+        const Expanded *const expanded = page.Sealed() ? &ExpandedPage(page) : nullptr;
+        for( size_t i = 0; i != page.lines; ++i ) {
+            const std::span<const Space> line = PageLine(page, expanded, i);
+            joined.insert(joined.end(), line.begin(), line.begin() + ScreenBuffer::OccupiedChars(line));
+            joining = page.wrapped[i];
+            if( !joining ) {
+                split();
+                joined.clear();
+            }
+        }
+    }
+
+    for( Expanded &expanded : m_Expanded )
+        expanded = {};
+    if( !m_Pages.empty() )
+        UnsealNewestPage();
+    Trim();
+
+    if( joining )
+        return joined;
+    return std::nullopt;
+}
+
+void Scrollback::Clear()
+{
+    m_Pages.clear();
+    m_Bytes = 0;
+    m_Dropped = 0;
+    for( Expanded &expanded : m_Expanded )
+        expanded = {};
+}
+
+} // namespace nc::term
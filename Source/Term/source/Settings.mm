@@ -1,4 +1,4 @@
-// Copyright (C) 2017-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2017-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Settings.h"
 #include <Utility/HexadecimalColor.h>
 #include <Utility/FontExtras.h>
@@ -139,6 +139,16 @@ bool DefaultSettings::HideScrollbar() const
     return false;
 }
 
+int DefaultSettings::ScrollbackMaxLines() const
+{
+    return 100'000;
+}
+
+int DefaultSettings::ScrollbackMaxMegabytes() const
+{
+    return 64;
+}
+
 int DefaultSettings::StartChangesObserving( [[maybe_unused]] std::function<void()> _callback )
 {
     return 0;
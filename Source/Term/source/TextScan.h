@@ -0,0 +1,111 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Bulk scanners of the terminal input used to skip over the plain text without looking at each byte individually.
+// Both process 16 bytes at a time via SSE2 when available and 8-byte words otherwise, e.g. on arm64.
+
+namespace nc::term {
+
+namespace detail {
+
+// Predicates are expressed as the amount of bytes from the beginning of the block which are accepted, i.e. as the
+// position of the first rejected byte, or the block size if all bytes are accepted.
+
+#if defined(__SSE2__)
+inline size_t FirstMarked16(__m128i _marks) noexcept
+{
+    const unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_marks));
+    return mask == 0 ? 16 : static_cast<size_t>(std::countr_zero(mask));
+}
+#endif
+
+inline uint64_t Load8(const unsigned char *_p) noexcept
+{
+    uint64_t word;
+    std::memcpy(&word, _p, sizeof(word));
+    return word;
+}
+
+inline size_t FirstMarked8(uint64_t _marks) noexcept
+{
+    // only the high bit of each byte is meaningful, the lowest one is exact and bytes are loaded little-endian
+    static_assert(std::endian::native == std::endian::little);
+    return _marks == 0 ? 8 : static_cast<size_t>(std::countr_zero(_marks) / 8);
+}
+
+inline constexpr uint64_t g_Ones = 0x0101010101010101ULL;
+inline constexpr uint64_t g_Highs = 0x8080808080808080ULL;
+
+// High bits set for the bytes less than _n, where _n <= 128
+inline constexpr uint64_t LessThan(uint64_t _word, uint64_t _n) noexcept
+{
+    return (_word - g_Ones * _n) & ~_word & g_Highs;
+}
+
+// High bits set for the bytes greater than _n, where _n < 128
+inline constexpr uint64_t GreaterThan(uint64_t _word, uint64_t _n) noexcept
+{
+    return ((_word + g_Ones * (127 - _n)) | _word) & g_Highs;
+}
+
+} // namespace detail
+
+// Returns the position of the first C0 control byte, i.e. less than 0x20, or _size if there's none
+inline size_t FindControlByte(const unsigned char *_bytes, size_t _size) noexcept
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i max_control = _mm_set1_epi8(0x1F);
+    for( ; i + 16 <= _size; i += 16 ) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_bytes + i));
+        if( const size_t n = detail::FirstMarked16(_mm_cmpeq_epi8(_mm_min_epu8(v, max_control), v)); n != 16 )
+            return i + n;
+    }
+#endif
+    for( ; i + 8 <= _size; i += 8 )
+        if( const size_t n = detail::FirstMarked8(detail::LessThan(detail::Load8(_bytes + i), 0x20)); n != 8 )
+            return i + n;
+    for( ; i < _size; ++i )
+        if( _bytes[i] < 0x20 )
+            return i;
+    return _size;
+}
+
+// Returns the position of the first byte which is not a printable ASCII character, i.e. not in [0x20, 0x7E], or
+// _size if there's none
+inline size_t FindNonPrintableASCII(const unsigned char *_bytes, size_t _size) noexcept
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i max_control = _mm_set1_epi8(0x1F);
+    const __m128i del = _mm_set1_epi8(0x7F);
+    for( ; i + 16 <= _size; i += 16 ) {
+        // as signed bytes everything starting from 0x80 is negative, so the printable ones are in (0x1F, 0x7F)
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_bytes + i));
+        const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, max_control), _mm_cmplt_epi8(v, del));
+        if( const size_t n = detail::FirstMarked16(_mm_xor_si128(printable, _mm_set1_epi8(-1))); n != 16 )
+            return i + n;
+    }
+#endif
+    for( ; i + 8 <= _size; i += 8 ) {
+        const uint64_t word = detail::Load8(_bytes + i);
+        const uint64_t marks = detail::LessThan(word, 0x20) | detail::GreaterThan(word, 0x7E);
+        if( const size_t n = detail::FirstMarked8(marks); n != 8 )
+            return i + n;
+    }
+    for( ; i < _size; ++i )
+        if( _bytes[i] < 0x20 || _bytes[i] > 0x7E )
+            return i;
+    return _size;
+}
+
+} // namespace nc::term
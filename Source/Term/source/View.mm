@@ -1,4 +1,4 @@
-// Copyright (C) 2013-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "View.h"
 #include <Utility/HexadecimalColor.h>
 #include <Utility/FontCache.h>
@@ -12,11 +12,13 @@
 #include "Settings.h"
 #include "CTCache.h"
 #include "ColorMap.h"
+#include "Log.h"
 
 #include <iostream>
 #include <cmath>
 #include <array>
 #include <memory_resource>
+#include <utility>
 
 using namespace nc;
 using namespace nc::term;
@@ -27,6 +29,23 @@ using SelPoint = term::ScreenPoint;
 [[clang::no_destroy]] static CTCacheRegistry
     g_CacheRegistry(ExtendedCharRegistry::SharedInstance()); // TODO: evil, refactor!
 
+namespace {
+
+// What a line of the view was drawn with, tells whether the line has to be drawn again
+struct DrawnLine {
+    uint64_t identity = 0; // ScreenBuffer::LineGeneration() or one of the values below, zero means "unknown"
+    int cursor = -1;       // position of the visible cursor, if it's in this line
+    bool operator==(const DrawnLine &) const noexcept = default;
+};
+
+// Nothing but the background is drawn in the lines beyond the buffer
+constexpr uint64_t g_BlankLine = 1ULL << 62;
+
+// The backscreen lines never change, such a line is identified by its position in the buffer instead
+constexpr uint64_t g_BackScreenLine = 1ULL << 63;
+
+} // namespace
+
 @implementation NCTermView {
     Screen *m_Screen;
     InputTranslator *m_InputTranslator;
@@ -59,6 +78,12 @@ using SelPoint = term::ScreenPoint;
     std::shared_ptr<Settings> m_Settings;
     int m_SettingsNotificationTicket;
     SelPoint m_LastMouseCell;
+
+    // the state of the visible lines [m_DrawnFirstLine, m_DrawnFirstLine + m_DrawnLines.size()) as they were drawn
+    std::vector<DrawnLine> m_DrawnLines;
+    int m_DrawnFirstLine;
+    uint64_t m_DrawnLayoutGeneration;
+    bool m_DrawnBlinkVisible;
 }
 
 @synthesize fpsDrawer = m_FPS;
@@ -76,6 +101,9 @@ using SelPoint = term::ScreenPoint;
         m_CursorType = TermViewCursor::BlinkingBlock;
         m_MouseEvents = Interpreter::RequestedMouseEvents::None;
         m_LastMouseCell = {0, 0};
+        m_DrawnFirstLine = 0;
+        m_DrawnLayoutGeneration = 0;
+        m_DrawnBlinkVisible = true;
 
         __weak NCTermView *weak_self = self;
         m_BlinkScheduler = utility::BlinkScheduler([weak_self] {
@@ -88,6 +116,10 @@ using SelPoint = term::ScreenPoint;
         m_HasSelection = false;
         m_ReportsSizeByOccupiedContent = false;
         m_ShowCursor = true;
+        // the lines are laid out from the top, so the drawn ones stay valid when the view grows or shrinks at the
+        // bottom, e.g. when the screen is scrolled into the backscreen. invalidateChangedRegions takes care of the rest.
+        self.layerContentsRedrawPolicy = NSViewLayerContentsRedrawOnSetNeedsDisplay;
+        self.layerContentsPlacement = NSViewLayerContentsPlacementTopLeft;
         m_FPS = [[FPSLimitedDrawer alloc] initWithView:self];
         m_FPS.fps = 60;
         m_IntrinsicSize = NSMakeSize(NSViewNoIntrinsicMetric, frame.size.height);
@@ -258,7 +290,7 @@ using SelPoint = term::ScreenPoint;
     CGContextSaveGState(context);
     auto restore_gstate = at_scope_end([=] { CGContextRestoreGState(context); });
     CGContextSetFillColorWithColor(context, m_Colors.GetSpecialColor(ColorMap::Special::Background));
-    CGContextFillRect(context, NSRectToCGRect(self.bounds));
+    CGContextFillRect(context, NSRectToCGRect(dirtyRect));
 
     if( !m_Screen )
         return;
@@ -269,27 +301,137 @@ using SelPoint = term::ScreenPoint;
     const auto font_height = m_FontCache->Height();
     const auto line_start = static_cast<int>(std::floor(dirtyRect.origin.y / font_height));
     const auto line_end = static_cast<int>(std::ceil((dirtyRect.origin.y + dirtyRect.size.height) / font_height));
+    const bool cursor_visible = self.cursorIsVisible;
 
     auto lock = m_Screen->AcquireLock();
 
     SetParamsForUserReadableText(context);
     CGContextSetShouldSmoothFonts(context, true);
 
+    size_t lines_drawn = 0;
+    size_t cells_drawn = 0;
     for( int i = line_start, bsl = m_Screen->Buffer().BackScreenLines(); i < line_end; ++i ) {
+        // the dirty rect is a union of the invalidated lines, which are not necessarily adjacent
+        if( ![self needsToDrawRect:NSMakeRect(dirtyRect.origin.x, i * font_height, dirtyRect.size.width, font_height)] )
+            continue;
+
+        if( i >= m_DrawnFirstLine && i - m_DrawnFirstLine < static_cast<int>(m_DrawnLines.size()) )
+            m_DrawnLines[i - m_DrawnFirstLine] = [self drawnStateOfLine:i cursorVisible:cursor_visible];
+
+        const auto line = std::as_const(m_Screen->Buffer()).LineFromNo(i - bsl);
+        if( line.empty() )
+            continue;
         if( i < bsl ) { // scrollback
-            if( auto line = m_Screen->Buffer().LineFromNo(i - bsl); !line.empty() )
-                [self DrawLine:line at_y:i sel_y:i - bsl context:context cursor_at:-1];
+            [self DrawLine:line at_y:i sel_y:i - bsl context:context cursor_at:-1];
         }
         else { // real screen
-            if( auto line = m_Screen->Buffer().LineFromNo(i - bsl); !line.empty() )
-                [self DrawLine:line
-                          at_y:i
-                         sel_y:i - bsl
-                       context:context
-                     cursor_at:(m_Screen->CursorY() != i - bsl) ? -1 : m_Screen->CursorX()];
+            [self DrawLine:line
+                      at_y:i
+                     sel_y:i - bsl
+                   context:context
+                 cursor_at:(m_Screen->CursorY() != i - bsl) ? -1 : m_Screen->CursorX()];
         }
+        ++lines_drawn;
+        cells_drawn += line.size();
     }
-    
+    Log::Trace(SPDLOC, "Drew {} lines, {} cells", lines_drawn, cells_drawn);
+}
+
+- (bool)cursorIsVisible
+{
+    // mirrors the logic of drawCursor:context:
+    if( m_ShowCursor == false )
+        return false;
+    if( self.window.isKeyWindow && m_IsFirstResponder )
+        return m_BlinkScheduler.Visible();
+    return true;
+}
+
+// Must be called with the screen lock being held
+- (DrawnLine)drawnStateOfLine:(int)_line cursorVisible:(bool)_cursor_visible
+{
+    const auto &buffer = m_Screen->Buffer();
+    const int bsl = static_cast<int>(buffer.BackScreenLines());
+    const int y = _line - bsl;
+    DrawnLine state;
+    if( y < -bsl || y >= static_cast<int>(buffer.Height()) ) {
+        state.identity = g_BlankLine;
+    }
+    else if( y < 0 ) {
+        state.identity = g_BackScreenLine | (buffer.BackScreenDroppedLines() + static_cast<size_t>(_line));
+    }
+    else {
+        state.identity = buffer.LineGeneration(y);
+        if( _cursor_visible && m_Screen->CursorY() == y )
+            state.cursor = m_Screen->CursorX();
+    }
+    return state;
+}
+
+// Invalidates only the visible lines which differ from what was drawn at their places, i.e. at their positions in this
+// view. When the output scrolls the screen into the backscreen, the lines keep their positions in the view along with
+// their generations: it's the view which grows and is scrolled by the clip view, and the layer keeps its contents on
+// that resize, so only the newly exposed lines are drawn. Lines which do change their positions in the view, i.e. the
+// ones scrolled within a region of the screen or shifted when the backscreen drops its oldest lines, are drawn again.
+- (void)invalidateChangedRegions
+{
+    if( !m_Screen || !m_FontCache ) {
+        self.needsDisplay = true;
+        return;
+    }
+
+    const auto font_height = m_FontCache->Height();
+    const auto width = self.bounds.size.width;
+    const auto rect = self.visibleRect;
+    const auto first = static_cast<int>(std::floor(rect.origin.y / font_height));
+    const auto last = std::max(static_cast<int>(std::ceil((rect.origin.y + rect.size.height) / font_height)), first);
+    const bool cursor_visible = self.cursorIsVisible;
+    const bool blink_visible = m_BlinkScheduler.Visible();
+
+    auto lock = m_Screen->AcquireLock();
+    const auto &buffer = m_Screen->Buffer();
+
+    // the whole view has to be drawn anew if the lines were laid out anew, if the blinking characters have changed
+    // their phase or if there's a selection, since it's bound to the lines numbers rather than to their contents
+    const bool blinked = m_HasVisibleBlinkingSpaces && blink_visible != m_DrawnBlinkVisible;
+    m_DrawnBlinkVisible = blink_visible;
+    if( buffer.LayoutGeneration() != m_DrawnLayoutGeneration || blinked || m_HasSelection ) {
+        m_DrawnLayoutGeneration = buffer.LayoutGeneration();
+        m_DrawnFirstLine = first;
+        m_DrawnLines.assign(last - first, DrawnLine{});
+        self.needsDisplay = true;
+        return;
+    }
+
+    const auto drawn = [&](int _line) -> DrawnLine {
+        if( _line < m_DrawnFirstLine || _line - m_DrawnFirstLine >= static_cast<int>(m_DrawnLines.size()) )
+            return {};
+        return m_DrawnLines[_line - m_DrawnFirstLine];
+    };
+
+    std::vector<int> changed;
+    std::vector<DrawnLine> lines(last - first);
+    for( int line = first; line < last; ++line ) {
+        const DrawnLine state = [self drawnStateOfLine:line cursorVisible:cursor_visible];
+        lines[line - first] = state;
+        if( state.identity == 0 || drawn(line) != state )
+            changed.push_back(line);
+    }
+
+    // the changed lines are unknown until drawn, adjacent ones are invalidated together
+    for( auto i = changed.begin(); i != changed.end(); ) {
+        auto e = std::next(i);
+        while( e != changed.end() && *e == *std::prev(e) + 1 )
+            ++e;
+        for( auto line = i; line != e; ++line )
+            lines[*line - first] = DrawnLine{};
+        [self setNeedsDisplayInRect:NSMakeRect(0., *i * font_height, width, (*std::prev(e) - *i + 1) * font_height)];
+        i = e;
+    }
+
+    m_DrawnFirstLine = first;
+    m_DrawnLines = std::move(lines);
+    Log::Trace(SPDLOC, "Invalidated {} of {} lines", changed.size(), m_DrawnLines.size());
 }
 
 namespace {
@@ -639,7 +781,7 @@ static const auto g_ClearCGColor = NSColor.clearColor.CGColor;
     NSPoint click_location = [self convertPoint:event.locationInWindow fromView:nil];
     SelPoint position = [self projectPoint:click_location];
     auto lock = m_Screen->AcquireLock();
-    if( !m_Screen->Buffer().LineFromNo(position.y).empty() ) {
+    if( !std::as_const(m_Screen->Buffer()).LineFromNo(position.y).empty() ) {
         m_HasSelection = true;
         m_SelStart = ScreenPoint(0, position.y);
         m_SelEnd = ScreenPoint(m_Screen->Buffer().Width(), position.y);
@@ -1,4 +1,4 @@
-// Copyright (C) 2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2023-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <ExtendedCharRegistry.h>
 #include "Tests.h"
 
@@ -286,3 +286,12 @@ TEST_CASE(PREFIX "IsDoubleWidth")
         CHECK( dw(tc.str) == tc.exp );
     }
 }
+
+TEST_CASE(PREFIX "DecodeUTF16")
+{
+    ExtendedCharRegistry r;
+    CHECK(r.DecodeUTF16(U'a').empty());
+    CHECK(r.DecodeUTF16(0x80001000).empty()); // not registered
+    CHECK(r.DecodeUTF16(r.Append(u"e\x0308").newchar) == u"e\x0308");
+    CHECK(r.DecodeUTF16(r.Append(u"🇬🇧").newchar) == u"🇬🇧");
+}
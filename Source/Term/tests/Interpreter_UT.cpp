@@ -1,4 +1,4 @@
-// Copyright (C) 2020-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2020-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <InterpreterImpl.h>
 #include <optional>
 #include "Tests.h"
@@ -541,6 +541,59 @@ TEST_CASE(PREFIX "Properly updates internal sizes")
                                        "345");
 }
 
+TEST_CASE(PREFIX "Puts runs of text")
+{
+    using namespace input;
+    Screen screen(4, 3);
+    const auto &buffer = screen.Buffer();
+    InterpreterImpl interpreter(screen);
+    SECTION("Wraps ASCII text with auto-wrap mode")
+    {
+        interpreter.Interpret(Command(Type::text, UTF8Text{"0123456789"}));
+        CHECK(buffer.DumpScreenAsANSI() == "0123"
+                                           "4567"
+                                           "89  ");
+        CHECK(buffer.LineWrapped(0) == true);
+        CHECK(buffer.LineWrapped(1) == true);
+        CHECK(buffer.LineWrapped(2) == false);
+        CHECK(screen.CursorX() == 2);
+        CHECK(screen.CursorY() == 2);
+    }
+    SECTION("Overwrites the last column without auto-wrap mode")
+    {
+        interpreter.Interpret(Command(Type::change_mode, ModeChange{ModeChange::Kind::AutoWrap, false}));
+        interpreter.Interpret(Command(Type::text, UTF8Text{"0123456789"}));
+        CHECK(buffer.DumpScreenAsANSI() == "0129"
+                                           "    "
+                                           "    ");
+        CHECK(screen.CursorX() == 3);
+        CHECK(screen.CursorY() == 0);
+    }
+    SECTION("Interleaves ASCII and non-ASCII text")
+    {
+        interpreter.Interpret(Command(Type::text, UTF8Text{"a\xD0\x96"
+                                                           "bc\xD0\x96"}));
+        const auto line = buffer.LineFromNo(0);
+        CHECK(line[0].l == 'a');
+        CHECK(line[1].l == U'Ж');
+        CHECK(line[2].l == 'b');
+        CHECK(line[3].l == 'c');
+        CHECK(buffer.LineFromNo(1)[0].l == U'Ж');
+        CHECK(screen.CursorX() == 1);
+        CHECK(screen.CursorY() == 1);
+    }
+    SECTION("Composes the last ASCII character with the following combining ones")
+    {
+        interpreter.Interpret(Command(Type::text, UTF8Text{"ae\xCC\x81"
+                                                           "b"}));
+        const auto line = buffer.LineFromNo(0);
+        CHECK(line[0].l == 'a');
+        CHECK(ExtendedCharRegistry::IsExtended(line[1].l));
+        CHECK(line[2].l == 'b');
+        CHECK(screen.CursorX() == 3);
+    }
+}
+
 TEST_CASE(PREFIX "Cursor visibility management")
 {
     using namespace input;
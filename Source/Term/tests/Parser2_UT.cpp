@@ -1,4 +1,4 @@
-// Copyright (C) 2020-2022 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2020-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <ParserImpl.h>
 #include "Tests.h"
 
@@ -2016,3 +2016,34 @@ TEST_CASE(PREFIX "Properly handles torn sequences")
     }
     CHECK(parser.GetEscState() == ParserImpl::EscState::Text);
 }
+
+TEST_CASE(PREFIX "Passes long runs of text without losses")
+{
+    ParserImpl parser;
+    std::string text;
+    for( int i = 0; text.size() < 100'000; ++i )
+        text += "line #" + std::to_string(i) + " \xD0\x96\xF0\x9F\x98\xB1 "; // Ж😱
+    auto r = parser.Parse(to_bytes(text.c_str()));
+    std::string parsed;
+    for( const auto &command : r ) {
+        REQUIRE(command.type == Type::text);
+        parsed += as_utf8text(command).characters;
+    }
+    CHECK(parsed == text);
+}
+
+TEST_CASE(PREFIX "Splits runs of text by control characters")
+{
+    ParserImpl parser;
+    auto r = parser.Parse(to_bytes("0123456789abcdefghijklmnopqrstuvwxyz\r\nABCDEFGHIJKLMNOPQRSTUVWXYZ\x1B[1mxyz"));
+    REQUIRE(r.size() == 6);
+    CHECK(r[0].type == Type::text);
+    CHECK(as_utf8text(r[0]).characters == "0123456789abcdefghijklmnopqrstuvwxyz");
+    CHECK(r[1].type == Type::carriage_return);
+    CHECK(r[2].type == Type::line_feed);
+    CHECK(r[3].type == Type::text);
+    CHECK(as_utf8text(r[3]).characters == "ABCDEFGHIJKLMNOPQRSTUVWXYZ");
+    CHECK(r[4].type == Type::set_character_attributes);
+    CHECK(r[5].type == Type::text);
+    CHECK(as_utf8text(r[5]).characters == "xyz");
+}
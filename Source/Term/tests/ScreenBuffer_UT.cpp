@@ -1,6 +1,8 @@
-// Copyright (C) 2015-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2015-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 
 #include "Tests.h"
+#include <set>
+#include <utility>
 
 // TODO: Fixme, please... 🤦
 #define private public
@@ -85,6 +87,143 @@ TEST_CASE(PREFIX "ComposeContinuousLines")
     REQUIRE(cl3[0].at(5).l == 'B');
 }
 
+TEST_CASE(PREFIX "RotateLines")
+{
+    ScreenBuffer buffer(3, 4);
+    buffer.LoadScreenFromANSI("AAA"
+                              "BBB"
+                              "CCC"
+                              "DDD");
+    buffer.SetLineWrapped(1, true);
+
+    buffer.RotateLines(0, 1, 3);
+    REQUIRE(buffer.DumpScreenAsANSI() == "BBB"
+                                         "CCC"
+                                         "AAA"
+                                         "DDD");
+    CHECK(buffer.LineWrapped(0) == true);
+    CHECK(buffer.LineWrapped(2) == false);
+
+    SECTION("Snapshots keep the order of the lines")
+    {
+        const auto snapshot = buffer.MakeSnapshot();
+        buffer.RotateLines(0, 3, 4);
+        REQUIRE(buffer.DumpScreenAsANSI() == "DDD"
+                                             "BBB"
+                                             "CCC"
+                                             "AAA");
+        buffer.RevertToSnapshot(snapshot);
+        CHECK(buffer.DumpScreenAsANSI() == "BBB"
+                                           "CCC"
+                                           "AAA"
+                                           "DDD");
+    }
+    SECTION("Invalid ranges are ignored")
+    {
+        buffer.RotateLines(2, 1, 3);
+        buffer.RotateLines(0, 1, 5);
+        buffer.RotateLines(-1, 1, 3);
+        CHECK(buffer.DumpScreenAsANSI() == "BBB"
+                                           "CCC"
+                                           "AAA"
+                                           "DDD");
+    }
+}
+
+TEST_CASE(PREFIX "LineGeneration")
+{
+    ScreenBuffer buffer(3, 4);
+    const auto generations = [&] {
+        std::vector<uint64_t> v;
+        for( int y = 0; y != 4; ++y )
+            v.push_back(buffer.LineGeneration(y));
+        return v;
+    };
+    const auto initial = generations();
+    CHECK(std::ranges::none_of(initial, [](uint64_t _g) { return _g == 0; }));
+    CHECK(std::set<uint64_t>(initial.begin(), initial.end()).size() == 4);
+    CHECK(buffer.LineGeneration(-1) == 0);
+    CHECK(buffer.LineGeneration(4) == 0);
+
+    SECTION("Changed lines get new generations")
+    {
+        buffer.MarkLineChanged(2);
+        CHECK(buffer.LineGeneration(2) > initial[3]);
+        CHECK(generations() == std::vector<uint64_t>{initial[0], initial[1], buffer.LineGeneration(2), initial[3]});
+        buffer.SetLineWrapped(1, false); // no change
+        CHECK(buffer.LineGeneration(1) == initial[1]);
+        buffer.SetLineWrapped(1, true);
+        CHECK(buffer.LineGeneration(1) != initial[1]);
+    }
+    SECTION("Rotated lines keep their generations")
+    {
+        buffer.RotateLines(0, 1, 4);
+        CHECK(generations() == std::vector<uint64_t>{initial[1], initial[2], initial[3], initial[0]});
+    }
+    SECTION("Backscreen lines have none")
+    {
+        const auto line = buffer.LineFromNo(0);
+        buffer.FeedBackscreen(line.data(), line.data() + line.size(), false);
+        CHECK(buffer.LineGeneration(-1) == 0);
+    }
+    SECTION("All lines change on a resize or a snapshot revert")
+    {
+        const auto snapshot = buffer.MakeSnapshot();
+        buffer.RevertToSnapshot(snapshot);
+        for( int y = 0; y != 4; ++y )
+            CHECK(buffer.LineGeneration(y) > initial[3]);
+        buffer.ResizeScreen(5, 4, false);
+        for( int y = 0; y != 4; ++y )
+            CHECK(buffer.LineGeneration(y) > initial[3] + 4);
+    }
+}
+
+TEST_CASE(PREFIX "Backscreen lines are read-only")
+{
+    ScreenBuffer buffer(3, 2);
+    buffer.LineFromNo(0).front().l = 'A';
+    const auto line = std::as_const(buffer).LineFromNo(0);
+    buffer.FeedBackscreen(line.data(), line.data() + line.size(), false);
+    CHECK(buffer.LineFromNo(-1).data() == nullptr);
+    REQUIRE(std::as_const(buffer).LineFromNo(-1).size() == 3);
+    CHECK(std::as_const(buffer).LineFromNo(-1)[0].l == 'A');
+}
+
+TEST_CASE(PREFIX "ResizeScreen rewraps the backscreen line continued on the screen")
+{
+    ScreenBuffer buffer(3, 2);
+    const std::u32string text = U"abcdefgh";
+    std::vector<ScreenBuffer::Space> spaces(text.size(), ScreenBuffer::DefaultEraseChar());
+    for( size_t i = 0; i < text.size(); ++i )
+        spaces[i].l = text[i];
+    buffer.FeedBackscreen(spaces.data(), spaces.data() + 6, true); // "abc", "def", continued by "gh" on the screen
+    buffer.LineFromNo(0)[0].l = 'g';
+    buffer.LineFromNo(0)[1].l = 'h';
+    REQUIRE(buffer.BackScreenLines() == 2);
+
+    SECTION("Merging with the backscreen")
+    {
+        buffer.ResizeScreen(5, 3, true);
+        CHECK(buffer.BackScreenLines() == 0);
+        CHECK(buffer.DumpScreenAsANSI() == "abcde"
+                                           "fgh  "
+                                           "     ");
+        CHECK(buffer.LineWrapped(0));
+        CHECK(!buffer.LineWrapped(1));
+    }
+    SECTION("Not merging with the backscreen")
+    {
+        buffer.ResizeScreen(4, 2, false);
+        REQUIRE(buffer.BackScreenLines() == 2);
+        CHECK(std::as_const(buffer).LineFromNo(-2)[3].l == 'd');
+        CHECK(buffer.LineWrapped(-2));
+        CHECK(std::as_const(buffer).LineFromNo(-1)[1].l == 'f');
+        CHECK(!buffer.LineWrapped(-1));
+        CHECK(buffer.DumpScreenAsANSI() == "gh  "
+                                           "    ");
+    }
+}
+
 TEST_CASE(PREFIX "Space::HaveSameAttributes")
 {
     ScreenBuffer::Space s1, s2;
@@ -0,0 +1,225 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include <ScreenSearch.h>
+#include <ParserImpl.h>
+#include <InterpreterImpl.h>
+#include <Screen.h>
+#include <atomic>
+#include <string>
+
+using namespace nc::term;
+#define PREFIX "nc::term::ScreenSearch "
+
+using Match = ScreenSearch::Match;
+
+namespace {
+
+struct Terminal {
+    Terminal(unsigned _width, unsigned _height) : screen(_width, _height), interpreter(screen) {}
+    void Feed(std::string_view _output)
+    {
+        const auto lock = screen.AcquireLock();
+        interpreter.Interpret(parser.Parse({reinterpret_cast<const std::byte *>(_output.data()), _output.size()}));
+    }
+    Screen screen;
+    ParserImpl parser;
+    InterpreterImpl interpreter;
+};
+
+} // namespace
+
+static std::vector<Match>
+Find(const Screen &_screen, std::string_view _text, ScreenSearch::Options _options = {}, int _first = -1'000'000)
+{
+    const auto query = ScreenSearch::Compile(_text, _options);
+    REQUIRE(query);
+    return ScreenSearch::Find(_screen.Buffer(), *query, _first, _screen.Height());
+}
+
+TEST_CASE(PREFIX "Compile")
+{
+    CHECK(ScreenSearch::Compile("", {}) == nullptr);
+    CHECK(ScreenSearch::Compile("(", {}) != nullptr);
+    CHECK(ScreenSearch::Compile("(", {.regex = true}) == nullptr);
+    CHECK(ScreenSearch::Compile("a+", {.regex = true}) != nullptr);
+}
+
+TEST_CASE(PREFIX "Finds literals in the onscreen lines")
+{
+    Terminal term(20, 4);
+    term.Feed("Hello, World!\r\nhello again\r\nbye");
+    SECTION("Case insensitive")
+    {
+        CHECK(Find(term.screen, "hello") == std::vector<Match>{{{0, 0}, {5, 0}}, {{0, 1}, {5, 1}}});
+    }
+    SECTION("Case sensitive")
+    {
+        CHECK(Find(term.screen, "hello", {.case_sensitive = true}) == std::vector<Match>{{{0, 1}, {5, 1}}});
+    }
+    SECTION("Special characters are taken literally")
+    {
+        CHECK(Find(term.screen, "d!") == std::vector<Match>{{{11, 0}, {13, 0}}});
+        CHECK(Find(term.screen, "o.").empty());
+    }
+    SECTION("Doesn't match across lines")
+    {
+        CHECK(Find(term.screen, "again\nbye", {.regex = true}).empty());
+        CHECK(Find(term.screen, "again\\sbye", {.regex = true}).empty());
+    }
+    SECTION("Lines range")
+    {
+        CHECK(Find(term.screen, "hello", {}, 1) == std::vector<Match>{{{0, 1}, {5, 1}}});
+    }
+}
+
+TEST_CASE(PREFIX "Finds regular expressions")
+{
+    Terminal term(20, 4);
+    term.Feed("error: 1\r\nno error: 2\r\nerror: 3");
+    CHECK(Find(term.screen, "^error: \\d", {.regex = true}) ==
+          std::vector<Match>{{{0, 0}, {8, 0}}, {{0, 2}, {8, 2}}});
+    CHECK(Find(term.screen, "\\d$", {.regex = true}).size() == 3);
+    CHECK(Find(term.screen, "x*", {.regex = true}).empty()); // empty matches are skipped
+}
+
+TEST_CASE(PREFIX "Matches wrapped lines as a whole")
+{
+    Terminal term(10, 4);
+    term.Feed("0123456789abcdef\r\n");
+    REQUIRE(term.screen.Buffer().LineWrapped(0));
+    CHECK(Find(term.screen, "89ab") == std::vector<Match>{{{8, 0}, {2, 1}}});
+    CHECK(Find(term.screen, "89ab", {}, 1) == std::vector<Match>{{{8, 0}, {2, 1}}}); // the whole logical line
+}
+
+TEST_CASE(PREFIX "Maps the matches back to the screen spaces")
+{
+    Terminal term(20, 4);
+    SECTION("Wide characters")
+    {
+        term.Feed("日本語 text\r\n");
+        CHECK(Find(term.screen, "本") == std::vector<Match>{{{2, 0}, {4, 0}}});
+        CHECK(Find(term.screen, "text") == std::vector<Match>{{{7, 0}, {11, 0}}});
+    }
+    SECTION("Extended graphemes")
+    {
+        term.Feed("caf\x65\xCC\x81 au lait\r\n");
+        CHECK(Find(term.screen, "caf\x65\xCC\x81") == std::vector<Match>{{{0, 0}, {4, 0}}});
+        CHECK(Find(term.screen, "au") == std::vector<Match>{{{5, 0}, {7, 0}}});
+    }
+    SECTION("Cyrillic, case insensitive")
+    {
+        term.Feed("Съешь ещё\r\n");
+        CHECK(Find(term.screen, "СЪЕШЬ") == std::vector<Match>{{{0, 0}, {5, 0}}});
+    }
+    SECTION("Gaps between the characters")
+    {
+        term.Feed("a\x1B[5Cb\r\n");
+        CHECK(Find(term.screen, "a     b") == std::vector<Match>{{{0, 0}, {7, 0}}});
+    }
+}
+
+TEST_CASE(PREFIX "Finds in the backscreen")
+{
+    Terminal term(40, 5);
+    for( int i = 0; i < 100; ++i )
+        term.Feed("line #" + std::to_string(i) + "\r\n");
+    const auto matches = Find(term.screen, "#7\\d", {.regex = true});
+    REQUIRE(matches.size() == 10);
+    CHECK(matches.front() == Match{{5, 70 - 96}, {8, 70 - 96}});
+    CHECK(matches.back() == Match{{5, 79 - 96}, {8, 79 - 96}});
+}
+
+TEST_CASE(PREFIX "Searches in the background")
+{
+    Terminal term(40, 10);
+    for( int i = 0; i < 20'000; ++i )
+        term.Feed("line #" + std::to_string(i) + "\r\n");
+
+    ScreenSearch search(term.screen);
+    std::atomic_int changes = 0;
+    search.SetOnChanged([&] { ++changes; });
+    search.SetQuery(ScreenSearch::Compile("#1\\d\\d\\d\\d$", {.regex = true}));
+    search.Wait();
+    CHECK(changes > 0);
+    CHECK(search.InProgress() == false);
+    CHECK(search.Count() == 10'000);
+    {
+        const auto lock = term.screen.AcquireLock();
+        const auto backscreen = static_cast<int>(term.screen.Buffer().BackScreenLines());
+        const auto matches = search.Matches(-backscreen, term.screen.Height());
+        REQUIRE(matches.size() == 10'000);
+        CHECK(matches.front().begin.y == 10'000 - 19'991);
+        CHECK(matches.back().begin.y == 19'999 - 19'991);
+        CHECK(std::is_sorted(matches.begin(), matches.end(), [](const Match &_lhs, const Match &_rhs) {
+            return _lhs.begin < _rhs.begin;
+        }));
+        CHECK(search.Matches(10'000 - 19'991, 10'000 - 19'991 + 1).size() == 1);
+    }
+
+    SECTION("New output")
+    {
+        term.Feed("line #12345\r\nline #2\r\nline #3");
+        search.Update();
+        search.Wait();
+        CHECK(search.Count() == 10'001);
+        const auto lock = term.screen.AcquireLock();
+        const auto last = search.Previous({0, term.screen.Height()});
+        REQUIRE(last);
+        CHECK(last->begin.y == term.screen.CursorY() - 2);
+
+        // the match keeps its place while the line scrolls
+        term.interpreter.Interpret(term.parser.Parse({reinterpret_cast<const std::byte *>("\r\n\r\n\r\n\r\n"), 8}));
+        const auto moved = search.Previous({0, term.screen.Height()});
+        REQUIRE(moved);
+        CHECK(moved->begin.y == last->begin.y - 4);
+    }
+    SECTION("Navigation")
+    {
+        const auto lock = term.screen.AcquireLock();
+        const auto first = search.Next({0, -1'000'000});
+        REQUIRE(first);
+        CHECK(first->begin.y == 10'000 - 19'991);
+        const auto second = search.Next(first->begin);
+        REQUIRE(second);
+        CHECK(second->begin.y == first->begin.y + 1);
+        CHECK(search.Previous(second->begin) == first);
+        CHECK(search.Previous(first->begin) == std::nullopt);
+    }
+    SECTION("Another query")
+    {
+        search.SetQuery(ScreenSearch::Compile("#12345", {}));
+        search.Wait();
+        CHECK(search.Count() == 1);
+        search.SetQuery(nullptr);
+        search.Wait();
+        CHECK(search.Count() == 0);
+    }
+    SECTION("Resize")
+    {
+        {
+            const auto lock = term.screen.AcquireLock();
+            term.screen.ResizeScreen(20, 10);
+        }
+        search.Update();
+        search.Wait();
+        CHECK(search.Count() == 10'000);
+    }
+}
+
+TEST_CASE(PREFIX "Skips the lines dropped from the backscreen")
+{
+    Terminal term(40, 10);
+    term.screen.Buffer().SetBackScreenLimits({.max_lines = 1000});
+    ScreenSearch search(term.screen);
+    search.SetQuery(ScreenSearch::Compile("line", {}));
+    for( int i = 0; i < 5000; ++i ) {
+        term.Feed("line #" + std::to_string(i) + "\r\n");
+        search.Update();
+    }
+    search.Wait();
+    const auto lock = term.screen.AcquireLock();
+    const auto &buffer = term.screen.Buffer();
+    const auto matches = search.Matches(-1'000'000, term.screen.Height());
+    CHECK(matches.size() == buffer.BackScreenLines() + term.screen.CursorY());
+    CHECK(matches.front().begin.y == -static_cast<int>(buffer.BackScreenLines()));
+}
@@ -1,4 +1,4 @@
-// Copyright (C) 2015-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2015-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <Screen.h>
 #include "Tests.h"
 
@@ -121,6 +121,117 @@ TEST_CASE(PREFIX"ScrollDown")
                                                 "ABCDE     ");
 }
 
+TEST_CASE(PREFIX"Marks the changed lines")
+{
+    Screen screen(10, 4);
+    const auto &buffer = screen.Buffer();
+    const auto generations = [&] {
+        std::vector<uint64_t> v;
+        for( int y = 0; y != screen.Height(); ++y )
+            v.push_back(buffer.LineGeneration(y));
+        return v;
+    };
+    const auto changed = [&](const std::vector<uint64_t> &_before) {
+        std::vector<int> lines;
+        const auto after = generations();
+        for( int y = 0; y != screen.Height(); ++y )
+            if( after[y] != _before[y] )
+                lines.push_back(y);
+        return lines;
+    };
+    screen.GoTo(2, 1);
+    const auto before = generations();
+    SECTION("PutCh")
+    {
+        screen.PutCh('A');
+        CHECK(changed(before) == std::vector<int>{1});
+    }
+    SECTION("PutASCII")
+    {
+        screen.PutASCII("ABC");
+        CHECK(changed(before) == std::vector<int>{1});
+    }
+    SECTION("EraseInLine")
+    {
+        screen.EraseInLine(0);
+        CHECK(changed(before) == std::vector<int>{1});
+    }
+    SECTION("EraseInLineCount")
+    {
+        screen.EraseInLineCount(2);
+        CHECK(changed(before) == std::vector<int>{1});
+    }
+    SECTION("EraseAt")
+    {
+        screen.EraseAt(0, 3, 2);
+        CHECK(changed(before) == std::vector<int>{3});
+    }
+    SECTION("DoShiftRowLeft")
+    {
+        screen.DoShiftRowLeft(1);
+        CHECK(changed(before) == std::vector<int>{1});
+    }
+    SECTION("DoShiftRowRight")
+    {
+        screen.DoShiftRowRight(1);
+        CHECK(changed(before) == std::vector<int>{1});
+    }
+    SECTION("DoEraseScreen")
+    {
+        screen.DoEraseScreen(0);
+        CHECK(changed(before) == std::vector<int>{1, 2, 3});
+        screen.DoEraseScreen(1);
+        CHECK(changed(before) == std::vector<int>{0, 1, 2, 3});
+    }
+    SECTION("FillScreenWithSpace")
+    {
+        screen.FillScreenWithSpace(ScreenBuffer::DefaultEraseChar());
+        CHECK(changed(before) == std::vector<int>{0, 1, 2, 3});
+    }
+    SECTION("Cursor movements don't change anything")
+    {
+        screen.GoTo(5, 3);
+        screen.DoCursorUp();
+        CHECK(changed(before).empty());
+    }
+    SECTION("Scrolled lines move along with their generations")
+    {
+        screen.DoScrollUp(0, 4, 1);
+        const auto after = generations();
+        CHECK(after[0] == before[1]);
+        CHECK(after[1] == before[2]);
+        CHECK(after[2] == before[3]);
+        CHECK(after[3] != before[0]); // erased
+
+        screen.ScrollDown(1, 4, 2);
+        const auto after2 = generations();
+        CHECK(after2[0] == after[0]);
+        CHECK(after2[3] == after[1]);
+        CHECK(after2[1] != after[2]);
+        CHECK(after2[2] != after[3]);
+    }
+    SECTION("Lines scrolled into the backscreen keep their positions in the whole buffer")
+    {
+        // i.e. they stay at the same places of the terminal view, which grows by the scrolled lines
+        const auto position_of = [&](uint64_t _generation) {
+            for( int y = 0; y != screen.Height(); ++y )
+                if( buffer.LineGeneration(y) == _generation )
+                    return static_cast<int>(buffer.BackScreenLines()) + y;
+            return -1;
+        };
+        const auto positions = [&] {
+            std::vector<int> v;
+            for( int y = 1; y != screen.Height(); ++y )
+                v.push_back(position_of(before[y]));
+            return v;
+        };
+        const auto initial = positions();
+        screen.DoScrollUp(0, 4, 1);
+        CHECK(buffer.BackScreenLines() == 1);
+        CHECK(positions() == initial);
+    }
+}
+
 //TEST_CASE(PREFIX"Line overflow logic")
 //{
 //    Screen screen(10, 1);
@@ -0,0 +1,73 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "Tests.h"
+#include <Scrollback.h>
+#include <string>
+
+// NB! disabled by default, include in the Term tests target to enable
+
+using namespace nc::term;
+using Space = ScreenBuffer::Space;
+#define PREFIX "nc::term::Scrollback PT "
+
+// Something resembling a build log: lines of ~60 characters with a colored prefix
+static void MakeLogLine(size_t _index, std::vector<Space> &_line)
+{
+    std::fill(_line.begin(), _line.end(), ScreenBuffer::DefaultEraseChar());
+    const auto text = "[" + std::to_string(_index) + "] compiling source/module_" + std::to_string(_index % 997) +
+                      ".cpp -o build/module_" + std::to_string(_index % 997) + ".o";
+    for( size_t i = 0; i < text.size() && i < _line.size(); ++i ) {
+        _line[i].l = static_cast<unsigned char>(text[i]);
+        if( i < 10 ) {
+            _line[i].customfg = true;
+            _line[i].foreground = Color(2);
+        }
+    }
+}
+
+TEST_CASE(PREFIX "Feeding 10M lines", "[!benchmark]")
+{
+    constexpr size_t lines = 10'000'000;
+    for( const size_t width : {80, 200} ) {
+        const auto suffix = " - " + std::to_string(width) + " columns";
+        std::vector<Space> line(width);
+
+        Scrollback::Limits unlimited;
+        unlimited.max_lines = std::numeric_limits<size_t>::max();
+        unlimited.max_bytes = std::numeric_limits<size_t>::max();
+        {
+            Scrollback sb(unlimited);
+            for( size_t i = 0; i < lines; ++i ) {
+                MakeLogLine(i, line);
+                sb.Append(line, false);
+            }
+            const size_t raw = lines * width * sizeof(Space);
+            WARN("Memory" << suffix << ": " << sb.Bytes() / (1024 * 1024) << "MB vs " << raw / (1024 * 1024)
+                          << "MB uncompressed, " << static_cast<double>(raw) / static_cast<double>(sb.Bytes())
+                          << "x");
+        }
+
+        BENCHMARK("Append with the default limits" + suffix)
+        {
+            Scrollback sb;
+            for( size_t i = 0; i < lines; ++i ) {
+                MakeLogLine(i, line);
+                sb.Append(line, false);
+            }
+            return sb.Size();
+        };
+
+        Scrollback sb;
+        for( size_t i = 0; i < Scrollback::PageLines * 100; ++i ) {
+            MakeLogLine(i, line);
+            sb.Append(line, false);
+        }
+        BENCHMARK("Reading all lines backwards" + suffix)
+        {
+            size_t total = 0;
+            for( size_t i = sb.Size(); i-- > 0; )
+                total += sb.Line(i).size();
+            return total;
+        };
+    }
+}
@@ -0,0 +1,214 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include <Scrollback.h>
+#include <bit>
+#include <random>
+
+using namespace nc::term;
+using Space = ScreenBuffer::Space;
+#define PREFIX "nc::term::Scrollback "
+
+static std::vector<Space> MakeLine(std::u32string_view _text, size_t _width)
+{
+    std::vector<Space> line(std::max(_text.size(), _width), ScreenBuffer::DefaultEraseChar());
+    for( size_t i = 0; i < _text.size(); ++i )
+        line[i].l = _text[i];
+    return line;
+}
+
+static bool Same(std::span<const Space> _lhs, std::span<const Space> _rhs)
+{
+    return std::equal(_lhs.begin(), _lhs.end(), _rhs.begin(), _rhs.end(), [](const Space &_l, const Space &_r) {
+        return std::bit_cast<uint64_t>(_l) == std::bit_cast<uint64_t>(_r);
+    });
+}
+
+TEST_CASE(PREFIX "Empty")
+{
+    Scrollback sb;
+    CHECK(sb.Size() == 0);
+    CHECK(sb.Bytes() == 0);
+    CHECK(sb.Line(0).empty());
+    CHECK(sb.Wrapped(0) == false);
+}
+
+TEST_CASE(PREFIX "Gives back the appended lines, across the compressed pages")
+{
+    std::mt19937 rnd(42);
+    std::vector<std::pair<std::vector<Space>, bool>> reference;
+    Scrollback sb;
+    for( size_t i = 0; i < Scrollback::PageLines * 5 + 17; ++i ) {
+        std::vector<Space> line(rnd() % 100, ScreenBuffer::DefaultEraseChar());
+        const size_t occupied = line.empty() ? 0 : rnd() % line.size();
+        for( size_t j = 0; j < occupied; ++j ) {
+            switch( rnd() % 6 ) {
+                case 0:
+                    line[j].l = U'ж';
+                    break;
+                case 1:
+                    line[j].l = U'😀';
+                    break;
+                case 2:
+                    line[j].l = static_cast<char32_t>(0x80000000u | (rnd() % 100)); // an extended character
+                    break;
+                case 3:
+                    line[j].l = ScreenBuffer::MultiCellGlyph;
+                    break;
+                default:
+                    line[j].l = 'a' + rnd() % 26;
+            }
+            line[j].customfg = rnd() % 4 == 0;
+            line[j].foreground = Color(static_cast<uint8_t>(rnd() % 16));
+            line[j].bold = rnd() % 8 == 0;
+        }
+        if( !line.empty() && rnd() % 4 == 0 )
+            line.back().custombg = true; // an attribute without a character is not an empty space
+        const bool wrapped = rnd() % 3 == 0;
+        sb.Append(line, wrapped);
+        reference.emplace_back(std::move(line), wrapped);
+    }
+
+    REQUIRE(sb.Size() == reference.size());
+    for( size_t i = 0; i < reference.size(); ++i ) {
+        const auto line = sb.Line(i);
+        CHECK(line.data() != nullptr);
+        CHECK(Same(line, reference[i].first));
+        CHECK(sb.Wrapped(i) == reference[i].second);
+    }
+    for( size_t i = reference.size(); i-- > 0; ) // backwards, jumping between the pages
+        CHECK(Same(sb.Line(i), reference[i].first));
+
+    sb.SetWrapped(3, !reference[3].second);
+    CHECK(sb.Wrapped(3) == !reference[3].second);
+}
+
+TEST_CASE(PREFIX "Drops the oldest pages beyond the lines limit")
+{
+    Scrollback::Limits limits;
+    limits.max_lines = 1000;
+    Scrollback sb(limits);
+    for( int i = 0; i < 10000; ++i )
+        sb.Append(MakeLine(std::u32string(1, U'0' + i % 10), 80), false);
+    CHECK(sb.Size() <= 1000);
+    CHECK(sb.Size() > 1000 - Scrollback::PageLines);
+    CHECK(sb.Line(sb.Size() - 1)[0].l == U'9');
+    CHECK(sb.Dropped() + sb.Size() == 10000);
+
+    limits.max_lines = 10;
+    sb.SetLimits(limits);
+    CHECK(sb.Size() <= Scrollback::PageLines);
+    CHECK(sb.Dropped() + sb.Size() == 10000);
+}
+
+TEST_CASE(PREFIX "Drops the oldest pages beyond the bytes limit")
+{
+    Scrollback::Limits limits;
+    limits.max_bytes = 100'000;
+    Scrollback sb(limits);
+    for( int i = 0; i < 100'000; ++i )
+        sb.Append(MakeLine(U"some line of a log " + std::u32string(1, U'a' + i % 26), 200), false);
+    CHECK(sb.Bytes() <= 100'000 + Scrollback::PageLines * 200 * sizeof(Space));
+    CHECK(sb.Size() < 100'000);
+}
+
+TEST_CASE(PREFIX "Compresses a typical log")
+{
+    Scrollback::Limits limits;
+    limits.max_lines = std::numeric_limits<size_t>::max();
+    Scrollback sb(limits);
+    const size_t width = 80;
+    const size_t lines = 10'000;
+    for( size_t i = 0; i < lines; ++i ) {
+        const auto text = "[" + std::to_string(i) + "] compiling source/module_" + std::to_string(i % 97) + ".cpp";
+        sb.Append(MakeLine(std::u32string(text.begin(), text.end()), width), false);
+    }
+    CHECK(sb.Bytes() * 5 < lines * width * sizeof(Space));
+}
+
+TEST_CASE(PREFIX "Clear")
+{
+    Scrollback sb;
+    for( int i = 0; i < 1000; ++i )
+        sb.Append(MakeLine(U"abc", 10), true);
+    sb.Clear();
+    CHECK(sb.Size() == 0);
+    CHECK(sb.Dropped() == 0);
+    CHECK(sb.Line(0).empty());
+    sb.Append(MakeLine(U"def", 10), false);
+    CHECK(sb.Line(0)[0].l == U'd');
+}
+
+TEST_CASE(PREFIX "PopBack")
+{
+    Scrollback sb;
+    for( size_t i = 0; i < Scrollback::PageLines + 2; ++i )
+        sb.Append(MakeLine(std::u32string(1, U'a' + i % 26), 10), i % 2 == 0);
+    for( int i = 0; i < 3; ++i )
+        sb.PopBack();
+    REQUIRE(sb.Size() == Scrollback::PageLines - 1);
+    CHECK(sb.Line(sb.Size() - 1)[0].l == U'a' + (Scrollback::PageLines - 2) % 26);
+    CHECK(sb.Wrapped(sb.Size() - 1) == true);
+    sb.Append(MakeLine(U"xyz", 10), false);
+    CHECK(sb.Line(sb.Size() - 1)[2].l == U'z');
+    CHECK(sb.Line(sb.Size() - 2)[0].l == U'a' + (Scrollback::PageLines - 2) % 26);
+}
+
+TEST_CASE(PREFIX "Rewrap")
+{
+    std::mt19937 rnd(42);
+    const size_t width = 20;
+    Scrollback sb;
+    std::vector<std::u32string> paragraphs; // the joined lines
+    for( size_t i = 0; i < Scrollback::PageLines * 6; ++i ) {
+        // the first pages are plain short lines, the rest are the long paragraphs wrapped to the width
+        const size_t length = i < Scrollback::PageLines * 3 ? rnd() % 15 : rnd() % 70;
+        std::u32string text;
+        for( size_t j = 0; j < length; ++j )
+            text += static_cast<char32_t>('a' + rnd() % 26);
+        for( size_t j = 0; j == 0 || j < text.size(); j += width ) {
+            const auto piece = text.substr(j, width);
+            sb.Append(MakeLine(piece, width), j + width < text.size());
+        }
+        paragraphs.emplace_back(std::move(text));
+    }
+    const auto unfinished = MakeLine(U"unfinished line", width);
+    sb.Append(unfinished, true);
+
+    const auto check = [&](size_t _width) {
+        size_t index = 0;
+        for( const auto &text : paragraphs )
+            for( size_t j = 0; j == 0 || j < text.size(); j += _width, ++index ) {
+                const auto piece = text.substr(j, _width);
+                const auto line = sb.Line(index);
+                REQUIRE(ScreenBuffer::OccupiedChars(line) == piece.size());
+                CHECK(line.size() <= _width);
+                for( size_t k = 0; k < piece.size(); ++k )
+                    CHECK(line[k].l == piece[k]);
+                CHECK(sb.Wrapped(index) == (j + _width < text.size()));
+            }
+        CHECK(sb.Size() == index);
+    };
+
+    SECTION("Narrower")
+    {
+        const auto rest = sb.Rewrap(7);
+        REQUIRE(rest);
+        CHECK(Same(*rest, MakeLine(U"unfinished line", 0)));
+        check(7);
+    }
+    SECTION("Wider")
+    {
+        const auto rest = sb.Rewrap(33);
+        REQUIRE(rest);
+        CHECK(rest->size() == 15);
+        check(33);
+        sb.Rewrap(5);
+        check(5);
+    }
+    SECTION("Without an unfinished line")
+    {
+        sb.PopBack();
+        CHECK(sb.Rewrap(50) == std::nullopt);
+        check(50);
+    }
+}
@@ -0,0 +1,126 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "Tests.h"
+#include <ParserImpl.h>
+#include <InterpreterImpl.h>
+#include <Screen.h>
+#include <chrono>
+#include <string>
+
+// NB! disabled by default, include in the Term tests target to enable
+
+using namespace nc::term;
+#define PREFIX "nc::term::TextThroughput PT "
+
+// The streams below mimic the output of common commands as the terminal receives it, i.e. with CR LF line endings
+// since the tty driver translates the newlines.
+
+static constexpr size_t g_StreamSize = 64 * 1024 * 1024;
+
+// The amount of bytes a shell task gets from the pty in one go
+static constexpr size_t g_ReadSize = 8192;
+
+// `cat` of a service log
+static std::string MakeLogStream()
+{
+    std::string s;
+    for( size_t i = 0; s.size() < g_StreamSize; ++i )
+        s += "2024-03-11 12:" + std::to_string(10 + i % 50) + ":" + std::to_string(10 + i % 49) + "." +
+             std::to_string(100 + i % 900) + " [info] worker-" + std::to_string(i % 16) +
+             ": processed request #" + std::to_string(i) + " from 10.0.0." + std::to_string(i % 256) + " in " +
+             std::to_string(i % 97) + "ms\r\n";
+    return s;
+}
+
+// Colored compiler diagnostics
+static std::string MakeBuildStream()
+{
+    std::string s;
+    for( size_t i = 0; s.size() < g_StreamSize; ++i ) {
+        const auto file = "/Users/dev/project/Source/Module" + std::to_string(i % 31) + "/source/File" +
+                          std::to_string(i % 113) + ".cpp";
+        s += "\x1B[1m" + file + ":" + std::to_string(i % 900) + ":" + std::to_string(i % 80) +
+             ": \x1B[0m\x1B[0;1;35mwarning: \x1B[0m\x1B[1munused variable 'value" + std::to_string(i % 10) +
+             "' [-Wunused-variable]\x1B[0m\r\n";
+        s += "    const auto value" + std::to_string(i % 10) + " = Calculate(input, options);\r\n";
+        s += "\x1B[0;1;32m               ^\r\n\x1B[0m";
+    }
+    return s;
+}
+
+// `ls -l --color`
+static std::string MakeListingStream()
+{
+    std::string s;
+    for( size_t i = 0; s.size() < g_StreamSize; ++i ) {
+        if( i % 5 == 0 )
+            s += "drwxr-xr-x  " + std::to_string(2 + i % 40) + " dev  staff  " + std::to_string(64 + i % 4000) +
+                 " Mar 11 12:34 \x1B[1;34mdirectory_" + std::to_string(i) + "\x1B[0m\r\n";
+        else
+            s += "-rw-r--r--  1 dev  staff  " + std::to_string(i * 37 % 1000000) + " Mar 11 12:34 file_" +
+                 std::to_string(i) + ".txt\r\n";
+    }
+    return s;
+}
+
+// `cat` of a text in Russian and Chinese
+static std::string MakeUnicodeStream()
+{
+    std::string s;
+    for( size_t i = 0; s.size() < g_StreamSize; ++i ) {
+        s += std::to_string(i) + ". Съешь же ещё этих мягких французских булок, да выпей чаю.\r\n";
+        s += std::to_string(i) + ". 敏捷的棕色狐狸跳过了懒狗。\r\n";
+    }
+    return s;
+}
+
+static void Feed(std::string_view _stream, ParserImpl &_parser, InterpreterImpl &_interpreter)
+{
+    for( size_t pos = 0; pos < _stream.size(); pos += g_ReadSize ) {
+        const auto chunk = _stream.substr(pos, g_ReadSize);
+        const auto commands =
+            _parser.Parse({reinterpret_cast<const std::byte *>(chunk.data()), chunk.size()});
+        _interpreter.Interpret(commands);
+    }
+}
+
+TEST_CASE(PREFIX "Parsing and interpreting recorded streams", "[!benchmark]")
+{
+    const std::pair<const char *, std::string> streams[] = {{"log", MakeLogStream()},
+                                                            {"build", MakeBuildStream()},
+                                                            {"listing", MakeListingStream()},
+                                                            {"unicode", MakeUnicodeStream()}};
+    for( const auto &[name, stream] : streams ) {
+        {
+            Screen screen(200, 50);
+            ParserImpl parser;
+            InterpreterImpl interpreter(screen);
+            const auto start = std::chrono::steady_clock::now();
+            Feed(stream, parser, interpreter);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            WARN("Throughput - " << name << ": "
+                                 << static_cast<double>(stream.size()) / (1024. * 1024.) / elapsed.count()
+                                 << "MB/s");
+        }
+
+        BENCHMARK(std::string("Parsing - ") + name)
+        {
+            ParserImpl parser;
+            size_t commands = 0;
+            for( size_t pos = 0; pos < stream.size(); pos += g_ReadSize ) {
+                const auto chunk = std::string_view(stream).substr(pos, g_ReadSize);
+                commands += parser.Parse({reinterpret_cast<const std::byte *>(chunk.data()), chunk.size()}).size();
+            }
+            return commands;
+        };
+
+        BENCHMARK(std::string("Parsing and interpreting - ") + name)
+        {
+            Screen screen(200, 50);
+            ParserImpl parser;
+            InterpreterImpl interpreter(screen);
+            Feed(stream, parser, interpreter);
+            return screen.CursorY();
+        };
+    }
+}
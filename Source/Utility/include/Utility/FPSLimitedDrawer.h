@@ -1,4 +1,4 @@
-// Copyright (C) 2014-2016 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <Cocoa/Cocoa.h>
@@ -31,4 +31,11 @@
 @required
 @property (nonatomic, readonly) FPSLimitedDrawer *fpsDrawer;
 
+@optional
+/**
+ * Called instead of marking the whole view as needing display when it's time to redraw,
+ * letting the view invalidate only the parts which have actually changed.
+ */
+- (void) invalidateChangedRegions;
+
 @end
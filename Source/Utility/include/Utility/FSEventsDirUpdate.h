@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <string>
+#include <string_view>
 #include <functional>
 
 namespace nc::utility {
@@ -19,6 +20,15 @@ public:
     // Any other values represent observation tickets.
     virtual uint64_t AddWatchPath(const char *_path, std::function<void()> _handler) = 0;
 
+    // Registers _handler as a watch callback for any changes inside the directory '_path', including all its
+    // subdirectories. The handler receives the path of a changed directory, spelled with the '_path' prefix and with a
+    // trailing slash. If _recursive is true, the events were coalesced or dropped by the system and the whole subtree
+    // below that directory has to be rescanned.
+    // Zero will be returned to indicate an error.
+    // Any other values represent observation tickets, they are deregistered via RemoveWatchPathWithTicket().
+    virtual uint64_t AddWatchSubtree(const char *_path,
+                                     std::function<void(std::string_view _dir, bool _recursive)> _handler) = 0;
+
     // Deregisters the watcher identified by _ticket.
     virtual void RemoveWatchPathWithTicket(uint64_t _ticket) = 0;
 
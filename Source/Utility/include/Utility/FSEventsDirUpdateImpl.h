@@ -5,6 +5,7 @@
 #include <CoreServices/CoreServices.h>
 #include <Base/spinlock.h>
 #include <filesystem>
+#include <optional>
 #include <Base/RobinHoodUtil.h>
 
 namespace nc::utility {
@@ -14,6 +15,9 @@ class FSEventsDirUpdateImpl : public FSEventsDirUpdate
 public:
     uint64_t AddWatchPath(const char *_path, std::function<void()> _handler) override;
 
+    uint64_t AddWatchSubtree(const char *_path,
+                             std::function<void(std::string_view _dir, bool _recursive)> _handler) override;
+
     void RemoveWatchPathWithTicket(uint64_t _ticket) override;
 
     // Implementation detail exposed for testability
@@ -22,6 +26,14 @@ public:
                            const char *_event_paths[],
                            const FSEventStreamEventFlags _event_flags[]) noexcept;
 
+    // Implementation detail exposed for testability.
+    // Maps an event of the stream watching _real_path to a changed directory below _path and tells whether its whole
+    // subtree has to be rescanned. Returns nothing for events outside the watched subtree.
+    static std::optional<std::pair<std::string, bool>> SubtreeChange(std::string_view _path,
+                                                                     std::string_view _real_path,
+                                                                     const char *_event_path,
+                                                                     FSEventStreamEventFlags _event_flags);
+
 private:
     struct WatchData {
         std::string_view path; // canonical fs representation, should include a trailing slash. points into hashmap
@@ -29,6 +41,13 @@ private:
         std::vector<std::pair<uint64_t, std::function<void()>>> handlers;
     };
 
+    struct SubtreeWatchData {
+        std::string path;      // as requested, with a trailing slash
+        std::string real_path; // canonical fs representation, with a trailing slash
+        FSEventStreamRef stream = nullptr;
+        std::function<void(std::string_view _dir, bool _recursive)> handler;
+    };
+
     using WatchesT = robin_hood::
         unordered_node_map<std::string, WatchData, RHTransparentStringHashEqual, RHTransparentStringHashEqual>;
 
@@ -41,10 +60,18 @@ private:
                                           void *eventPaths,
                                           const FSEventStreamEventFlags eventFlags[],
                                           const FSEventStreamEventId eventIds[]);
-    static FSEventStreamRef CreateEventStream(const std::string &path, void *context);
+    static void FSEventsSubtreeCallback(ConstFSEventStreamRef streamRef,
+                                        void *userData,
+                                        size_t numEvents,
+                                        void *eventPaths,
+                                        const FSEventStreamEventFlags eventFlags[],
+                                        const FSEventStreamEventId eventIds[]);
+    static FSEventStreamRef
+    CreateEventStream(const std::string &path, void *context, FSEventStreamCallback callback);
 
     spinlock m_Lock;
     WatchesT m_Watches;                // path -> watch data;
+    robin_hood::unordered_node_map<uint64_t, SubtreeWatchData> m_SubtreeWatches; // ticket -> watch data
     std::atomic_ulong m_LastTicket{1}; // no #0 ticket, it's an error code
 };
 
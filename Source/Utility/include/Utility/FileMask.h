@@ -1,4 +1,4 @@
-// Copyright (C) 2013-2022 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 #include <string>
 #include <string_view>
@@ -46,6 +46,11 @@ public:
      */
     const std::string &Mask() const noexcept;
 
+    /**
+     * Get the type of the current file mask.
+     */
+    Type MaskType() const noexcept;
+
     /**
      * Return true if _mask is a wildcard(s).
      * If it's a set of fixed names or a single word - return false.
@@ -75,6 +80,9 @@ private:
 
     // The original string this mask was constructed with
     std::string m_Mask;
+
+    // The type of the original string
+    Type m_Type = Type::Mask;
 };
 
 } // namespace nc::utility
@@ -1,4 +1,4 @@
-// Copyright (C) 2014-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <atomic>
 #include <Base/mach_time.h>
 #include <Base/dispatch_cpp.h>
@@ -78,7 +78,11 @@ static const nanoseconds m_MaxTimeBeforeInvalidation = 1s;
 {
     if( self.view ) {
         if( m_Dirty ) {
-            self.view.needsDisplay = true;
+            const id view = self.view;
+            if( [view respondsToSelector:@selector(invalidateChangedRegions)] )
+                [view invalidateChangedRegions];
+            else
+                self.view.needsDisplay = true;
             m_Dirty = false;
             m_LastDrawedTime = nc::base::machtime();
         }
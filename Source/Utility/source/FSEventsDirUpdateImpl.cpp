@@ -75,6 +75,38 @@ bool FSEventsDirUpdateImpl::ShouldFire(const std::string_view _watched_path,
     return false;
 }
 
+std::optional<std::pair<std::string, bool>> FSEventsDirUpdateImpl::SubtreeChange(std::string_view _path,
+                                                                                 std::string_view _real_path,
+                                                                                 const char *_event_path,
+                                                                                 FSEventStreamEventFlags _event_flags)
+{
+    assert(!_path.empty() && _path.back() == '/');
+    assert(!_real_path.empty() && _real_path.back() == '/');
+
+    // the watched directory itself was moved or deleted - nothing below it can be trusted
+    if( _event_flags & kFSEventStreamEventFlagRootChanged )
+        return std::pair{std::string(_path), true};
+
+    const bool recursive = _event_flags & (kFSEventStreamEventFlagMustScanSubDirs | kFSEventStreamEventFlagMount |
+                                           kFSEventStreamEventFlagUnmount);
+    const auto event_path = std::string_view{_event_path != nullptr ? _event_path : ""};
+    std::string_view relative;
+    if( event_path.size() + 1 == _real_path.size() && _real_path.starts_with(event_path) )
+        relative = {}; // the watched directory itself, spelled without a trailing slash
+    else if( event_path.starts_with(_real_path) )
+        relative = event_path.substr(_real_path.size());
+    else
+        return std::nullopt;
+
+    std::string dir;
+    dir.reserve(_path.size() + relative.size() + 1);
+    dir += _path;
+    dir += relative;
+    if( dir.back() != '/' )
+        dir += '/';
+    return std::pair{std::move(dir), recursive};
+}
+
 void FSEventsDirUpdateImpl::FSEventsDirUpdateCallback([[maybe_unused]] ConstFSEventStreamRef _stream_ref,
                                                       void *_user_data,
                                                       size_t _num,
@@ -96,7 +128,27 @@ void FSEventsDirUpdateImpl::FSEventsDirUpdateCallback([[maybe_unused]] ConstFSEv
     }
 }
 
-FSEventStreamRef FSEventsDirUpdateImpl::CreateEventStream(const std::string &path, void *context_ptr)
+void FSEventsDirUpdateImpl::FSEventsSubtreeCallback([[maybe_unused]] ConstFSEventStreamRef _stream_ref,
+                                                    void *_user_data,
+                                                    size_t _num,
+                                                    void *_paths,
+                                                    const FSEventStreamEventFlags _flags[],
+                                                    [[maybe_unused]] const FSEventStreamEventId _ids[])
+{
+    const auto paths = reinterpret_cast<const char **>(_paths);
+    Log::Trace(SPDLOC,
+               "FSEventsDirUpdate::Impl::FSEventsSubtreeCallback for {} path(s): {}",
+               _num,
+               fmt::join(std::span<const char *>{paths, _num}, ", "));
+
+    const SubtreeWatchData &watch = *static_cast<const SubtreeWatchData *>(_user_data);
+    for( size_t i = 0; i < _num; ++i )
+        if( const auto change = SubtreeChange(watch.path, watch.real_path, paths[i], _flags[i]) )
+            watch.handler(change->first, change->second);
+}
+
+FSEventStreamRef
+FSEventsDirUpdateImpl::CreateEventStream(const std::string &path, void *context_ptr, FSEventStreamCallback callback)
 {
     Log::Debug(SPDLOC, "CreateEventStream called for '{}'", path);
     auto cf_path = base::CFStringCreateWithUTF8StdString(path);
@@ -111,7 +163,7 @@ FSEventStreamRef FSEventsDirUpdateImpl::CreateEventStream(const std::string &pat
         const auto flags = kFSEventStreamCreateFlagNoDefer | kFSEventStreamCreateFlagWatchRoot;
         auto context = FSEventStreamContext{0, context_ptr, nullptr, nullptr, nullptr};
         stream = FSEventStreamCreate(nullptr,
-                                     &FSEventsDirUpdateImpl::FSEventsDirUpdateCallback,
+                                     callback,
                                      &context,
                                      pathsToWatch,
                                      kFSEventStreamEventIdSinceNow,
@@ -197,7 +249,7 @@ uint64_t FSEventsDirUpdateImpl::AddWatchPath(const char *_path, std::function<vo
     auto ep = m_Watches.emplace(dir_path, WatchData{});
     assert(ep.second == true);
     WatchData &w = ep.first->second;
-    w.stream = CreateEventStream(dir_path, &w);
+    w.stream = CreateEventStream(dir_path, &w, &FSEventsDirUpdateImpl::FSEventsDirUpdateCallback);
     if( w.stream == nullptr ) {
         // failed to creat the event stream, roll back the changes and return a failure indication
         m_Watches.erase(ep.first);
@@ -210,6 +262,41 @@ uint64_t FSEventsDirUpdateImpl::AddWatchPath(const char *_path, std::function<vo
     return ticket;
 }
 
+uint64_t FSEventsDirUpdateImpl::AddWatchSubtree(const char *_path,
+                                                std::function<void(std::string_view _dir, bool _recursive)> _handler)
+{
+    if( !_path || !*_path || !_handler )
+        return no_ticket;
+
+    Log::Debug(SPDLOC, "FSEventsDirUpdate::Impl::AddWatchSubtree called for '{}'", _path);
+
+    const auto real_path = GetRealPath(_path);
+    if( real_path.empty() ) {
+        Log::Debug(SPDLOC, "Failed to get a real path of '{}'", _path);
+        return no_ticket;
+    }
+
+    const auto ticket = m_LastTicket++;
+
+    auto lock = std::lock_guard{m_Lock};
+
+    // subtree watches are not shared - each one maps the event paths back to its own spelling of the path
+    SubtreeWatchData &w = m_SubtreeWatches[ticket];
+    w.path = _path;
+    if( w.path.back() != '/' )
+        w.path += '/';
+    w.real_path = real_path;
+    w.handler = std::move(_handler);
+    w.stream = CreateEventStream(real_path, &w, &FSEventsDirUpdateImpl::FSEventsSubtreeCallback);
+    if( w.stream == nullptr ) {
+        m_SubtreeWatches.erase(ticket);
+        return no_ticket;
+    }
+    StartStream(w.stream);
+
+    return ticket;
+}
+
 // Erases an element at '_i' from containers '_c' by swapping it with the last element and then removing the last
 // element. That's to cause less data movements
 template <class Container, class Iterator>
@@ -236,6 +323,12 @@ void FSEventsDirUpdateImpl::RemoveWatchPathWithTicket(uint64_t _ticket)
 
     auto lock = std::lock_guard{m_Lock};
 
+    if( auto i = m_SubtreeWatches.find(_ticket); i != m_SubtreeWatches.end() ) {
+        StopStream(i->second.stream);
+        m_SubtreeWatches.erase(i);
+        return;
+    }
+
     for( auto i = m_Watches.begin(), e = m_Watches.end(); i != e; ++i ) {
         auto &watch = i->second;
         for( auto h = watch.handlers.begin(), he = watch.handlers.end(); h != he; ++h )
@@ -261,6 +354,10 @@ void FSEventsDirUpdateImpl::OnVolumeDidUnmount(const std::string &_on_path)
                 h.second();
         }
     }
+    for( auto &i : m_SubtreeWatches ) {
+        if( i.second.real_path.starts_with(_on_path) )
+            i.second.handler(i.second.path, true);
+    }
 }
 
 } // namespace nc::utility
@@ -1,4 +1,4 @@
-// Copyright (C) 2013-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "FileMask.h"
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -172,7 +172,7 @@ static std::optional<std::string> GetSimpleMask(const std::string &_regexp)
 
 FileMask::FileMask() noexcept = default;
 
-FileMask::FileMask(const std::string_view _mask, const Type _type) : m_Mask(_mask)
+FileMask::FileMask(const std::string_view _mask, const Type _type) : m_Mask(_mask), m_Type(_type)
 {
     if( _mask.empty() )
         return;
@@ -304,6 +304,11 @@ const std::string &FileMask::Mask() const noexcept
     return m_Mask;
 }
 
+FileMask::Type FileMask::MaskType() const noexcept
+{
+    return m_Type;
+}
+
 bool FileMask::IsEmpty() const noexcept
 {
     return m_Masks.empty();
@@ -5,6 +5,8 @@
 #include <Base/dispatch_cpp.h>
 #include <CoreFoundation/CoreFoundation.h>
 #include <fcntl.h>
+#include <filesystem>
+#include <algorithm>
 
 using nc::utility::FSEventsDirUpdate;
 using nc::utility::FSEventsDirUpdateImpl;
@@ -108,6 +110,53 @@ TEST_CASE(PREFIX "Firing logic")
     }
 }
 
+TEST_CASE(PREFIX "Registers subtree listeners")
+{
+    TempTestDir tmp_dir;
+    auto &inst = FSEventsDirUpdate::Instance();
+    std::filesystem::create_directories(tmp_dir.directory / "a/b");
+    const std::string root = tmp_dir.directory;
+    std::vector<std::string> changed;
+
+    const auto ticket = inst.AddWatchSubtree(root.c_str(), [&](std::string_view _dir, bool) {
+        changed.emplace_back(_dir);
+    });
+    REQUIRE(ticket != 0);
+
+    touch(tmp_dir.directory / "a/b/something.txt");
+    REQUIRE(runMainLoopUntilExpectationOrTimeout(
+        5s, [&] { return std::ranges::find(changed, root + "a/b/") != changed.end(); }));
+
+    inst.RemoveWatchPathWithTicket(ticket);
+    changed.clear();
+    touch(tmp_dir.directory / "a/something.txt");
+    CHECK(!runMainLoopUntilExpectationOrTimeout(500ms, [&] { return !changed.empty(); }));
+}
+
+TEST_CASE(PREFIX "Subtree firing logic")
+{
+    using I = FSEventsDirUpdateImpl;
+    using R = std::optional<std::pair<std::string, bool>>;
+    struct TC {
+        const char *event_path;
+        FSEventStreamEventFlags event_flags;
+        R exp;
+    } tcs[] = {
+        {"/private/tmp/dir", 0, R{{"/tmp/dir/", false}}},
+        {"/private/tmp/dir/", 0, R{{"/tmp/dir/", false}}},
+        {"/private/tmp/dir/sub", 0, R{{"/tmp/dir/sub/", false}}},
+        {"/private/tmp/dir/sub/", kFSEventStreamEventFlagMustScanSubDirs, R{{"/tmp/dir/sub/", true}}},
+        {"/private/tmp/dir/vol/", kFSEventStreamEventFlagMount, R{{"/tmp/dir/vol/", true}}},
+        {"/private/tmp/", kFSEventStreamEventFlagRootChanged, R{{"/tmp/dir/", true}}},
+        {"/private/tmp/", 0, std::nullopt},
+        {"/private/tmp/di", 0, std::nullopt},
+        {"/private/tmp/dirr/", 0, std::nullopt},
+        {"", 0, std::nullopt},
+    };
+    for( auto &tc : tcs )
+        CHECK(I::SubtreeChange("/tmp/dir/", "/private/tmp/dir/", tc.event_path, tc.event_flags) == tc.exp);
+}
+
 static void touch(const std::string &_path)
 {
     close(open(_path.c_str(), O_CREAT | O_RDWR, S_IRWXU));
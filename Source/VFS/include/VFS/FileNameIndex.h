@@ -0,0 +1,148 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <Utility/FileMask.h>
+#include <VFS/Host.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace nc::vfs {
+
+/**
+ * A persistent index of the file names below a directory of a VFS host, which lets SearchForFiles answer filename
+ * queries without traversing the directories.
+ * The index consists of an immutable base image and an in-memory overlay of incremental changes.
+ * The base image is built by walking the host once, it can be saved into a file and later memory-mapped back.
+ * Names are bucketed by the trigrams of their normalized (FormC, lowercase) forms. A query takes the trigrams of the
+ * literal parts of a file mask to narrow down the candidates, which are then checked with FileMask::MatchName().
+ * Masks without such literal parts and regular expressions are checked against every name below the directory.
+ * Refresh() re-lists a single directory and records the difference in the overlay, which allows keeping the index
+ * in sync via the subtree-change notifications delivered by Host::DirSubtreeChangeObserve().
+ * All methods are thread-safe.
+ */
+class FileNameIndex : public std::enable_shared_from_this<FileNameIndex>
+{
+public:
+    struct Entry {
+        std::string dir_path; // with a trailing slash
+        std::string name;
+        uint16_t type;        // VFSDirEnt::Type
+    };
+
+    FileNameIndex(const FileNameIndex &) = delete;
+    ~FileNameIndex();
+    FileNameIndex &operator=(const FileNameIndex &) = delete;
+
+    /**
+     * Walks the directories below _root on _host and builds an index of all the entries found there.
+     * Returns nullptr if the root can't be listed or the process was canceled.
+     */
+    static std::shared_ptr<FileNameIndex>
+    Build(VFSHost &_host, std::string_view _root, const VFSCancelChecker &_cancel_checker = nullptr);
+
+    /**
+     * Memory-maps an index previously written by Save().
+     * The image is verified before use, nullptr is returned if it's missing, corrupted or has an unsupported version.
+     */
+    static std::shared_ptr<FileNameIndex> Load(const std::string &_index_path);
+
+    /**
+     * Atomically writes the index into _index_path, merging the overlay into the base image.
+     * Returns false on I/O errors.
+     */
+    bool Save(const std::string &_index_path) const;
+
+    /**
+     * The directory covered by this index, with a trailing slash.
+     */
+    const std::string &Root() const noexcept;
+
+    /**
+     * Returns true if _path is the root or is located below it.
+     */
+    bool Covers(std::string_view _path) const noexcept;
+
+    /**
+     * Amount of entries currently in the index, the root itself is not counted.
+     */
+    size_t Size() const;
+
+    /**
+     * Returns the entries located below _dir (recursively) whose names match _mask, in no particular order.
+     * Returns nothing if _dir is not covered by the index or the query was canceled.
+     */
+    std::vector<Entry> Query(std::string_view _dir,
+                             const utility::FileMask &_mask,
+                             const VFSCancelChecker &_cancel_checker = nullptr) const;
+
+    /**
+     * Re-lists _dir on _host and updates the index accordingly: new entries are added, removed ones are dropped
+     * together with their subtrees, new subdirectories are indexed recursively.
+     * With _recursive, the subdirectories already known to the index are re-listed as well.
+     * Directories unknown to the index are ignored.
+     */
+    void Refresh(VFSHost &_host, std::string_view _dir, bool _recursive = false);
+
+    /**
+     * Starts observing the changes of _dir and of all the directories below it on _host, and refreshes the
+     * changed directories in background. The observation lasts while the returned ticket is alive.
+     * Returns an empty ticket if _host can't observe subtrees.
+     */
+    HostDirObservationTicket Observe(const VFSHostPtr &_host, const std::string &_dir);
+
+private:
+    struct Storage;
+
+    // An entry of the base image. Nodes are stored in the depth-first pre-order, so the subtree of a node
+    // occupies [node, subtree_end) and its children can be enumerated by hopping over their subtrees.
+    struct Node {
+        uint32_t parent;
+        uint32_t subtree_end;
+        uint32_t name_offset;
+        uint16_t name_length;
+        uint16_t type;
+    };
+    struct Child {
+        std::string name;
+        uint16_t type;
+    };
+    using Lister = std::function<bool(const std::string &_dir, std::vector<Child> &_children)>;
+
+    explicit FileNameIndex(std::unique_ptr<Storage> _storage);
+    static std::unique_ptr<Storage>
+    BuildImage(const std::string &_root, const Lister &_lister, const VFSCancelChecker &_cancel_checker);
+    static bool Verify(std::span<const std::byte> _image) noexcept;
+
+    std::optional<uint32_t> FindBase(std::string_view _dir) const;
+    bool CurrentChildren(const std::string &_dir, std::vector<Child> &_children) const;
+    std::optional<std::vector<uint32_t>> Candidates(const utility::FileMask &_mask) const;
+    std::vector<uint32_t> Postings(uint32_t _bucket) const;
+    std::string BasePath(uint32_t _node) const;
+    void RemoveSubtree(const std::string &_dir);
+    void RefreshDirectory(VFSHost &_host, const std::string &_dir);
+
+    std::unique_ptr<Storage> m_Storage;
+
+    // views of the base image
+    std::string m_Root;
+    std::span<const Node> m_Nodes;
+    std::string_view m_Names;
+    std::span<const uint64_t> m_Buckets;
+    std::span<const uint8_t> m_Postings;
+
+    mutable std::mutex m_Lock;
+    std::vector<bool> m_Removed; // base nodes removed from the filesystem, along with their subtrees
+    std::vector<bool> m_Hidden;  // base nodes superseded by the overlay
+    std::map<std::string, std::vector<Child>, std::less<>> m_Overlay; // dir path -> actual children
+
+    std::mutex m_RefreshLock; // serializes Refresh() calls
+};
+
+} // namespace nc::vfs
@@ -1,4 +1,4 @@
-// Copyright (C) 2013-2022 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <optional>
@@ -360,6 +360,15 @@ public:
     virtual HostDirObservationTicket DirChangeObserve(const char *_path,
                                                       std::function<void()> _handler);
 
+    /**
+     * Observes the changes of _path and of all the directories below it.
+     * _handler gets the path of a changed directory (with a trailing slash) and a flag telling that the
+     * whole subtree below that directory has to be rescanned, it can be called from any thread.
+     * Default implementation doesn't provide this functionality and returns an empty ticket.
+     */
+    virtual HostDirObservationTicket
+    DirSubtreeChangeObserve(const char *_path, std::function<void(std::string_view _dir, bool _recursive)> _handler);
+
     /**
      * Will fire _handler whenever a file identified by '_path' is changed.
      * Can return an empty token if observation is unavailable.
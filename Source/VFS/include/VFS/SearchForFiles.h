@@ -1,14 +1,17 @@
-// Copyright (C) 2014-2022 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <Base/SerialQueue.h>
 #include <Utility/Encodings.h>
 #include <Utility/FileMask.h>
 #include <VFS/VFS.h>
+#include <VFS/SearchInFile.h>
+#include <VFS/FileNameIndex.h>
 
 #include <functional>
 #include <string>
-#include <queue>
+#include <mutex>
+#include <vector>
 #include <stdint.h>
 
 namespace nc::vfs {
@@ -22,11 +25,30 @@ public:
             SearchForDirs   = 0x0002,
             SearchForFiles  = 0x0004,
             LookInArchives  = 0x0008,
+            ParallelTraversal = 0x0010, // process directories and contents on a pool of workers
         };
     };
+
+    /**
+     * Upper limits of concurrent workers used with Options::ParallelTraversal, per a kind of
+     * VFS host the currently processed items belong to. Zero means "amount of active CPU cores".
+     */
+    struct Concurrency {
+        int native = 0;
+        int archive = 1;
+        int network = 4;
+    };
         
     struct FilterContent {
+        enum class Type {
+            Text,     // look for 'text' in 'encoding'
+            Literals, // look for any of 'literals', UTF8 only, whole_phrase is ignored
+            RegEx,    // look for RE2 expression in 'text', UTF8 only, whole_phrase is ignored
+            Bytes     // look for hex byte pattern in 'text', e.g. "7F 45 4C 46", '?' matches any nibble
+        };
         std::string text; //utf8-encoded
+        std::vector<std::string> literals; //utf8-encoded
+        Type type           = Type::Text;
         int encoding        = encodings::ENCODING_UTF8;
         bool whole_phrase   = false; // search for a phrase, not a part of something
         bool case_sensitive = false;
@@ -58,6 +80,7 @@ public:
     
     /**
      * Sets file content filtering. Should not be called with background search going on.
+     * Throws std::invalid_argument if a regular expression or a byte pattern can't be compiled.
      */
     void SetFilterContent(const FilterContent &_filter);
 
@@ -67,6 +90,19 @@ public:
      */
     void SetFilterSize(const FilterSize &_filter);
     
+    /**
+     * Sets limits on concurrency for the parallel traversal. Should not be called with background search going on.
+     */
+    void SetConcurrency(const Concurrency &_concurrency);
+
+    /**
+     * Sets an index of file names to look up instead of traversing the directories, nullptr turns it off.
+     * The index has to be built over the host the search is performed on. It's used only when it covers the
+     * starting directory and the search goes into subdirectories without looking into archives.
+     * Should not be called with background search going on.
+     */
+    void SetFileNameIndex(std::shared_ptr<const FileNameIndex> _index);
+
     /**
      * Removes all previously set filters, supposing following SetFilerXXX calls.
      * Should not be called with background search going on.
@@ -75,6 +111,8 @@ public:
     
     /**
      * Returns immediately, run in background thread. Options is a bitfield with bits from Options:: enum.
+     * With Options::ParallelTraversal the callbacks can be fired from different background threads, but they are never
+     * called concurrently. Found items are delivered in batches in no particular order.
      */
     bool Go(const std::string &_from_path,
             const VFSHostPtr &_in_host,
@@ -106,33 +144,59 @@ public:
     bool IsRunning() const noexcept;
     
 private:
-    void AsyncProc(const char* _from_path, VFSHost &_in_host);
-    void ProcessDirent(const char* _full_path,
-                       const char* _dir_path,
+    class Traversal;
+    struct Found;
+
+    void AsyncProc(const char *_from_path, VFSHost &_in_host);
+    void WorkerProc(Traversal &_traversal, size_t _worker);
+    void ProcessDirectory(Traversal &_traversal, size_t _worker, const VFSPath &_dir);
+    void ProcessContentCheck(Traversal &_traversal, size_t _worker, const VFSPath &_dir, const std::string &_filename);
+    void ProcessDirent(Traversal &_traversal,
+                       size_t _worker,
+                       const char *_full_path,
+                       const char *_dir_path,
                        const VFSDirEnt &_dirent,
-                       VFSHost &_in_host
-                       );
-    void ProcessValidEntry(const char* _full_path,
-                           const char* _dir_path,
-                           const VFSDirEnt &_dirent,
+                       VFSHost &_in_host);
+    void ProcessEntry(Traversal &_traversal,
+                      size_t _worker,
+                      const char *_full_path,
+                      const char *_dir_path,
+                      const VFSDirEnt &_dirent,
+                      VFSHost &_in_host);
+    bool CanUseFileNameIndex(const char *_from_path) const;
+    void ProcessFileNameIndex(Traversal &_traversal, const char *_from_path, VFSHost &_in_host);
+    void ProcessValidEntry(Traversal &_traversal,
+                           size_t _worker,
+                           const char *_filename,
+                           const char *_dir_path,
                            VFSHost &_in_host,
                            CFRange _cont_range);
-    
-    void NotifyLookingIn(const char* _path, VFSHost &_in_host) const;
-    bool FilterByContent(const char* _full_path, VFSHost &_in_host, CFRange &_r);
-    bool FilterByFilename(const char* _filename) const;
-    
+    void FlushFound(std::vector<Found> &_found);
+
+    void NotifyLookingIn(const char *_path, VFSHost &_in_host) const;
+    bool FilterByContent(const char *_full_path, VFSHost &_in_host, CFRange &_r);
+    bool FilterByFilename(const char *_filename) const;
+    VFSHostPtr SpawnArchive(const char *_full_path, VFSHost &_in_host);
+
     base::SerialQueue           m_Queue;
     utility::FileMask           m_FilterName;
     std::optional<FilterContent>m_FilterContent;
+    std::shared_ptr<const SearchInFile::Literals> m_FilterContentLiterals;
+    std::shared_ptr<const SearchInFile::RegEx> m_FilterContentRegEx;
+    std::shared_ptr<const SearchInFile::BytePattern> m_FilterContentBytes;
     std::optional<FilterSize>   m_FilterSize;
-    
+    Concurrency                 m_Concurrency;
+    std::shared_ptr<const FileNameIndex> m_FileNameIndex;
+
     FoundCallback               m_Callback;
     SpawnArchiveCallback        m_SpawnArchiveCallback;
     std::function<void()>       m_FinishCallback;
     LookingInCallback           m_LookingInCallback;
     int                         m_SearchOptions;
-    std::queue<VFSPath>         m_DirsFIFO;
+    mutable std::mutex          m_CallbackLock;
+    std::mutex                  m_SpawnArchiveLock;
+    std::mutex                  m_TraversalLock;
+    Traversal                  *m_Traversal = nullptr; // the running one, woken up by Stop()
 };
 
 }
@@ -1,4 +1,4 @@
-// Copyright (C) 2013-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <CoreFoundation/CoreFoundation.h>
@@ -6,10 +6,15 @@
 #include <memory>
 #include <functional>
 #include <optional>
+#include <span>
+#include <string>
+#include <string_view>
 #include <VFS/FileWindow.h>
 
 namespace nc::vfs {
 
+class TextMatcher;
+
 /**
  * Provides a *stateful* searching facilty to find text in VFS file accessible through
  * a FileWindow object.
@@ -22,6 +27,15 @@ public:
 
     enum class Options : int;
 
+    // A compiled set of literals to look for simultaneously. Immutable, can be shared between threads and searches.
+    class Literals;
+
+    // A compiled regular expression. Immutable, can be shared between threads and searches.
+    class RegEx;
+
+    // A compiled binary pattern. Immutable, can be shared between threads and searches.
+    class BytePattern;
+
     struct Location {
         uint64_t offset;
         uint64_t bytes_len;
@@ -48,6 +62,45 @@ public:
     CFStringRef TextSearchString(); // may be NULL. don't alter it. don't release it
     int TextSearchEncoding();       // may be ENCODING_INVALID
 
+    /**
+     * Compiles a set of UTF8 literals to be found in a single pass over a file.
+     * When _case_sensitive is false, only the ASCII letters are matched case-insensitively.
+     */
+    static std::shared_ptr<const Literals> CompileLiterals(std::span<const std::string> _literals,
+                                                           bool _case_sensitive);
+
+    /**
+     * Compiles a UTF8 RE2 regular expression, returns nullptr if the pattern is malformed.
+     * Lines are matched as a whole, lines longer than RegExMaxLine bytes are split for matching purposes.
+     */
+    static std::shared_ptr<const RegEx> CompileRegEx(std::string_view _pattern, bool _case_sensitive);
+    static constexpr size_t RegExMaxLine = 1024 * 1024;
+
+    /**
+     * Compiles a hexadecimal byte pattern like "7F 45 4C 46" or "DE?D ??EF", where '?' matches any nibble.
+     * Whitespaces are ignored. Returns nullptr if the pattern is malformed, empty or longer than 4096 bytes.
+     */
+    static std::shared_ptr<const BytePattern> CompileBytePattern(std::string_view _hex);
+
+    /**
+     * Switches to looking for any of the compiled literals.
+     * The file data is looked at exactly once, regardless of the amount of literals.
+     * Search options are not applied - the case sensitivity is defined at the compilation time.
+     */
+    void ToggleLiteralsSearch(std::shared_ptr<const Literals> _literals);
+
+    /**
+     * Switches to looking for the compiled regular expression.
+     * Search options are not applied - the case sensitivity is defined at the compilation time.
+     */
+    void ToggleRegExSearch(std::shared_ptr<const RegEx> _regex);
+
+    /**
+     * Switches to looking for the compiled byte pattern.
+     * Search options are not applied.
+     */
+    void ToggleBytesSearch(std::shared_ptr<const BytePattern> _pattern);
+
     using CancelChecker = std::function<bool()>;
     Result Search(const CancelChecker &_checker = {});
 
@@ -56,12 +109,19 @@ private:
     void operator=(const SearchInFile &); // forbid
 
     Response SearchText(uint64_t *_offset, uint64_t *_bytes_len, CancelChecker _checker);
+    Response SearchLiterals(uint64_t *_offset, uint64_t *_bytes_len, const CancelChecker &_checker);
+    Response SearchRegEx(uint64_t *_offset, uint64_t *_bytes_len, const CancelChecker &_checker);
+    Response SearchBytes(uint64_t *_offset, uint64_t *_bytes_len, const CancelChecker &_checker);
+    void MoveWindowToPosition();
+    void ResetStreamingState();
 
     enum class WorkMode
     {
         NotSet,
-        Text
-        /* binary(hex) and regexp(tempates) later */
+        Text,
+        Literals,
+        RegEx,
+        Bytes
     };
 
     nc::vfs::FileWindow &m_File;
@@ -83,11 +143,20 @@ private:
     CFStringRef m_RequestedTextSearch = nullptr;
     int m_TextSearchEncoding;
 
-    std::unique_ptr<uint16_t[]> m_DecodedBuffer;
-    std::unique_ptr<uint32_t[]> m_DecodedBufferIndx;
+    // lazily compiled from the text request, the encoding and the options
+    std::unique_ptr<TextMatcher> m_TextMatcher;
+
+    // multiple literals search related stuff
+    std::shared_ptr<const Literals> m_Literals;
+    uint32_t m_LiteralsState = 0; // state of the automaton at m_Position
+
+    // regex search related stuff
+    std::shared_ptr<const RegEx> m_RegEx;
+    std::string m_Carry;    // bytes preceding m_Position which were read but not yet matched against
+    size_t m_CarrySkip = 0; // prefix of m_Carry which was already matched, kept as a context for anchors
 
-    size_t m_DecodedBufferSize = 0;
-    CFStringRef m_DecodedBufferString = nullptr;
+    // binary search related stuff
+    std::shared_ptr<const BytePattern> m_BytePattern;
 
     WorkMode m_WorkMode = WorkMode::NotSet;
 };
@@ -103,10 +172,12 @@ enum class SearchInFile::Response : int
     // Search performed successfuly, found one entry and returning its address
     Found,
 
-    // Search performed successfully, didn't found
+    // Search performed successfully, didn't found.
+    // The rest of the file was looked through, so the next search will report EndOfFile.
     NotFound,
 
-    // Can't search since current position is already at the end of the file
+    // Can't search since current position is already at the end of the file, i.e. there's nothing left to look
+    // through. That's the case after a match which ends at the very end of the file. The same in all work modes.
     EndOfFile,
 
     // User did cancel the search. The search position will remain at the
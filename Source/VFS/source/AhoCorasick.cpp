@@ -0,0 +1,97 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "AhoCorasick.h"
+#include <limits>
+#include <queue>
+
+namespace nc::vfs {
+
+static constexpr AhoCorasick::State g_NoState = std::numeric_limits<AhoCorasick::State>::max();
+
+static uint8_t FoldASCII(uint8_t _c) noexcept
+{
+    return (_c >= 'A' && _c <= 'Z') ? static_cast<uint8_t>(_c + ('a' - 'A')) : _c;
+}
+
+AhoCorasick::AhoCorasick(std::span<const std::string> _patterns, bool _case_sensitive)
+{
+    // bytes which don't appear in any pattern share the class #0
+    for( const auto &pattern : _patterns )
+        for( const char c : pattern ) {
+            const auto byte = static_cast<uint8_t>(c);
+            const auto folded = _case_sensitive ? byte : FoldASCII(byte);
+            if( m_Classes[folded] == 0 )
+                m_Classes[folded] = static_cast<uint16_t>(m_ClassesCount++);
+        }
+    if( !_case_sensitive )
+        for( uint8_t c = 'A'; c <= 'Z'; ++c )
+            m_Classes[c] = m_Classes[FoldASCII(c)];
+
+    // build a trie
+    m_Transitions.assign(m_ClassesCount, g_NoState);
+    m_Outputs.assign(1, 0);
+    for( const auto &pattern : _patterns ) {
+        if( pattern.empty() )
+            continue;
+        State state = Root;
+        for( const char c : pattern ) {
+            auto &next = m_Transitions[state * m_ClassesCount + m_Classes[static_cast<uint8_t>(c)]];
+            if( next == g_NoState ) {
+                next = static_cast<State>(m_Outputs.size());
+                m_Outputs.emplace_back(0);
+                m_Transitions.resize(m_Transitions.size() + m_ClassesCount, g_NoState);
+            }
+            state = m_Transitions[state * m_ClassesCount + m_Classes[static_cast<uint8_t>(c)]];
+        }
+        m_Outputs[state] = static_cast<uint32_t>(pattern.size());
+    }
+
+    // turn the trie into a DFA by folding the failure links into the transitions, breadth-first
+    std::vector<State> failures(m_Outputs.size(), Root);
+    std::queue<State> queue;
+    for( size_t c = 0; c < m_ClassesCount; ++c ) {
+        auto &next = m_Transitions[c];
+        if( next == g_NoState )
+            next = Root;
+        else
+            queue.push(next);
+    }
+    while( !queue.empty() ) {
+        const State state = queue.front();
+        queue.pop();
+        if( m_Outputs[state] == 0 )
+            m_Outputs[state] = m_Outputs[failures[state]];
+        for( size_t c = 0; c < m_ClassesCount; ++c ) {
+            auto &next = m_Transitions[state * m_ClassesCount + c];
+            const State fallback = m_Transitions[failures[state] * m_ClassesCount + c];
+            if( next == g_NoState ) {
+                next = fallback;
+            }
+            else {
+                failures[next] = fallback;
+                queue.push(next);
+            }
+        }
+    }
+}
+
+bool AhoCorasick::Empty() const noexcept
+{
+    return m_Outputs.size() == 1;
+}
+
+std::optional<AhoCorasick::Hit>
+AhoCorasick::Feed(State &_state, const std::byte *_data, size_t _size) const noexcept
+{
+    State state = _state;
+    for( size_t i = 0; i < _size; ++i ) {
+        state = Next(state, static_cast<uint8_t>(_data[i]));
+        if( m_Outputs[state] != 0 ) {
+            _state = state;
+            return Hit{i + 1, m_Outputs[state]};
+        }
+    }
+    _state = state;
+    return std::nullopt;
+}
+
+} // namespace nc::vfs
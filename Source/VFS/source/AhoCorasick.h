@@ -0,0 +1,59 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace nc::vfs {
+
+/**
+ * A byte-oriented Aho-Corasick automaton compiled into a dense DFA over byte equivalence classes.
+ * Matching is streaming: the state is kept by the caller, so the input can be fed in arbitrary pieces and every byte
+ * is looked at exactly once.
+ * Case-insensitivity is applied to ASCII letters only.
+ * The automaton is immutable after construction and can be shared between threads.
+ */
+class AhoCorasick
+{
+public:
+    using State = uint32_t;
+    static constexpr State Root = 0;
+
+    struct Hit {
+        size_t end;    // position right after the last byte of the match, relative to the fed data
+        size_t length; // length of the longest pattern which ends at 'end'
+    };
+
+    AhoCorasick(std::span<const std::string> _patterns, bool _case_sensitive);
+
+    /**
+     * Returns true if there are no non-empty patterns and thus nothing can ever be found.
+     */
+    bool Empty() const noexcept;
+
+    /**
+     * Feeds the bytes into the automaton starting from _state and stops at the first match.
+     * _state is updated to reflect the consumed input.
+     */
+    std::optional<Hit> Feed(State &_state, const std::byte *_data, size_t _size) const noexcept;
+
+private:
+    State Next(State _state, uint8_t _byte) const noexcept;
+
+    std::array<uint16_t, 256> m_Classes{};
+    size_t m_ClassesCount = 1;
+    std::vector<State> m_Transitions;  // [state * m_ClassesCount + class]
+    std::vector<uint32_t> m_Outputs;   // length of the longest pattern ending in a state, zero if none
+};
+
+inline AhoCorasick::State AhoCorasick::Next(State _state, uint8_t _byte) const noexcept
+{
+    return m_Transitions[_state * m_ClassesCount + m_Classes[_byte]];
+}
+
+} // namespace nc::vfs
@@ -0,0 +1,111 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "ByteMatcher.h"
+#include <cstring>
+
+namespace nc::vfs {
+
+// Returns the value of a hex digit, 16 for a wildcard and -1 for anything else
+static int NibbleFromChar(char _c) noexcept
+{
+    if( _c >= '0' && _c <= '9' )
+        return _c - '0';
+    if( _c >= 'a' && _c <= 'f' )
+        return _c - 'a' + 10;
+    if( _c >= 'A' && _c <= 'F' )
+        return _c - 'A' + 10;
+    if( _c == '?' )
+        return 16;
+    return -1;
+}
+
+static bool IsSpace(char _c) noexcept
+{
+    return _c == ' ' || _c == '\t' || _c == '\r' || _c == '\n';
+}
+
+std::optional<ByteMatcher> ByteMatcher::FromHex(std::string_view _hex)
+{
+    ByteMatcher matcher;
+    bool has_defined_nibble = false;
+    int pending = -1; // a high nibble waiting for its pair
+    for( const char c : _hex ) {
+        if( IsSpace(c) )
+            continue;
+        const int nibble = NibbleFromChar(c);
+        if( nibble < 0 )
+            return std::nullopt;
+        has_defined_nibble |= nibble < 16;
+        if( pending < 0 ) {
+            pending = nibble;
+            continue;
+        }
+        const uint8_t high_mask = pending < 16 ? 0xF0 : 0x00;
+        const uint8_t low_mask = nibble < 16 ? 0x0F : 0x00;
+        const uint8_t value = static_cast<uint8_t>(((pending & 0xF) << 4) | (nibble & 0xF));
+        const uint8_t mask = high_mask | low_mask;
+        matcher.m_Values.push_back(value & mask);
+        matcher.m_Masks.push_back(mask);
+        pending = -1;
+    }
+
+    if( pending >= 0 || !has_defined_nibble || matcher.m_Values.size() > MaxLength )
+        return std::nullopt;
+
+    for( size_t i = 0; i < matcher.m_Masks.size(); ++i ) {
+        if( matcher.m_Masks[i] != 0xFF ) {
+            matcher.m_Exact = false;
+            continue;
+        }
+        if( !matcher.m_First )
+            matcher.m_First = i;
+        matcher.m_Second = i;
+    }
+    return matcher;
+}
+
+size_t ByteMatcher::Length() const noexcept
+{
+    return m_Values.size();
+}
+
+bool ByteMatcher::VerifyAt(const std::byte *_data) const noexcept
+{
+    if( m_Exact )
+        return std::memcmp(_data, m_Values.data(), m_Values.size()) == 0;
+    for( size_t i = 0, e = m_Values.size(); i != e; ++i )
+        if( (static_cast<uint8_t>(_data[i]) & m_Masks[i]) != m_Values[i] )
+            return false;
+    return true;
+}
+
+std::optional<size_t> ByteMatcher::Find(const std::byte *_data, size_t _size, size_t _from) const noexcept
+{
+    const size_t length = m_Values.size();
+    if( _size < length || _from > _size - length )
+        return std::nullopt;
+    const size_t last = _size - length; // the last position where a match can start
+
+    if( !m_First ) {
+        for( size_t pos = _from; pos <= last; ++pos )
+            if( VerifyAt(_data + pos) )
+                return pos;
+        return std::nullopt;
+    }
+
+    // scan for the pairs of fully-defined bytes, positions are shifted by the index of the first one
+    const size_t first = *m_First;
+    bytescan::ByteSet first_set;
+    first_set.Add(m_Values[first]);
+    bytescan::ByteSet second_set;
+    second_set.Add(m_Values[m_Second]);
+    std::optional<size_t> found;
+    bytescan::Scan(_data + first, _from, last, first_set, m_Second - first, second_set, [&](size_t _pos) {
+        if( !VerifyAt(_data + _pos) )
+            return false;
+        found = _pos;
+        return true;
+    });
+    return found;
+}
+
+} // namespace nc::vfs
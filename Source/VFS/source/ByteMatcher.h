@@ -0,0 +1,51 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include "ByteScan.h"
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace nc::vfs {
+
+/**
+ * Byte-level matcher of a fixed-length binary pattern used by SearchInFile.
+ * Each byte of the pattern may have one or both of its nibbles set to "any value".
+ * Candidates are filtered by two fully-defined bytes of the pattern with the vectorized scanner from ByteScan.h,
+ * patterns without fully-defined bytes fall back to a plain scalar scan.
+ */
+class ByteMatcher
+{
+public:
+    static constexpr size_t MaxLength = 4096;
+
+    /**
+     * Parses a hexadecimal pattern like "7F 45 4C 46" or "DE?D ??EF", where '?' stands for any nibble.
+     * Whitespaces are ignored. Returns nullopt if the pattern is malformed, longer than MaxLength bytes or
+     * doesn't have any defined nibble.
+     */
+    static std::optional<ByteMatcher> FromHex(std::string_view _hex);
+
+    /**
+     * Returns the amount of bytes occupied by a match.
+     */
+    size_t Length() const noexcept;
+
+    /**
+     * Looks for the first match which starts in [_from, _size) of _data and fully fits into it.
+     * Returns the offset of the match.
+     */
+    std::optional<size_t> Find(const std::byte *_data, size_t _size, size_t _from) const noexcept;
+
+private:
+    ByteMatcher() = default;
+    bool VerifyAt(const std::byte *_data) const noexcept;
+
+    std::vector<uint8_t> m_Values; // already masked
+    std::vector<uint8_t> m_Masks;  // 0xFF for fully-defined bytes
+    bool m_Exact = true;           // no wildcards at all
+    std::optional<size_t> m_First; // index of the first fully-defined byte
+    size_t m_Second = 0;           // index of the last fully-defined byte
+};
+
+} // namespace nc::vfs
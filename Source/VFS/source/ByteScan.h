@@ -0,0 +1,103 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// A vectorized candidates filter used by the byte-level matchers in SearchInFile.
+// The filter checks two bytes of each possible match: the first byte and the byte at a fixed offset (usually the last
+// one), each against a small set of allowed values, processing 16 positions per iteration.
+// Uses the generic compiler vector extensions which are lowered to SSE2 on x86-64 and to NEON on arm64.
+namespace nc::vfs::bytescan {
+
+// A set of up to 4 allowed byte values.
+struct ByteSet {
+    std::array<uint8_t, 4> values{};
+    uint8_t count = 0;
+
+    bool Add(uint8_t _value) noexcept;
+    bool Contains(uint8_t _value) const noexcept;
+};
+
+inline bool ByteSet::Add(uint8_t _value) noexcept
+{
+    if( Contains(_value) )
+        return true;
+    if( count == values.size() )
+        return false;
+    values[count++] = _value;
+    return true;
+}
+
+inline bool ByteSet::Contains(uint8_t _value) const noexcept
+{
+    for( uint8_t i = 0; i < count; ++i )
+        if( values[i] == _value )
+            return true;
+    return false;
+}
+
+namespace detail {
+
+using u8x16 = uint8_t __attribute__((vector_size(16)));
+
+inline u8x16 Load(const std::byte *_p) noexcept
+{
+    u8x16 v;
+    std::memcpy(&v, _p, sizeof(v));
+    return v;
+}
+
+// Returns 0xFF in lanes which are equal to any of the values in the set
+inline u8x16 Match(u8x16 _v, const ByteSet &_set) noexcept
+{
+    u8x16 mask{};
+    for( uint8_t i = 0; i < _set.count; ++i )
+        mask |= __builtin_convertvector(_v == _set.values[i], u8x16);
+    return mask;
+}
+
+} // namespace detail
+
+/**
+ * Calls _verify(position) for every position in [_from, _last] where _data[position] is in _first and
+ * _data[position + _offset] is in _second, in ascending order. Stops and returns true as soon as _verify returns true.
+ * _data must contain at least _last + _offset + 1 bytes.
+ */
+template <class Verify>
+bool Scan(const std::byte *_data,
+          size_t _from,
+          size_t _last,
+          const ByteSet &_first,
+          size_t _offset,
+          const ByteSet &_second,
+          Verify _verify)
+{
+    using namespace detail;
+    size_t pos = _from;
+    for( ; pos + 16 <= _last + 1; pos += 16 ) {
+        const u8x16 mask = Match(Load(_data + pos), _first) & Match(Load(_data + pos + _offset), _second);
+        uint64_t halves[2];
+        std::memcpy(halves, &mask, sizeof(halves));
+        for( size_t half = 0; half < 2; ++half ) {
+            uint64_t bits = halves[half];
+            while( bits != 0 ) {
+                const size_t lane = static_cast<size_t>(__builtin_ctzll(bits)) / 8;
+                if( _verify(pos + half * 8 + lane) )
+                    return true;
+                bits &= ~(uint64_t{0xFF} << (lane * 8));
+            }
+        }
+    }
+    for( ; pos <= _last; ++pos ) {
+        const auto b1 = static_cast<uint8_t>(_data[pos]);
+        const auto b2 = static_cast<uint8_t>(_data[pos + _offset]);
+        if( _first.Contains(b1) && _second.Contains(b2) && _verify(pos) )
+            return true;
+    }
+    return false;
+}
+
+} // namespace nc::vfs::bytescan
@@ -0,0 +1,739 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "FileNameIndex.h"
+#include <Base/CFPtr.h>
+#include <Base/algo.h>
+#include <Base/dispatch_cpp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <ranges>
+#include <utility>
+
+namespace nc::vfs {
+
+// Image layout: Header, root path, nodes, names, bucket offsets, postings.
+// Postings of each bucket are the ascending node indices encoded as LEB128 deltas.
+static constexpr char g_Magic[8] = {'N', 'C', 'F', 'N', 'I', 'D', 'X', '\0'};
+static constexpr uint32_t g_Version = 1;
+static constexpr uint32_t g_BucketsBits = 20;
+static constexpr uint32_t g_Buckets = 1u << g_BucketsBits;
+static constexpr uint32_t g_NoParent = std::numeric_limits<uint32_t>::max();
+
+namespace {
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t nodes;
+    uint64_t root_offset;
+    uint64_t root_size;
+    uint64_t nodes_offset;
+    uint64_t names_offset;
+    uint64_t names_size;
+    uint64_t buckets_offset;
+    uint64_t postings_offset;
+    uint64_t postings_size;
+};
+
+} // namespace
+
+struct FileNameIndex::Storage {
+    Storage() = default;
+    Storage(const Storage &) = delete;
+    ~Storage()
+    {
+        if( mapped != nullptr )
+            munmap(mapped, mapped_size);
+    }
+    std::span<const std::byte> Bytes() const noexcept
+    {
+        if( mapped != nullptr )
+            return {static_cast<const std::byte *>(mapped), mapped_size};
+        return owned;
+    }
+
+    std::vector<std::byte> owned;
+    void *mapped = nullptr;
+    size_t mapped_size = 0;
+};
+
+static bool NeedsNormalization(std::string_view _string) noexcept
+{
+    return std::ranges::any_of(_string, [](unsigned char _c) { return _c > 127 || (_c >= 'A' && _c <= 'Z'); });
+}
+
+static bool IsASCII(std::string_view _string) noexcept
+{
+    return std::ranges::all_of(_string, [](unsigned char _c) { return _c < 128; });
+}
+
+// Produces the same FormC lowercase representation FileMask uses for matching.
+static std::string Normalize(std::string_view _string)
+{
+    if( !NeedsNormalization(_string) )
+        return std::string(_string);
+
+    if( IsASCII(_string) ) {
+        std::string lower(_string);
+        for( auto &c : lower )
+            if( c >= 'A' && c <= 'Z' )
+                c = static_cast<char>(c - 'A' + 'a');
+        return lower;
+    }
+
+    const auto original = base::CFPtr<CFStringRef>::adopt(CFStringCreateWithBytes(nullptr,
+                                                                                   reinterpret_cast<const UInt8 *>(_string.data()),
+                                                                                   static_cast<CFIndex>(_string.length()),
+                                                                                   kCFStringEncodingUTF8,
+                                                                                   false));
+    if( !original )
+        return std::string(_string);
+    const auto mutable_string = base::CFPtr<CFMutableStringRef>::adopt(CFStringCreateMutableCopy(nullptr, 0, original.get()));
+    if( !mutable_string )
+        return std::string(_string);
+    CFStringLowercase(mutable_string.get(), nullptr);
+    CFStringNormalize(mutable_string.get(), kCFStringNormalizationFormC);
+
+    const CFRange range = CFRangeMake(0, CFStringGetLength(mutable_string.get()));
+    CFIndex bytes = 0;
+    CFStringGetBytes(mutable_string.get(), range, kCFStringEncodingUTF8, 0, false, nullptr, 0, &bytes);
+    std::string normalized(static_cast<size_t>(bytes), '\0');
+    CFStringGetBytes(mutable_string.get(),
+                     range,
+                     kCFStringEncodingUTF8,
+                     0,
+                     false,
+                     reinterpret_cast<UInt8 *>(normalized.data()),
+                     bytes,
+                     nullptr);
+    return normalized;
+}
+
+static uint32_t Bucket(const char *_trigram) noexcept
+{
+    const auto byte = [_trigram](size_t _index) { return static_cast<uint32_t>(static_cast<uint8_t>(_trigram[_index])); };
+    const uint32_t key = (byte(0) << 16) | (byte(1) << 8) | byte(2);
+    return (key * 2654435761u) >> (32 - g_BucketsBits);
+}
+
+// Appends the distinct buckets of all trigrams of _normalized into _buckets.
+static void AppendBuckets(std::string_view _normalized, std::vector<uint32_t> &_buckets)
+{
+    for( size_t i = 0; i + 3 <= _normalized.size(); ++i )
+        _buckets.push_back(Bucket(_normalized.data() + i));
+}
+
+static void SortUnique(std::vector<uint32_t> &_v)
+{
+    std::ranges::sort(_v);
+    _v.erase(std::unique(_v.begin(), _v.end()), _v.end());
+}
+
+static size_t VarIntLength(uint32_t _value) noexcept
+{
+    size_t length = 1;
+    while( _value >= 0x80 ) {
+        _value >>= 7;
+        ++length;
+    }
+    return length;
+}
+
+static uint8_t *PutVarInt(uint8_t *_out, uint32_t _value) noexcept
+{
+    while( _value >= 0x80 ) {
+        *_out++ = static_cast<uint8_t>(_value | 0x80);
+        _value >>= 7;
+    }
+    *_out++ = static_cast<uint8_t>(_value);
+    return _out;
+}
+
+static std::string EnsureTrailingSlash(std::string_view _path)
+{
+    std::string path(_path);
+    if( path.empty() || path.back() != '/' )
+        path += '/';
+    return path;
+}
+
+static size_t AlignUp(size_t _value, size_t _alignment) noexcept
+{
+    return (_value + _alignment - 1) / _alignment * _alignment;
+}
+
+FileNameIndex::FileNameIndex(std::unique_ptr<Storage> _storage) : m_Storage(std::move(_storage))
+{
+    const auto bytes = m_Storage->Bytes();
+    Header header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    m_Root.assign(reinterpret_cast<const char *>(bytes.data() + header.root_offset), header.root_size);
+    m_Nodes = {reinterpret_cast<const Node *>(bytes.data() + header.nodes_offset), header.nodes};
+    m_Names = {reinterpret_cast<const char *>(bytes.data() + header.names_offset), header.names_size};
+    m_Buckets = {reinterpret_cast<const uint64_t *>(bytes.data() + header.buckets_offset), g_Buckets + 1};
+    m_Postings = {reinterpret_cast<const uint8_t *>(bytes.data() + header.postings_offset), header.postings_size};
+    m_Removed.resize(m_Nodes.size());
+    m_Hidden.resize(m_Nodes.size());
+}
+
+FileNameIndex::~FileNameIndex() = default;
+
+std::unique_ptr<FileNameIndex::Storage>
+FileNameIndex::BuildImage(const std::string &_root, const Lister &_lister, const VFSCancelChecker &_cancel_checker)
+{
+    std::vector<Node> nodes;
+    std::string names;
+
+    struct Frame {
+        uint32_t node;
+        std::string path;
+        std::vector<Child> children;
+        size_t next = 0;
+    };
+    const auto list = [&](Frame &_frame) {
+        if( !_lister(_frame.path, _frame.children) )
+            return false;
+        std::ranges::sort(_frame.children, [](const Child &_lhs, const Child &_rhs) { return _lhs.name < _rhs.name; });
+        return true;
+    };
+
+    // traverse the tree depth-first, assigning the nodes in pre-order
+    nodes.push_back(Node{g_NoParent, 0, 0, 0, VFSDirEnt::Dir});
+    std::vector<Frame> stack;
+    stack.push_back(Frame{0, _root, {}, 0});
+    if( !list(stack.back()) )
+        return nullptr;
+    while( !stack.empty() ) {
+        Frame &top = stack.back();
+        if( top.next == top.children.size() ) {
+            nodes[top.node].subtree_end = static_cast<uint32_t>(nodes.size());
+            stack.pop_back();
+            continue;
+        }
+        const Child &child = top.children[top.next++];
+        if( nodes.size() >= g_NoParent || names.size() + child.name.size() > std::numeric_limits<uint32_t>::max() ||
+            child.name.size() > std::numeric_limits<uint16_t>::max() )
+            return nullptr;
+        const auto index = static_cast<uint32_t>(nodes.size());
+        nodes.push_back(Node{top.node,
+                             index + 1,
+                             static_cast<uint32_t>(names.size()),
+                             static_cast<uint16_t>(child.name.size()),
+                             child.type});
+        names += child.name;
+        if( child.type == VFSDirEnt::Dir ) {
+            if( _cancel_checker && _cancel_checker() )
+                return nullptr;
+            Frame frame{index, top.path + child.name + "/", {}, 0};
+            list(frame); // an unreadable directory is indexed as an empty one
+            stack.push_back(std::move(frame));
+        }
+    }
+
+    // two passes over the trigrams: first to measure the postings of each bucket, then to write them
+    std::vector<uint64_t> buckets(g_Buckets + 1, 0);
+    std::vector<uint32_t> last(g_Buckets, 0);
+    std::vector<uint32_t> node_buckets;
+    const auto for_each_bucket = [&](auto _callback) {
+        for( uint32_t i = 1; i < nodes.size(); ++i ) {
+            node_buckets.clear();
+            AppendBuckets(Normalize(std::string_view(names).substr(nodes[i].name_offset, nodes[i].name_length)),
+                          node_buckets);
+            SortUnique(node_buckets);
+            for( const uint32_t bucket : node_buckets ) {
+                _callback(bucket, i - last[bucket]);
+                last[bucket] = i;
+            }
+        }
+    };
+    for_each_bucket([&](uint32_t _bucket, uint32_t _delta) { buckets[_bucket + 1] += VarIntLength(_delta); });
+    for( uint32_t i = 1; i <= g_Buckets; ++i )
+        buckets[i] += buckets[i - 1];
+
+    Header header;
+    std::memcpy(header.magic, g_Magic, sizeof(g_Magic));
+    header.version = g_Version;
+    header.nodes = static_cast<uint32_t>(nodes.size());
+    header.root_offset = sizeof(Header);
+    header.root_size = _root.size();
+    header.nodes_offset = AlignUp(header.root_offset + header.root_size, alignof(uint64_t));
+    header.names_offset = header.nodes_offset + nodes.size() * sizeof(Node);
+    header.names_size = names.size();
+    header.buckets_offset = AlignUp(header.names_offset + header.names_size, alignof(uint64_t));
+    header.postings_offset = header.buckets_offset + buckets.size() * sizeof(uint64_t);
+    header.postings_size = buckets.back();
+
+    auto storage = std::make_unique<Storage>();
+    auto &image = storage->owned;
+    image.resize(header.postings_offset + header.postings_size);
+    std::memcpy(image.data(), &header, sizeof(header));
+    std::memcpy(image.data() + header.root_offset, _root.data(), _root.size());
+    std::memcpy(image.data() + header.nodes_offset, nodes.data(), nodes.size() * sizeof(Node));
+    std::memcpy(image.data() + header.names_offset, names.data(), names.size());
+    std::memcpy(image.data() + header.buckets_offset, buckets.data(), buckets.size() * sizeof(uint64_t));
+
+    auto postings = reinterpret_cast<uint8_t *>(image.data() + header.postings_offset);
+    std::ranges::fill(last, 0);
+    std::vector<uint64_t> cursors(buckets.begin(), buckets.end() - 1);
+    for_each_bucket([&](uint32_t _bucket, uint32_t _delta) {
+        cursors[_bucket] = PutVarInt(postings + cursors[_bucket], _delta) - postings;
+    });
+
+    return storage;
+}
+
+bool FileNameIndex::Verify(std::span<const std::byte> _image) noexcept
+{
+    Header header;
+    if( _image.size() < sizeof(header) )
+        return false;
+    std::memcpy(&header, _image.data(), sizeof(header));
+    if( std::memcmp(header.magic, g_Magic, sizeof(g_Magic)) != 0 || header.version != g_Version )
+        return false;
+
+    const auto fits = [&](uint64_t _offset, uint64_t _size) {
+        return _offset <= _image.size() && _size <= _image.size() - _offset;
+    };
+    if( !fits(header.root_offset, header.root_size) || header.root_size == 0 ||
+        !fits(header.nodes_offset, uint64_t(header.nodes) * sizeof(Node)) ||
+        !fits(header.names_offset, header.names_size) ||
+        !fits(header.buckets_offset, uint64_t(g_Buckets + 1) * sizeof(uint64_t)) ||
+        !fits(header.postings_offset, header.postings_size) || header.nodes_offset % alignof(Node) != 0 ||
+        header.buckets_offset % alignof(uint64_t) != 0 || header.nodes == 0 )
+        return false;
+
+    const auto nodes = reinterpret_cast<const Node *>(_image.data() + header.nodes_offset);
+    if( nodes[0].parent != g_NoParent || nodes[0].subtree_end != header.nodes || nodes[0].type != VFSDirEnt::Dir )
+        return false;
+    for( uint32_t i = 1; i < header.nodes; ++i ) {
+        const Node &node = nodes[i];
+        if( node.parent >= i || node.subtree_end <= i || node.subtree_end > nodes[node.parent].subtree_end ||
+            uint64_t(node.name_offset) + node.name_length > header.names_size || node.name_length == 0 )
+            return false;
+    }
+
+    const auto buckets = reinterpret_cast<const uint64_t *>(_image.data() + header.buckets_offset);
+    if( buckets[0] != 0 || buckets[g_Buckets] != header.postings_size )
+        return false;
+    for( uint32_t i = 0; i < g_Buckets; ++i )
+        if( buckets[i] > buckets[i + 1] )
+            return false;
+
+    return true;
+}
+
+std::shared_ptr<FileNameIndex>
+FileNameIndex::Build(VFSHost &_host, std::string_view _root, const VFSCancelChecker &_cancel_checker)
+{
+    const auto lister = [&](const std::string &_dir, std::vector<Child> &_children) {
+        return _host.IterateDirectoryListing(_dir.c_str(), [&](const VFSDirEnt &_dirent) {
+            _children.emplace_back(Child{std::string(_dirent.name, _dirent.name_len), _dirent.type});
+            return true;
+        }) == VFSError::Ok;
+    };
+    auto storage = BuildImage(EnsureTrailingSlash(_root), lister, _cancel_checker);
+    if( !storage )
+        return nullptr;
+    return std::shared_ptr<FileNameIndex>(new FileNameIndex(std::move(storage)));
+}
+
+std::shared_ptr<FileNameIndex> FileNameIndex::Load(const std::string &_index_path)
+{
+    const int fd = open(_index_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if( fd < 0 )
+        return nullptr;
+    struct stat st;
+    if( fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(Header)) ) {
+        close(fd);
+        return nullptr;
+    }
+    void *mapped = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if( mapped == MAP_FAILED )
+        return nullptr;
+
+    auto storage = std::make_unique<Storage>();
+    storage->mapped = mapped;
+    storage->mapped_size = static_cast<size_t>(st.st_size);
+    if( !Verify(storage->Bytes()) )
+        return nullptr;
+    return std::shared_ptr<FileNameIndex>(new FileNameIndex(std::move(storage)));
+}
+
+bool FileNameIndex::Save(const std::string &_index_path) const
+{
+    auto lock = std::lock_guard{m_Lock};
+    std::unique_ptr<Storage> merged;
+    std::span<const std::byte> image = m_Storage->Bytes();
+    if( !m_Overlay.empty() || std::ranges::find(m_Removed, true) != m_Removed.end() ) {
+        const auto lister = [this](const std::string &_dir, std::vector<Child> &_children) {
+            return CurrentChildren(_dir, _children);
+        };
+        merged = BuildImage(m_Root, lister, nullptr);
+        if( !merged )
+            return false;
+        image = merged->Bytes();
+    }
+
+    const std::string temp_path = _index_path + ".tmp";
+    const int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if( fd < 0 )
+        return false;
+    size_t written = 0;
+    while( written < image.size() ) {
+        const ssize_t res = write(fd, image.data() + written, image.size() - written);
+        if( res < 0 ) {
+            if( errno == EINTR )
+                continue;
+            break;
+        }
+        written += static_cast<size_t>(res);
+    }
+    if( close(fd) != 0 || written != image.size() || rename(temp_path.c_str(), _index_path.c_str()) != 0 ) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+const std::string &FileNameIndex::Root() const noexcept
+{
+    return m_Root;
+}
+
+bool FileNameIndex::Covers(std::string_view _path) const noexcept
+{
+    if( _path.size() + 1 == m_Root.size() )
+        return m_Root.starts_with(_path);
+    return _path.starts_with(m_Root);
+}
+
+size_t FileNameIndex::Size() const
+{
+    auto lock = std::lock_guard{m_Lock};
+    size_t size = 0;
+    for( size_t i = 1; i < m_Nodes.size(); ++i )
+        size += !m_Removed[i] && !m_Hidden[i];
+    for( const auto &dir : m_Overlay )
+        size += dir.second.size();
+    return size;
+}
+
+std::optional<uint32_t> FileNameIndex::FindBase(std::string_view _dir) const
+{
+    if( !Covers(_dir) )
+        return std::nullopt;
+    uint32_t node = 0;
+    const auto relative = _dir.size() > m_Root.size() ? _dir.substr(m_Root.size()) : std::string_view{};
+    for( const auto part : std::views::split(relative, '/') ) {
+        const std::string_view name(part.begin(), part.end());
+        if( name.empty() )
+            continue;
+        std::optional<uint32_t> found;
+        for( uint32_t child = node + 1; child < m_Nodes[node].subtree_end; child = m_Nodes[child].subtree_end )
+            if( !m_Removed[child] && m_Nodes[child].type == VFSDirEnt::Dir &&
+                m_Names.substr(m_Nodes[child].name_offset, m_Nodes[child].name_length) == name ) {
+                found = child;
+                break;
+            }
+        if( !found )
+            return std::nullopt;
+        node = *found;
+    }
+    return node;
+}
+
+bool FileNameIndex::CurrentChildren(const std::string &_dir, std::vector<Child> &_children) const
+{
+    if( const auto it = m_Overlay.find(_dir); it != m_Overlay.end() ) {
+        _children = it->second;
+        return true;
+    }
+    const auto node = FindBase(_dir);
+    if( !node )
+        return false;
+    _children.clear();
+    for( uint32_t child = *node + 1; child < m_Nodes[*node].subtree_end; child = m_Nodes[child].subtree_end )
+        if( !m_Removed[child] )
+            _children.emplace_back(Child{std::string(m_Names.substr(m_Nodes[child].name_offset,
+                                                                    m_Nodes[child].name_length)),
+                                         m_Nodes[child].type});
+    return true;
+}
+
+std::string FileNameIndex::BasePath(uint32_t _node) const
+{
+    std::vector<uint32_t> chain;
+    for( uint32_t node = _node; node != 0; node = m_Nodes[node].parent )
+        chain.push_back(node);
+    std::string path = m_Root;
+    for( const uint32_t node : std::views::reverse(chain) ) {
+        path += m_Names.substr(m_Nodes[node].name_offset, m_Nodes[node].name_length);
+        path += '/';
+    }
+    return path;
+}
+
+std::vector<uint32_t> FileNameIndex::Postings(uint32_t _bucket) const
+{
+    std::vector<uint32_t> nodes;
+    const uint8_t *p = m_Postings.data() + m_Buckets[_bucket];
+    const uint8_t *const end = m_Postings.data() + std::min<uint64_t>(m_Buckets[_bucket + 1], m_Postings.size());
+    uint64_t node = 0;
+    while( p < end ) {
+        uint64_t delta = 0;
+        for( int shift = 0; p < end && shift < 35; shift += 7 ) {
+            const uint8_t byte = *p++;
+            delta |= uint64_t(byte & 0x7F) << shift;
+            if( (byte & 0x80) == 0 )
+                break;
+        }
+        node += delta;
+        if( node >= m_Nodes.size() )
+            break; // corrupted postings, don't go any further
+        nodes.push_back(static_cast<uint32_t>(node));
+    }
+    return nodes;
+}
+
+std::optional<std::vector<uint32_t>> FileNameIndex::Candidates(const utility::FileMask &_mask) const
+{
+    if( _mask.MaskType() != utility::FileMask::Type::Mask )
+        return std::nullopt;
+
+    std::vector<uint32_t> candidates;
+    for( const auto part : std::views::split(std::string_view(_mask.Mask()), ',') ) {
+        const auto alternative = base::Trim(std::string_view{part});
+        if( alternative.empty() )
+            continue; // FileMask skips empty alternatives as well
+
+        std::vector<uint32_t> buckets;
+        for( const auto literal : std::views::split(alternative, '*') )
+            for( const auto piece : std::views::split(std::string_view{literal}, '?') )
+                AppendBuckets(Normalize(std::string_view{piece}), buckets);
+        SortUnique(buckets);
+        if( buckets.empty() )
+            return std::nullopt; // no literals to lean on, every name has to be checked
+
+        // intersect the postings starting from the shortest ones
+        std::ranges::sort(buckets, [this](uint32_t _lhs, uint32_t _rhs) {
+            return m_Buckets[_lhs + 1] - m_Buckets[_lhs] < m_Buckets[_rhs + 1] - m_Buckets[_rhs];
+        });
+        std::vector<uint32_t> matching = Postings(buckets.front());
+        for( size_t i = 1; i < buckets.size() && !matching.empty(); ++i ) {
+            const auto postings = Postings(buckets[i]);
+            std::vector<uint32_t> intersection;
+            std::ranges::set_intersection(matching, postings, std::back_inserter(intersection));
+            matching = std::move(intersection);
+        }
+
+        std::vector<uint32_t> merged;
+        std::ranges::set_union(candidates, matching, std::back_inserter(merged));
+        candidates = std::move(merged);
+    }
+    return candidates;
+}
+
+std::vector<FileNameIndex::Entry> FileNameIndex::Query(std::string_view _dir,
+                                                       const utility::FileMask &_mask,
+                                                       const VFSCancelChecker &_cancel_checker) const
+{
+    const std::string dir = EnsureTrailingSlash(_dir);
+    if( !Covers(dir) || _mask.IsEmpty() )
+        return {};
+
+    auto lock = std::lock_guard{m_Lock};
+    std::vector<Entry> entries;
+
+    if( const auto dir_node = FindBase(dir) ) {
+        uint32_t last_parent = g_NoParent;
+        std::string last_parent_path;
+        const auto check = [&](uint32_t _node) {
+            if( m_Removed[_node] || m_Hidden[_node] )
+                return;
+            const Node &node = m_Nodes[_node];
+            const auto name = m_Names.substr(node.name_offset, node.name_length);
+            if( !_mask.MatchName(name) )
+                return;
+            if( node.parent != last_parent ) {
+                last_parent = node.parent;
+                last_parent_path = BasePath(node.parent);
+            }
+            entries.emplace_back(Entry{last_parent_path, std::string(name), node.type});
+        };
+        const uint32_t first = *dir_node + 1;
+        const uint32_t end = m_Nodes[*dir_node].subtree_end;
+        if( const auto candidates = Candidates(_mask) ) {
+            for( auto it = std::ranges::lower_bound(*candidates, first); it != candidates->end() && *it < end; ++it )
+                check(*it);
+        }
+        else {
+            for( uint32_t node = first; node < end; ++node ) {
+                if( (node & 0xFFFF) == 0 && _cancel_checker && _cancel_checker() )
+                    return {};
+                check(node);
+            }
+        }
+    }
+
+    for( auto it = m_Overlay.lower_bound(dir); it != m_Overlay.end() && it->first.starts_with(dir); ++it )
+        for( const auto &child : it->second )
+            if( _mask.MatchName(child.name) )
+                entries.emplace_back(Entry{it->first, child.name, child.type});
+
+    if( _cancel_checker && _cancel_checker() )
+        return {};
+    return entries;
+}
+
+void FileNameIndex::RemoveSubtree(const std::string &_dir)
+{
+    if( const auto node = FindBase(_dir) )
+        for( uint32_t i = *node; i < m_Nodes[*node].subtree_end; ++i )
+            m_Removed[i] = true;
+    auto it = m_Overlay.lower_bound(_dir);
+    while( it != m_Overlay.end() && it->first.starts_with(_dir) )
+        it = m_Overlay.erase(it);
+}
+
+void FileNameIndex::Refresh(VFSHost &_host, std::string_view _dir, bool _recursive)
+{
+    const std::string dir = EnsureTrailingSlash(_dir);
+    if( !Covers(dir) )
+        return;
+
+    auto refresh_lock = std::lock_guard{m_RefreshLock};
+    if( !_recursive ) {
+        RefreshDirectory(_host, dir);
+        return;
+    }
+
+    std::vector<std::string> pending{dir};
+    std::vector<Child> children;
+    while( !pending.empty() ) {
+        const std::string path = std::move(pending.back());
+        pending.pop_back();
+        RefreshDirectory(_host, path);
+        {
+            auto lock = std::lock_guard{m_Lock};
+            if( !CurrentChildren(path, children) )
+                continue;
+        }
+        for( const auto &child : children )
+            if( child.type == VFSDirEnt::Dir )
+                pending.emplace_back(path + child.name + "/");
+    }
+}
+
+void FileNameIndex::RefreshDirectory(VFSHost &_host, const std::string &_dir)
+{
+    const auto list = [&](const std::string &_path, std::vector<Child> &_children) {
+        _children.clear();
+        return _host.IterateDirectoryListing(_path.c_str(), [&](const VFSDirEnt &_dirent) {
+            _children.emplace_back(Child{std::string(_dirent.name, _dirent.name_len), _dirent.type});
+            return true;
+        }) == VFSError::Ok;
+    };
+
+    std::vector<Child> actual;
+    if( !list(_dir, actual) )
+        return; // the directory is gone, its parent will be refreshed as well
+
+    std::vector<Child> previous;
+    {
+        auto lock = std::lock_guard{m_Lock};
+        if( !CurrentChildren(_dir, previous) )
+            return;
+    }
+
+    const auto directories = [](const std::vector<Child> &_children) {
+        std::vector<std::string> dirs;
+        for( const auto &child : _children )
+            if( child.type == VFSDirEnt::Dir )
+                dirs.emplace_back(child.name);
+        std::ranges::sort(dirs);
+        return dirs;
+    };
+    const auto previous_dirs = directories(previous);
+    const auto actual_dirs = directories(actual);
+    std::vector<std::string> removed_dirs;
+    std::ranges::set_difference(previous_dirs, actual_dirs, std::back_inserter(removed_dirs));
+    std::vector<std::string> added_dirs;
+    std::ranges::set_difference(actual_dirs, previous_dirs, std::back_inserter(added_dirs));
+
+    // index the new subdirectories without holding the lock
+    std::map<std::string, std::vector<Child>, std::less<>> added;
+    std::vector<std::string> pending;
+    for( const auto &name : added_dirs )
+        pending.emplace_back(_dir + name + "/");
+    while( !pending.empty() ) {
+        const std::string path = std::move(pending.back());
+        pending.pop_back();
+        std::vector<Child> children;
+        list(path, children);
+        for( const auto &child : children )
+            if( child.type == VFSDirEnt::Dir )
+                pending.emplace_back(path + child.name + "/");
+        added.emplace(path, std::move(children));
+    }
+
+    auto lock = std::lock_guard{m_Lock};
+    for( const auto &name : removed_dirs )
+        RemoveSubtree(_dir + name + "/");
+    for( const auto &name : added_dirs )
+        RemoveSubtree(_dir + name + "/");
+    if( const auto node = FindBase(_dir) )
+        for( uint32_t child = *node + 1; child < m_Nodes[*node].subtree_end; child = m_Nodes[child].subtree_end )
+            m_Hidden[child] = true;
+    m_Overlay.insert_or_assign(_dir, std::move(actual));
+    m_Overlay.merge(added);
+}
+
+HostDirObservationTicket FileNameIndex::Observe(const VFSHostPtr &_host, const std::string &_dir)
+{
+    // coalesce the bursts of notifications into a single pass over the changed directories
+    struct Pending {
+        std::mutex lock;
+        std::map<std::string, bool> dirs; // path -> recursive
+        bool scheduled = false;
+    };
+    auto pending = std::make_shared<Pending>();
+    std::weak_ptr<FileNameIndex> weak_index = weak_from_this();
+    std::weak_ptr<VFSHost> weak_host = _host;
+    const auto refresh = [=] {
+        std::map<std::string, bool> dirs;
+        {
+            auto lock = std::lock_guard{pending->lock};
+            dirs.swap(pending->dirs);
+            pending->scheduled = false;
+        }
+        const auto index = weak_index.lock();
+        const auto host = weak_host.lock();
+        if( !index || !host )
+            return;
+        // parents go first, so the directories they add are indexed as a whole
+        std::string rescanned;
+        for( const auto &[dir, recursive] : dirs ) {
+            if( !rescanned.empty() && dir.starts_with(rescanned) )
+                continue; // already re-listed as a part of a subtree
+            index->Refresh(*host, dir, recursive);
+            if( recursive )
+                rescanned = dir;
+        }
+    };
+    return _host->DirSubtreeChangeObserve(_dir.c_str(), [=, root = m_Root](std::string_view _changed, bool _recursive) {
+        if( !_changed.starts_with(root) )
+            return; // outside of the indexed subtree
+        auto lock = std::lock_guard{pending->lock};
+        auto &recursive = pending->dirs[std::string(_changed)];
+        recursive = recursive || _recursive;
+        if( std::exchange(pending->scheduled, true) )
+            return;
+        dispatch_to_background(refresh);
+    });
+}
+
+} // namespace nc::vfs
@@ -1,4 +1,4 @@
-// Copyright (C) 2013-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <Utility/PathManip.h>
 #include "ListingInput.h"
 #include "../include/VFS/Host.h"
@@ -269,6 +269,13 @@ HostDirObservationTicket Host::DirChangeObserve([[maybe_unused]] const char *_pa
     return {};
 }
 
+HostDirObservationTicket
+Host::DirSubtreeChangeObserve([[maybe_unused]] const char *_path,
+                              [[maybe_unused]] std::function<void(std::string_view _dir, bool _recursive)> _handler)
+{
+    return {};
+}
+
 void Host::StopDirChangeObserving([[maybe_unused]] unsigned long _ticket)
 {
 }
@@ -4,11 +4,17 @@
 #include "ListingInput.h"
 #include <sys/param.h>
 #include <Base/mach_time.h>
+#include <Base/dispatch_cpp.h>
+#include <algorithm>
 
 namespace nc::vfs {
 
 using nc::base::variable_container;
 
+// MaterializeCFStrings() processes the items concurrently in chunks of this size once there are enough of them
+static constexpr size_t g_ConcurrentMaterializationThresh = 10'000;
+static constexpr size_t g_MaterializationChunk = 2'048;
+
 // static_assert(sizeof(Listing) <= 824); // became 944 on Xcode15 ???
 static_assert(std::is_move_constructible<ListingItem>::value);
 static_assert(std::is_move_constructible<Listing::iterator>::value);
@@ -108,26 +114,27 @@ static void Compress(ListingInput &_input)
 
 Listing::Listing() = default;
 
-Listing::~Listing() = default;
-
-template <class It>
-static std::unique_ptr<typename std::iterator_traits<It>::value_type[]> CopyToUniquePtr(It first, It last)
+Listing::~Listing()
 {
-    using T = typename std::iterator_traits<It>::value_type;
-    auto count = std::distance(first, last);
-    auto ptr = std::make_unique<T[]>(count);
-    std::copy(first, last, ptr.get());
-    return ptr;
+    if( !m_FilenamesCF )
+        return;
+    for( unsigned i = 0; i != m_ItemsCount; ++i ) {
+        if( const CFStringRef str = m_FilenamesCF[i].load(std::memory_order_relaxed) )
+            CFRelease(str);
+        if( m_DisplayFilenamesCF )
+            if( const CFStringRef str = m_DisplayFilenamesCF[i].load(std::memory_order_relaxed) )
+                CFRelease(str);
+    }
 }
 
-template <class It>
-static std::unique_ptr<typename std::iterator_traits<It>::value_type[]> MoveToUniquePtr(It first, It last)
+// Takes over a column of ListingInput without copying the elements, trimming the excess capacity left by a builder if
+// it's noticeable
+template <class T>
+static std::vector<T> AdoptColumn(std::vector<T> &_column)
 {
-    using T = typename std::iterator_traits<It>::value_type;
-    auto count = std::distance(first, last);
-    auto ptr = std::make_unique<T[]>(count);
-    std::move(first, last, ptr.get());
-    return ptr;
+    if( _column.capacity() - _column.size() > _column.size() / 8 )
+        _column.shrink_to_fit();
+    return std::move(_column);
 }
 
 base::intrusive_ptr<const Listing> Listing::Build(ListingInput &&_input)
@@ -140,7 +147,7 @@ base::intrusive_ptr<const Listing> Listing::Build(ListingInput &&_input)
     l->m_Title = std::move(_input.title);
     l->m_Hosts = std::move(_input.hosts);
     l->m_Directories = std::move(_input.directories);
-    l->m_Filenames = MoveToUniquePtr(_input.filenames.begin(), _input.filenames.end());
+    l->m_Filenames = AdoptColumn(_input.filenames);
     l->m_DisplayFilenames = std::move(_input.display_filenames);
     l->m_Sizes = std::move(_input.sizes);
     l->m_Inodes = std::move(_input.inodes);
@@ -149,8 +156,8 @@ base::intrusive_ptr<const Listing> Listing::Build(ListingInput &&_input)
     l->m_CTimes = std::move(_input.ctimes);
     l->m_MTimes = std::move(_input.mtimes);
     l->m_AddTimes = std::move(_input.add_times);
-    l->m_UnixModes = CopyToUniquePtr(_input.unix_modes.begin(), _input.unix_modes.end());
-    l->m_UnixTypes = CopyToUniquePtr(_input.unix_types.begin(), _input.unix_types.end());
+    l->m_UnixModes = AdoptColumn(_input.unix_modes);
+    l->m_UnixTypes = AdoptColumn(_input.unix_types);
     l->m_UIDS = std::move(_input.uids);
     l->m_GIDS = std::move(_input.gids);
     l->m_UnixFlags = std::move(_input.unix_flags);
@@ -376,37 +383,61 @@ const base::intrusive_ptr<const Listing> &Listing::EmptyListing() noexcept
     return empty;
 }
 
-static base::CFString UTF8WithFallback(const std::string &_s)
+CFStringRef Listing::MaterializeCFString(std::atomic<CFStringRef> &_slot, const std::string &_utf8)
 {
-    base::CFString s(_s);
-    if( !s )
-        s = base::CFString(_s, kCFStringEncodingMacRoman);
-    return s;
+    // if filename is badly broken and UTF8 is invalid - treat it like MacRoman encoding
+    CFStringRef str = CFStringCreateWithBytes(nullptr,
+                                              reinterpret_cast<const UInt8 *>(_utf8.data()),
+                                              static_cast<CFIndex>(_utf8.size()),
+                                              kCFStringEncodingUTF8,
+                                              false);
+    if( str == nullptr )
+        str = CFStringCreateWithBytes(nullptr,
+                                      reinterpret_cast<const UInt8 *>(_utf8.data()),
+                                      static_cast<CFIndex>(_utf8.size()),
+                                      kCFStringEncodingMacRoman,
+                                      false);
+
+    // another thread might have been quicker, its string wins then
+    CFStringRef expected = nullptr;
+    if( _slot.compare_exchange_strong(expected, str, std::memory_order_acq_rel, std::memory_order_acquire) )
+        return str;
+    CFRelease(str);
+    return expected;
 }
 
-void Listing::BuildFilenames()
+void Listing::MaterializeCFStrings(std::span<const unsigned> _indices) const
 {
-    size_t i = 0, e = m_ItemsCount;
-
-    m_FilenamesCF = std::make_unique<base::CFString[]>(e);
-    m_ExtensionOffsets = std::make_unique<uint16_t[]>(e);
-    m_DisplayFilenamesCF = variable_container<base::CFString>(variable_container<>::type::sparse);
-
-    for( ; i != e; ++i ) {
-        auto &current = m_Filenames[i];
-
-        // build Cocoa strings for filenames.
-        // if filename is badly broken and UTF8 is invalid - treat it like MacRoman encoding
-        m_FilenamesCF[i] = UTF8WithFallback(current);
-
-        if( m_DisplayFilenames.has(static_cast<unsigned>(i)) )
-            m_DisplayFilenamesCF.insert(static_cast<unsigned>(i),
-                                        UTF8WithFallback(m_DisplayFilenames[static_cast<unsigned>(i)]));
+    const auto materialize = [this](std::span<const unsigned> _chunk) {
+        for( const unsigned index : _chunk )
+            if( index < m_ItemsCount )
+                DisplayFilenameCF(index);
+    };
+    if( _indices.size() < g_ConcurrentMaterializationThresh ) {
+        materialize(_indices);
+        return;
+    }
+    const size_t chunks = (_indices.size() + g_MaterializationChunk - 1) / g_MaterializationChunk;
+    dispatch_apply(chunks, [&](size_t _chunk) {
+        materialize(_indices.subspan(_chunk * g_MaterializationChunk,
+                                     std::min(g_MaterializationChunk, _indices.size() - _chunk * g_MaterializationChunk)));
+    });
+}
 
-        // parse extension if any
-        // here we skip possible cases like
-        // filename. and .filename
-        // in such cases we think there's no extension at all
+void Listing::BuildFilenames()
+{
+    const size_t e = m_ItemsCount;
+    m_FilenamesCF = std::make_unique<std::atomic<CFStringRef>[]>(e);
+    if( !m_DisplayFilenames.empty() )
+        m_DisplayFilenamesCF = std::make_unique<std::atomic<CFStringRef>[]>(e);
+
+    // parse extension if any
+    // here we skip possible cases like
+    // filename. and .filename
+    // in such cases we think there's no extension at all
+    m_ExtensionOffsets.resize(e);
+    for( size_t i = 0; i != e; ++i ) {
+        const auto &current = m_Filenames[i];
         uint16_t offset = 0;
         auto dot_it = current.find_last_of('.');
         if( dot_it != std::string::npos && dot_it != 0 && dot_it != current.size() - 1 )
@@ -6,9 +6,11 @@
 #include <Base/intrusive_ptr.h>
 #include <VFS/VFSDeclarations.h>
 #include <Utility/Tags.h>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <span>
+#include <vector>
 
 /**
  * A note about symlinks handling. Listing must be aware, that some items might be symlinks.
@@ -77,6 +79,8 @@ public:
     std::string Path(unsigned _ind) const;
 
     const std::string &Filename(unsigned _ind) const;
+
+    // The CF strings of the filenames and the display filenames are created on the first request, from any thread.
     CFStringRef FilenameCF(unsigned _ind) const;
 #ifdef __OBJC__
     NSString *FilenameNS(unsigned _ind) const;
@@ -140,6 +144,9 @@ public:
     bool IsSymlink(unsigned _ind) const;
     bool IsHidden(unsigned _ind) const;
 
+    // Creates the CF strings of the (display) filenames of the specified items upfront, e.g. of the visible ones.
+    void MaterializeCFStrings(std::span<const unsigned> _indices) const;
+
     class iterator;
     iterator begin() const noexcept;
     iterator end() const noexcept;
@@ -149,16 +156,18 @@ private:
     Listing(const Listing &) = delete;
     Listing &operator=(const Listing &) = delete;
     void BuildFilenames();
+    static CFStringRef MaterializeCFString(std::atomic<CFStringRef> &_slot, const std::string &_utf8);
 
     unsigned m_ItemsCount;
     time_t m_CreationTime;
     std::chrono::nanoseconds m_CreationTicks; // the kernel ticks stamp at which the Listing was created
     std::string m_Title;
-    std::unique_ptr<std::string[]> m_Filenames;
-    std::unique_ptr<base::CFString[]> m_FilenamesCF;
-    std::unique_ptr<uint16_t[]> m_ExtensionOffsets;
-    std::unique_ptr<mode_t[]> m_UnixModes;
-    std::unique_ptr<uint8_t[]> m_UnixTypes;
+    // the columns which every item has are plain arrays adopted from ListingInput as they are
+    std::vector<std::string> m_Filenames;
+    std::unique_ptr<std::atomic<CFStringRef>[]> m_FilenamesCF; // owned references, nullptr until requested
+    std::vector<uint16_t> m_ExtensionOffsets;
+    std::vector<mode_t> m_UnixModes;
+    std::vector<uint8_t> m_UnixTypes;
     base::variable_container<VFSHostPtr> m_Hosts;
     base::variable_container<std::string> m_Directories;
     base::variable_container<uint64_t> m_Sizes;
@@ -173,7 +182,7 @@ private:
     base::variable_container<uint32_t> m_UnixFlags;
     base::variable_container<std::string> m_Symlinks;
     base::variable_container<std::string> m_DisplayFilenames;
-    base::variable_container<base::CFString> m_DisplayFilenamesCF;
+    std::unique_ptr<std::atomic<CFStringRef>[]> m_DisplayFilenamesCF; // same, allocated if there are display names
     robin_hood::unordered_flat_map<size_t, std::vector<utility::Tags::Tag>> m_Tags;
 
     // this is a copy of POSIX/BSD constants to reduce headers pollution
@@ -367,7 +376,9 @@ inline const std::string &Listing::Filename(unsigned _ind) const
 inline CFStringRef Listing::FilenameCF(unsigned _ind) const
 {
     VFS_LISTING_CHECK_BOUNDS(_ind);
-    return *m_FilenamesCF[_ind];
+    if( const CFStringRef str = m_FilenamesCF[_ind].load(std::memory_order_acquire) )
+        return str;
+    return MaterializeCFString(m_FilenamesCF[_ind], m_Filenames[_ind]);
 }
 
 inline std::string Listing::Path(unsigned _ind) const
@@ -630,7 +641,11 @@ inline const std::string &Listing::DisplayFilename(unsigned _ind) const
 inline CFStringRef Listing::DisplayFilenameCF(unsigned _ind) const
 {
     VFS_LISTING_CHECK_BOUNDS(_ind);
-    return m_DisplayFilenamesCF.has(_ind) ? *m_DisplayFilenamesCF[_ind] : FilenameCF(_ind);
+    if( !m_DisplayFilenames.has(_ind) )
+        return FilenameCF(_ind);
+    if( const CFStringRef str = m_DisplayFilenamesCF[_ind].load(std::memory_order_acquire) )
+        return str;
+    return MaterializeCFString(m_DisplayFilenamesCF[_ind], m_DisplayFilenames[_ind]);
 }
 
 inline bool Listing::IsDotDot(unsigned _ind) const
@@ -4,10 +4,14 @@
 #include <sys/errno.h>
 #include <sys/vnode.h>
 #include <Base/algo.h>
+#include <Base/DispatchGroup.h>
 #include <RoutedIO/RoutedIO.h>
 #include <Utility/PathManip.h>
 #include <VFS/VFSError.h>
 #include <sys/stat.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <vector>
 
 // hack to access function from libc implementation directly.
@@ -16,6 +20,17 @@ struct dirent *_readdir_unlocked(DIR *, int) __DARWIN_INODE64(_readdir_unlocked)
 
 namespace nc::vfs::native {
 
+// getattrlistbulk() fills the buffer with as many entries as fit, thus a larger buffer means fewer syscalls
+static constexpr size_t g_BulkBufferSize = 256 * 1024;
+
+// a buffer with less free space than this is considered full, i.e. more entries are likely to follow
+static constexpr size_t g_BulkBufferReserve = 4096;
+
+static constexpr uint64_t g_BulkOptions = FSOPT_ATTR_CMN_EXTENDED;
+
+// amount of entries stat()-ed by one task in the admin mode
+static constexpr size_t g_StatChunkSize = 256;
+
 static mode_t VNodeToUnixMode(const fsobj_type_t _type)
 {
     switch( _type ) {
@@ -208,36 +223,61 @@ int Fetching::ReadDirAttributesStat(const int _dir_fd,
                                     const std::function<void(size_t _fetched_now)> &_cb_fetch,
                                     const Callback &_cb_param)
 {
-    // initial directory lookup
-    std::vector<std::tuple<std::string, uint64_t, uint8_t>> dirents; // name, inode, entry_type
+    // the entries are stat()-ed by chunks concurrently while the directory is still being read, since with the
+    // routed I/O every call is a round-trip to the privileged helper
+    struct Chunk {
+        std::vector<std::string> names;
+        std::vector<struct stat> stats;
+        std::vector<char> stat_ok;
+    };
+    auto &io = nc::routedio::RoutedIO::Default;
+    const auto stat_chunk = [&io, _dir_path](Chunk &_chunk) {
+        _chunk.stats.resize(_chunk.names.size());
+        _chunk.stat_ok.resize(_chunk.names.size());
+        std::string entry_path = _dir_path; // need absolute paths
+        const size_t dir_path_len = entry_path.length();
+        for( size_t i = 0; i != _chunk.names.size(); ++i ) {
+            entry_path.resize(dir_path_len);
+            entry_path += _chunk.names[i];
+            _chunk.stat_ok[i] = io.lstat(entry_path.c_str(), &_chunk.stats[i]) == 0;
+        }
+    };
+
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    base::DispatchGroup stat_group; // destroyed before the chunks, waiting for the pending tasks
     if( auto dirp = fdopendir(dup(_dir_fd)) ) {
         auto close_dir = at_scope_end([=] { closedir(dirp); });
-        static const auto dirents_reserve_amount = 64;
-        dirents.reserve(dirents_reserve_amount);
+        auto chunk = std::make_unique<Chunk>();
+        chunk->names.reserve(g_StatChunkSize);
         while( auto entp = ::_readdir_unlocked(dirp, 1) ) {
             if( entp->d_ino == 0 ||         // apple's documentation suggest to skip such files
                 strisdot(entp->d_name) ||   // do not process self entry
                 strisdotdot(entp->d_name) ) // do not process parent entry
                 continue;
 
-            dirents.emplace_back(
-                std::string(entp->d_name, entp->d_namlen), entp->d_ino, entp->d_type);
+            chunk->names.emplace_back(entp->d_name, entp->d_namlen);
+            if( chunk->names.size() == g_StatChunkSize ) {
+                stat_group.Run([&stat_chunk, full_chunk = chunk.get()] { stat_chunk(*full_chunk); });
+                chunks.emplace_back(std::move(chunk));
+                chunk = std::make_unique<Chunk>();
+                chunk->names.reserve(g_StatChunkSize);
+            }
         }
+        stat_chunk(*chunk);
+        chunks.emplace_back(std::move(chunk));
     }
     else
         return errno;
+    stat_group.Wait();
 
-    // call stat() for every directory entry
-    auto &io = nc::routedio::RoutedIO::Default;
-    for( auto &e : dirents ) {
-        // need absolute paths
-        const std::string entry_path = _dir_path + std::get<0>(e);
-
-        // stat the file
-        struct stat stat_buffer;
-        if( io.lstat(entry_path.c_str(), &stat_buffer) == 0 ) {
+    // report the entries in the order of the directory
+    for( auto &chunk : chunks ) {
+        for( size_t i = 0; i != chunk->names.size(); ++i ) {
+            if( !chunk->stat_ok[i] )
+                continue;
+            const struct stat &stat_buffer = chunk->stats[i];
             CallbackParams params;
-            params.filename = std::get<0>(e).c_str();
+            params.filename = chunk->names[i].c_str();
             params.crt_time = stat_buffer.st_birthtimespec.tv_sec;
             params.mod_time = stat_buffer.st_mtimespec.tv_sec;
             params.chg_time = stat_buffer.st_mtimespec.tv_sec;
@@ -262,9 +302,7 @@ int Fetching::ReadDirAttributesStat(const int _dir_fd,
     return 0;
 }
 
-int Fetching::ReadDirAttributesBulk(const int _dir_fd,
-                                    const std::function<void(size_t _fetched_now)> &_cb_fetch,
-                                    const Callback &_cb_param)
+static attrlist BulkAttributesList() noexcept
 {
     attrlist attr_list;
     memset(&attr_list, 0, sizeof(attr_list));
@@ -276,153 +314,244 @@ int Fetching::ReadDirAttributesBulk(const int _dir_fd,
                            ATTR_CMN_FLAGS | ATTR_CMN_FILEID;
     attr_list.fileattr = ATTR_FILE_DATALENGTH;
     attr_list.forkattr = ATTR_CMNEXT_EXT_FLAGS;
+    return attr_list;
+}
 
-// TODO: handle ENOTSUP
-//    getattrlist() will return ENOTSUP if it is not supported on a particular volume.
+// Parses a batch of entries returned by getattrlistbulk(), returns the amount of bytes it occupied
+static size_t ParseBulkBatch(const char *_buffer, int _count, const Fetching::Callback &_cb_param)
+{
+    Fetching::CallbackParams params;
+    const char *entry_start = _buffer;
+    for( int index = 0; index < _count; index++ ) {
+        const char *field = entry_start;
+        const uint32_t length = *reinterpret_cast<const uint32_t *>(field);
+        field += sizeof(uint32_t);
 
-    constexpr uint64_t options = FSOPT_ATTR_CMN_EXTENDED;
-    constexpr size_t attr_buf_size = 65536;
-    std::unique_ptr<char[]> attr_buf = std::make_unique<char[]>(attr_buf_size);
-    CallbackParams params;
-    while( true ) {
-        const int retcount = getattrlistbulk(_dir_fd, &attr_list, &attr_buf[0], attr_buf_size, options);
-        if( retcount < 0 )
-            return errno;
+        entry_start += length;
 
-        if( retcount == 0 )
-            return 0;
+        const attribute_set_t returned = *reinterpret_cast<const attribute_set_t *>(field);
+        field += sizeof(attribute_set_t);
 
-        _cb_fetch(retcount);
+        if( returned.commonattr & ATTR_CMN_ERROR ) {
+            continue;
+        }
 
-        const char *entry_start = &attr_buf[0];
-        for( int index = 0; index < retcount; index++ ) {
-            const char *field = entry_start;
-            const uint32_t length = *reinterpret_cast<const uint32_t *>(field);
-            field += sizeof(uint32_t);
+        if( returned.commonattr & ATTR_CMN_NAME ) {
+            params.filename =
+                field + reinterpret_cast<const attrreference_t *>(field)->attr_dataoffset;
+            field += sizeof(attrreference_t);
+        }
+        else
+            continue; // can't work without filename
 
-            entry_start += length;
+        if( returned.commonattr & ATTR_CMN_DEVID ) {
+            params.dev = *reinterpret_cast<const dev_t *>(field);
+            field += sizeof(dev_t);
+        }
 
-            const attribute_set_t returned = *reinterpret_cast<const attribute_set_t *>(field);
-            field += sizeof(attribute_set_t);
+        params.mode = 0;
+        if( returned.commonattr & ATTR_CMN_OBJTYPE ) {
+            params.mode = VNodeToUnixMode(*reinterpret_cast<const fsobj_type_t *>(field));
+            field += sizeof(fsobj_type_t);
+        }
 
-            if( returned.commonattr & ATTR_CMN_ERROR ) {
-                continue;
-            }
+        if( returned.commonattr & ATTR_CMN_CRTIME ) {
+            params.crt_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
+            field += sizeof(timespec);
+        }
+        else {
+            params.crt_time = 0;
+        }
 
-            if( returned.commonattr & ATTR_CMN_NAME ) {
-                params.filename =
-                    field + reinterpret_cast<const attrreference_t *>(field)->attr_dataoffset;
-                field += sizeof(attrreference_t);
-            }
-            else
-                continue; // can't work without filename
+        if( returned.commonattr & ATTR_CMN_MODTIME ) {
+            params.mod_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
+            field += sizeof(timespec);
+        }
+        else {
+            params.mod_time = 0;
+        }
 
-            if( returned.commonattr & ATTR_CMN_DEVID ) {
-                params.dev = *reinterpret_cast<const dev_t *>(field);
-                field += sizeof(dev_t);
-            }
+        if( returned.commonattr & ATTR_CMN_CHGTIME ) {
+            params.chg_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
+            field += sizeof(timespec);
+        }
+        else {
+            params.chg_time = 0;
+        }
 
-            params.mode = 0;
-            if( returned.commonattr & ATTR_CMN_OBJTYPE ) {
-                params.mode = VNodeToUnixMode(*reinterpret_cast<const fsobj_type_t *>(field));
-                field += sizeof(fsobj_type_t);
-            }
+        if( returned.commonattr & ATTR_CMN_ACCTIME ) {
+            params.acc_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
+            field += sizeof(timespec);
+        }
+        else {
+            params.acc_time = 0;
+        }
 
-            if( returned.commonattr & ATTR_CMN_CRTIME ) {
-                params.crt_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
-                field += sizeof(timespec);
-            }
-            else {
-                params.crt_time = 0;
-            }
+        if( returned.commonattr & ATTR_CMN_OWNERID ) {
+            params.uid = *reinterpret_cast<const uid_t *>(field);
+            field += sizeof(uid_t);
+        }
+        else {
+            params.uid = 0;
+        }
 
-            if( returned.commonattr & ATTR_CMN_MODTIME ) {
-                params.mod_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
-                field += sizeof(timespec);
-            }
-            else {
-                params.mod_time = 0;
-            }
+        if( returned.commonattr & ATTR_CMN_GRPID ) {
+            params.gid = *reinterpret_cast<const gid_t *>(field);
+            field += sizeof(gid_t);
+        }
+        else {
+            params.gid = 0;
+        }
 
-            if( returned.commonattr & ATTR_CMN_CHGTIME ) {
-                params.chg_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
-                field += sizeof(timespec);
-            }
-            else {
-                params.chg_time = 0;
-            }
+        if( returned.commonattr & ATTR_CMN_ACCESSMASK ) {
+            params.mode |= *reinterpret_cast<const u_int32_t *>(field) & (~S_IFMT);
+            field += sizeof(u_int32_t);
+        }
 
-            if( returned.commonattr & ATTR_CMN_ACCTIME ) {
-                params.acc_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
-                field += sizeof(timespec);
-            }
-            else {
-                params.acc_time = 0;
-            }
+        if( returned.commonattr & ATTR_CMN_FLAGS ) {
+            params.flags = *reinterpret_cast<const u_int32_t *>(field);
+            field += sizeof(u_int32_t);
+        }
+        else {
+            params.flags = 0;
+        }
 
-            if( returned.commonattr & ATTR_CMN_OWNERID ) {
-                params.uid = *reinterpret_cast<const uid_t *>(field);
-                field += sizeof(uid_t);
-            }
-            else {
-                params.uid = 0;
-            }
+        if( returned.commonattr & ATTR_CMN_FILEID ) {
+            params.inode = *reinterpret_cast<const u_int64_t *>(field);
+            field += sizeof(uint64_t);
+        }
+        else {
+            params.inode = 0;
+        }
 
-            if( returned.commonattr & ATTR_CMN_GRPID ) {
-                params.gid = *reinterpret_cast<const gid_t *>(field);
-                field += sizeof(gid_t);
-            }
-            else {
-                params.gid = 0;
-            }
+        if( returned.commonattr & ATTR_CMN_ADDEDTIME ) {
+            params.add_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
+            field += sizeof(timespec);
+        }
+        else {
+            params.add_time = -1;
+        }
 
-            if( returned.commonattr & ATTR_CMN_ACCESSMASK ) {
-                params.mode |= *reinterpret_cast<const u_int32_t *>(field) & (~S_IFMT);
-                field += sizeof(u_int32_t);
-            }
+        if( returned.fileattr & ATTR_FILE_DATALENGTH ) {
+            params.size = *reinterpret_cast<const off_t *>(field);
+            field += sizeof(off_t);
+        }
+        else {
+            params.size = -1;
+        }
+        
+        if( returned.forkattr & ATTR_CMNEXT_EXT_FLAGS ) {
+            params.ext_flags = *reinterpret_cast<const uint64_t *>(field);
+            field += sizeof(uint64_t);
+        }
+        else {
+            params.ext_flags = 0;
+        }
 
-            if( returned.commonattr & ATTR_CMN_FLAGS ) {
-                params.flags = *reinterpret_cast<const u_int32_t *>(field);
-                field += sizeof(u_int32_t);
-            }
-            else {
-                params.flags = 0;
-            }
+        _cb_param(params);
+    }
+    return static_cast<size_t>(entry_start - _buffer);
+}
 
-            if( returned.commonattr & ATTR_CMN_FILEID ) {
-                params.inode = *reinterpret_cast<const u_int64_t *>(field);
-                field += sizeof(uint64_t);
-            }
-            else {
-                params.inode = 0;
-            }
+int Fetching::ReadDirAttributesBulk(const int _dir_fd,
+                                    const std::function<void(size_t _fetched_now)> &_cb_fetch,
+                                    const Callback &_cb_param)
+{
+    // TODO: handle ENOTSUP
+    //    getattrlistbulk() will return ENOTSUP if it is not supported on a particular volume.
 
-            if( returned.commonattr & ATTR_CMN_ADDEDTIME ) {
-                params.add_time = reinterpret_cast<const struct timespec *>(field)->tv_sec;
-                field += sizeof(timespec);
-            }
-            else {
-                params.add_time = -1;
-            }
+    attrlist attr_list = BulkAttributesList();
+    auto attr_buf = std::make_unique<char[]>(g_BulkBufferSize);
+    const int first_count = getattrlistbulk(_dir_fd, &attr_list, attr_buf.get(), g_BulkBufferSize, g_BulkOptions);
+    if( first_count < 0 )
+        return errno;
+    if( first_count == 0 )
+        return 0;
+
+    _cb_fetch(first_count);
+    const size_t first_batch_bytes = ParseBulkBatch(attr_buf.get(), first_count, _cb_param);
+
+    if( first_batch_bytes + g_BulkBufferReserve < g_BulkBufferSize ) {
+        // the first batch didn't fill the buffer - this is a small directory, there will be nothing to overlap with
+        while( true ) {
+            const int count = getattrlistbulk(_dir_fd, &attr_list, attr_buf.get(), g_BulkBufferSize, g_BulkOptions);
+            if( count < 0 )
+                return errno;
+            if( count == 0 )
+                return 0;
+            _cb_fetch(count);
+            ParseBulkBatch(attr_buf.get(), count, _cb_param);
+        }
+    }
 
-            if( returned.fileattr & ATTR_FILE_DATALENGTH ) {
-                params.size = *reinterpret_cast<const off_t *>(field);
-                field += sizeof(off_t);
-            }
-            else {
-                params.size = -1;
-            }
-            
-            if( returned.forkattr & ATTR_CMNEXT_EXT_FLAGS ) {
-                params.ext_flags = *reinterpret_cast<const uint64_t *>(field);
-                field += sizeof(uint64_t);
+    // a large directory - the next batches are read on a background thread while the caller parses the previous
+    // ones. two buffers are passed back and forth between the reader and the parser.
+    struct Batch {
+        std::unique_ptr<char[]> buffer;
+        int count = 0;
+        int error = 0;
+    };
+    std::mutex lock;
+    std::condition_variable batches_changed;
+    std::vector<std::unique_ptr<char[]>> free_buffers;
+    std::deque<Batch> ready_batches;
+    bool stop = false;
+    free_buffers.emplace_back(std::move(attr_buf));
+    free_buffers.emplace_back(std::make_unique<char[]>(g_BulkBufferSize));
+
+    base::DispatchGroup reader;
+    reader.Run([&] {
+        while( true ) {
+            Batch batch;
+            {
+                auto guard = std::unique_lock{lock};
+                batches_changed.wait(guard, [&] { return stop || !free_buffers.empty(); });
+                if( stop )
+                    return;
+                batch.buffer = std::move(free_buffers.back());
+                free_buffers.pop_back();
             }
-            else {
-                params.ext_flags = 0;
+            batch.count = getattrlistbulk(_dir_fd, &attr_list, batch.buffer.get(), g_BulkBufferSize, g_BulkOptions);
+            batch.error = batch.count < 0 ? errno : 0;
+            const bool last = batch.count <= 0;
+            {
+                auto guard = std::lock_guard{lock};
+                ready_batches.emplace_back(std::move(batch));
             }
+            batches_changed.notify_all();
+            if( last )
+                return;
+        }
+    });
+    auto stop_reader = at_scope_end([&] {
+        {
+            auto guard = std::lock_guard{lock};
+            stop = true;
+        }
+        batches_changed.notify_all();
+        reader.Wait();
+    });
 
-            _cb_param(params);
+    while( true ) {
+        Batch batch;
+        {
+            auto guard = std::unique_lock{lock};
+            batches_changed.wait(guard, [&] { return !ready_batches.empty(); });
+            batch = std::move(ready_batches.front());
+            ready_batches.pop_front();
+        }
+        if( batch.count < 0 )
+            return batch.error;
+        if( batch.count == 0 )
+            return 0;
+
+        _cb_fetch(batch.count);
+        ParseBulkBatch(batch.buffer.get(), batch.count, _cb_param);
+        {
+            auto guard = std::lock_guard{lock};
+            free_buffers.emplace_back(std::move(batch.buffer));
         }
+        batches_changed.notify_all();
     }
 }
 
@@ -57,6 +57,10 @@ public:
     bool IsDirChangeObservingAvailable(const char *_path) override;
     HostDirObservationTicket DirChangeObserve(const char *_path,
                                               std::function<void()> _handler) override;
+
+    HostDirObservationTicket
+    DirSubtreeChangeObserve(const char *_path,
+                            std::function<void(std::string_view _dir, bool _recursive)> _handler) override;
     
     void StopDirChangeObserving(unsigned long _ticket) override;
     
@@ -20,6 +20,8 @@
 #include <Utility/ObjCpp.h>
 #include <Utility/Tags.h>
 #include <sys/mount.h>
+#include <atomic>
+#include <mutex>
 
 // hack to access function from libc implementation directly.
 // this func does readdir but without mutex locking
@@ -358,36 +360,78 @@ int NativeHost::CreateFile(const char *_path,
     return VFSError::Ok;
 }
 
-// return VFSError on error or cancellation
-static int CalculateDirectoriesSizesHelper(char *_path,
-                                           size_t _path_len,
-                                           std::atomic_bool &_iscancelling,
-                                           const VFSCancelChecker &_checker,
-                                           dispatch_queue &_stat_queue,
-                                           std::atomic_int64_t &_size_stock)
+// Amount of directories listed concurrently by CalculateDirectorySize()
+static constexpr size_t g_DirectorySizeStreams = 8;
+
+namespace {
+
+// Sums the sizes of the files in a directory tree.
+// Each directory is listed and its files are lstat()-ed by one of a few workers, the subdirectories found along the way
+// are queued for the others. The queue is a stack, so the walk goes depth-first and the queue stays short.
+class DirectorySizeWalk
 {
-    if( _checker && _checker() ) {
-        _iscancelling = true;
+public:
+    DirectorySizeWalk(const VFSCancelChecker &_cancel_checker) : m_CancelChecker(_cancel_checker) {}
+
+    // Returns the total size, or a VFSError if the root directory can't be listed or the walk was cancelled
+    ssize_t Run(const std::string &_root);
+
+private:
+    int Walk(const std::string &_directory, std::vector<std::string> &_subdirectories);
+    void Enqueue(std::vector<std::string> &_subdirectories); // called with m_Lock held
+    void Worker();
+    bool IsCancelled();
+
+    const VFSCancelChecker &m_CancelChecker;
+    std::mutex m_CancelCheckerLock; // the cancel checker is never called concurrently
+    std::mutex m_Lock;
+    std::vector<std::string> m_Queue;
+    size_t m_RunningWorkers = 0;
+    std::atomic_bool m_Cancelled = false;
+    std::atomic_int64_t m_Size = 0;
+    base::DispatchGroup m_Workers;
+};
+
+} // namespace
+
+ssize_t DirectorySizeWalk::Run(const std::string &_root)
+{
+    if( m_CancelChecker && m_CancelChecker() )
         return VFSError::Cancelled;
+
+    std::vector<std::string> subdirectories;
+    if( const int rc = Walk(_root, subdirectories); rc != VFSError::Ok )
+        return rc;
+
+    {
+        auto lock = std::lock_guard{m_Lock};
+        Enqueue(subdirectories);
     }
+    m_Workers.Wait();
 
-    auto &io = routedio::RoutedIO::InterfaceForAccess(_path, R_OK); // <-- sync IO operation
+    if( m_Cancelled )
+        return VFSError::Cancelled;
+    return m_Size;
+}
 
-    const auto dirp = io.opendir(_path); // <-- sync IO operation
+int DirectorySizeWalk::Walk(const std::string &_directory, std::vector<std::string> &_subdirectories)
+{
+    auto &io = routedio::RoutedIO::InterfaceForAccess(_directory.c_str(), R_OK); // <-- sync IO operation
+
+    const auto dirp = io.opendir(_directory.c_str()); // <-- sync IO operation
     if( dirp == nullptr )
         return VFSError::FromErrno();
 
-    _path[_path_len] = '/';
-    _path[_path_len + 1] = 0;
-    char *var = _path + _path_len + 1;
+    std::string path = _directory;
+    if( path.empty() || path.back() != '/' )
+        path += '/';
+    const size_t path_len = path.length();
 
+    int64_t size = 0;
     dirent *entp = nullptr;
-    while( (entp = io.readdir(dirp)) != NULL ) { // <-- sync IO operation
-        if( _checker && _checker() ) {
-            _iscancelling = true;
-            goto cleanup;
-        }
-
+    while( (entp = io.readdir(dirp)) != nullptr ) { // <-- sync IO operation
+        if( IsCancelled() )
+            break;
         if( entp->d_ino == 0 )
             continue; // apple's documentation suggest to skip such files
         if( entp->d_namlen == 1 && entp->d_name[0] == '.' )
@@ -395,48 +439,73 @@ static int CalculateDirectoriesSizesHelper(char *_path,
         if( entp->d_namlen == 2 && entp->d_name[0] == '.' && entp->d_name[1] == '.' )
             continue; // do not process parent entry
 
-        memcpy(var, entp->d_name, entp->d_namlen + 1);
+        path.resize(path_len);
+        path.append(entp->d_name, entp->d_namlen);
         if( entp->d_type == DT_DIR ) {
-            CalculateDirectoriesSizesHelper(
-                _path, _path_len + entp->d_namlen + 1, _iscancelling, _checker, _stat_queue, _size_stock);
-            if( _iscancelling )
-                goto cleanup;
+            _subdirectories.emplace_back(path);
         }
-        else if( entp->d_type == DT_REG || entp->d_type == DT_LNK ) {
-            std::string full_path = _path;
-            _stat_queue.async([&, full_path = std::move(full_path)] {
-                if( _iscancelling )
-                    return;
-
-                struct stat st;
-                if( io.lstat(full_path.c_str(), &st) == 0 ) // <-- sync IO operation
-                    _size_stock += st.st_size;
-            });
-        }
-        else if( entp->d_type == DT_UNKNOWN ) {
+        else if( entp->d_type == DT_REG || entp->d_type == DT_LNK || entp->d_type == DT_UNKNOWN ) {
             // some filesystems (e.g. ftp) might provide DT_UNKNOWN via readdir, so need to check
             // them via lstat() before doing further processing
             struct stat st;
-            if( io.lstat(_path, &st) == 0 ) { // <-- sync IO operation
-                if( S_ISDIR(st.st_mode) ) {
-                    CalculateDirectoriesSizesHelper(
-                        _path, _path_len + entp->d_namlen + 1, _iscancelling, _checker, _stat_queue, _size_stock);
-                    if( _iscancelling )
-                        goto cleanup;
-                }
-                else if( S_ISREG(st.st_mode) || S_ISLNK(st.st_mode) ) {
-                    _size_stock += st.st_size;
-                }
+            if( io.lstat(path.c_str(), &st) == 0 ) { // <-- sync IO operation
+                if( S_ISDIR(st.st_mode) )
+                    _subdirectories.emplace_back(path);
+                else if( S_ISREG(st.st_mode) || S_ISLNK(st.st_mode) )
+                    size += st.st_size;
             }
         }
     }
 
-cleanup:
     io.closedir(dirp); // <-- sync IO operation
-    _path[_path_len] = 0;
+    m_Size += size;
     return VFSError::Ok;
 }
 
+void DirectorySizeWalk::Enqueue(std::vector<std::string> &_subdirectories)
+{
+    for( auto &subdirectory : _subdirectories )
+        m_Queue.emplace_back(std::move(subdirectory));
+    _subdirectories.clear();
+    while( m_RunningWorkers < std::min(g_DirectorySizeStreams, m_Queue.size()) ) {
+        ++m_RunningWorkers;
+        m_Workers.Run([this] { Worker(); });
+    }
+}
+
+void DirectorySizeWalk::Worker()
+{
+    std::vector<std::string> subdirectories;
+    auto lock = std::unique_lock{m_Lock};
+    while( !m_Queue.empty() ) {
+        if( IsCancelled() ) {
+            m_Queue.clear();
+            break;
+        }
+        const std::string directory = std::move(m_Queue.back());
+        m_Queue.pop_back();
+
+        lock.unlock();
+        Walk(directory, subdirectories); // silently skip the subdirectories which can't be listed
+        lock.lock();
+
+        Enqueue(subdirectories);
+    }
+    --m_RunningWorkers;
+}
+
+bool DirectorySizeWalk::IsCancelled()
+{
+    if( m_Cancelled )
+        return true;
+    if( !m_CancelChecker )
+        return false;
+    auto lock = std::lock_guard{m_CancelCheckerLock};
+    if( m_CancelChecker() )
+        m_Cancelled = true;
+    return m_Cancelled;
+}
+
 ssize_t NativeHost::CalculateDirectorySize(const char *_path, const VFSCancelChecker &_cancel_checker)
 {
     if( _cancel_checker && _cancel_checker() )
@@ -445,19 +514,8 @@ ssize_t NativeHost::CalculateDirectorySize(const char *_path, const VFSCancelChe
     if( _path == 0 || _path[0] != '/' )
         return VFSError::InvalidCall;
 
-    std::atomic_bool iscancelling{false};
-    char path[MAXPATHLEN];
-    strcpy(path, _path);
-
-    dispatch_queue stat_queue("VFSNativeHost.CalculateDirectoriesSizes");
-
-    std::atomic_int64_t size{0};
-    int result = CalculateDirectoriesSizesHelper(path, strlen(path), iscancelling, _cancel_checker, stat_queue, size);
-    stat_queue.sync([] {});
-    if( result >= 0 )
-        return size;
-    else
-        return result;
+    DirectorySizeWalk walk(_cancel_checker);
+    return walk.Run(_path);
 }
 
 bool NativeHost::IsDirChangeObservingAvailable(const char *_path)
@@ -474,6 +532,15 @@ HostDirObservationTicket NativeHost::DirChangeObserve(const char *_path, std::fu
     return t ? HostDirObservationTicket(t, shared_from_this()) : HostDirObservationTicket();
 }
 
+HostDirObservationTicket
+NativeHost::DirSubtreeChangeObserve(const char *_path,
+                                    std::function<void(std::string_view _dir, bool _recursive)> _handler)
+{
+    auto &inst = nc::utility::FSEventsDirUpdate::Instance();
+    uint64_t t = inst.AddWatchSubtree(_path, std::move(_handler));
+    return t ? HostDirObservationTicket(t, shared_from_this()) : HostDirObservationTicket();
+}
+
 void NativeHost::StopDirChangeObserving(unsigned long _ticket)
 {
     auto &inst = nc::utility::FSEventsDirUpdate::Instance();
@@ -3,9 +3,197 @@
 #include <sys/stat.h>
 #include <VFS/FileWindow.h>
 #include <VFS/SearchInFile.h>
+#include <Base/DispatchGroup.h>
+#include <Base/algo.h>
+#include <Base/spinlock.h>
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <thread>
 
 namespace nc::vfs {
 
+// amount of found items accumulated by a parallel worker before passing them to the FoundCallback
+static constexpr size_t g_FoundBatchSize = 64;
+
+enum class HostKind : size_t {
+    Native = 0,
+    Archive = 1,
+    Network = 2
+};
+
+static HostKind KindOf(const VFSHost &_host) noexcept
+{
+    if( _host.IsNativeFS() )
+        return HostKind::Native;
+    if( _host.IsImmutableFS() )
+        return HostKind::Archive;
+    return HostKind::Network;
+}
+
+static size_t Resolve(int _limit) noexcept
+{
+    if( _limit > 0 )
+        return static_cast<size_t>(_limit);
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+struct SearchForFiles::Found {
+    std::string filename;
+    std::string dir_path;
+    VFSHostPtr host;
+    CFRange content_pos;
+};
+
+// A set of per-worker deques with work stealing. Each worker takes its own items from the back (LIFO) and steals
+// from the front of the others (FIFO). With a single worker the deque is consumed from the front which gives the
+// classic breadth-first order.
+// Additionally, limits the amount of workers simultaneously busy with items from each kind of host.
+class SearchForFiles::Traversal
+{
+public:
+    struct Item {
+        VFSPath dir;
+        std::string content_check; // if non-empty - a file in 'dir' which content is yet to be filtered
+    };
+
+    Traversal(const base::SerialQueue &_queue, size_t _workers, const std::array<size_t, 3> &_limits)
+        : m_Queue(_queue), m_Shards(_workers), m_Limits(_limits)
+    {
+    }
+
+    size_t Workers() const noexcept { return m_Shards.size(); }
+
+    std::vector<Found> &FoundBatch(size_t _worker) noexcept { return m_Shards[_worker].found; }
+
+    void Push(size_t _worker, Item _item)
+    {
+        m_Pending.fetch_add(1);
+        {
+            auto &shard = m_Shards[_worker];
+            auto lock = std::lock_guard{shard.lock};
+            shard.items.emplace_back(std::move(_item));
+        }
+        m_Queued.fetch_add(1);
+        if( m_Shards.size() > 1 )
+            Notify(m_WakeLock, m_Wake, false);
+    }
+
+    // Returns std::nullopt when there's nothing left to process or the search was stopped.
+    std::optional<Item> Pop(size_t _worker)
+    {
+        while( true ) {
+            if( m_Queue.IsStopped() )
+                return std::nullopt;
+            if( auto item = TryPopOwn(_worker) )
+                return item;
+            if( auto item = TrySteal(_worker) )
+                return item;
+            if( m_Pending.load() == 0 )
+                return std::nullopt;
+            auto lock = std::unique_lock{m_WakeLock};
+            m_Wake.wait(lock, [this] { return m_Queued.load() != 0 || m_Pending.load() == 0 || m_Interrupted; });
+        }
+    }
+
+    // Marks an item previously received via Pop() as processed.
+    void Done()
+    {
+        if( m_Pending.fetch_sub(1) == 1 )
+            Notify(m_WakeLock, m_Wake, true);
+    }
+
+    void Acquire(HostKind _kind)
+    {
+        const auto idx = static_cast<size_t>(_kind);
+        auto lock = std::unique_lock{m_GateLock};
+        m_Gate.wait(lock, [&] { return m_Active[idx] < m_Limits[idx] || m_Interrupted; });
+        ++m_Active[idx];
+    }
+
+    void Release(HostKind _kind)
+    {
+        {
+            auto lock = std::lock_guard{m_GateLock};
+            --m_Active[static_cast<size_t>(_kind)];
+        }
+        m_Gate.notify_one();
+    }
+
+    // Wakes up all the waiting workers for good, must be called after the search was stopped
+    void Interrupt()
+    {
+        {
+            auto lock = std::scoped_lock{m_WakeLock, m_GateLock};
+            m_Interrupted = true;
+        }
+        m_Wake.notify_all();
+        m_Gate.notify_all();
+    }
+
+private:
+    struct alignas(64) Shard {
+        spinlock lock;
+        std::deque<Item> items;
+        std::vector<Found> found;
+    };
+
+    // the waiters check their predicates under _lock, so taking it here makes the notification not to get lost
+    static void Notify(std::mutex &_lock, std::condition_variable &_cv, bool _all)
+    {
+        {
+            auto lock = std::lock_guard{_lock};
+        }
+        _all ? _cv.notify_all() : _cv.notify_one();
+    }
+
+    std::optional<Item> TryPopOwn(size_t _worker)
+    {
+        auto &shard = m_Shards[_worker];
+        auto lock = std::lock_guard{shard.lock};
+        if( shard.items.empty() )
+            return std::nullopt;
+        m_Queued.fetch_sub(1);
+        if( m_Shards.size() == 1 ) {
+            auto item = std::move(shard.items.front());
+            shard.items.pop_front();
+            return item;
+        }
+        auto item = std::move(shard.items.back());
+        shard.items.pop_back();
+        return item;
+    }
+
+    std::optional<Item> TrySteal(size_t _worker)
+    {
+        for( size_t i = 1; i < m_Shards.size(); ++i ) {
+            auto &victim = m_Shards[(_worker + i) % m_Shards.size()];
+            auto lock = std::lock_guard{victim.lock};
+            if( victim.items.empty() )
+                continue;
+            m_Queued.fetch_sub(1);
+            auto item = std::move(victim.items.front());
+            victim.items.pop_front();
+            return item;
+        }
+        return std::nullopt;
+    }
+
+    const base::SerialQueue &m_Queue;
+    std::vector<Shard> m_Shards;
+    std::atomic_size_t m_Pending{0}; // pushed and not done yet
+    std::atomic_size_t m_Queued{0};  // pushed and not popped yet
+    std::mutex m_WakeLock;
+    std::condition_variable m_Wake;
+    const std::array<size_t, 3> m_Limits;
+    std::array<size_t, 3> m_Active{};
+    std::mutex m_GateLock;
+    std::condition_variable m_Gate;
+    bool m_Interrupted = false; // guarded by both m_WakeLock and m_GateLock
+};
+
 static int EncodingFromXAttr(const VFSFilePtr &_f)
 {
     char buf[128];
@@ -47,6 +235,24 @@ void SearchForFiles::SetFilterContent(const FilterContent &_filter)
 {
     if( IsRunning() )
         throw std::logic_error("Filters can't be changed during background search process");
+
+    // compile the patterns once, they are shared by all the files being searched
+    m_FilterContentLiterals = nullptr;
+    m_FilterContentRegEx = nullptr;
+    m_FilterContentBytes = nullptr;
+    if( _filter.type == FilterContent::Type::Literals ) {
+        m_FilterContentLiterals = SearchInFile::CompileLiterals(_filter.literals, _filter.case_sensitive);
+    }
+    else if( _filter.type == FilterContent::Type::RegEx ) {
+        m_FilterContentRegEx = SearchInFile::CompileRegEx(_filter.text, _filter.case_sensitive);
+        if( !m_FilterContentRegEx )
+            throw std::invalid_argument("Malformed regular expression");
+    }
+    else if( _filter.type == FilterContent::Type::Bytes ) {
+        m_FilterContentBytes = SearchInFile::CompileBytePattern(_filter.text);
+        if( !m_FilterContentBytes )
+            throw std::invalid_argument("Malformed byte pattern");
+    }
     m_FilterContent = _filter;
 }
 
@@ -59,12 +265,29 @@ void SearchForFiles::SetFilterSize(const FilterSize &_filter)
     m_FilterSize = _filter;
 }
 
+void SearchForFiles::SetConcurrency(const Concurrency &_concurrency)
+{
+    if( IsRunning() )
+        throw std::logic_error("Concurrency can't be changed during background search process");
+    m_Concurrency = _concurrency;
+}
+
+void SearchForFiles::SetFileNameIndex(std::shared_ptr<const FileNameIndex> _index)
+{
+    if( IsRunning() )
+        throw std::logic_error("File name index can't be changed during background search process");
+    m_FileNameIndex = std::move(_index);
+}
+
 void SearchForFiles::ClearFilters()
 {
     if( IsRunning() )
         throw std::logic_error("Filters can't be changed during background search process");
     m_FilterName = {};
     m_FilterContent = std::nullopt;
+    m_FilterContentLiterals = nullptr;
+    m_FilterContentRegEx = nullptr;
+    m_FilterContentBytes = nullptr;
     m_FilterSize = std::nullopt;
 }
 
@@ -86,7 +309,6 @@ bool SearchForFiles::Go(const std::string &_from_path,
     m_SpawnArchiveCallback = std::move(_spawn_archive_callback);
     m_LookingInCallback = std::move(_looking_in_callback);
     m_SearchOptions = _options;
-    m_DirsFIFO = {};
 
     m_Queue.Run([=, this] { AsyncProc(_from_path.c_str(), *_in_host); });
 
@@ -96,6 +318,9 @@ bool SearchForFiles::Go(const std::string &_from_path,
 void SearchForFiles::Stop()
 {
     m_Queue.Stop();
+    auto lock = std::lock_guard{m_TraversalLock};
+    if( m_Traversal )
+        m_Traversal->Interrupt();
 }
 
 bool SearchForFiles::IsStopped()
@@ -110,43 +335,158 @@ void SearchForFiles::Wait()
 
 void SearchForFiles::NotifyLookingIn(const char *_path, VFSHost &_in_host) const
 {
-    if( m_LookingInCallback )
+    if( m_LookingInCallback ) {
+        auto lock = std::lock_guard{m_CallbackLock};
         m_LookingInCallback(_path, _in_host);
+    }
 }
 
 void SearchForFiles::AsyncProc(const char *_from_path, VFSHost &_in_host)
 {
-    m_DirsFIFO.emplace(_in_host.SharedPtr(), _from_path);
+    const std::array<size_t, 3> limits = {
+        Resolve(m_Concurrency.native), Resolve(m_Concurrency.archive), Resolve(m_Concurrency.network)};
+    const size_t workers =
+        (m_SearchOptions & Options::ParallelTraversal) ? *std::max_element(limits.begin(), limits.end()) : 1;
+
+    Traversal traversal(m_Queue, workers, limits);
+    {
+        auto lock = std::lock_guard{m_TraversalLock};
+        m_Traversal = &traversal;
+        if( m_Queue.IsStopped() )
+            traversal.Interrupt();
+    }
+    auto unregister = at_scope_end([this] {
+        auto lock = std::lock_guard{m_TraversalLock};
+        m_Traversal = nullptr;
+    });
+
+    if( CanUseFileNameIndex(_from_path) )
+        ProcessFileNameIndex(traversal, _from_path, _in_host); // may leave content checks for the workers
+    else
+        traversal.Push(0, {VFSPath(_in_host.SharedPtr(), _from_path), {}});
+
+    base::DispatchGroup group;
+    for( size_t worker = 1; worker < workers; ++worker )
+        group.Run([this, &traversal, worker] { WorkerProc(traversal, worker); });
+    WorkerProc(traversal, 0);
+    group.Wait();
+}
+
+void SearchForFiles::WorkerProc(Traversal &_traversal, size_t _worker)
+{
+    while( auto item = _traversal.Pop(_worker) ) {
+        const auto kind = KindOf(*item->dir.Host());
+        _traversal.Acquire(kind);
+        if( item->content_check.empty() )
+            ProcessDirectory(_traversal, _worker, item->dir);
+        else
+            ProcessContentCheck(_traversal, _worker, item->dir, item->content_check);
+        _traversal.Release(kind);
+        FlushFound(_traversal.FoundBatch(_worker));
+        _traversal.Done();
+    }
+    FlushFound(_traversal.FoundBatch(_worker));
+}
 
-    while( !m_DirsFIFO.empty() ) {
+void SearchForFiles::ProcessDirectory(Traversal &_traversal, size_t _worker, const VFSPath &_dir)
+{
+    NotifyLookingIn(_dir.Path().c_str(), *_dir.Host());
+
+    std::string full_path = _dir.Path();
+    if( full_path.empty() || full_path.back() != '/' )
+        full_path += '/';
+    const size_t dir_path_len = full_path.size();
+
+    _dir.Host()->IterateDirectoryListing(_dir.Path().c_str(), [&](const VFSDirEnt &_dirent) {
         if( m_Queue.IsStopped() )
-            break;
+            return false;
 
-        auto path = std::move(m_DirsFIFO.front());
-        m_DirsFIFO.pop();
+        full_path.resize(dir_path_len);
+        full_path += _dirent.name;
 
-        NotifyLookingIn(path.Path().c_str(), *path.Host());
+        ProcessDirent(_traversal, _worker, full_path.c_str(), _dir.Path().c_str(), _dirent, *_dir.Host());
 
-        path.Host()->IterateDirectoryListing(path.Path().c_str(), [&](const VFSDirEnt &_dirent) {
-            if( m_Queue.IsStopped() )
-                return false;
+        return true;
+    });
+}
 
-            std::string full_path = path.Path();
-            if( full_path.back() != '/' )
-                full_path += '/';
-            full_path += _dirent.name;
+void SearchForFiles::ProcessContentCheck(Traversal &_traversal,
+                                         size_t _worker,
+                                         const VFSPath &_dir,
+                                         const std::string &_filename)
+{
+    std::string full_path = _dir.Path();
+    if( full_path.empty() || full_path.back() != '/' )
+        full_path += '/';
+    full_path += _filename;
 
-            ProcessDirent(full_path.c_str(), path.Path().c_str(), _dirent, *path.Host());
+    CFRange content_pos{-1, 0};
+    if( FilterByContent(full_path.c_str(), *_dir.Host(), content_pos) )
+        ProcessValidEntry(_traversal, _worker, _filename.c_str(), _dir.Path().c_str(), *_dir.Host(), content_pos);
+}
 
-            return true;
-        });
+bool SearchForFiles::CanUseFileNameIndex(const char *_from_path) const
+{
+    return m_FileNameIndex && m_FileNameIndex->Covers(_from_path) && (m_SearchOptions & Options::GoIntoSubDirs) &&
+           !(m_SearchOptions & Options::LookInArchives);
+}
+
+void SearchForFiles::ProcessFileNameIndex(Traversal &_traversal, const char *_from_path, VFSHost &_in_host)
+{
+    NotifyLookingIn(_from_path, _in_host);
+
+    const auto mask = m_FilterName.IsEmpty() ? utility::FileMask("*") : m_FilterName;
+    const auto entries = m_FileNameIndex->Query(_from_path, mask, [this] { return m_Queue.IsStopped(); });
+
+    // report the entries with the same directory paths as the traversal would
+    std::string from_path = _from_path;
+    if( from_path.empty() || from_path.back() != '/' )
+        from_path += '/';
+    VFSDirEnt dirent;
+    std::string full_path;
+    std::string dir_path;
+    for( const auto &entry : entries ) {
+        if( m_Queue.IsStopped() )
+            return;
+        if( entry.dir_path == from_path )
+            dir_path = _from_path;
+        else
+            dir_path.assign(entry.dir_path, 0, entry.dir_path.size() - 1);
+        full_path = entry.dir_path + entry.name;
+        dirent.type = entry.type;
+        dirent.name_len = static_cast<uint16_t>(std::min(entry.name.size(), sizeof(dirent.name) - 1));
+        std::memcpy(dirent.name, entry.name.data(), dirent.name_len);
+        dirent.name[dirent.name_len] = 0;
+        ProcessEntry(_traversal, 0, full_path.c_str(), dir_path.c_str(), dirent, _in_host);
     }
+    FlushFound(_traversal.FoundBatch(0));
 }
 
-void SearchForFiles::ProcessDirent(const char *_full_path,
+void SearchForFiles::ProcessDirent(Traversal &_traversal,
+                                   size_t _worker,
+                                   const char *_full_path,
                                    const char *_dir_path,
                                    const VFSDirEnt &_dirent,
                                    VFSHost &_in_host)
+{
+    ProcessEntry(_traversal, _worker, _full_path, _dir_path, _dirent, _in_host);
+
+    if( m_SearchOptions & Options::GoIntoSubDirs )
+        if( _dirent.type == VFSDirEnt::Dir )
+            _traversal.Push(_worker, {VFSPath(_in_host.SharedPtr(), _full_path), {}});
+
+    if( m_SearchOptions & Options::LookInArchives )
+        if( _dirent.type == VFSDirEnt::Reg && m_SpawnArchiveCallback )
+            if( auto archive_host = SpawnArchive(_full_path, _in_host) )
+                _traversal.Push(_worker, {VFSPath(archive_host, "/"), {}});
+}
+
+void SearchForFiles::ProcessEntry(Traversal &_traversal,
+                                  size_t _worker,
+                                  const char *_full_path,
+                                  const char *_dir_path,
+                                  const VFSDirEnt &_dirent,
+                                  VFSHost &_in_host)
 {
     bool failed_filtering = false;
 
@@ -181,21 +521,25 @@ void SearchForFiles::ProcessDirent(const char *_full_path,
     // Filter by file content
     CFRange content_pos{-1, 0};
     if( failed_filtering == false && m_FilterContent ) {
-        if( _dirent.type != VFSDirEnt::Reg || !FilterByContent(_full_path, _in_host, content_pos) )
+        if( _dirent.type != VFSDirEnt::Reg )
+            failed_filtering = true;
+        else if( _traversal.Workers() > 1 ) {
+            // let any idle worker pick up this file instead of scanning it inline
+            _traversal.Push(_worker, {VFSPath(_in_host.SharedPtr(), _dir_path), _dirent.name});
+            failed_filtering = true;
+        }
+        else if( !FilterByContent(_full_path, _in_host, content_pos) )
             failed_filtering = true;
     }
 
     if( failed_filtering == false )
-        ProcessValidEntry(_full_path, _dir_path, _dirent, _in_host, content_pos);
-
-    if( m_SearchOptions & Options::GoIntoSubDirs )
-        if( _dirent.type == VFSDirEnt::Dir )
-            m_DirsFIFO.emplace(_in_host.SharedPtr(), _full_path);
+        ProcessValidEntry(_traversal, _worker, _dirent.name, _dir_path, _in_host, content_pos);
+}
 
-    if( m_SearchOptions & Options::LookInArchives )
-        if( _dirent.type == VFSDirEnt::Reg && m_SpawnArchiveCallback )
-            if( auto archive_host = m_SpawnArchiveCallback(_full_path, _in_host) )
-                m_DirsFIFO.emplace(archive_host, "/");
+VFSHostPtr SearchForFiles::SpawnArchive(const char *_full_path, VFSHost &_in_host)
+{
+    auto lock = std::lock_guard{m_SpawnArchiveLock};
+    return m_SpawnArchiveCallback(_full_path, _in_host);
 }
 
 bool SearchForFiles::FilterByContent(const char *_full_path, VFSHost &_in_host, CFRange &_r)
@@ -216,24 +560,35 @@ bool SearchForFiles::FilterByContent(const char *_full_path, VFSHost &_in_host,
     if( fw.Attach(file) != 0 )
         return false;
 
-    int encoding = m_FilterContent->encoding;
-    if( int xattr_enc = EncodingFromXAttr(file) )
-        encoding = xattr_enc;
-
     using nc::vfs::SearchInFile;
     SearchInFile sif(fw);
 
-    base::CFString request{m_FilterContent->text};
-    sif.ToggleTextSearch(*request, encoding);
-    const auto search_options = [&] {
-        auto options = SearchInFile::Options::None;
-        if( m_FilterContent->case_sensitive )
-            options |= SearchInFile::Options::CaseSensitive;
-        if( m_FilterContent->whole_phrase )
-            options |= SearchInFile::Options::FindWholePhrase;
-        return options;
-    }();
-    sif.SetSearchOptions(search_options);
+    if( m_FilterContentLiterals ) {
+        sif.ToggleLiteralsSearch(m_FilterContentLiterals);
+    }
+    else if( m_FilterContentRegEx ) {
+        sif.ToggleRegExSearch(m_FilterContentRegEx);
+    }
+    else if( m_FilterContentBytes ) {
+        sif.ToggleBytesSearch(m_FilterContentBytes);
+    }
+    else {
+        int encoding = m_FilterContent->encoding;
+        if( int xattr_enc = EncodingFromXAttr(file) )
+            encoding = xattr_enc;
+
+        base::CFString request{m_FilterContent->text};
+        sif.ToggleTextSearch(*request, encoding);
+        const auto search_options = [&] {
+            auto options = SearchInFile::Options::None;
+            if( m_FilterContent->case_sensitive )
+                options |= SearchInFile::Options::CaseSensitive;
+            if( m_FilterContent->whole_phrase )
+                options |= SearchInFile::Options::FindWholePhrase;
+            return options;
+        }();
+        sif.SetSearchOptions(search_options);
+    }
 
     const auto result = sif.Search([this] { return m_Queue.IsStopped(); });
     if( result.response == SearchInFile::Response::Found ) {
@@ -252,14 +607,30 @@ bool SearchForFiles::FilterByFilename(const char *_filename) const
     return m_FilterName.MatchName(_filename);
 }
 
-void SearchForFiles::ProcessValidEntry([[maybe_unused]] const char *_full_path,
+void SearchForFiles::ProcessValidEntry(Traversal &_traversal,
+                                       size_t _worker,
+                                       const char *_filename,
                                        const char *_dir_path,
-                                       const VFSDirEnt &_dirent,
                                        VFSHost &_in_host,
                                        CFRange _cont_range)
 {
-    if( m_Callback ) // change to assert
-        m_Callback(_dirent.name, _dir_path, _in_host, _cont_range);
+    auto &batch = _traversal.FoundBatch(_worker);
+    batch.emplace_back(Found{_filename, _dir_path, _in_host.SharedPtr(), _cont_range});
+    // a single worker reports right away, there's no contention on the callback lock to amortize
+    if( _traversal.Workers() == 1 || batch.size() >= g_FoundBatchSize )
+        FlushFound(batch);
+}
+
+void SearchForFiles::FlushFound(std::vector<Found> &_found)
+{
+    if( _found.empty() )
+        return;
+    if( m_Callback ) {
+        auto lock = std::lock_guard{m_CallbackLock};
+        for( const auto &found : _found )
+            m_Callback(found.filename.c_str(), found.dir_path.c_str(), *found.host, found.content_pos);
+    }
+    _found.clear();
 }
 
 bool SearchForFiles::IsRunning() const noexcept
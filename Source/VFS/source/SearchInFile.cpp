@@ -1,14 +1,55 @@
-// Copyright (C) 2013-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2013-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "SearchInFile.h"
+#include "TextMatcher.h"
+#include "AhoCorasick.h"
+#include "ByteMatcher.h"
 #include <Utility/Encodings.h>
 #include <VFS/FileWindow.h>
+#include <re2/re2.h>
 #include <exception>
 
 namespace nc::vfs {
 
-static const unsigned g_MaximumCodeUnit = 2;
+class SearchInFile::Literals
+{
+public:
+    Literals(std::span<const std::string> _literals, bool _case_sensitive) : automaton(_literals, _case_sensitive) {}
+    AhoCorasick automaton;
+};
+
+class SearchInFile::RegEx
+{
+public:
+    RegEx(std::string_view _pattern, const re2::RE2::Options &_options) : re(_pattern, _options) {}
+
+    // Looks for the first non-empty match in _text starting at _from.
+    std::optional<Location> Find(std::string_view _text, size_t _from) const noexcept;
+
+    re2::RE2 re;
+};
+
+std::optional<SearchInFile::Location> SearchInFile::RegEx::Find(std::string_view _text, size_t _from) const noexcept
+{
+    const re2::StringPiece text(_text.data(), _text.size());
+    size_t pos = _from;
+    while( pos <= _text.size() ) {
+        re2::StringPiece match;
+        if( !re.Match(text, pos, _text.size(), re2::RE2::UNANCHORED, &match, 1) )
+            return std::nullopt;
+        const auto offset = static_cast<size_t>(match.data() - _text.data());
+        if( !match.empty() )
+            return Location{offset, match.size()};
+        pos = offset + 1; // skip empty matches
+    }
+    return std::nullopt;
+}
 
-static bool IsWholePhrase(CFStringRef _string, CFRange _range);
+class SearchInFile::BytePattern
+{
+public:
+    BytePattern(ByteMatcher _matcher) : matcher(std::move(_matcher)) {}
+    ByteMatcher matcher;
+};
 
 SearchInFile::SearchInFile(nc::vfs::FileWindow &_file)
     : m_File(_file), m_TextSearchEncoding(encodings::ENCODING_INVALID)
@@ -16,16 +57,12 @@ SearchInFile::SearchInFile(nc::vfs::FileWindow &_file)
     if( !m_File.FileOpened() )
         throw std::invalid_argument("SearchInFile: FileWindow should be opened");
     m_Position = _file.WindowPos();
-    m_DecodedBuffer = std::make_unique<uint16_t[]>(_file.WindowSize());
-    m_DecodedBufferIndx = std::make_unique<uint32_t[]>(_file.WindowSize());
 }
 
 SearchInFile::~SearchInFile()
 {
     if( m_RequestedTextSearch != 0 )
         CFRelease(m_RequestedTextSearch);
-    if( m_DecodedBufferString != 0 )
-        CFRelease(m_DecodedBufferString);
 }
 
 void SearchInFile::MoveCurrentPosition(uint64_t _pos)
@@ -36,6 +73,7 @@ void SearchInFile::MoveCurrentPosition(uint64_t _pos)
     ;
 
     m_Position = _pos;
+    ResetStreamingState();
 
     if( m_File.WindowSize() + m_Position > m_File.FileSize() )
         m_File.MoveWindow(m_File.FileSize() - m_File.WindowSize());
@@ -49,31 +87,110 @@ void SearchInFile::ToggleTextSearch(CFStringRef _string, int _encoding)
         CFRelease(m_RequestedTextSearch);
     m_RequestedTextSearch = CFStringCreateCopy(0, _string);
     m_TextSearchEncoding = _encoding;
+    m_TextMatcher.reset();
 
     m_WorkMode = WorkMode::Text;
 }
 
+std::shared_ptr<const SearchInFile::Literals> SearchInFile::CompileLiterals(std::span<const std::string> _literals,
+                                                                             bool _case_sensitive)
+{
+    return std::make_shared<Literals>(_literals, _case_sensitive);
+}
+
+std::shared_ptr<const SearchInFile::RegEx> SearchInFile::CompileRegEx(std::string_view _pattern, bool _case_sensitive)
+{
+    re2::RE2::Options options;
+    options.set_case_sensitive(_case_sensitive);
+    options.set_log_errors(false);
+    // let ^ and $ match at the beginning and the end of each line
+    auto regex = std::make_shared<RegEx>("(?m)" + std::string(_pattern), options);
+    if( !regex->re.ok() )
+        return nullptr;
+    return regex;
+}
+
+std::shared_ptr<const SearchInFile::BytePattern> SearchInFile::CompileBytePattern(std::string_view _hex)
+{
+    auto matcher = ByteMatcher::FromHex(_hex);
+    if( !matcher )
+        return nullptr;
+    return std::make_shared<BytePattern>(std::move(*matcher));
+}
+
+void SearchInFile::ToggleLiteralsSearch(std::shared_ptr<const Literals> _literals)
+{
+    if( !_literals )
+        throw std::invalid_argument("SearchInFile::ToggleLiteralsSearch: literals can't be nullptr");
+    m_Literals = std::move(_literals);
+    ResetStreamingState();
+    m_WorkMode = WorkMode::Literals;
+}
+
+void SearchInFile::ToggleRegExSearch(std::shared_ptr<const RegEx> _regex)
+{
+    if( !_regex )
+        throw std::invalid_argument("SearchInFile::ToggleRegExSearch: regex can't be nullptr");
+    m_RegEx = std::move(_regex);
+    ResetStreamingState();
+    m_WorkMode = WorkMode::RegEx;
+}
+
+void SearchInFile::ToggleBytesSearch(std::shared_ptr<const BytePattern> _pattern)
+{
+    if( !_pattern )
+        throw std::invalid_argument("SearchInFile::ToggleBytesSearch: pattern can't be nullptr");
+    m_BytePattern = std::move(_pattern);
+    ResetStreamingState();
+    m_WorkMode = WorkMode::Bytes;
+}
+
+void SearchInFile::ResetStreamingState()
+{
+    m_LiteralsState = AhoCorasick::Root;
+    m_Carry.clear();
+    m_CarrySkip = 0;
+}
+
 SearchInFile::Result SearchInFile::Search(const CancelChecker &_checker)
 {
-    if( m_WorkMode == WorkMode::Text ) {
-        uint64_t offset = 0;
-        uint64_t bytes_len = 0;
-        Result result;
-        result.response = SearchText(&offset, &bytes_len, _checker);
-        if( result.response == Response::Found )
-            result.location = {offset, bytes_len};
-        return result;
-    }
-    else {
-        Result result;
-        result.response = Response::NotFound;
-        return result;
+    uint64_t offset = 0;
+    uint64_t bytes_len = 0;
+    Result result;
+    switch( m_WorkMode ) {
+        case WorkMode::Text:
+            result.response = SearchText(&offset, &bytes_len, _checker);
+            break;
+        case WorkMode::Literals:
+            result.response = SearchLiterals(&offset, &bytes_len, _checker);
+            break;
+        case WorkMode::RegEx:
+            result.response = SearchRegEx(&offset, &bytes_len, _checker);
+            break;
+        case WorkMode::Bytes:
+            result.response = SearchBytes(&offset, &bytes_len, _checker);
+            break;
+        default:
+            result.response = Response::NotFound;
     }
+    if( result.response == Response::Found )
+        result.location = {offset, bytes_len};
+    return result;
 }
 
 bool SearchInFile::IsEOF() const
 {
-    return m_Position >= m_File.FileSize();
+    return m_Position >= m_File.FileSize() && m_Carry.size() == m_CarrySkip;
+}
+
+void SearchInFile::MoveWindowToPosition()
+{
+    size_t window_pos = m_Position;
+    if( window_pos + m_File.WindowSize() > m_File.FileSize() )
+        window_pos = m_File.FileSize() - m_File.WindowSize();
+    m_File.MoveWindow(window_pos);
+    assert(m_Position >= m_File.WindowPos() &&
+           m_Position < m_File.WindowPos() + m_File.WindowSize()); // sanity check
 }
 
 SearchInFile::Response
@@ -85,12 +202,24 @@ SearchInFile::SearchText(uint64_t *_offset, uint64_t *_bytes_len, CancelChecker
     if( m_File.FileSize() < static_cast<size_t>(encodings::BytesForCodeUnit(m_TextSearchEncoding)) )
         return Response::NotFound; // for singular case
 
-    if( m_Position >= m_File.FileSize() )
+    if( IsEOF() )
         return Response::EndOfFile; // when finished searching
 
     if( CFStringGetLength(m_RequestedTextSearch) <= 0 )
         return Response::Invalid;
 
+    if( !m_TextMatcher )
+        m_TextMatcher = std::make_unique<TextMatcher>(m_RequestedTextSearch,
+                                                      m_TextSearchEncoding,
+                                                      static_cast<bool>(m_SearchOptionsBits.case_sensitive),
+                                                      static_cast<bool>(m_SearchOptionsBits.find_whole_phrase));
+
+    if( !m_TextMatcher->Valid() ) {
+        // the request can't be represented in this encoding, so there's nothing to look for
+        m_Position = m_File.FileSize();
+        return Response::NotFound;
+    }
+
     while( true ) {
         if( m_Position >= m_File.FileSize() )
             break; // when finished searching
@@ -99,76 +228,180 @@ SearchInFile::SearchText(uint64_t *_offset, uint64_t *_bytes_len, CancelChecker
             return Response::Canceled;
 
         // move our load window inside a file
-        size_t window_pos = m_Position;
-        size_t left_window_gap = 0;
-        if( window_pos + m_File.WindowSize() > m_File.FileSize() ) {
-            window_pos = m_File.FileSize() - m_File.WindowSize();
-            left_window_gap = m_Position - window_pos;
+        MoveWindowToPosition();
+
+        // scan the raw bytes of this window
+        const auto match = m_TextMatcher->Find(static_cast<const std::byte *>(m_File.Window()),
+                                               m_File.WindowSize(),
+                                               m_Position - m_File.WindowPos(),
+                                               m_File.WindowPos());
+
+        if( match ) {
+            if( _offset != nullptr )
+                *_offset = m_File.WindowPos() + match->offset;
+            if( _bytes_len != nullptr )
+                *_bytes_len = match->length;
+            m_Position = m_File.WindowPos() + match->offset + match->length;
+            return Response::Found;
         }
-        m_File.MoveWindow(window_pos);
-        assert(m_Position >= m_File.WindowPos() &&
-               m_Position < m_File.WindowPos() + m_File.WindowSize()); // sanity check
-
-        // get UniChars from this window using given encoding
-        assert(encodings::BytesForCodeUnit(m_TextSearchEncoding) <=
-               2); // TODO: support for UTF-32 in the future
-        bool isodd = (encodings::BytesForCodeUnit(m_TextSearchEncoding) == 2) &&
-                     ((m_File.WindowPos() & 1) == 1);
-        encodings::InterpretAsUnichar(m_TextSearchEncoding,
-                                      static_cast<const unsigned char *>(m_File.Window()) +
-                                          left_window_gap + (isodd ? 1 : 0),
-                                      m_File.WindowSize() - left_window_gap - (isodd ? 1 : 0),
-                                      m_DecodedBuffer.get(),
-                                      m_DecodedBufferIndx.get(),
-                                      &m_DecodedBufferSize);
-
-        assert(m_DecodedBufferSize != 0);
-
-        // use this UniChars to produce a regular CFString
-        if( m_DecodedBufferString != 0 )
-            CFRelease(m_DecodedBufferString);
-        m_DecodedBufferString = CFStringCreateWithCharactersNoCopy(
-            0, m_DecodedBuffer.get(), m_DecodedBufferSize, kCFAllocatorNull);
-
-        const auto find_flags = m_SearchOptionsBits.case_sensitive ? 0 : kCFCompareCaseInsensitive;
-        CFRange result = CFStringFind(m_DecodedBufferString, m_RequestedTextSearch, find_flags);
-
-        if( result.location == kCFNotFound ) {
-            // lets proceed further
-            if( m_File.WindowPos() + m_File.WindowSize() < m_File.FileSize() ) { // can move on
-                // left some space in the tail to exclude situations when searched text is cut
-                // between the windows
-                assert(left_window_gap == 0);
-                assert(size_t(CFStringGetLength(m_RequestedTextSearch) * g_MaximumCodeUnit) <
-                       m_File.WindowSize());
-                m_Position = m_Position + m_File.WindowSize() -
-                             CFStringGetLength(m_RequestedTextSearch) * g_MaximumCodeUnit;
-            }
-            else { // this is the end (c)
-                m_Position = m_File.FileSize();
-            }
+
+        // lets proceed further
+        if( m_File.WindowPos() + m_File.WindowSize() < m_File.FileSize() ) { // can move on
+            // left some space in the tail to exclude situations when searched text is cut
+            // between the windows
+            assert(m_TextMatcher->MaxMatchLength() < m_File.WindowSize());
+            m_Position = m_File.WindowPos() + m_File.WindowSize() - m_TextMatcher->MaxMatchLength() + 1;
+        }
+        else { // this is the end (c)
+            m_Position = m_File.FileSize();
+        }
+    }
+
+    return Response::NotFound;
+}
+
+SearchInFile::Response
+SearchInFile::SearchLiterals(uint64_t *_offset, uint64_t *_bytes_len, const CancelChecker &_checker)
+{
+    if( m_File.FileSize() == 0 || m_Literals->automaton.Empty() )
+        return Response::NotFound;
+
+    if( IsEOF() )
+        return Response::EndOfFile; // when finished searching
+
+    while( m_Position < m_File.FileSize() ) {
+        if( _checker && _checker() )
+            return Response::Canceled;
+
+        MoveWindowToPosition();
+
+        // feed the rest of the window into the automaton, the state is carried over to the next window
+        const size_t from = m_Position - m_File.WindowPos();
+        const size_t size = m_File.WindowSize() - from;
+        const auto data = static_cast<const std::byte *>(m_File.Window()) + from;
+        if( const auto hit = m_Literals->automaton.Feed(m_LiteralsState, data, size) ) {
+            const uint64_t end = m_Position + hit->end;
+            if( _offset != nullptr )
+                *_offset = end - hit->length;
+            if( _bytes_len != nullptr )
+                *_bytes_len = hit->length;
+            m_Position = end;
+            m_LiteralsState = AhoCorasick::Root;
+            return Response::Found;
+        }
+        m_Position += size;
+    }
+
+    return Response::NotFound;
+}
+
+SearchInFile::Response
+SearchInFile::SearchRegEx(uint64_t *_offset, uint64_t *_bytes_len, const CancelChecker &_checker)
+{
+    if( m_File.FileSize() == 0 )
+        return Response::NotFound;
+
+    if( IsEOF() )
+        return Response::EndOfFile; // when finished searching
+
+    while( true ) {
+        if( _checker && _checker() )
+            return Response::Canceled;
+
+        // bytes from m_Position till the end of the window
+        std::string_view fresh;
+        if( m_Position < m_File.FileSize() ) {
+            MoveWindowToPosition();
+            const size_t from = m_Position - m_File.WindowPos();
+            fresh = {static_cast<const char *>(m_File.Window()) + from, m_File.WindowSize() - from};
+        }
+        const bool eof = m_Position + fresh.size() >= m_File.FileSize();
+
+        // only complete lines are matched, an incomplete tail is carried over to the next window
+        size_t complete = fresh.size();
+        if( !eof ) {
+            if( const auto newline = fresh.rfind('\n'); newline != std::string_view::npos )
+                complete = newline + 1;
+            else if( m_Carry.size() + fresh.size() < RegExMaxLine )
+                complete = 0;
+        }
+
+        if( !eof && complete == 0 ) {
+            m_Carry.append(fresh);
+            m_Position += fresh.size();
+            continue;
+        }
+
+        const uint64_t chunk_pos = m_Position - m_Carry.size();
+        std::string_view chunk;
+        if( m_Carry.empty() ) {
+            chunk = fresh.substr(0, complete);
         }
         else {
-            assert(size_t(result.location + result.length) <= m_DecodedBufferSize); // sanity check
-            // check for whole phrase is this option is set
-            if( m_SearchOptionsBits.find_whole_phrase &&
-                !IsWholePhrase(m_DecodedBufferString, result) ) {
-                // false alarm - just move position beyond found part ang go on
-                m_Position = m_Position + m_DecodedBufferIndx[result.location + result.length];
-                continue;
-            }
+            m_Carry.append(fresh.substr(0, complete));
+            chunk = m_Carry;
+        }
+        const auto tail = fresh.substr(complete);
+        const auto match = m_RegEx->Find(chunk, m_CarrySkip);
+        m_Position += fresh.size();
 
+        if( match ) {
             if( _offset != nullptr )
-                *_offset = m_Position + m_DecodedBufferIndx[result.location];
+                *_offset = chunk_pos + match->offset;
+            if( _bytes_len != nullptr )
+                *_bytes_len = match->bytes_len;
+            // the rest of the chunk will be matched on the next call
+            std::string carry(chunk);
+            carry.append(tail);
+            m_Carry = std::move(carry);
+            m_CarrySkip = match->offset + match->bytes_len;
+            return Response::Found;
+        }
+
+        m_Carry.assign(tail);
+        m_CarrySkip = 0;
+        if( eof && m_Carry.empty() )
+            break;
+    }
+
+    return Response::NotFound;
+}
+
+SearchInFile::Response
+SearchInFile::SearchBytes(uint64_t *_offset, uint64_t *_bytes_len, const CancelChecker &_checker)
+{
+    const ByteMatcher &matcher = m_BytePattern->matcher;
+    if( m_File.FileSize() < matcher.Length() )
+        return Response::NotFound;
+
+    if( IsEOF() )
+        return Response::EndOfFile; // when finished searching
+
+    while( m_Position < m_File.FileSize() ) {
+        if( _checker && _checker() )
+            return Response::Canceled;
 
+        MoveWindowToPosition();
+
+        const auto match = matcher.Find(
+            static_cast<const std::byte *>(m_File.Window()), m_File.WindowSize(), m_Position - m_File.WindowPos());
+        if( match ) {
             if( _offset != nullptr )
-                *_bytes_len = (size_t(result.location + result.length) < m_DecodedBufferSize
-                                   ? m_DecodedBufferIndx[result.location + result.length]
-                                   : m_File.WindowSize() - left_window_gap) -
-                              m_DecodedBufferIndx[result.location];
-            m_Position = m_Position + m_DecodedBufferIndx[result.location + result.length];
+                *_offset = m_File.WindowPos() + *match;
+            if( _bytes_len != nullptr )
+                *_bytes_len = matcher.Length();
+            m_Position = m_File.WindowPos() + *match + matcher.Length();
             return Response::Found;
         }
+
+        if( m_File.WindowPos() + m_File.WindowSize() < m_File.FileSize() ) {
+            // overlap the windows so that a match cut by the window boundary is found in the next one
+            assert(matcher.Length() < m_File.WindowSize());
+            m_Position = m_File.WindowPos() + m_File.WindowSize() - matcher.Length() + 1;
+        }
+        else {
+            m_Position = m_File.FileSize();
+        }
     }
 
     return Response::NotFound;
@@ -187,6 +420,7 @@ int SearchInFile::TextSearchEncoding()
 void SearchInFile::SetSearchOptions(Options _options)
 {
     m_SearchOptions = _options;
+    m_TextMatcher.reset();
 }
 
 SearchInFile::Options SearchInFile::SearchOptions()
@@ -194,26 +428,4 @@ SearchInFile::Options SearchInFile::SearchOptions()
     return m_SearchOptions;
 }
 
-static bool IsWholePhrase(CFStringRef _string, CFRange _range)
-{
-    static const auto alphanumeric = CFCharacterSetGetPredefined(kCFCharacterSetAlphaNumeric);
-    assert(_range.length > 0);
-    assert(_range.location >= 0);
-
-    if( _range.location > 0 ) {
-        const auto character = CFStringGetCharacterAtIndex(_string, _range.location - 1);
-        if( CFCharacterSetIsCharacterMember(alphanumeric, character) )
-            return false;
-    }
-
-    if( _range.location + _range.length < CFStringGetLength(_string) ) {
-        const auto character =
-            CFStringGetCharacterAtIndex(_string, _range.location + _range.length);
-        if( CFCharacterSetIsCharacterMember(alphanumeric, character) )
-            return false;
-    }
-
-    return true;
-}
-
 } // namespace nc::vfs
@@ -0,0 +1,329 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "TextMatcher.h"
+#include <Base/CFPtr.h>
+#include <Utility/Encodings.h>
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <numeric>
+
+namespace nc::vfs {
+
+static bool IsSingleByteEncoding(int _encoding) noexcept
+{
+    return _encoding >= encodings::ENCODING_SINGLE_BYTES_FIRST__ &&
+           _encoding <= encodings::ENCODING_SINGLE_BYTES_LAST__;
+}
+
+static size_t ToUTF16(char32_t _c, UniChar _out[2]) noexcept
+{
+    if( _c < 0x10000 ) {
+        _out[0] = static_cast<UniChar>(_c);
+        return 1;
+    }
+    _c -= 0x10000;
+    _out[0] = static_cast<UniChar>(0xD800 + (_c >> 10));
+    _out[1] = static_cast<UniChar>(0xDC00 + (_c & 0x3FF));
+    return 2;
+}
+
+// Returns an uppercased or lowercased form of the character, if it's a single character as well
+static std::optional<char32_t> ChangeCase(char32_t _c, bool _upper)
+{
+    UniChar chars[2];
+    const auto length = ToUTF16(_c, chars);
+    const auto str = base::CFPtr<CFMutableStringRef>::adopt(CFStringCreateMutable(nullptr, 0));
+    CFStringAppendCharacters(str.get(), chars, static_cast<CFIndex>(length));
+    if( _upper )
+        CFStringUppercase(str.get(), nullptr);
+    else
+        CFStringLowercase(str.get(), nullptr);
+
+    const auto changed_length = CFStringGetLength(str.get());
+    if( changed_length == 1 )
+        return CFStringGetCharacterAtIndex(str.get(), 0);
+    if( changed_length == 2 ) {
+        const auto high = CFStringGetCharacterAtIndex(str.get(), 0);
+        const auto low = CFStringGetCharacterAtIndex(str.get(), 1);
+        if( CFStringIsSurrogateHighCharacter(high) && CFStringIsSurrogateLowCharacter(low) )
+            return CFStringGetLongCharacterForSurrogatePair(high, low);
+    }
+    return std::nullopt;
+}
+
+static std::optional<char32_t> DecodeUTF8(const uint8_t *_p, size_t _available) noexcept
+{
+    if( _available == 0 )
+        return std::nullopt;
+    const uint8_t lead = _p[0];
+    if( lead < 0x80 )
+        return lead;
+    size_t length = 0;
+    char32_t c = 0;
+    if( (lead & 0xE0) == 0xC0 ) {
+        length = 2;
+        c = lead & 0x1F;
+    }
+    else if( (lead & 0xF0) == 0xE0 ) {
+        length = 3;
+        c = lead & 0x0F;
+    }
+    else if( (lead & 0xF8) == 0xF0 ) {
+        length = 4;
+        c = lead & 0x07;
+    }
+    else
+        return std::nullopt;
+    if( _available < length )
+        return std::nullopt;
+    for( size_t i = 1; i < length; ++i ) {
+        if( (_p[i] & 0xC0) != 0x80 )
+            return std::nullopt;
+        c = (c << 6) | (_p[i] & 0x3F);
+    }
+    return c;
+}
+
+TextMatcher::TextMatcher(CFStringRef _needle, int _encoding, bool _case_sensitive, bool _whole_phrase)
+    : m_Encoding(_encoding), m_CaseSensitive(_case_sensitive), m_WholePhrase(_whole_phrase)
+{
+    if( IsSingleByteEncoding(_encoding) ) {
+        std::array<unsigned char, 256> bytes;
+        std::iota(bytes.begin(), bytes.end(), 0);
+        std::array<unsigned short, 256> chars;
+        InterpretSingleByteBufferAsUniCharPreservingBufferSize(bytes.data(), bytes.size(), chars.data(), _encoding);
+        std::copy(chars.begin(), chars.end(), m_SingleByteTable.begin());
+    }
+    else if( _encoding == encodings::ENCODING_UTF16LE || _encoding == encodings::ENCODING_UTF16BE )
+        m_CodeUnit = 2;
+    else if( _encoding != encodings::ENCODING_UTF8 )
+        return;
+
+    if( _needle == nullptr )
+        return;
+    const auto needle_length = CFStringGetLength(_needle);
+    if( needle_length <= 0 )
+        return;
+    std::vector<UniChar> chars(static_cast<size_t>(needle_length));
+    CFStringGetCharacters(_needle, CFRangeMake(0, needle_length), chars.data());
+
+    for( size_t i = 0; i < chars.size(); ++i ) {
+        char32_t c = chars[i];
+        if( CFStringIsSurrogateHighCharacter(chars[i]) && i + 1 < chars.size() &&
+            CFStringIsSurrogateLowCharacter(chars[i + 1]) ) {
+            c = CFStringGetLongCharacterForSurrogatePair(chars[i], chars[i + 1]);
+            ++i;
+        }
+        AddCharacter(c);
+        if( m_Characters.back().count == 0 )
+            return; // this character can't be represented in the target encoding, no matches are possible
+    }
+
+    bool exact = true;
+    for( const auto &character : m_Characters ) {
+        uint8_t min = 4;
+        uint8_t max = 0;
+        for( uint8_t i = 0; i < character.count; ++i ) {
+            min = std::min(min, character.variants[i].length);
+            max = std::max(max, character.variants[i].length);
+        }
+        m_MinLength += min;
+        m_MaxLength += max;
+        exact &= character.count == 1;
+    }
+
+    const auto &first = m_Characters.front();
+    for( uint8_t i = 0; i < first.count; ++i )
+        m_FirstBytes.Add(first.variants[i].bytes[0]);
+    const auto &last = m_Characters.back();
+    for( uint8_t i = 0; i < last.count; ++i )
+        m_LastBytes.Add(last.variants[i].bytes[last.variants[i].length - 1]);
+
+    if( exact )
+        for( const auto &character : m_Characters )
+            m_Exact.insert(m_Exact.end(),
+                           character.variants[0].bytes.begin(),
+                           character.variants[0].bytes.begin() + character.variants[0].length);
+
+    m_Valid = true;
+}
+
+void TextMatcher::AddCharacter(char32_t _c)
+{
+    Character character;
+    Encode(_c, character);
+    if( !m_CaseSensitive ) {
+        if( auto lower = ChangeCase(_c, false) )
+            Encode(*lower, character);
+        if( auto upper = ChangeCase(_c, true) )
+            Encode(*upper, character);
+    }
+    m_Characters.emplace_back(character);
+}
+
+void TextMatcher::Encode(char32_t _c, Character &_to) const
+{
+    Variant variant{};
+    if( m_Encoding == encodings::ENCODING_UTF8 ) {
+        if( _c < 0x80 ) {
+            variant.bytes[0] = static_cast<uint8_t>(_c);
+            variant.length = 1;
+        }
+        else if( _c < 0x800 ) {
+            variant.bytes[0] = static_cast<uint8_t>(0xC0 | (_c >> 6));
+            variant.bytes[1] = static_cast<uint8_t>(0x80 | (_c & 0x3F));
+            variant.length = 2;
+        }
+        else if( _c < 0x10000 ) {
+            variant.bytes[0] = static_cast<uint8_t>(0xE0 | (_c >> 12));
+            variant.bytes[1] = static_cast<uint8_t>(0x80 | ((_c >> 6) & 0x3F));
+            variant.bytes[2] = static_cast<uint8_t>(0x80 | (_c & 0x3F));
+            variant.length = 3;
+        }
+        else {
+            variant.bytes[0] = static_cast<uint8_t>(0xF0 | (_c >> 18));
+            variant.bytes[1] = static_cast<uint8_t>(0x80 | ((_c >> 12) & 0x3F));
+            variant.bytes[2] = static_cast<uint8_t>(0x80 | ((_c >> 6) & 0x3F));
+            variant.bytes[3] = static_cast<uint8_t>(0x80 | (_c & 0x3F));
+            variant.length = 4;
+        }
+    }
+    else if( m_CodeUnit == 2 ) {
+        UniChar units[2];
+        const auto count = ToUTF16(_c, units);
+        const bool le = m_Encoding == encodings::ENCODING_UTF16LE;
+        for( size_t i = 0; i < count; ++i ) {
+            variant.bytes[i * 2 + (le ? 0 : 1)] = static_cast<uint8_t>(units[i] & 0xFF);
+            variant.bytes[i * 2 + (le ? 1 : 0)] = static_cast<uint8_t>(units[i] >> 8);
+        }
+        variant.length = static_cast<uint8_t>(count * 2);
+    }
+    else {
+        const auto it = std::find(m_SingleByteTable.begin(), m_SingleByteTable.end(), _c);
+        if( it == m_SingleByteTable.end() )
+            return;
+        variant.bytes[0] = static_cast<uint8_t>(std::distance(m_SingleByteTable.begin(), it));
+        variant.length = 1;
+    }
+
+    for( uint8_t i = 0; i < _to.count; ++i )
+        if( _to.variants[i].length == variant.length && _to.variants[i].bytes == variant.bytes )
+            return;
+    if( _to.count < _to.variants.size() )
+        _to.variants[_to.count++] = variant;
+}
+
+bool TextMatcher::Valid() const noexcept
+{
+    return m_Valid;
+}
+
+size_t TextMatcher::MaxMatchLength() const noexcept
+{
+    return m_MaxLength;
+}
+
+std::optional<TextMatcher::Match>
+TextMatcher::Find(const std::byte *_data, size_t _size, size_t _from, uint64_t _data_offset) const noexcept
+{
+    if( !m_Valid || _size < m_MinLength || _from > _size - m_MinLength )
+        return std::nullopt;
+
+    // the second byte filter can only be used when all the matches have the same length
+    const bool fixed_length = m_MinLength == m_MaxLength;
+    std::optional<Match> match;
+    bytescan::Scan(_data,
+                   _from,
+                   _size - m_MinLength,
+                   m_FirstBytes,
+                   fixed_length ? m_MinLength - 1 : 0,
+                   fixed_length ? m_LastBytes : m_FirstBytes,
+                   [&](size_t _pos) {
+                       if( m_CodeUnit > 1 && (_data_offset + _pos) % m_CodeUnit != 0 )
+                           return false;
+                       size_t length = 0;
+                       if( !VerifyAt(_data, _size, _pos, length) )
+                           return false;
+                       if( m_WholePhrase && !IsWholePhrase(_data, _size, _pos, length) )
+                           return false;
+                       match = Match{_pos, length};
+                       return true;
+                   });
+    return match;
+}
+
+bool TextMatcher::VerifyAt(const std::byte *_data, size_t _size, size_t _pos, size_t &_length) const noexcept
+{
+    if( !m_Exact.empty() ) {
+        if( _pos + m_Exact.size() > _size || std::memcmp(_data + _pos, m_Exact.data(), m_Exact.size()) != 0 )
+            return false;
+        _length = m_Exact.size();
+        return true;
+    }
+
+    size_t pos = _pos;
+    for( const auto &character : m_Characters ) {
+        bool matched = false;
+        for( uint8_t i = 0; i < character.count && !matched; ++i ) {
+            const auto &variant = character.variants[i];
+            if( pos + variant.length <= _size && std::memcmp(_data + pos, variant.bytes.data(), variant.length) == 0 ) {
+                pos += variant.length;
+                matched = true;
+            }
+        }
+        if( !matched )
+            return false;
+    }
+    _length = pos - _pos;
+    return true;
+}
+
+bool TextMatcher::IsWholePhrase(const std::byte *_data, size_t _size, size_t _pos, size_t _length) const noexcept
+{
+    static const auto alphanumeric = CFCharacterSetGetPredefined(kCFCharacterSetAlphaNumeric);
+    if( const auto before = DecodeBefore(_data, _pos) )
+        if( CFCharacterSetIsLongCharacterMember(alphanumeric, *before) )
+            return false;
+    if( const auto after = DecodeAt(_data, _size, _pos + _length) )
+        if( CFCharacterSetIsLongCharacterMember(alphanumeric, *after) )
+            return false;
+    return true;
+}
+
+std::optional<char32_t> TextMatcher::DecodeBefore(const std::byte *_data, size_t _pos) const noexcept
+{
+    const auto bytes = reinterpret_cast<const uint8_t *>(_data);
+    if( _pos < m_CodeUnit )
+        return std::nullopt;
+    if( m_Encoding == encodings::ENCODING_UTF8 ) {
+        size_t lead = _pos - 1;
+        while( lead > 0 && _pos - lead < 4 && (bytes[lead] & 0xC0) == 0x80 )
+            --lead;
+        return DecodeUTF8(bytes + lead, _pos - lead);
+    }
+    if( m_CodeUnit == 2 ) {
+        const auto unit = (m_Encoding == encodings::ENCODING_UTF16LE)
+                              ? static_cast<char16_t>(bytes[_pos - 2] | (bytes[_pos - 1] << 8))
+                              : static_cast<char16_t>(bytes[_pos - 1] | (bytes[_pos - 2] << 8));
+        return unit;
+    }
+    return m_SingleByteTable[bytes[_pos - 1]];
+}
+
+std::optional<char32_t> TextMatcher::DecodeAt(const std::byte *_data, size_t _size, size_t _pos) const noexcept
+{
+    const auto bytes = reinterpret_cast<const uint8_t *>(_data);
+    if( _pos + m_CodeUnit > _size )
+        return std::nullopt;
+    if( m_Encoding == encodings::ENCODING_UTF8 )
+        return DecodeUTF8(bytes + _pos, _size - _pos);
+    if( m_CodeUnit == 2 ) {
+        const auto unit = (m_Encoding == encodings::ENCODING_UTF16LE)
+                              ? static_cast<char16_t>(bytes[_pos] | (bytes[_pos + 1] << 8))
+                              : static_cast<char16_t>(bytes[_pos + 1] | (bytes[_pos] << 8));
+        return unit;
+    }
+    return m_SingleByteTable[bytes[_pos]];
+}
+
+} // namespace nc::vfs
@@ -0,0 +1,80 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#pragma once
+
+#include "ByteScan.h"
+#include <CoreFoundation/CoreFoundation.h>
+#include <optional>
+#include <vector>
+
+namespace nc::vfs {
+
+/**
+ * Byte-level text matcher used by SearchInFile.
+ * The needle is compiled into the target encoding once, including case variants of every character when the search
+ * is case-insensitive, and then raw bytes are scanned directly without decoding them into UTF-16.
+ * Only the bytes around candidate hits are decoded to check the whole-phrase condition.
+ * Supports UTF-8, UTF-16LE/BE and the single-byte encodings from Utility/Encodings.h.
+ */
+class TextMatcher
+{
+public:
+    struct Match {
+        size_t offset;
+        size_t length;
+    };
+
+    TextMatcher(CFStringRef _needle, int _encoding, bool _case_sensitive, bool _whole_phrase);
+
+    /**
+     * Returns false if the needle is empty or can't be represented in the target encoding.
+     * An invalid matcher never finds anything.
+     */
+    bool Valid() const noexcept;
+
+    /**
+     * Returns the maximum amount of bytes a match can occupy.
+     */
+    size_t MaxMatchLength() const noexcept;
+
+    /**
+     * Looks for the first match which starts in [_from, _size) of _data.
+     * _data_offset is the position of _data in the file and is used to keep matches aligned to code units.
+     * Bytes before _from are only looked at to check word boundaries.
+     */
+    std::optional<Match> Find(const std::byte *_data, size_t _size, size_t _from, uint64_t _data_offset) const noexcept;
+
+private:
+    // Byte representation of one variant of a character
+    struct Variant {
+        std::array<uint8_t, 4> bytes;
+        uint8_t length;
+    };
+
+    // A character of the needle with all its accepted representations
+    struct Character {
+        std::array<Variant, 3> variants;
+        uint8_t count = 0;
+    };
+
+    void AddCharacter(char32_t _c);
+    void Encode(char32_t _c, Character &_to) const;
+    bool VerifyAt(const std::byte *_data, size_t _size, size_t _pos, size_t &_length) const noexcept;
+    bool IsWholePhrase(const std::byte *_data, size_t _size, size_t _pos, size_t _length) const noexcept;
+    std::optional<char32_t> DecodeBefore(const std::byte *_data, size_t _pos) const noexcept;
+    std::optional<char32_t> DecodeAt(const std::byte *_data, size_t _size, size_t _pos) const noexcept;
+
+    int m_Encoding;
+    bool m_CaseSensitive;
+    bool m_WholePhrase;
+    bool m_Valid = false;
+    size_t m_CodeUnit = 1;
+    size_t m_MinLength = 0;
+    size_t m_MaxLength = 0;
+    std::vector<Character> m_Characters;
+    std::vector<uint8_t> m_Exact; // whole needle bytes when no character has alternative representations
+    bytescan::ByteSet m_FirstBytes;
+    bytescan::ByteSet m_LastBytes; // only meaningful when m_MinLength == m_MaxLength
+    std::array<char16_t, 256> m_SingleByteTable{}; // code page -> UTF16 for single-byte encodings
+};
+
+} // namespace nc::vfs
@@ -0,0 +1,191 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include "TestEnv.h"
+#include "FileNameIndex.h"
+#include <Native.h>
+#include <Base/dispatch_cpp.h>
+#include <CoreFoundation/CoreFoundation.h>
+#include <set>
+#include <chrono>
+#include <fstream>
+#include <filesystem>
+#include <sys/stat.h>
+
+using nc::vfs::FileNameIndex;
+using nc::utility::FileMask;
+
+#define PREFIX "[nc::vfs::FileNameIndex] "
+
+using set = std::set<std::string>;
+using namespace std::chrono_literals;
+
+static set Query(const FileNameIndex &_index, const std::string &_dir, const FileMask &_mask)
+{
+    set paths;
+    for( auto &entry : _index.Query(_dir, _mask) )
+        paths.emplace(entry.dir_path + entry.name);
+    return paths;
+}
+
+static void Touch(const std::string &_path)
+{
+    std::ofstream{_path};
+}
+
+static bool RunMainLoopUntilExpectationOrTimeout(std::chrono::nanoseconds _timeout,
+                                                 std::function<bool()> _expectation)
+{
+    dispatch_assert_main_queue();
+    const auto start_tp = std::chrono::steady_clock::now();
+    const auto time_slice = 1. / 100.; // 10 ms;
+    while( true ) {
+        CFRunLoopRunInMode(kCFRunLoopDefaultMode, time_slice, false);
+        if( std::chrono::steady_clock::now() - start_tp > _timeout )
+            return false;
+        if( _expectation() )
+            return true;
+    }
+}
+
+static void BuildTestData(const std::string &_root)
+{
+    mkdir((_root + "A").c_str(), S_IRWXU);
+    mkdir((_root + "A/B").c_str(), S_IRWXU);
+    mkdir((_root + "C").c_str(), S_IRWXU);
+    Touch(_root + "readme.txt");
+    Touch(_root + "A/notes.txt");
+    Touch(_root + "A/B/main.cpp");
+    Touch(_root + "C/Hello World.TXT");
+    Touch(_root + "C/image.png");
+}
+
+TEST_CASE(PREFIX "Build and query")
+{
+    TestDir test_dir;
+    const std::string root = test_dir.directory;
+    BuildTestData(root);
+    auto index = FileNameIndex::Build(*TestEnv().vfs_native, root);
+    REQUIRE(index);
+    CHECK(index->Root() == root);
+    CHECK(index->Size() == 8);
+    CHECK(index->Covers(root + "A/B"));
+    CHECK(index->Covers(root.substr(0, root.size() - 1)));
+    CHECK(!index->Covers("/some/other/dir/"));
+
+    CHECK(Query(*index, root, FileMask("*.txt")) ==
+          set{root + "readme.txt", root + "A/notes.txt", root + "C/Hello World.TXT"});
+    CHECK(Query(*index, root + "A/", FileMask("*.txt")) == set{root + "A/notes.txt"});
+    CHECK(Query(*index, root, FileMask("hello*, *.cpp")) == set{root + "C/Hello World.TXT", root + "A/B/main.cpp"});
+    CHECK(Query(*index, root, FileMask("?")) == set{root + "A", root + "A/B", root + "C"});
+    CHECK(Query(*index, root, FileMask("*")).size() == 8);
+    CHECK(Query(*index, root, FileMask(".*\\.png", FileMask::Type::RegEx)) == set{root + "C/image.png"});
+    CHECK(Query(*index, "/some/other/dir/", FileMask("*")).empty());
+}
+
+TEST_CASE(PREFIX "Refresh")
+{
+    TestDir test_dir;
+    const std::string root = test_dir.directory;
+    BuildTestData(root);
+    auto &host = *TestEnv().vfs_native;
+    auto index = FileNameIndex::Build(host, root);
+    REQUIRE(index);
+
+    SECTION("a new file")
+    {
+        Touch(root + "A/todo.txt");
+        index->Refresh(host, root + "A/");
+        CHECK(Query(*index, root, FileMask("*.txt")) ==
+              set{root + "readme.txt", root + "A/notes.txt", root + "A/todo.txt", root + "C/Hello World.TXT"});
+        CHECK(index->Size() == 9);
+    }
+    SECTION("a removed subtree")
+    {
+        std::filesystem::remove_all(root + "A");
+        index->Refresh(host, root);
+        CHECK(Query(*index, root, FileMask("*")) ==
+              set{root + "readme.txt", root + "C", root + "C/Hello World.TXT", root + "C/image.png"});
+        CHECK(index->Size() == 4);
+    }
+    SECTION("a renamed subtree")
+    {
+        std::filesystem::rename(root + "A", root + "D");
+        index->Refresh(host, root);
+        CHECK(Query(*index, root, FileMask("*.cpp")) == set{root + "D/B/main.cpp"});
+        CHECK(Query(*index, root + "D/B/", FileMask("main*")) == set{root + "D/B/main.cpp"});
+        CHECK(Query(*index, root + "A/", FileMask("*")).empty());
+        CHECK(index->Size() == 8);
+    }
+    SECTION("unknown directories are ignored")
+    {
+        index->Refresh(host, "/some/other/dir/");
+        CHECK(index->Size() == 8);
+    }
+}
+
+TEST_CASE(PREFIX "Observe")
+{
+    TestDir test_dir;
+    const std::string root = test_dir.directory;
+    BuildTestData(root);
+    const auto host = TestEnv().vfs_native;
+    auto index = FileNameIndex::Build(*host, root);
+    REQUIRE(index);
+    const auto ticket = index->Observe(host, root);
+    REQUIRE(ticket);
+
+    SECTION("a new file deep below the root")
+    {
+        Touch(root + "A/B/main.h");
+        CHECK(RunMainLoopUntilExpectationOrTimeout(
+            5s, [&] { return Query(*index, root, FileMask("main.*")).size() == 2; }));
+    }
+    SECTION("a new subtree")
+    {
+        std::filesystem::create_directories(root + "C/D/E");
+        Touch(root + "C/D/E/deep.txt");
+        CHECK(RunMainLoopUntilExpectationOrTimeout(
+            5s, [&] { return Query(*index, root, FileMask("deep.txt")) == set{root + "C/D/E/deep.txt"}; }));
+    }
+    SECTION("a removed file in a subdirectory")
+    {
+        std::filesystem::remove(root + "A/B/main.cpp");
+        CHECK(RunMainLoopUntilExpectationOrTimeout(
+            5s, [&] { return Query(*index, root, FileMask("*.cpp")).empty(); }));
+    }
+}
+
+TEST_CASE(PREFIX "Save and load")
+{
+    TestDir test_dir;
+    const std::string root = test_dir.directory / "data/";
+    const std::string index_path = test_dir.directory / "index";
+    mkdir(root.c_str(), S_IRWXU);
+    BuildTestData(root);
+    auto &host = *TestEnv().vfs_native;
+    auto index = FileNameIndex::Build(host, root);
+    REQUIRE(index);
+    Touch(root + "A/B/main.h");
+    index->Refresh(host, root + "A/B/");
+    REQUIRE(index->Save(index_path));
+
+    auto loaded = FileNameIndex::Load(index_path);
+    REQUIRE(loaded);
+    CHECK(loaded->Root() == root);
+    CHECK(loaded->Size() == 9);
+    CHECK(Query(*loaded, root, FileMask("main.*")) == set{root + "A/B/main.cpp", root + "A/B/main.h"});
+
+    SECTION("a corrupted image is rejected")
+    {
+        {
+            std::fstream file(index_path, std::ios::in | std::ios::out | std::ios::binary);
+            file.seekp(0);
+            file.write("garbage", 7);
+        }
+        CHECK(FileNameIndex::Load(index_path) == nullptr);
+    }
+    SECTION("a missing image is rejected")
+    {
+        CHECK(FileNameIndex::Load(index_path + "-nonexistent") == nullptr);
+    }
+}
@@ -1,10 +1,13 @@
-// Copyright (C) 2020-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2020-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Tests.h"
 #include "TestEnv.h"
 #include <VFSListingInput.h>
 #include <Native.h>
 #include <VFSDeclarations.h>
 #include <Base/mach_time.h>
+#include <Base/dispatch_cpp.h>
+#include <Base/CFString.h>
+#include <sys/stat.h>
 #include <thread>
 
 using namespace nc::vfs;
@@ -47,3 +50,41 @@ TEST_CASE(PREFIX"Prodives a correct ticks timestamp")
     CHECK( listing->BuildTicksTimestamp() >= old_ts );
     CHECK( listing->BuildTicksTimestamp() <= new_ts );
 }
+
+TEST_CASE(PREFIX"CF strings are created on demand")
+{
+    ListingInput input;
+    input.hosts.insert(0, TestEnv().vfs_native);
+    input.directories.insert(0, "/");
+    input.display_filenames.reset(nc::base::variable_container<>::type::sparse);
+    const std::vector<std::string> filenames = {"a.txt", reinterpret_cast<const char *>(u8"Привет"), "\xFF\xFE", "dir"};
+    for( auto &filename : filenames ) {
+        input.filenames.emplace_back(filename);
+        input.unix_modes.emplace_back(S_IFREG | S_IRUSR);
+        input.unix_types.emplace_back(DT_REG);
+    }
+    input.display_filenames.insert(3, "Directory");
+    const auto listing = Listing::Build(std::move(input));
+
+    // every thread gets the same string
+    std::vector<std::vector<CFStringRef>> strings(16);
+    nc::dispatch_apply(strings.size(), [&](size_t _thread) {
+        for( unsigned i = 0; i != listing->Count(); ++i ) {
+            strings[_thread].push_back(listing->FilenameCF(i));
+            strings[_thread].push_back(listing->DisplayFilenameCF(i));
+        }
+    });
+    for( auto &thread_strings : strings )
+        CHECK(thread_strings == strings.front());
+
+    CHECK(nc::base::CFStringGetUTF8StdString(listing->FilenameCF(0)) == "a.txt");
+    CHECK(nc::base::CFStringGetUTF8StdString(listing->FilenameCF(1)) == filenames[1]);
+    CHECK(CFStringGetLength(listing->FilenameCF(2)) == 2); // invalid UTF8 falls back to MacRoman
+    CHECK(nc::base::CFStringGetUTF8StdString(listing->FilenameCF(3)) == "dir");
+    CHECK(nc::base::CFStringGetUTF8StdString(listing->DisplayFilenameCF(3)) == "Directory");
+    CHECK(listing->DisplayFilenameCF(0) == listing->FilenameCF(0));
+
+    const std::vector<unsigned> indices = {3, 2, 1, 0, 100};
+    listing->MaterializeCFStrings(indices);
+    CHECK(listing->DisplayFilenameCF(3) == strings.front()[7]);
+}
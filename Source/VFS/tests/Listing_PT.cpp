@@ -0,0 +1,95 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include <VFS/VFS.h>
+#include <VFSListingInput.h>
+#include <malloc/malloc.h>
+#include <sys/dirent.h>
+#include <sys/stat.h>
+#include <random>
+
+// NB! disabled by default, include in the VFS tests target to enable
+
+using namespace nc::vfs;
+using nc::base::variable_container;
+
+#define PREFIX "[nc::vfs::Listing] PT "
+
+// Something resembling a native directory listing: every item has the stat() fields, a mix of short and long names
+static ListingInput MakeInput(size_t _count)
+{
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> name_len(4, 40);
+
+    ListingInput input;
+    input.hosts[0] = VFSHost::DummyHost();
+    input.directories[0] = "/some/directory/";
+    input.sizes.reset(variable_container<>::type::dense);
+    input.inodes.reset(variable_container<>::type::dense);
+    input.atimes.reset(variable_container<>::type::dense);
+    input.mtimes.reset(variable_container<>::type::dense);
+    input.ctimes.reset(variable_container<>::type::dense);
+    input.btimes.reset(variable_container<>::type::dense);
+    input.uids.reset(variable_container<>::type::dense);
+    input.gids.reset(variable_container<>::type::dense);
+    input.unix_flags.reset(variable_container<>::type::dense);
+    for( size_t i = 0; i < _count; ++i ) {
+        std::string name;
+        for( int len = name_len(rnd); len > 0; --len )
+            name += static_cast<char>(letter(rnd));
+        name += ".txt";
+        input.filenames.emplace_back(std::move(name));
+        input.unix_modes.emplace_back(S_IFREG | S_IRUSR | S_IWUSR);
+        input.unix_types.emplace_back(DT_REG);
+        input.sizes.insert(i, i);
+        input.inodes.insert(i, i);
+        input.atimes.insert(i, 1'700'000'000);
+        input.mtimes.insert(i, 1'700'000'000);
+        input.ctimes.insert(i, 1'700'000'000);
+        input.btimes.insert(i, 1'700'000'000);
+        input.uids.insert(i, 501);
+        input.gids.insert(i, 20);
+        input.unix_flags.insert(i, 0);
+    }
+    return input;
+}
+
+static size_t MemoryInUse()
+{
+    malloc_statistics_t stats;
+    malloc_zone_statistics(nullptr, &stats);
+    return stats.size_in_use;
+}
+
+TEST_CASE(PREFIX "Building and destroying", "[!benchmark]")
+{
+    for( const size_t count : {10'000, 100'000, 1'000'000} ) {
+        const auto suffix = " - " + std::to_string(count) + " entries";
+
+        {
+            auto input = MakeInput(count);
+            const size_t before = MemoryInUse();
+            const VFSListingPtr listing = Listing::Build(std::move(input));
+            input = {};
+            const size_t after = MemoryInUse();
+            WARN("Memory per entry" << suffix << ": " << (after - before + count / 2) / count << " bytes");
+        }
+
+        BENCHMARK_ADVANCED("Build" + suffix)(Catch::Benchmark::Chronometer meter)
+        {
+            std::vector<ListingInput> inputs(meter.runs());
+            for( auto &input : inputs )
+                input = MakeInput(count);
+            std::vector<VFSListingPtr> listings(meter.runs());
+            meter.measure([&](int _run) { listings[_run] = Listing::Build(std::move(inputs[_run])); });
+        };
+
+        BENCHMARK_ADVANCED("Destroy" + suffix)(Catch::Benchmark::Chronometer meter)
+        {
+            std::vector<VFSListingPtr> listings(meter.runs());
+            for( auto &listing : listings )
+                listing = Listing::Build(MakeInput(count));
+            meter.measure([&](int _run) { listings[_run].reset(); });
+        };
+    }
+}
@@ -1,4 +1,4 @@
-// Copyright (C) 2019-2022 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Tests.h"
 #include "TestEnv.h"
 #include "SearchForFiles.h"
@@ -6,6 +6,7 @@
 #include <Native.h>
 #include <set>
 #include <fstream>
+#include <filesystem>
 #include <sys/stat.h>
 
 using nc::vfs::SearchForFiles;
@@ -208,6 +209,154 @@ TEST_CASE(PREFIX "Test content filter")
         do_search( Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs );
         CHECK( filenames == set{} );
     }    
+    SECTION("hello or edge, literals") {
+        auto filter = SearchForFiles::FilterContent{};
+        filter.type = SearchForFiles::FilterContent::Type::Literals;
+        filter.literals = {"hello", "edge"};
+        search.SetFilterContent(filter);
+        do_search( Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs );
+        CHECK( filenames == set{"filename1.txt", "filename3.txt"} );
+    }
+    SECTION("^hello, regex") {
+        auto filter = SearchForFiles::FilterContent{};
+        filter.type = SearchForFiles::FilterContent::Type::RegEx;
+        filter.text = "^hello, w.+d!$";
+        search.SetFilterContent(filter);
+        do_search( Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs );
+        CHECK( filenames == set{"filename1.txt"} );
+    }
+    SECTION("'world!', bytes") {
+        auto filter = SearchForFiles::FilterContent{};
+        filter.type = SearchForFiles::FilterContent::Type::Bytes;
+        filter.text = "77 6F 72 6C 64 2?";
+        search.SetFilterContent(filter);
+        do_search( Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs );
+        CHECK( filenames == set{"filename1.txt", "filename3.txt"} );
+    }
+    SECTION("malformed bytes") {
+        auto filter = SearchForFiles::FilterContent{};
+        filter.type = SearchForFiles::FilterContent::Type::Bytes;
+        filter.text = "77 6";
+        CHECK_THROWS_AS( search.SetFilterContent(filter), std::invalid_argument );
+    }
+    SECTION("malformed regex") {
+        auto filter = SearchForFiles::FilterContent{};
+        filter.type = SearchForFiles::FilterContent::Type::RegEx;
+        filter.text = "hello, (";
+        CHECK_THROWS_AS( search.SetFilterContent(filter), std::invalid_argument );
+    }
+}
+
+TEST_CASE(PREFIX "Test parallel traversal")
+{
+    using Options = SearchForFiles::Options;
+    TestDir test_dir;
+    BuildTestData(test_dir.directory);
+    auto &host = TestEnv().vfs_native;
+
+    using set = std::set<std::string>;
+    set filenames;
+    size_t found = 0;
+    auto callback = [&](const char *_filename,
+                        [[maybe_unused]] const char *_in_path,
+                        VFSHost&, CFRange) {
+        filenames.emplace(_filename);
+        ++found;
+    };
+
+    SearchForFiles search;
+    SearchForFiles::Concurrency concurrency;
+    concurrency.native = 4;
+    search.SetConcurrency(concurrency);
+    auto do_search = [&](int _flags) {
+        search.Go(test_dir.directory, host, _flags | Options::ParallelTraversal, callback, {});
+        search.Wait();
+    };
+
+    SECTION("search for all entries, recursively") {
+        do_search( Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs );
+        CHECK( filenames == set{"Dir", "filename1.txt", "filename2.txt", "filename3.txt"} );
+    }
+    SECTION("search for all entries with mask='*.txt'") {
+        search.SetFilterName(FileMask("*.txt"));
+        do_search( Options::GoIntoSubDirs | Options::SearchForDirs | Options::SearchForFiles );
+        CHECK( filenames == set{"filename1.txt", "filename2.txt", "filename3.txt"} );
+    }
+    SECTION("world") {
+        auto filter = SearchForFiles::FilterContent{};
+        filter.text = "world";
+        search.SetFilterContent(filter);
+        do_search( Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs );
+        CHECK( filenames == set{"filename1.txt", "filename3.txt"} );
+    }
+    SECTION("hello, not containing") {
+        auto filter = SearchForFiles::FilterContent{};
+        filter.text = "hello";
+        filter.not_containing = true;
+        search.SetFilterContent(filter);
+        do_search( Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs );
+        CHECK( filenames == set{"filename2.txt", "filename3.txt"} );
+    }
+    SECTION("a wide tree") {
+        for( int dir = 0; dir < 16; ++dir ) {
+            const auto dir_path = test_dir.directory / ("D" + std::to_string(dir));
+            MkDir(dir_path);
+            for( int file = 0; file < 100; ++file )
+                Save(dir_path / (std::to_string(file) + ".dat"), "");
+        }
+        search.SetFilterName(FileMask("*.dat"));
+        do_search( Options::GoIntoSubDirs | Options::SearchForFiles );
+        CHECK( found == 1600 );
+    }
+}
+
+TEST_CASE(PREFIX "Test file name index")
+{
+    using Options = SearchForFiles::Options;
+    TestDir test_dir;
+    BuildTestData(test_dir.directory);
+    auto &host = TestEnv().vfs_native;
+
+    using set = std::set<std::string>;
+    set found;
+    auto callback = [&](const char *_filename, const char *_in_path, VFSHost &, CFRange) {
+        found.emplace(std::filesystem::path(_in_path) / _filename);
+    };
+
+    // the index is deliberately stale to make sure it's the index that answers the queries
+    auto index = nc::vfs::FileNameIndex::Build(*host, test_dir.directory.native());
+    REQUIRE(index);
+    Save(test_dir.directory / "filename4.txt", "");
+
+    SearchForFiles search;
+    search.SetFileNameIndex(index);
+    auto do_search = [&](const std::string &_path, int _flags) {
+        found.clear();
+        search.Go(_path, host, _flags, callback, {});
+        search.Wait();
+    };
+    const std::string root = test_dir.directory.native();
+
+    SECTION("search for all entries, recursively") {
+        do_search(root, Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs);
+        CHECK(found == set{root + "Dir", root + "filename1.txt", root + "filename2.txt", root + "Dir/filename3.txt"});
+    }
+    SECTION("search for files with mask='*3.txt' in a subdirectory") {
+        search.SetFilterName(FileMask("*3.txt"));
+        do_search(root + "Dir", Options::GoIntoSubDirs | Options::SearchForFiles | Options::SearchForDirs);
+        CHECK(found == set{root + "Dir/filename3.txt"});
+    }
+    SECTION("the index is combined with the content filter") {
+        auto filter = SearchForFiles::FilterContent{};
+        filter.text = "world";
+        search.SetFilterContent(filter);
+        do_search(root, Options::GoIntoSubDirs | Options::SearchForFiles);
+        CHECK(found == set{root + "filename1.txt", root + "Dir/filename3.txt"});
+    }
+    SECTION("non-recursive searches don't use the index") {
+        do_search(root, Options::SearchForFiles);
+        CHECK(found == set{root + "filename1.txt", root + "filename2.txt", root + "filename4.txt"});
+    }
 }
 
 static void BuildTestData(const std::string &_root_path)
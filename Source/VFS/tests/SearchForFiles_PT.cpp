@@ -0,0 +1,98 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include "TestEnv.h"
+#include "SearchForFiles.h"
+#include <fstream>
+#include <sys/stat.h>
+
+// NB! disabled by default, include in the VFS tests target to enable
+
+using nc::vfs::SearchForFiles;
+using nc::utility::FileMask;
+
+#define PREFIX "[nc::vfs::SearchForFiles] PT "
+
+// Builds a synthetic tree of _fanout^_depth directories with _files_per_dir files in each of them.
+static void BuildTree(const std::string &_path, int _depth, int _fanout, int _files_per_dir)
+{
+    for( int i = 0; i < _files_per_dir; ++i ) {
+        std::ofstream out(_path + "/file" + std::to_string(i) + (i % 10 == 0 ? ".log" : ".txt"));
+        out << "some content of file #" << i << (i % 100 == 0 ? ", needle" : "");
+    }
+    if( _depth == 0 )
+        return;
+    for( int i = 0; i < _fanout; ++i ) {
+        const auto dir = _path + "/dir" + std::to_string(i);
+        mkdir(dir.c_str(), S_IRWXU);
+        BuildTree(dir, _depth - 1, _fanout, _files_per_dir);
+    }
+}
+
+TEST_CASE(PREFIX "Synthetic tree", "[!benchmark]")
+{
+    using Options = SearchForFiles::Options;
+    TestDir test_dir;
+    BuildTree(test_dir.directory, 4, 8, 20); // ~4.7K directories, ~94K files
+    auto &host = TestEnv().vfs_native;
+
+    SearchForFiles search;
+    size_t found = 0;
+    auto callback = [&](const char *, const char *, VFSHost &, CFRange) { ++found; };
+    auto run = [&](int _options) {
+        found = 0;
+        search.Go(test_dir.directory, host, _options | Options::GoIntoSubDirs | Options::SearchForFiles, callback, {});
+        search.Wait();
+        return found;
+    };
+
+    search.SetFilterName(FileMask("*.log"));
+    BENCHMARK("Filename, serial")
+    {
+        return run(0);
+    };
+    for( int workers : {2, 4, 8} ) {
+        SearchForFiles::Concurrency concurrency;
+        concurrency.native = workers;
+        search.SetConcurrency(concurrency);
+        BENCHMARK("Filename, parallel x" + std::to_string(workers))
+        {
+            return run(Options::ParallelTraversal);
+        };
+    }
+
+    auto index = nc::vfs::FileNameIndex::Build(*host, test_dir.directory.native());
+    BENCHMARK("Filename, index build")
+    {
+        return nc::vfs::FileNameIndex::Build(*host, test_dir.directory.native());
+    };
+    const auto index_path = test_dir.directory / "index";
+    index->Save(index_path);
+    BENCHMARK("Filename, index load")
+    {
+        return nc::vfs::FileNameIndex::Load(index_path);
+    };
+    search.SetFileNameIndex(index);
+    BENCHMARK("Filename, index")
+    {
+        return run(0);
+    };
+    search.SetFileNameIndex(nullptr);
+
+    search.ClearFilters();
+    SearchForFiles::FilterContent content;
+    content.text = "needle";
+    search.SetFilterContent(content);
+    BENCHMARK("Content, serial")
+    {
+        return run(0);
+    };
+    for( int workers : {2, 4, 8} ) {
+        SearchForFiles::Concurrency concurrency;
+        concurrency.native = workers;
+        search.SetConcurrency(concurrency);
+        BENCHMARK("Content, parallel x" + std::to_string(workers))
+        {
+            return run(Options::ParallelTraversal);
+        };
+    }
+}
@@ -0,0 +1,152 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include "SearchInFile.h"
+#include "VFSGenericMemReadOnlyFile.h"
+#include <Utility/Encodings.h>
+#include <Base/CFString.h>
+#include <random>
+
+// NB! disabled by default, include in the VFS tests target to enable
+
+using namespace nc::base;
+using nc::vfs::FileWindow;
+using nc::vfs::GenericMemReadOnlyFile;
+using nc::vfs::SearchInFile;
+
+#define PREFIX "[nc::vfs::SearchInFile] PT "
+
+static const size_t g_InputSize = size_t(1) * 1024 * 1024 * 1024;
+
+// Something resembling a log file: lines of random words, with the needle appended at the very end.
+static std::string MakeInput(std::string_view _needle)
+{
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int> letter('a', 'z');
+    std::uniform_int_distribution<int> word_len(2, 10);
+    std::string data;
+    data.reserve(g_InputSize + _needle.size());
+    while( data.size() < g_InputSize ) {
+        for( int len = word_len(rnd); len > 0; --len )
+            data += static_cast<char>(letter(rnd));
+        data += (data.size() % 80 < 10) ? '\n' : ' ';
+    }
+    data += _needle;
+    return data;
+}
+
+// The search path used by SearchInFile before the byte-level matcher: decode each window into UTF-16 and use
+// CoreFoundation to find the request.
+static std::optional<uint64_t> LegacySearch(std::string_view _data, CFStringRef _request, int _encoding, bool _case)
+{
+    const size_t window_size = FileWindow::DefaultWindowSize;
+    const size_t overlap = static_cast<size_t>(CFStringGetLength(_request)) * 2;
+    auto decoded = std::make_unique<uint16_t[]>(window_size);
+    auto indices = std::make_unique<uint32_t[]>(window_size);
+    for( size_t pos = 0; pos < _data.size(); ) {
+        const size_t len = std::min(window_size, _data.size() - pos);
+        size_t decoded_size = 0;
+        encodings::InterpretAsUnichar(_encoding,
+                                      reinterpret_cast<const unsigned char *>(_data.data() + pos),
+                                      len,
+                                      decoded.get(),
+                                      indices.get(),
+                                      &decoded_size);
+        const auto str = CFStringCreateWithCharactersNoCopy(
+            nullptr, decoded.get(), static_cast<CFIndex>(decoded_size), kCFAllocatorNull);
+        const auto range = CFStringFind(str, _request, _case ? 0 : kCFCompareCaseInsensitive);
+        CFRelease(str);
+        if( range.location != kCFNotFound )
+            return pos + indices[range.location];
+        if( pos + len == _data.size() )
+            break;
+        pos += len - overlap;
+    }
+    return std::nullopt;
+}
+
+static std::optional<uint64_t> ByteLevelSearch(std::string_view _data, CFStringRef _request, int _encoding, bool _case)
+{
+    auto mem_file = std::make_shared<GenericMemReadOnlyFile>(nullptr, nullptr, _data);
+    mem_file->Open(VFSFlags::OF_Read);
+    FileWindow fw{mem_file};
+    SearchInFile search{fw};
+    search.ToggleTextSearch(_request, _encoding);
+    search.SetSearchOptions(_case ? SearchInFile::Options::CaseSensitive : SearchInFile::Options::None);
+    const auto result = search.Search();
+    if( result.response == SearchInFile::Response::Found )
+        return result.location->offset;
+    return std::nullopt;
+}
+
+TEST_CASE(PREFIX "1GB of text", "[!benchmark]")
+{
+    const auto needle = std::string("ThisIsTheNeedle");
+    const auto data = MakeInput(needle);
+    const auto request = CFString(needle);
+    const auto expected = data.size() - needle.size();
+
+    REQUIRE( LegacySearch(data, *request, encodings::ENCODING_UTF8, false) == expected );
+    REQUIRE( ByteLevelSearch(data, *request, encodings::ENCODING_UTF8, false) == expected );
+
+    BENCHMARK("Legacy, UTF8, case-insensitive")
+    {
+        return LegacySearch(data, *request, encodings::ENCODING_UTF8, false);
+    };
+    BENCHMARK("Byte-level, UTF8, case-insensitive")
+    {
+        return ByteLevelSearch(data, *request, encodings::ENCODING_UTF8, false);
+    };
+    BENCHMARK("Legacy, UTF8, case-sensitive")
+    {
+        return LegacySearch(data, *request, encodings::ENCODING_UTF8, true);
+    };
+    BENCHMARK("Byte-level, UTF8, case-sensitive")
+    {
+        return ByteLevelSearch(data, *request, encodings::ENCODING_UTF8, true);
+    };
+    BENCHMARK("Legacy, WIN1251, case-insensitive")
+    {
+        return LegacySearch(data, *request, encodings::ENCODING_WIN1251, false);
+    };
+    BENCHMARK("Byte-level, WIN1251, case-insensitive")
+    {
+        return ByteLevelSearch(data, *request, encodings::ENCODING_WIN1251, false);
+    };
+}
+
+static std::optional<uint64_t> BytesSearch(std::string_view _data, std::string_view _pattern)
+{
+    auto mem_file = std::make_shared<GenericMemReadOnlyFile>(nullptr, nullptr, _data);
+    mem_file->Open(VFSFlags::OF_Read);
+    FileWindow fw{mem_file};
+    SearchInFile search{fw};
+    search.ToggleBytesSearch(SearchInFile::CompileBytePattern(_pattern));
+    const auto result = search.Search();
+    if( result.response == SearchInFile::Response::Found )
+        return result.location->offset;
+    return std::nullopt;
+}
+
+TEST_CASE(PREFIX "1GB of binary data", "[!benchmark]")
+{
+    const auto signature = std::string("\x89PNG\r\n\x1A\n");
+    std::string data(g_InputSize, '\0');
+    std::mt19937 rnd(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+    for( auto &c : data )
+        c = static_cast<char>(byte(rnd));
+    data += signature;
+    const auto expected = data.size() - signature.size();
+
+    REQUIRE( BytesSearch(data, "89 50 4E 47 0D 0A 1A 0A") == expected );
+    REQUIRE( BytesSearch(data, "89 50 4E 47 0? 0A 1A 0A") == expected );
+
+    BENCHMARK("Exact bytes")
+    {
+        return BytesSearch(data, "89 50 4E 47 0D 0A 1A 0A");
+    };
+    BENCHMARK("Bytes with wildcard nibbles")
+    {
+        return BytesSearch(data, "89 50 4E 47 0? 0A 1A 0A");
+    };
+}
@@ -1,4 +1,4 @@
-// Copyright (C) 2019-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Tests.h"
 #include "SearchInFile.h"
 #include "VFSGenericMemReadOnlyFile.h"
@@ -199,6 +199,273 @@ TEST_CASE(PREFIX "Handles case the whole phrase flag")
     }
 }
 
+TEST_CASE(PREFIX "Searches in UTF16")
+{
+    using namespace std::string_view_literals;
+    SECTION("UTF16LE") {
+        auto fw = MakeFileWindow("h\0e\0l\0l\0o\0,\0 \0\x3F\x04\x40\x04\x38\x04\x32\x04\x35\x04\x42\x04"sv);
+        auto search = SearchInFile{fw};
+        const auto cf_string = CFString(reinterpret_cast<const char*>(u8"ПРИВЕТ"));
+        search.ToggleTextSearch(*cf_string, encodings::ENCODING_UTF16LE);
+        const auto result = search.Search();
+        REQUIRE( result.response == SearchInFile::Response::Found );
+        CHECK( result.location->offset == 14 );
+        CHECK( result.location->bytes_len == 12 );
+    }
+    SECTION("UTF16BE") {
+        auto fw = MakeFileWindow("\0h\0e\0l\0l\0o\0,\0 \x04\x3F\x04\x40\x04\x38\x04\x32\x04\x35\x04\x42"sv);
+        auto search = SearchInFile{fw};
+        search.ToggleTextSearch(CFSTR("LLO"), encodings::ENCODING_UTF16BE);
+        const auto result = search.Search();
+        REQUIRE( result.response == SearchInFile::Response::Found );
+        CHECK( result.location->offset == 4 );
+        CHECK( result.location->bytes_len == 6 );
+    }
+    SECTION("UTF16LE doesn't match on odd offsets") {
+        auto fw = MakeFileWindow("\0a\0b\0"sv);
+        auto search = SearchInFile{fw};
+        search.ToggleTextSearch(CFSTR("a"), encodings::ENCODING_UTF16LE);
+        const auto result = search.Search();
+        CHECK( result.response == SearchInFile::Response::NotFound );
+    }
+}
+
+TEST_CASE(PREFIX "Searches in single-byte encodings")
+{
+    // "Привет, ПРИВЕТ" in Windows-1251
+    auto fw = MakeFileWindow("\xCF\xF0\xE8\xE2\xE5\xF2, \xCF\xD0\xC8\xC2\xC5\xD2");
+    auto search = SearchInFile{fw};
+    const auto cf_string = CFString(reinterpret_cast<const char*>(u8"привет"));
+    search.ToggleTextSearch(*cf_string, encodings::ENCODING_WIN1251);
+    SECTION("case insensitive") {
+        const auto result1 = search.Search();
+        REQUIRE( result1.response == SearchInFile::Response::Found );
+        CHECK( result1.location->offset == 0 );
+        CHECK( result1.location->bytes_len == 6 );
+        const auto result2 = search.Search();
+        REQUIRE( result2.response == SearchInFile::Response::Found );
+        CHECK( result2.location->offset == 8 );
+        CHECK( result2.location->bytes_len == 6 );
+    }
+    SECTION("case sensitive") {
+        search.SetSearchOptions(SearchInFile::Options::CaseSensitive);
+        const auto result = search.Search();
+        CHECK( result.response == SearchInFile::Response::NotFound );
+    }
+    SECTION("not representable request") {
+        const auto greek = CFString(reinterpret_cast<const char*>(u8"λ"));
+        search.ToggleTextSearch(*greek, encodings::ENCODING_WIN1251);
+        const auto result = search.Search();
+        CHECK( result.response == SearchInFile::Response::NotFound );
+    }
+}
+
+TEST_CASE(PREFIX "Finds matches cut by the window boundary")
+{
+    const auto window_size = FileWindow::DefaultWindowSize;
+    for( size_t delta : {5, 4, 3, 2, 1} ) {
+        std::string memory(window_size - delta, ' ');
+        memory += "hello";
+        memory.resize(2 * window_size, ' ');
+        auto fw = MakeFileWindow(memory);
+        auto search = SearchInFile{fw};
+        search.ToggleTextSearch(CFSTR("HELLO"), encodings::ENCODING_UTF8);
+        const auto result = search.Search();
+        REQUIRE( result.response == SearchInFile::Response::Found );
+        CHECK( result.location->offset == window_size - delta );
+        CHECK( result.location->bytes_len == 5 );
+    }
+}
+
+TEST_CASE(PREFIX "Checks whole phrase around non-ASCII characters")
+{
+    auto fw = MakeFileWindow(reinterpret_cast<const char*>(u8"приветмир мир"));
+    auto search = SearchInFile{fw};
+    const auto cf_string = CFString(reinterpret_cast<const char*>(u8"мир"));
+    search.ToggleTextSearch(*cf_string, encodings::ENCODING_UTF8);
+    search.SetSearchOptions(SearchInFile::Options::FindWholePhrase);
+    const auto result = search.Search();
+    REQUIRE( result.response == SearchInFile::Response::Found );
+    CHECK( result.location->offset == 19 );
+    CHECK( result.location->bytes_len == 6 );
+}
+
+TEST_CASE(PREFIX "Searches for multiple literals at once")
+{
+    auto fw = MakeFileWindow("one Two three tWo ONE");
+    auto search = SearchInFile{fw};
+    const std::vector<std::string> literals = {"two", "one"};
+    SECTION("case insensitive") {
+        search.ToggleLiteralsSearch(SearchInFile::CompileLiterals(literals, false));
+        const std::pair<uint64_t, uint64_t> expected[] = {{0, 3}, {4, 3}, {14, 3}, {18, 3}};
+        for( auto [offset, length] : expected ) {
+            const auto result = search.Search();
+            REQUIRE( result.response == SearchInFile::Response::Found );
+            CHECK( result.location->offset == offset );
+            CHECK( result.location->bytes_len == length );
+        }
+        CHECK( search.Search().response == SearchInFile::Response::EndOfFile );
+    }
+    SECTION("case sensitive") {
+        search.ToggleLiteralsSearch(SearchInFile::CompileLiterals(literals, true));
+        const auto result = search.Search();
+        REQUIRE( result.response == SearchInFile::Response::Found );
+        CHECK( result.location->offset == 0 );
+        CHECK( search.Search().response == SearchInFile::Response::NotFound );
+    }
+}
+
+TEST_CASE(PREFIX "Finds literals cut by the window boundary")
+{
+    const auto window_size = FileWindow::DefaultWindowSize;
+    std::string memory(window_size - 2, ' ');
+    memory += "needle";
+    memory.resize(2 * window_size, ' ');
+    auto fw = MakeFileWindow(memory);
+    auto search = SearchInFile{fw};
+    const std::vector<std::string> literals = {"haystack", "needle"};
+    search.ToggleLiteralsSearch(SearchInFile::CompileLiterals(literals, false));
+    const auto result = search.Search();
+    REQUIRE( result.response == SearchInFile::Response::Found );
+    CHECK( result.location->offset == window_size - 2 );
+    CHECK( result.location->bytes_len == 6 );
+}
+
+TEST_CASE(PREFIX "Searches for regular expressions")
+{
+    auto fw = MakeFileWindow("int a = 10;\nfloat b = 2;\nint c = 345;\n");
+    auto search = SearchInFile{fw};
+    SECTION("anchored") {
+        search.ToggleRegExSearch(SearchInFile::CompileRegEx("^int [a-z] = \\d+", true));
+        const auto result1 = search.Search();
+        REQUIRE( result1.response == SearchInFile::Response::Found );
+        CHECK( result1.location->offset == 0 );
+        CHECK( result1.location->bytes_len == 10 );
+        const auto result2 = search.Search();
+        REQUIRE( result2.response == SearchInFile::Response::Found );
+        CHECK( result2.location->offset == 25 );
+        CHECK( result2.location->bytes_len == 11 );
+        CHECK( search.Search().response == SearchInFile::Response::NotFound );
+    }
+    SECTION("case insensitive") {
+        search.ToggleRegExSearch(SearchInFile::CompileRegEx("FLOAT", false));
+        const auto result = search.Search();
+        REQUIRE( result.response == SearchInFile::Response::Found );
+        CHECK( result.location->offset == 12 );
+    }
+    SECTION("malformed expression") {
+        CHECK( SearchInFile::CompileRegEx("int (", true) == nullptr );
+        CHECK_THROWS( search.ToggleRegExSearch(nullptr) );
+    }
+}
+
+TEST_CASE(PREFIX "Finds regular expressions in lines cut by the window boundary")
+{
+    const auto window_size = FileWindow::DefaultWindowSize;
+    std::string memory(window_size - 3, 'x');
+    memory += "\nabc123\n";
+    memory.resize(2 * window_size, 'x');
+    auto fw = MakeFileWindow(memory);
+    auto search = SearchInFile{fw};
+    search.ToggleRegExSearch(SearchInFile::CompileRegEx("^[a-z]+\\d+$", true));
+    const auto result = search.Search();
+    REQUIRE( result.response == SearchInFile::Response::Found );
+    CHECK( result.location->offset == window_size - 2 );
+    CHECK( result.location->bytes_len == 6 );
+    CHECK( search.Search().response == SearchInFile::Response::NotFound );
+}
+
+TEST_CASE(PREFIX "Searches for byte patterns")
+{
+    auto fw = MakeFileWindow("\x7F" "ELF\x02\x01 junk \xCA\xFE\xBA\xBE \xCA\xFF\xBA\xBE"sv);
+    auto search = SearchInFile{fw};
+    SECTION("exact") {
+        search.ToggleBytesSearch(SearchInFile::CompileBytePattern("7f454c46"));
+        const auto result = search.Search();
+        REQUIRE( result.response == SearchInFile::Response::Found );
+        CHECK( result.location->offset == 0 );
+        CHECK( result.location->bytes_len == 4 );
+        CHECK( search.Search().response == SearchInFile::Response::NotFound );
+    }
+    SECTION("wildcard nibbles") {
+        search.ToggleBytesSearch(SearchInFile::CompileBytePattern("CA F? BA BE"));
+        const auto result1 = search.Search();
+        REQUIRE( result1.response == SearchInFile::Response::Found );
+        CHECK( result1.location->offset == 12 );
+        CHECK( result1.location->bytes_len == 4 );
+        const auto result2 = search.Search();
+        REQUIRE( result2.response == SearchInFile::Response::Found );
+        CHECK( result2.location->offset == 17 );
+        CHECK( search.Search().response == SearchInFile::Response::EndOfFile );
+    }
+    SECTION("wildcard bytes only partially defined") {
+        search.ToggleBytesSearch(SearchInFile::CompileBytePattern("?E ?A"));
+        const auto result = search.Search();
+        REQUIRE( result.response == SearchInFile::Response::Found );
+        CHECK( result.location->offset == 13 );
+    }
+    SECTION("malformed patterns") {
+        CHECK( SearchInFile::CompileBytePattern("") == nullptr );
+        CHECK( SearchInFile::CompileBytePattern("CAF") == nullptr );
+        CHECK( SearchInFile::CompileBytePattern("CAFG") == nullptr );
+        CHECK( SearchInFile::CompileBytePattern("????") == nullptr );
+        CHECK_THROWS( search.ToggleBytesSearch(nullptr) );
+    }
+}
+
+TEST_CASE(PREFIX "Finds byte patterns cut by the window boundary")
+{
+    const auto window_size = FileWindow::DefaultWindowSize;
+    for( size_t delta : {4, 3, 2, 1} ) {
+        std::string memory(window_size - delta, '\0');
+        memory += "\xDE\xAD\xBE\xEF";
+        memory.resize(2 * window_size, '\0');
+        auto fw = MakeFileWindow(memory);
+        auto search = SearchInFile{fw};
+        search.ToggleBytesSearch(SearchInFile::CompileBytePattern("DE AD ?? EF"));
+        const auto result = search.Search();
+        REQUIRE( result.response == SearchInFile::Response::Found );
+        CHECK( result.location->offset == window_size - delta );
+        CHECK( result.location->bytes_len == 4 );
+    }
+}
+
+TEST_CASE(PREFIX "Reports the end of file the same way in all modes")
+{
+    const std::vector<std::string> literals = {"two"};
+    const auto toggle = [&](SearchInFile &_search, int _mode) {
+        if( _mode == 0 )
+            _search.ToggleTextSearch(CFSTR("two"), encodings::ENCODING_UTF8);
+        else if( _mode == 1 )
+            _search.ToggleLiteralsSearch(SearchInFile::CompileLiterals(literals, true));
+        else if( _mode == 2 )
+            _search.ToggleRegExSearch(SearchInFile::CompileRegEx("two", true));
+        else
+            _search.ToggleBytesSearch(SearchInFile::CompileBytePattern("74776F"));
+    };
+    for( int mode = 0; mode < 4; ++mode ) {
+        INFO( mode );
+        {   // a match at the very end leaves nothing to look through
+            auto fw = MakeFileWindow("one two");
+            auto search = SearchInFile{fw};
+            toggle(search, mode);
+            const auto result = search.Search();
+            REQUIRE( result.response == SearchInFile::Response::Found );
+            CHECK( result.location->offset == 4 );
+            CHECK( search.Search().response == SearchInFile::Response::EndOfFile );
+            CHECK( search.Search().response == SearchInFile::Response::EndOfFile );
+        }
+        {   // the rest after a match is looked through first
+            auto fw = MakeFileWindow("two one");
+            auto search = SearchInFile{fw};
+            toggle(search, mode);
+            REQUIRE( search.Search().response == SearchInFile::Response::Found );
+            CHECK( search.Search().response == SearchInFile::Response::NotFound );
+            CHECK( search.Search().response == SearchInFile::Response::EndOfFile );
+        }
+    }
+}
+
 static FileWindow MakeFileWindow(std::string_view _data)
 {
     assert(_data.data() != nullptr);
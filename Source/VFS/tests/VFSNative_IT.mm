@@ -1,4 +1,4 @@
-// Copyright (C) 2020-2022 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2020-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Tests.h"
 #include "TestEnv.h"
 #include <Base/algo.h>
@@ -142,8 +142,9 @@ TEST_CASE(PREFIX "Fetching")
         return st.st_dev;
     }();
 
-    // spawn a bunch of regular files to ensure the batching mechanism can deal with the mass
-    for( size_t i = 0; i != 1000; ++i ) {
+    // spawn a bunch of regular files to ensure the batching mechanism can deal with the mass, enough to take several
+    // batches of getattrlistbulk() and several chunks of lstat()
+    for( size_t i = 0; i != 10000; ++i ) {
         auto filename = fmt::format("reg{}", i);
         REQUIRE(close(creat((test_dir / filename).c_str(), 0755)) == 0);
         to_visit.emplace(filename);
@@ -242,6 +243,29 @@ TEST_CASE(PREFIX "Fetching")
     CHECK(to_visit.empty());
 }
 
+TEST_CASE(PREFIX "CalculateDirectorySize")
+{
+    TestDir dir;
+    const auto host = TestEnv().vfs_native;
+    const auto root = dir.directory / "root";
+    std::filesystem::create_directories(root / "sub");
+    for( int i = 0; i < 1000; ++i )
+        std::ofstream(root / std::to_string(i)) << "12345";
+    std::ofstream(root / "sub" / "f") << "123";
+
+    SECTION("Sums the sizes of all files")
+    {
+        CHECK(host->CalculateDirectorySize(root.c_str(), {}) == 5003);
+    }
+    SECTION("Stops within a directory once cancelled")
+    {
+        int calls = 0;
+        const VFSCancelChecker checker = [&] { return ++calls > 10; };
+        CHECK(host->CalculateDirectorySize(root.c_str(), checker) == VFSError::Cancelled);
+        CHECK(calls == 11);
+    }
+}
+
 static int Execute(const std::string &_command)
 {
     using namespace boost::process;
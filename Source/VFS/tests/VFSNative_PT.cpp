@@ -0,0 +1,73 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#include "Tests.h"
+#include "TestEnv.h"
+#include "../source/Native/Fetching.h"
+#include <Base/algo.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// NB! disabled by default, include in the VFS tests target to enable
+
+using namespace nc::vfs;
+using namespace nc::vfs::native;
+
+#define PREFIX "VFSNative PT "
+
+static void MakeFiles(const std::filesystem::path &_directory, size_t _count)
+{
+    for( size_t i = 0; i < _count; ++i ) {
+        const auto path = _directory / ("file_with_a_moderately_long_name_" + std::to_string(i) + ".txt");
+        close(creat(path.c_str(), 0644));
+    }
+}
+
+static void PurgeDiskCache()
+{
+    // the same as running "purge", requires the privileges, silently does nothing otherwise
+    system("/usr/sbin/purge > /dev/null 2>&1");
+}
+
+TEST_CASE(PREFIX "Fetching a large directory", "[!benchmark]")
+{
+    TestDir test_dir_holder;
+    const std::filesystem::path directory = test_dir_holder.directory;
+    for( const size_t count : {1'000, 10'000, 100'000} ) {
+        const auto subdir = directory / std::to_string(count);
+        std::filesystem::create_directory(subdir);
+        MakeFiles(subdir, count);
+        const auto suffix = " - " + std::to_string(count) + " entries";
+
+        BENCHMARK("FetchDirectoryListing, first fetch" + suffix)
+        {
+            PurgeDiskCache();
+            VFSListingPtr listing;
+            TestEnv().vfs_native->FetchDirectoryListing(subdir.c_str(), listing, 0);
+            return listing;
+        };
+
+        BENCHMARK("FetchDirectoryListing, repeated fetch" + suffix)
+        {
+            VFSListingPtr listing;
+            TestEnv().vfs_native->FetchDirectoryListing(subdir.c_str(), listing, 0);
+            return listing;
+        };
+
+        const int fd = open(subdir.c_str(), O_RDONLY | O_NONBLOCK | O_DIRECTORY | O_CLOEXEC);
+        REQUIRE(fd >= 0);
+        auto close_fd = at_scope_end([fd] { close(fd); });
+        size_t fetched = 0;
+        const auto on_fetch = [&](size_t _fetched_now) { fetched += _fetched_now; };
+        const auto on_param = [&](const Fetching::CallbackParams &) {};
+
+        BENCHMARK("ReadDirAttributesBulk" + suffix)
+        {
+            lseek(fd, 0, SEEK_SET);
+            return Fetching::ReadDirAttributesBulk(fd, on_fetch, on_param);
+        };
+
+        BENCHMARK("ReadDirAttributesStat" + suffix)
+        {
+            return Fetching::ReadDirAttributesStat(fd, (subdir.native() + "/").c_str(), on_fetch, on_param);
+        };
+    }
+}
@@ -1,9 +1,9 @@
-// Copyright (C) 2014-2020 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "QLThumbnailsCache.h"
 #include <Cocoa/Cocoa.h>
-#include <Base/LRUCache.h>
+#include <Base/FlatLRUCache.h>
 #include <Base/spinlock.h>
 #include <Base/intrusive_ptr.h>
 #include <string>
@@ -63,7 +63,7 @@ private:
         std::atomic_flag is_in_work = {false}; // item is currenly updating its image
     };
     
-    using Container = base::LRUCache<Key, base::intrusive_ptr<Info>, m_CacheSize, KeyHash>;
+    using Container = base::FlatLRUCache<Key, base::intrusive_ptr<Info>, KeyHash>;
 
     NSImage *Produce(const std::string &_filename,
                      int _px_size,
@@ -1,9 +1,9 @@
-// Copyright (C) 2018-2019 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2018-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "QLVFSThumbnailsCache.h"
 #include <Utility/BriefOnDiskStorage.h>
-#include <Base/LRUCache.h>
+#include <Base/FlatLRUCache.h>
 #include <Base/spinlock.h>
 
 namespace nc::vfsicon {
@@ -30,7 +30,7 @@ private:
     // also, it's pretty inefficient in dealing with strings 
 
     enum { m_CacheSize = 1024 };    
-    using Container = base::LRUCache<std::string, NSImage*, m_CacheSize>;    
+    using Container = base::FlatLRUCache<std::string, NSImage*>;    
 
     NSImage *ProduceThumbnail(const std::string &_path,
                               const std::string &_ext,
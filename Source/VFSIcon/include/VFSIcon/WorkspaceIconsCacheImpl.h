@@ -1,9 +1,9 @@
-// Copyright (C) 2014-2020 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <optional>
 #include "WorkspaceIconsCache.h"
-#include <Base/LRUCache.h>
+#include <Base/FlatLRUCache.h>
 #include <Base/spinlock.h>
 #include <Base/intrusive_ptr.h>
 #include <Cocoa/Cocoa.h>
@@ -72,7 +72,7 @@ private:
         std::atomic_flag is_in_work = {false}; // item is currenly updating its image        
     };
     
-    using Container = base::LRUCache<std::string, base::intrusive_ptr<Info>, m_CacheSize>;    
+    using Container = base::FlatLRUCache<std::string, base::intrusive_ptr<Info>>;    
 
     NSImage *Produce(const std::string &_file_path,
                      std::optional<FileStateHint> _state_hint);    
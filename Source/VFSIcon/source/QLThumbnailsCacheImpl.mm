@@ -1,4 +1,4 @@
-// Copyright (C) 2014-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <VFSIcon/QLThumbnailsCacheImpl.h>
 #include <VFSIcon/Log.h>
 #include <Quartz/Quartz.h>
@@ -129,7 +129,9 @@ static NSImage *BuildRep(const std::string &_filename, int _px_size)
     return result;
 }
 
-QLThumbnailsCacheImpl::QLThumbnailsCacheImpl() = default;
+QLThumbnailsCacheImpl::QLThumbnailsCacheImpl() : m_Items(m_CacheSize)
+{
+}
 
 QLThumbnailsCacheImpl::~QLThumbnailsCacheImpl() = default;
 
@@ -149,9 +151,9 @@ QLThumbnailsCacheImpl::Produce(const std::string &_filename, int _px_size, const
     Log::Info(SPDLOC, "Produce(): request for '{}' ({}px)", _filename, _px_size);
     const auto temp_key = Key{std::string_view{_filename}, _px_size, Key::no_ownership};
     auto lock = std::unique_lock{m_ItemsLock};
-    if( m_Items.count(temp_key) ) { // O(1)
+    if( auto cached = m_Items.find(temp_key) ) { // O(1)
         Log::Debug(SPDLOC, "found a cached item for '{}' ({}px)", _filename, _px_size);
-        auto info = m_Items[temp_key]; // acquiring a copy of intrusive_ptr **by*value**! O(1)
+        auto info = *cached; // acquiring a copy of intrusive_ptr **by*value**!
         lock.unlock();
         assert(info != nullptr);
         CheckCacheAndUpdateIfNeeded(_filename, _px_size, *info, _hint);
@@ -253,9 +255,9 @@ NSImage *QLThumbnailsCacheImpl::ThumbnailIfHas(const std::string &_filename, int
     Log::Trace(SPDLOC, "ThumbnailIfHas(): called for '{}' ({}px)", _filename, _px_size);
     const auto temp_key = Key{std::string_view{_filename}, _px_size, Key::no_ownership};
     auto lock = std::lock_guard{m_ItemsLock};
-    if( m_Items.count(temp_key) != 0 ) { // O(1)
+    if( auto cached = m_Items.find(temp_key) ) { // O(1)
         Log::Trace(SPDLOC, "ThumbnailIfHas(): found a cached entry for '{}' ({}px)", _filename, _px_size);
-        auto &info = m_Items[temp_key]; // O(1)
+        auto &info = *cached;
         assert(info != nullptr);
         return info->image;
     }
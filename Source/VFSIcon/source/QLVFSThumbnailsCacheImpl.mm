@@ -1,4 +1,4 @@
-// Copyright (C) 2018-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2018-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <VFSIcon/QLVFSThumbnailsCacheImpl.h>
 #include <Quartz/Quartz.h>
 #include <filesystem>
@@ -10,7 +10,7 @@ static std::optional<std::vector<uint8_t>> ReadEntireFile(const std::string &_pa
 
 QLVFSThumbnailsCacheImpl::QLVFSThumbnailsCacheImpl(
     const std::shared_ptr<utility::BriefOnDiskStorage> &_temp_storage)
-    : m_TempStorage(_temp_storage)
+    : m_Thumbnails(m_CacheSize), m_TempStorage(_temp_storage)
 {
 }
 
@@ -26,8 +26,8 @@ NSImage *QLVFSThumbnailsCacheImpl::ThumbnailIfHas(const std::string &_file_path,
 
     {
         auto lock = std::lock_guard{m_Lock};
-        if( m_Thumbnails.count(key) )
-            return m_Thumbnails.at(key);
+        if( auto cached = m_Thumbnails.find(key) )
+            return *cached;
     }
 
     return nil;
@@ -41,8 +41,8 @@ NSImage *QLVFSThumbnailsCacheImpl::ProduceThumbnail(const std::string &_file_pat
 
     {
         auto lock = std::lock_guard{m_Lock};
-        if( m_Thumbnails.count(key) )
-            return m_Thumbnails.at(key);
+        if( auto cached = m_Thumbnails.find(key) )
+            return *cached;
     }
 
     auto image = ProduceThumbnail(_file_path,
@@ -1,4 +1,4 @@
-// Copyright (C) 2018-2023 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2018-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <VFSIcon/VFSBundleIconsCacheImpl.h>
 #include <Utility/ObjCpp.h>
 
@@ -10,7 +10,7 @@ static NSData *ToTempNSData(const std::optional<std::vector<uint8_t>> &_data);
 static NSImage *ReadImageFromFile(const std::string &_path, VFSHost &_host);
 static std::optional<std::vector<uint8_t>> ReadEntireFile(const std::string &_path, VFSHost &_host);
 
-VFSBundleIconsCacheImpl::VFSBundleIconsCacheImpl()
+VFSBundleIconsCacheImpl::VFSBundleIconsCacheImpl() : m_Icons(m_CacheSize)
 {
 }
 
@@ -24,8 +24,8 @@ NSImage *VFSBundleIconsCacheImpl::IconIfHas(const std::string &_file_path, VFSHo
 
     {
         auto lock = std::lock_guard{m_Lock};
-        if( m_Icons.count(key) )
-            return m_Icons.at(key);
+        if( auto cached = m_Icons.find(key) )
+            return *cached;
     }
 
     return nil;
@@ -37,8 +37,8 @@ NSImage *VFSBundleIconsCacheImpl::ProduceIcon(const std::string &_file_path, VFS
 
     {
         auto lock = std::lock_guard{m_Lock};
-        if( m_Icons.count(key) )
-            return m_Icons.at(key);
+        if( auto cached = m_Icons.find(key) )
+            return *cached;
     }
 
     auto image = ProduceBundleIcon(_file_path, _host);
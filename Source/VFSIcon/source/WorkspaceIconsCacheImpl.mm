@@ -1,4 +1,4 @@
-// Copyright (C) 2014-2022 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2014-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include <VFSIcon/WorkspaceIconsCacheImpl.h>
 #include <VFSIcon/Log.h>
 #include <sys/stat.h>
@@ -9,7 +9,7 @@
 namespace nc::vfsicon {
 
 WorkspaceIconsCacheImpl::WorkspaceIconsCacheImpl(FileStateReader &_file_state_reader, IconBuilder &_icon_builder)
-    : m_FileStateReader(_file_state_reader), m_IconBuilder(_icon_builder)
+    : m_Items(m_CacheSize), m_FileStateReader(_file_state_reader), m_IconBuilder(_icon_builder)
 {
 }
 
@@ -19,8 +19,8 @@ NSImage *WorkspaceIconsCacheImpl::IconIfHas(const std::string &_file_path)
 {
     Log::Trace(SPDLOC, "IconIfHas() called for '{}'", _file_path);
     auto lock = std::lock_guard{m_ItemsLock};
-    if( m_Items.count(_file_path) != 0 ) { // O(1)
-        auto &info = m_Items[_file_path];  // O(1)
+    if( auto cached = m_Items.find(_file_path) ) { // O(1)
+        auto &info = *cached;
         assert(info != nullptr);
         Log::Trace(SPDLOC, "found, image={}", objc_bridge_cast<void>(info->image));
         return info->image;
@@ -33,8 +33,8 @@ NSImage *WorkspaceIconsCacheImpl::ProduceIcon(const std::string &_file_path)
 {
     Log::Trace(SPDLOC, "ProduceIcon() called for '{}'", _file_path);
     auto lock = std::unique_lock{m_ItemsLock};
-    if( m_Items.count(_file_path) ) {    // O(1)
-        auto info = m_Items[_file_path]; // acquiring a copy of intrusive_ptr **by*value**! O(1)
+    if( auto cached = m_Items.find(_file_path) ) { // O(1)
+        auto info = *cached; // acquiring a copy of intrusive_ptr **by*value**!
         lock.unlock();
         assert(info != nullptr);
         Log::Trace(SPDLOC, "found, image={}", objc_bridge_cast<void>(info->image));
@@ -1,13 +1,21 @@
-// Copyright (C) 2019-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include "TextModeWorkingSet.h"
 #include "TextProcessing.h"
 #include "TextModeIndexedTextLine.h"
 #include <Utility/FontExtras.h>
+#include <functional>
+#include <memory>
 
 namespace nc::viewer {
 
+/**
+ * Lines of a working set laid out for drawing.
+ * The line breaks are calculated upfront, while the CTLines and their widths are built lazily, in chunks of lines, in
+ * a background queue which is started upon the construction. A line can be drawn once IsLaidOut() says so, everything
+ * which depends on the CTLine of a line or on its width lays it out synchronously if it's not ready yet.
+ */
 class TextModeFrame
 {
 public:
@@ -18,6 +26,11 @@ public:
         CTFontRef font = nullptr;
         nc::utility::FontGeometryInfo font_info;
         CGColorRef foreground_color = nullptr;
+
+        /**
+         * Is called each time another chunk of lines has been laid out, usually from a background thread.
+         */
+        std::function<void()> on_lines_laid_out;
     };
 
     TextModeFrame(const Source &_source);
@@ -32,8 +45,33 @@ public:
     /** Returns the number of IndexedTextLine lines in the frame. */
     int LinesNumber() const noexcept;
     const TextModeIndexedTextLine &Line(int _index) const;
+
+    /**
+     * Checks whether the CTLine and the width of the line are ready. Doesn't block.
+     */
+    bool IsLaidOut(int _index) const noexcept;
+
+    /**
+     * Synchronously lays out the lines in [_first, _last) which are not laid out yet.
+     * The range is clamped to the existing lines.
+     */
+    void LayOut(int _first, int _last) const;
+
+    /**
+     * Asks the background queue to lay out the lines in [_first, _last) ahead of the others.
+     * The range is clamped to the existing lines.
+     */
+    void PrioritizeLayout(int _first, int _last) const;
+
+    /**
+     * Returns the width of the line, laying it out first if needed.
+     */
     double LineWidth(int _index) const;
-    CGSize Bounds() const noexcept;
+
+    /**
+     * The width of the frame is known only once all lines are laid out, so this waits for that.
+     */
+    CGSize Bounds() const;
 
     /**
      * Returns an index of a character which corresponds to the pixel specified by _position.
@@ -79,37 +117,37 @@ public:
     const nc::utility::FontGeometryInfo &FontGeometryInfo() const noexcept;
 
 private:
+    // The lines along with the state of their layout, shared with the background jobs which can outlive the frame
+    struct Layout;
+
+    void CancelLayout() noexcept;
+
     std::shared_ptr<const TextModeWorkingSet> m_WorkingSet;
-    std::vector<TextModeIndexedTextLine> m_Lines;
-    std::vector<float> m_LinesWidths;
+    std::shared_ptr<Layout> m_Layout;
+    const std::vector<TextModeIndexedTextLine> *m_Lines = nullptr; // owned by m_Layout
     nc::utility::FontGeometryInfo m_FontInfo;
-    CGSize m_Bounds;
+    double m_Height = 0.;
     double m_WrappingWidth = 0.;
 };
 
 inline const std::vector<TextModeIndexedTextLine> &TextModeFrame::Lines() const noexcept
 {
-    return m_Lines;
+    return *m_Lines;
 }
 
 inline bool TextModeFrame::Empty() const noexcept
 {
-    return m_Lines.empty();
+    return m_Lines->empty();
 }
 
 inline int TextModeFrame::LinesNumber() const noexcept
 {
-    return static_cast<int>(m_Lines.size());
+    return static_cast<int>(m_Lines->size());
 }
 
 inline const TextModeIndexedTextLine &TextModeFrame::Line(int _index) const
 {
-    return m_Lines.at(_index);
-}
-
-inline double TextModeFrame::LineWidth(int _index) const
-{
-    return m_LinesWidths.at(_index);
+    return m_Lines->at(_index);
 }
 
 inline double TextModeFrame::WrappingWidth() const noexcept
@@ -127,9 +165,4 @@ inline const nc::utility::FontGeometryInfo &TextModeFrame::FontGeometryInfo() co
     return m_FontInfo;
 }
 
-inline CGSize TextModeFrame::Bounds() const noexcept
-{
-    return m_Bounds;
-}
-
 }
@@ -1,10 +1,12 @@
-// Copyright (C) 2019 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <CoreText/CoreText.h>
 
 namespace nc::viewer {
-    
+
+class TextModeFrame;
+
 class TextModeIndexedTextLine
 {
 public:
@@ -28,12 +30,17 @@ public:
     int BytesStart() const noexcept;
     int BytesLen() const noexcept;
     int BytesEnd() const noexcept;
+    /**
+     * Can be nullptr when the line hasn't been laid out yet, see TextModeFrame::IsLaidOut().
+     */
     CTLineRef Line() const noexcept;
     
     bool UniCharInside( int _unichar_index ) const noexcept;
     bool ByteInside( int _byte_index ) const noexcept;
     
 private:
+    friend class TextModeFrame; // lays out the lines lazily
+    
     /**
      * Index of a first unichar of this line whithin a string.
      */
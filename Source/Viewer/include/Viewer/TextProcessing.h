@@ -1,4 +1,4 @@
-// Copyright (C) 2019-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #pragma once
 
 #include <vector>
@@ -24,6 +24,8 @@ CTParagraphStyleRef CreateParagraphStyleWithRegularTabs(double _tab_width);
 
 /**
  * Returns a vector of pairs, each pair is (begin_index, chars_length)
+ * Long strings are split in parallel, in chunks starting right after the hard breaks, since the wrapping restarts there.
+ * The result is the same as if the string was split serially.
  */
 std::vector<std::pair<int, int>> SplitStringIntoLines(const char16_t *_characters,
                                                       int _characters_number,
@@ -2,24 +2,59 @@
 #include "TextModeFrame.h"
 #include <Base/algo.h>
 #include <Base/dispatch_cpp.h>
+#include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <mutex>
+#include <stdexcept>
 
 namespace nc::viewer {
 
-static void CalculateLinesWidths(const TextModeIndexedTextLine *_lines_begin,
-                                 const TextModeIndexedTextLine *_lines_end,
-                                 float *_widths);
+// a chunk of lines is laid out in one go, it ends once either of the limits is reached
+static constexpr int g_ChunkMaxLines = 1024;
+static constexpr int g_ChunkMaxCharacters = 64 * 1024;
+
+struct TextModeFrame::Layout {
+    struct Chunk {
+        int first_line = 0;
+        int last_line = 0;
+        std::once_flag once;
+        std::atomic_bool laid_out{false};
+        std::atomic_bool prioritized{false};
+        float max_width = 0.f; // valid once laid out
+    };
+
+    ~Layout();
+    CTTypesetterRef Typesetter();
+    size_t ChunkOfLine(int _line) const noexcept;
+    void LayOutChunk(size_t _chunk);
+    void LayOutChunks(size_t _first, size_t _last);
+
+    std::shared_ptr<const TextModeWorkingSet> working_set; // keeps the characters alive while there are CTLines
+    CFAttributedStringRef attributed_string = nullptr;     // released once the typesetter is created
+    std::once_flag typesetter_once;
+    CTTypesetterRef typesetter = nullptr;
+    std::vector<TextModeIndexedTextLine> lines;
+    std::vector<float> widths;
+    std::unique_ptr<Chunk[]> chunks;
+    size_t chunks_number = 0;
+    std::once_flag width_once;
+    float width = 0.f;
+    std::atomic_bool cancelled{false};
+    std::function<void()> on_laid_out;
+};
 
 TextModeFrame::TextModeFrame(const Source &_source)
-    : m_WorkingSet{_source.working_set}, m_FontInfo{_source.font_info}, m_WrappingWidth{_source.wrapping_width}
+    : m_WorkingSet{_source.working_set}, m_Layout{std::make_shared<Layout>()}, m_FontInfo{_source.font_info},
+      m_WrappingWidth{_source.wrapping_width}
 {
     assert(m_WorkingSet != nullptr);
+    assert(m_WrappingWidth > 0.);
 
     const auto monospace_width = _source.font_info.PreciseMonospaceWidth();
     const auto tab_width = _source.tab_spaces * monospace_width;
 
     auto attr_string = CFAttributedStringCreateMutable(kCFAllocatorDefault, 0);
-    auto release_attr_string = at_scope_end([&] { CFRelease(attr_string); });
 
     const auto pstyle = CreateParagraphStyleWithRegularTabs(tab_width);
     const auto release_pstyle = at_scope_end([&] { CFRelease(pstyle); });
@@ -30,25 +65,135 @@ TextModeFrame::TextModeFrame(const Source &_source)
     CFAttributedStringSetAttribute(attr_string, full_range, kCTFontAttributeName, _source.font);
     CFAttributedStringSetAttribute(attr_string, full_range, kCTParagraphStyleAttributeName, pstyle);
 
-    m_Lines = SplitAttributedStringsIntoLines(
-        attr_string, _source.wrapping_width, monospace_width, tab_width, m_WorkingSet->CharactersByteOffsets());
+    auto &layout = *m_Layout;
+    layout.working_set = m_WorkingSet;
+    layout.attributed_string = attr_string;
+    layout.on_laid_out = _source.on_lines_laid_out;
+
+    // the line breaks are needed right away, while building the CTLines is deferred
+    const auto starts_and_lengths = SplitStringIntoLines(
+        m_WorkingSet->Characters(), m_WorkingSet->Length(), m_WrappingWidth, monospace_width, tab_width);
+    const auto bytes_offsets = m_WorkingSet->CharactersByteOffsets();
+    layout.lines.reserve(starts_and_lengths.size());
+    for( const auto &position : starts_and_lengths )
+        layout.lines.emplace_back(position.first,
+                                  position.second,
+                                  bytes_offsets[position.first],
+                                  bytes_offsets[position.first + position.second] - bytes_offsets[position.first],
+                                  nullptr);
+    layout.widths.resize(layout.lines.size());
+
+    std::vector<int> chunks_starts;
+    for( int line = 0, characters = 0; line < static_cast<int>(layout.lines.size()); ++line ) {
+        if( chunks_starts.empty() || line - chunks_starts.back() == g_ChunkMaxLines ||
+            characters >= g_ChunkMaxCharacters ) {
+            chunks_starts.push_back(line);
+            characters = 0;
+        }
+        characters += layout.lines[line].UniCharsLen();
+    }
+    layout.chunks_number = chunks_starts.size();
+    layout.chunks = std::make_unique<Layout::Chunk[]>(layout.chunks_number);
+    for( size_t n = 0; n < layout.chunks_number; ++n ) {
+        layout.chunks[n].first_line = chunks_starts[n];
+        layout.chunks[n].last_line =
+            n + 1 < layout.chunks_number ? chunks_starts[n + 1] : static_cast<int>(layout.lines.size());
+    }
 
-    m_LinesWidths.resize(m_Lines.size());
-    CalculateLinesWidths(m_Lines.data(), m_Lines.data() + m_Lines.size(), m_LinesWidths.data());
+    m_Lines = &layout.lines;
+    m_Height = m_FontInfo.LineHeight() * static_cast<double>(layout.lines.size());
 
-    const auto width = m_LinesWidths.empty() ? 0.f : *std::max_element(m_LinesWidths.begin(), m_LinesWidths.end());
-    const auto height = m_FontInfo.LineHeight() * static_cast<double>(m_Lines.size());
-    m_Bounds = CGSizeMake(std::min(static_cast<double>(width), m_WrappingWidth), height);
+    if( layout.chunks_number != 0 ) {
+        dispatch_to_default([layout = m_Layout] { layout->LayOutChunks(0, layout->chunks_number); });
+    }
 }
 
 TextModeFrame::TextModeFrame(TextModeFrame &&) noexcept = default;
 
 TextModeFrame::~TextModeFrame()
 {
-    m_Lines.clear(); // be sure to remove CTLines before removing the reference to the working set
+    CancelLayout();
 }
 
-TextModeFrame &TextModeFrame::operator=(TextModeFrame &&) noexcept = default;
+TextModeFrame &TextModeFrame::operator=(TextModeFrame &&_rhs) noexcept
+{
+    if( this != &_rhs ) {
+        CancelLayout();
+        m_WorkingSet = std::move(_rhs.m_WorkingSet);
+        m_Layout = std::move(_rhs.m_Layout);
+        m_Lines = _rhs.m_Lines;
+        m_FontInfo = _rhs.m_FontInfo;
+        m_Height = _rhs.m_Height;
+        m_WrappingWidth = _rhs.m_WrappingWidth;
+    }
+    return *this;
+}
+
+void TextModeFrame::CancelLayout() noexcept
+{
+    // the background jobs which are still running will skip the chunks they haven't started yet
+    if( m_Layout )
+        m_Layout->cancelled = true;
+}
+
+bool TextModeFrame::IsLaidOut(int _index) const noexcept
+{
+    if( _index < 0 || _index >= LinesNumber() )
+        return false;
+    return m_Layout->chunks[m_Layout->ChunkOfLine(_index)].laid_out.load(std::memory_order_acquire);
+}
+
+void TextModeFrame::LayOut(int _first, int _last) const
+{
+    _first = std::max(_first, 0);
+    _last = std::min(_last, LinesNumber());
+    if( _first >= _last )
+        return;
+    m_Layout->LayOutChunks(m_Layout->ChunkOfLine(_first), m_Layout->ChunkOfLine(_last - 1) + 1);
+}
+
+void TextModeFrame::PrioritizeLayout(int _first, int _last) const
+{
+    _first = std::max(_first, 0);
+    _last = std::min(_last, LinesNumber());
+    if( _first >= _last )
+        return;
+    const auto first_chunk = m_Layout->ChunkOfLine(_first);
+    const auto last_chunk = m_Layout->ChunkOfLine(_last - 1) + 1;
+    std::vector<size_t> chunks;
+    for( size_t n = first_chunk; n < last_chunk; ++n )
+        if( !m_Layout->chunks[n].laid_out && !m_Layout->chunks[n].prioritized.exchange(true) )
+            chunks.push_back(n);
+    if( chunks.empty() )
+        return;
+
+    const auto queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_HIGH, 0);
+    dispatch_async(queue, [queue, layout = m_Layout, chunks = std::move(chunks)] {
+        dispatch_apply(chunks.size(), queue, [&](size_t n) {
+            if( !layout->cancelled )
+                layout->LayOutChunk(chunks[n]);
+        });
+    });
+}
+
+double TextModeFrame::LineWidth(int _index) const
+{
+    if( _index < 0 || _index >= LinesNumber() )
+        throw std::out_of_range("TextModeFrame::LineWidth: invalid index");
+    LayOut(_index, _index + 1);
+    return m_Layout->widths[_index];
+}
+
+CGSize TextModeFrame::Bounds() const
+{
+    auto &layout = *m_Layout;
+    std::call_once(layout.width_once, [&] {
+        layout.LayOutChunks(0, layout.chunks_number);
+        for( size_t n = 0; n < layout.chunks_number; ++n )
+            layout.width = std::max(layout.width, layout.chunks[n].max_width);
+    });
+    return CGSizeMake(std::min(static_cast<double>(layout.width), m_WrappingWidth), m_Height);
+}
 
 int TextModeFrame::CharIndexForPosition(CGPoint _position) const
 {
@@ -58,6 +203,7 @@ int TextModeFrame::CharIndexForPosition(CGPoint _position) const
     if( line_index >= LinesNumber() )
         return m_WorkingSet->Length();
 
+    LayOut(line_index, line_index + 1);
     const auto &line = Line(line_index);
     const auto char_index =
         static_cast<int>(CTLineGetStringIndexForPosition(line.Line(), CGPointMake(_position.x, 0.)));
@@ -88,14 +234,67 @@ int TextModeFrame::LineIndexForPosition(CGPoint _position) const
     return line_index;
 }
 
-static void CalculateLinesWidths(const TextModeIndexedTextLine *_lines_begin,
-                                 const TextModeIndexedTextLine *_lines_end,
-                                 float *_widths)
+TextModeFrame::Layout::~Layout()
 {
-    const auto block = [&](size_t n) {
-        _widths[n] = static_cast<float>(CTLineGetTypographicBounds(_lines_begin[n].Line(), nullptr, nullptr, nullptr));
-    };
-    dispatch_apply(_lines_end - _lines_begin, dispatch_get_global_queue(0, 0), block);
+    lines.clear(); // be sure to remove CTLines before removing the reference to the working set
+    if( typesetter != nullptr )
+        CFRelease(typesetter);
+    if( attributed_string != nullptr )
+        CFRelease(attributed_string);
+}
+
+CTTypesetterRef TextModeFrame::Layout::Typesetter()
+{
+    std::call_once(typesetter_once, [this] {
+        typesetter = CTTypesetterCreateWithAttributedString(attributed_string);
+        CFRelease(attributed_string);
+        attributed_string = nullptr;
+    });
+    return typesetter;
+}
+
+size_t TextModeFrame::Layout::ChunkOfLine(int _line) const noexcept
+{
+    assert(_line >= 0 && _line < static_cast<int>(lines.size()));
+    const auto chunk = std::upper_bound(chunks.get(),
+                                        chunks.get() + chunks_number,
+                                        _line,
+                                        [](int _value, const Chunk &_chunk) { return _value < _chunk.first_line; });
+    return static_cast<size_t>(chunk - chunks.get()) - 1;
+}
+
+void TextModeFrame::Layout::LayOutChunk(size_t _chunk)
+{
+    auto &chunk = chunks[_chunk];
+    bool has_laid_out = false;
+    std::call_once(chunk.once, [&] {
+        const auto typesetter = Typesetter();
+        float max_width = 0.f;
+        for( int n = chunk.first_line; n < chunk.last_line; ++n ) {
+            auto &line = lines[n];
+            line.m_Line = CTTypesetterCreateLine(typesetter, CFRangeMake(line.UniCharsStart(), line.UniCharsLen()));
+            widths[n] = static_cast<float>(CTLineGetTypographicBounds(line.m_Line, nullptr, nullptr, nullptr));
+            max_width = std::max(max_width, widths[n]);
+        }
+        chunk.max_width = max_width;
+        chunk.laid_out.store(true, std::memory_order_release);
+        has_laid_out = true;
+    });
+    if( has_laid_out && on_laid_out )
+        on_laid_out();
+}
+
+void TextModeFrame::Layout::LayOutChunks(size_t _first, size_t _last)
+{
+    if( _last - _first == 1 ) {
+        LayOutChunk(_first);
+        return;
+    }
+    // the chunks are independent, so build them in multiple threads since it can be time-consuming
+    dispatch_apply(_last - _first, dispatch_get_global_queue(0, 0), [&](size_t n) {
+        if( !cancelled )
+            LayOutChunk(_first + n);
+    });
 }
 
 } // namespace nc::viewer
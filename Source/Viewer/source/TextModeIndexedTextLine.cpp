@@ -1,4 +1,4 @@
-// Copyright (C) 2019-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "TextModeIndexedTextLine.h"
 #include <algorithm>
 
@@ -22,7 +22,8 @@ TextModeIndexedTextLine::TextModeIndexedTextLine(const TextModeIndexedTextLine &
     : m_UniCharsStart(_rhs.m_UniCharsStart), m_UniCharsLen(_rhs.m_UniCharsLen),
       m_BytesStart(_rhs.m_BytesStart), m_BytesLen(_rhs.m_BytesLen), m_Line(_rhs.m_Line)
 {
-    CFRetain(m_Line);
+    if( m_Line != nullptr )
+        CFRetain(m_Line);
 }
 
 TextModeIndexedTextLine::TextModeIndexedTextLine(TextModeIndexedTextLine &&_rhs) noexcept
@@ -54,7 +55,8 @@ TextModeIndexedTextLine::operator=(const TextModeIndexedTextLine &_rhs) noexcept
     m_BytesStart = _rhs.m_BytesStart;
     m_BytesLen = _rhs.m_BytesLen;
     m_Line = _rhs.m_Line;
-    CFRetain(m_Line);
+    if( m_Line != nullptr )
+        CFRetain(m_Line);
     return *this;
 }
 
@@ -4,6 +4,7 @@
 #include "TextModeIndexedTextLine.h"
 #include "TextModeWorkingSet.h"
 #include "TextModeFrame.h"
+#include <Base/dispatch_cpp.h>
 
 #include <cmath>
 #include <iostream>
@@ -70,6 +71,7 @@ static double CalculateVerticalPxPositionFromScrollPosition(const TextModeFrame
     CGPoint m_PxOffset;          // smooth offset in pixels
 
     NSScroller *m_VerticalScroller;
+    bool m_AwaitsLayout; // some visible lines were drawn as placeholders
 }
 
 @synthesize delegate;
@@ -89,6 +91,7 @@ static double CalculateVerticalPxPositionFromScrollPosition(const TextModeFrame
         m_VerticalLineOffset = 0;
         m_HorizontalCharsOffset = 0;
         m_PxOffset = CGPointMake(0., 0.);
+        m_AwaitsLayout = false;
 
         m_VerticalScroller = [[NSScroller alloc] initWithFrame:NSMakeRect(0, 0, 15, 100)];
         m_VerticalScroller.enabled = true;
@@ -186,9 +189,22 @@ static double CalculateVerticalPxPositionFromScrollPosition(const TextModeFrame
     source.foreground_color = m_Theme->TextColor().CGColor;
     source.tab_spaces = g_TabSpaces;
     source.working_set = m_WorkingSet;
+    __weak NCViewerTextModeView *weak_self = self;
+    source.on_lines_laid_out = [weak_self] {
+        dispatch_to_main_queue([weak_self] {
+            if( NCViewerTextModeView *strong_self = weak_self )
+                [strong_self linesDidLayOut];
+        });
+    };
     return std::make_shared<TextModeFrame>(source);
 }
 
+- (void)linesDidLayOut
+{
+    if( m_AwaitsLayout )
+        [self setNeedsDisplay:true];
+}
+
 /**
  * Returns local view coordinates of the left-top corner of text.
  * Does move on both vertical and horizontal movement.
@@ -265,12 +281,25 @@ static double CalculateVerticalPxPositionFromScrollPosition(const TextModeFrame
     auto line_pos = CGPointMake(origin.x, origin.y + lines_start * m_FontInfo.LineHeight());
 
     const auto selection = [self localSelection];
+    bool awaits_layout = false;
 
     for( int line_no = lines_start; line_no < lines_end;
          ++line_no, line_pos.y += m_FontInfo.LineHeight() ) {
         if( line_no < 0 || line_no >= m_Frame->LinesNumber() )
             continue;
         auto &line = m_Frame->Line(line_no);
+
+        // the line is still being laid out in background - draw a placeholder of its approximate width instead
+        if( !m_Frame->IsLaidOut(line_no) ) {
+            const auto width = std::min(line.UniCharsLen() * m_FontInfo.PreciseMonospaceWidth(), view_width);
+            CGContextSetFillColorWithColor(context, [m_Theme->TextColor() colorWithAlphaComponent:0.1].CGColor);
+            CGContextFillRect(
+                context,
+                CGRectMake(line_pos.x, line_pos.y + m_FontInfo.LineHeight() / 4., width, m_FontInfo.LineHeight() / 2.));
+            awaits_layout = true;
+            continue;
+        }
+
         const auto text_origin =
             CGPointMake(line_pos.x, line_pos.y + m_FontInfo.LineHeight() - m_FontInfo.Descent());
 
@@ -311,6 +340,10 @@ static double CalculateVerticalPxPositionFromScrollPosition(const TextModeFrame
         CGContextSetTextPosition(context, text_origin.x, text_origin.y);
         CTLineDraw(line.Line(), context);
     }
+
+    m_AwaitsLayout = awaits_layout;
+    if( awaits_layout )
+        m_Frame->PrioritizeLayout(lines_start, lines_end);
 }
 
 - (void)drawFocusRingMask
@@ -1,4 +1,4 @@
-// Copyright (C) 2019-2021 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "TextProcessing.h"
 #include "TextModeIndexedTextLine.h"
 
@@ -84,18 +84,26 @@ CTParagraphStyleRef CreateParagraphStyleWithRegularTabs(double _tab_width)
     return CTParagraphStyleCreate(settings, 2);
 }
 
-std::vector<std::pair<int, int>> SplitStringIntoLines(const char16_t *_characters,
-                                                      int _characters_number,
-                                                      double _wrapping_width,
-                                                      double _monospace_width,
-                                                      double _tab_width)
+// amount of characters in a chunk of a string split in parallel
+static constexpr int g_SplitChunkLength = 256 * 1024;
+
+static bool IsHardbreak(char16_t c) noexcept
+{
+    return c == 0xA || c == 0xD; // more???
+}
+
+// appends the lines of [_characters, _characters + _characters_number) to _starts_and_lengths, _offset is added to the
+// starts of the lines
+static void SplitStringIntoLinesSerially(const char16_t *_characters,
+                                         int _characters_number,
+                                         int _offset,
+                                         double _wrapping_width,
+                                         double _monospace_width,
+                                         double _tab_width,
+                                         std::vector<std::pair<int, int>> &_starts_and_lengths)
 {
     const auto wrapping_epsilon = 0.2;
-    const auto is_hardbreak = [](char16_t c) -> bool {
-        return c == 0xA || c == 0xD; // more???
-    };
 
-    std::vector<std::pair<int, int>> starts_and_lengths;
     int start = 0;
     while( start < _characters_number ) {
         // 1st - manual hack for breaking lines by space characters
@@ -104,7 +112,7 @@ std::vector<std::pair<int, int>> SplitStringIntoLines(const char16_t *_character
         double width = 0.;
         for( int i = start; i < _characters_number; ++i ) {
             const auto c = _characters[i];
-            if( is_hardbreak(c) ) {
+            if( IsHardbreak(c) ) {
                 count++;
                 break;
             }
@@ -135,9 +143,60 @@ std::vector<std::pair<int, int>> SplitStringIntoLines(const char16_t *_character
         }
 
         // Use the returned character count (to the break) to create the line.
-        starts_and_lengths.emplace_back(start, count);
+        _starts_and_lengths.emplace_back(_offset + start, count);
         start += count;
     }
+}
+
+std::vector<std::pair<int, int>> SplitStringIntoLines(const char16_t *_characters,
+                                                      int _characters_number,
+                                                      double _wrapping_width,
+                                                      double _monospace_width,
+                                                      double _tab_width)
+{
+    std::vector<std::pair<int, int>> starts_and_lengths;
+    if( _characters_number < 2 * g_SplitChunkLength ) {
+        SplitStringIntoLinesSerially(_characters,
+                                     _characters_number,
+                                     0,
+                                     _wrapping_width,
+                                     _monospace_width,
+                                     _tab_width,
+                                     starts_and_lengths);
+        return starts_and_lengths;
+    }
+
+    // each chunk starts right after a hard break, a paragraph without hard breaks stays in a single chunk
+    std::vector<int> chunks_starts{0};
+    const auto characters_end = _characters + _characters_number;
+    for( int position = g_SplitChunkLength; position < _characters_number;
+         position = chunks_starts.back() + g_SplitChunkLength ) {
+        const auto hardbreak = std::find_if(_characters + position, characters_end, IsHardbreak);
+        if( hardbreak + 1 >= characters_end )
+            break;
+        chunks_starts.push_back(static_cast<int>(hardbreak + 1 - _characters));
+    }
+    chunks_starts.push_back(_characters_number);
+
+    std::vector<std::vector<std::pair<int, int>>> chunks(chunks_starts.size() - 1);
+    const auto block = [&](size_t n) {
+        chunks[n].reserve((chunks_starts[n + 1] - chunks_starts[n]) / 32);
+        SplitStringIntoLinesSerially(_characters + chunks_starts[n],
+                                     chunks_starts[n + 1] - chunks_starts[n],
+                                     chunks_starts[n],
+                                     _wrapping_width,
+                                     _monospace_width,
+                                     _tab_width,
+                                     chunks[n]);
+    };
+    dispatch_apply(chunks.size(), dispatch_get_global_queue(0, 0), block);
+
+    size_t total = 0;
+    for( const auto &chunk : chunks )
+        total += chunk.size();
+    starts_and_lengths.reserve(total);
+    for( const auto &chunk : chunks )
+        starts_and_lengths.insert(starts_and_lengths.end(), chunk.begin(), chunk.end());
     return starts_and_lengths;
 }
 
@@ -19,6 +19,7 @@ using namespace nc::viewer;
 static const auto g_ConfigRespectComAppleTextEncoding = "viewer.respectComAppleTextEncoding";
 static const auto g_ConfigSearchCaseSensitive = "viewer.searchCaseSensitive";
 static const auto g_ConfigSearchForWholePhrase = "viewer.searchForWholePhrase";
+static const auto g_ConfigSearchForHexBytes = "viewer.searchForHexBytes";
 static const auto g_ConfigWindowSize = "viewer.fileWindowSize";
 static const auto g_ConfigAutomaticRefresh = "viewer.automaticRefresh";
 static const auto g_AutomaticRefreshDelay = std::chrono::milliseconds(200);
@@ -93,6 +94,7 @@ struct BackgroundFileOpener {
     std::shared_ptr<nc::vfs::FileWindow> m_SearchFileWindow;
     std::shared_ptr<nc::vfs::SearchInFile> m_SearchInFile;
     nc::base::SerialQueue m_SearchInFileQueue;
+    NSString *m_BytesSearchRequest; // the hex pattern being searched for in hex mode, nil for text search
     nc::viewer::History *m_History;
     nc::config::Config *m_Config;
     std::function<nc::utility::ActionShortcut(std::string_view _name)> m_Shortcuts;
@@ -163,6 +165,7 @@ struct BackgroundFileOpener {
 
     [m_View detachFromFile];
     m_SearchInFile.reset();
+    m_BytesSearchRequest = nil;
     m_ViewerFileWindow.reset();
     m_SearchFileWindow.reset();
     m_WorkFile.reset();
@@ -200,6 +203,7 @@ struct BackgroundFileOpener {
     m_ViewerFileWindow = std::move(opener.viewer_file_window);
     m_SearchFileWindow = std::move(opener.search_file_window);
     m_SearchInFile = std::move(opener.search_in_file);
+    m_BytesSearchRequest = nil;
     m_GlobalFilePath = m_WorkFile->ComposeVerbosePath();
 
     [self buildTitle];
@@ -344,17 +348,26 @@ struct BackgroundFileOpener {
     item.target = self;
     [menu insertItem:item atIndex:1];
 
+    item = [[NSMenuItem alloc]
+        initWithTitle:NSLocalizedString(@"Search for hex bytes",
+                                        "Menu item option in internal viewer search")
+               action:@selector(onSearchFieldMenuHexBytesSearch:)
+        keyEquivalent:@""];
+    item.state = m_Config->GetBool(g_ConfigSearchForHexBytes);
+    item.target = self;
+    [menu insertItem:item atIndex:2];
+
     item = [[NSMenuItem alloc]
         initWithTitle:NSLocalizedString(@"Clear Recents",
                                         "Menu item title in internal viewer search")
                action:NULL
         keyEquivalent:@""];
     item.tag = NSSearchFieldClearRecentsMenuItemTag;
-    [menu insertItem:item atIndex:2];
+    [menu insertItem:item atIndex:3];
 
     item = [NSMenuItem separatorItem];
     item.tag = NSSearchFieldRecentsTitleMenuItemTag;
-    [menu insertItem:item atIndex:3];
+    [menu insertItem:item atIndex:4];
 
     item = [[NSMenuItem alloc]
         initWithTitle:NSLocalizedString(@"Recent Searches",
@@ -362,14 +375,14 @@ struct BackgroundFileOpener {
                action:NULL
         keyEquivalent:@""];
     item.tag = NSSearchFieldRecentsTitleMenuItemTag;
-    [menu insertItem:item atIndex:4];
+    [menu insertItem:item atIndex:5];
 
     item = [[NSMenuItem alloc]
         initWithTitle:NSLocalizedString(@"Recents", "Menu item title in internal viewer search")
                action:NULL
         keyEquivalent:@""];
     item.tag = NSSearchFieldRecentsMenuItemTag;
-    [menu insertItem:item atIndex:5];
+    [menu insertItem:item atIndex:6];
 
     return menu;
 }
@@ -393,11 +406,30 @@ struct BackgroundFileOpener {
         return;
     }
 
-    if( m_SearchInFile->TextSearchString() == NULL ||
-        [str compare:(__bridge NSString *)m_SearchInFile->TextSearchString()] != NSOrderedSame ||
-        m_SearchInFile->TextSearchEncoding() != m_View.encoding ) {
+    // with the hex bytes option on the request is a byte pattern, e.g. "CAFE BABE", searched for as raw bytes
+    std::shared_ptr<const nc::vfs::SearchInFile::BytePattern> bytes_pattern;
+    if( m_Config->GetBool(g_ConfigSearchForHexBytes) ) {
+        bytes_pattern = nc::vfs::SearchInFile::CompileBytePattern(str.UTF8String);
+        if( !bytes_pattern ) {
+            m_SearchInFileQueue.Stop();
+            m_View.selectionInFile = CFRangeMake(-1, 0);
+            NSBeep();
+            return;
+        }
+    }
+
+    const bool request_changed = [&] {
+        if( bytes_pattern )
+            return m_BytesSearchRequest == nil || ![str isEqualToString:m_BytesSearchRequest];
+        return m_BytesSearchRequest != nil || m_SearchInFile->TextSearchString() == NULL ||
+               [str compare:(__bridge NSString *)m_SearchInFile->TextSearchString()] != NSOrderedSame ||
+               m_SearchInFile->TextSearchEncoding() != m_View.encoding;
+    }();
+
+    if( request_changed ) {
         // user did some changes in search request
         m_View.selectionInFile = CFRangeMake(-1, 0); // remove current selection
+        m_BytesSearchRequest = bytes_pattern ? str : nil;
 
         uint64_t view_offset = m_View.verticalPositionInBytes;
         int encoding = m_View.encoding;
@@ -406,7 +438,10 @@ struct BackgroundFileOpener {
         m_SearchInFileQueue.Wait();
         m_SearchInFileQueue.Run([=] {
             m_SearchInFile->MoveCurrentPosition(view_offset);
-            m_SearchInFile->ToggleTextSearch((__bridge CFStringRef)str, encoding);
+            if( bytes_pattern )
+                m_SearchInFile->ToggleBytesSearch(bytes_pattern);
+            else
+                m_SearchInFile->ToggleTextSearch((__bridge CFStringRef)str, encoding);
         });
     }
     else {
@@ -476,6 +511,16 @@ struct BackgroundFileOpener {
     m_Config->Set(g_ConfigSearchForWholePhrase, bool(options & Options::FindWholePhrase));
 }
 
+- (void)onSearchFieldMenuHexBytesSearch:(id) [[maybe_unused]] _sender
+{
+    const bool hex_bytes = !m_Config->GetBool(g_ConfigSearchForHexBytes);
+    auto cell = static_cast<NSSearchFieldCell *>(m_SearchField.cell);
+    NSMenu *menu = cell.searchMenuTemplate;
+    [menu itemAtIndex:2].state = hex_bytes;
+    cell.searchMenuTemplate = menu;
+    m_Config->Set(g_ConfigSearchForHexBytes, hex_bytes);
+}
+
 - (void)setSearchProgressIndicator:(NSProgressIndicator *)searchProgressIndicator
 {
     dispatch_assert_main_queue();
@@ -650,6 +695,7 @@ struct BackgroundFileOpener {
     m_ViewerFileWindow = std::move(_opener.viewer_file_window);
     m_SearchFileWindow = std::move(_opener.search_file_window);
     m_SearchInFile = std::move(_opener.search_in_file);
+    m_BytesSearchRequest = nil;
 
     m_FileSizeLabel.stringValue = ByteCountFormatter::Instance().ToNSString(
         m_ViewerFileWindow->FileSize(), ByteCountFormatter::Fixed6);
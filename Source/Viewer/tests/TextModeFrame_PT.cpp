@@ -0,0 +1,93 @@
+// Copyright (C) 2024 Michael Kazakov. Subject to GNU General Public License version 3.
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "Tests.h"
+#include "TextModeFrame.h"
+#include "TextModeWorkingSet.h"
+#include "TextProcessing.h"
+#include <Base/algo.h>
+#include <string>
+#include <vector>
+
+// NB! disabled by default, include in the Viewer tests target to enable
+
+using nc::viewer::TextModeFrame;
+using nc::viewer::TextModeWorkingSet;
+#define PREFIX "TextModeFrame PT "
+
+// Something resembling a source code: lines of various lengths, indented with tabs and spaces
+static std::u16string MakeText(size_t _characters)
+{
+    std::u16string text;
+    text.reserve(_characters);
+    for( size_t i = 0; text.size() < _characters; ++i ) {
+        text += i % 3 == 0 ? u"\t" : u"    ";
+        text += u"auto value_" + std::u16string(i % 13, u'x') + u" = Calculate(first_argument, second_argument);";
+        text += std::u16string((i * 37) % 120, u'.');
+        text += u"\x0A";
+    }
+    text.resize(_characters);
+    return text;
+}
+
+static std::shared_ptr<const TextModeWorkingSet> MakeWorkingSet(const std::u16string &_text)
+{
+    std::vector<int> offsets(_text.size());
+    for( size_t i = 0; i < offsets.size(); ++i )
+        offsets[i] = static_cast<int>(i);
+    TextModeWorkingSet::Source source;
+    source.unprocessed_characters = _text.data();
+    source.mapping_to_byte_offsets = offsets.data();
+    source.characters_number = static_cast<int>(_text.size());
+    source.bytes_offset = 0;
+    source.bytes_length = static_cast<int>(_text.size());
+    return std::make_shared<TextModeWorkingSet>(source);
+}
+
+TEST_CASE(PREFIX "Laying out 16MB of text", "[!benchmark]")
+{
+    const auto font = CTFontCreateWithName(CFSTR("Menlo-Regular"), 13., nullptr);
+    const auto release_font = at_scope_end([&] { CFRelease(font); });
+    const auto font_info = nc::utility::FontGeometryInfo{font};
+    const auto text = MakeText(8 * 1024 * 1024); // 16MB of UTF-16
+    const auto working_set = MakeWorkingSet(text);
+
+    for( const double columns : {80., 200., 1000.} ) {
+        const auto suffix = " - " + std::to_string(static_cast<int>(columns)) + " columns";
+        TextModeFrame::Source source;
+        source.working_set = working_set;
+        source.wrapping_width = columns * font_info.PreciseMonospaceWidth();
+        source.font = font;
+        source.font_info = font_info;
+        source.foreground_color = CGColorGetConstantColor(kCGColorBlack);
+
+        BENCHMARK("Splitting into lines" + suffix)
+        {
+            return nc::viewer::SplitStringIntoLines(text.data(),
+                                                    static_cast<int>(text.size()),
+                                                    source.wrapping_width,
+                                                    font_info.PreciseMonospaceWidth(),
+                                                    4 * font_info.PreciseMonospaceWidth())
+                .size();
+        };
+
+        BENCHMARK("Building a frame and laying out the first screen" + suffix)
+        {
+            TextModeFrame frame(source);
+            frame.LayOut(0, 60);
+            return frame.LinesNumber();
+        };
+
+        BENCHMARK("Building a frame and laying out a screen in the middle" + suffix)
+        {
+            TextModeFrame frame(source);
+            frame.LayOut(frame.LinesNumber() / 2, frame.LinesNumber() / 2 + 60);
+            return frame.LinesNumber();
+        };
+
+        BENCHMARK("Building a frame and laying out all lines" + suffix)
+        {
+            TextModeFrame frame(source);
+            return frame.Bounds().width;
+        };
+    }
+}
@@ -1,4 +1,4 @@
-// Copyright (C) 2019 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Tests.h"
 #include "TextModeFrame.h"
 #include "TextModeWorkingSet.h"
@@ -7,6 +7,8 @@
 
 #include <vector>
 #include <numeric>
+#include <atomic>
+#include <string>
 
 using nc::viewer::TextModeFrame;
 using nc::viewer::TextModeWorkingSet;
@@ -71,6 +73,49 @@ TEST_CASE(PREFIX"Properly selects text by words")
     CHECK( frame->WordRangeForPosition({100., 100.}).second == 11 );
 }
 
+TEST_CASE(PREFIX"Lays out lines lazily")
+{
+    const auto font = CTFontCreateWithName(CFSTR("Menlo-Regular"), 13., nullptr);
+    const auto release_font = at_scope_end([&]{ CFRelease(font); });
+    std::u16string str;
+    for( int i = 0; i < 100'000; ++i )
+        str += u"Hello, World!\x0A";
+    const auto working_set = ProduceWorkingSet(str.data(), static_cast<int>(str.size()));
+
+    TextModeFrame::Source source;
+    source.working_set = working_set;
+    source.font = font;
+    source.font_info = nc::utility::FontGeometryInfo{font};
+    source.foreground_color = CGColorGetConstantColor(kCGColorBlack);
+    std::atomic_int notifications = 0;
+    source.on_lines_laid_out = [&]{ ++notifications; };
+    TextModeFrame frame(source);
+
+    // the line breaks are available right away
+    REQUIRE( frame.LinesNumber() == 100'000 );
+    CHECK( frame.Line(50'000).UniCharsStart() == 50'000 * 14 );
+    CHECK( frame.Line(50'000).UniCharsLen() == 14 );
+
+    // the lines which are needed are laid out on demand
+    frame.LayOut(70'000, 70'010);
+    for( int i = 70'000; i < 70'010; ++i ) {
+        CHECK( frame.IsLaidOut(i) );
+        CHECK( frame.Line(i).Line() != nullptr );
+    }
+    CHECK( frame.LineWidth(99'999) > 0. );
+    CHECK( frame.CharIndexForPosition({-50., frame.FontGeometryInfo().LineHeight() * 80'000.5}) == 80'000 * 14 );
+    CHECK( frame.IsLaidOut(-1) == false );
+    CHECK( frame.IsLaidOut(100'000) == false );
+
+    // the bounds require all lines
+    const auto bounds = frame.Bounds();
+    CHECK( bounds.width == frame.LineWidth(0) );
+    CHECK( bounds.height == frame.FontGeometryInfo().LineHeight() * 100'000 );
+    for( int i = 0; i < frame.LinesNumber(); ++i )
+        REQUIRE( frame.IsLaidOut(i) );
+    CHECK( notifications > 0 );
+}
+
 static std::shared_ptr<const TextModeFrame> ProduceFrame
     (std::shared_ptr<const TextModeWorkingSet> _working_set,
      double _wrapping_width,
@@ -1,4 +1,4 @@
-// Copyright (C) 2019-2020 Michael Kazakov. Subject to GNU General Public License version 3.
+// Copyright (C) 2019-2024 Michael Kazakov. Subject to GNU General Public License version 3.
 #include "Tests.h"
 #include "TextProcessing.h"
 #include "TextModeIndexedTextLine.h"
@@ -93,3 +93,32 @@ TEST_CASE("SplitStringIntoLines handles double-sized characters")
     CHECK( lines[2].first == 3 );
     CHECK( lines[2].second == 1 );
 }
+
+TEST_CASE("SplitStringIntoLines splits long strings the same way as short ones")
+{
+    // long enough to be split in parallel chunks, with paragraphs of various lengths, including a very long one
+    std::u16string str;
+    for( int i = 0; i < 20'000; ++i ) {
+        str += std::u16string(i % 150, u'a');
+        str += i % 7 == 0 ? u"\t百\x0D" : u" b\x0A";
+    }
+    str += std::u16string(700'000, u'c');
+    str += u"\x0A" u"tail";
+
+    for( const double wrapping_width : {45., 400., 100000.} ) {
+        const auto lines = SplitStringIntoLines(str.data(), static_cast<int>(str.size()), wrapping_width, 10., 40.);
+
+        // split paragraph by paragraph
+        std::vector<std::pair<int, int>> expected;
+        for( size_t start = 0; start < str.size(); ) {
+            const auto end = std::min(str.find_first_of(u"\x0A\x0D", start), str.size() - 1) + 1;
+            for( auto line : SplitStringIntoLines(
+                     str.data() + start, static_cast<int>(end - start), wrapping_width, 10., 40.) ) {
+                line.first += static_cast<int>(start);
+                expected.emplace_back(line);
+            }
+            start = end;
+        }
+        CHECK( lines == expected );
+    }
+}